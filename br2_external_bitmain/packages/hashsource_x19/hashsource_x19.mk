@@ -45,6 +45,8 @@ define HASHSOURCE_X19_INSTALL_TARGET_CMDS
 		$(TARGET_DIR)/usr/bin/pattern_test
 	$(INSTALL) -D -m 0755 $(@D)/bin/pattern_parser \
 		$(TARGET_DIR)/usr/bin/pattern_parser
+	$(INSTALL) -D -m 0755 $(@D)/bin/bm1398_bench \
+		$(TARGET_DIR)/usr/bin/bm1398_bench
 	$(INSTALL) -D -m 0755 $(@D)/bin/test_fixture_shim.so \
 		$(TARGET_DIR)/root/test_fixture/test_fixture_shim.so
 	if [ -f $(@D)/config/miner.conf ]; then \
@@ -0,0 +1,21 @@
+/*
+ * Nonce stream records read() from /dev/axi_fpga_dev
+ *
+ * Shared by the bitmain_axi kernel module (producer) and user space
+ * (bm1398_nonce_stream_read, bm1398_bench). The module drains the FPGA
+ * nonce FIFO into a kernel ring and hands out whole records only, register
+ * replies included.
+ */
+
+#ifndef BITMAIN_AXI_NONCE_H
+#define BITMAIN_AXI_NONCE_H
+
+#include <linux/types.h>
+
+struct axi_nonce_record {
+    __u32 header;       // REG_RETURN_NONCE: nonce flag, work_id, chain (FIFO_IS_NONCE)
+    __u32 value;        // REG_RETURN_NONCE_VALUE: nonce or register value
+    __u64 ts_ns;        // CLOCK_MONOTONIC when drained from the FPGA
+};
+
+#endif // BITMAIN_AXI_NONCE_H
@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 //==============================================================================
 // FPGA Register Definitions
@@ -23,6 +24,8 @@
 
 // Logical register indices (use with fpga_read_indirect/fpga_write_indirect)
 #define FPGA_REG_CONTROL            0   // Maps to word 0 (0x000)
+#define FPGA_REG_CHAIN_RESET        13  // Maps to word 14 (0x038) - per-chain reset/enable bits
+#define FPGA_REG_BAUD               15  // Maps to word 16 (0x040) - per-chain baud divisors
 #define FPGA_REG_TW_WRITE_CMD_FIRST 16  // Maps to word 16 (0x040) - first word of work
 #define FPGA_REG_TW_WRITE_CMD_REST  17  // Maps to word 16 (0x040) - rest of work (SAME!)
 #define FPGA_REG_SPECIAL_18         18  // Maps to word 33 (0x084) - init register
@@ -38,6 +41,7 @@
 #define REG_HASH_ON_PLUG            (0x008 / 4)
 #define REG_BUFFER_SPACE            (0x00C / 4)
 #define REG_RETURN_NONCE            (0x010 / 4)
+#define REG_RETURN_NONCE_VALUE      (0x014 / 4)
 #define REG_NONCE_NUMBER_IN_FIFO    (0x018 / 4)
 #define REG_NONCE_FIFO_INTERRUPT    (0x01C / 4)
 #define REG_IIC_COMMAND             (0x030 / 4)
@@ -61,6 +65,24 @@
 #define NONCE_INDICATOR             (1U << 7)
 #define NONCE_CHAIN_NUMBER(v)       ((v) & 0xF)
 
+// Return FIFO entries are two words: a header from REG_RETURN_NONCE and the
+// nonce or register value from REG_RETURN_NONCE_VALUE. Layout as decoded by
+// the factory test's receive thread (single_board_test @ 0x1d3bc) and seen in
+// docs/single_board_test_pt2_fpga_dump.log (chip ID reply 0x04000000 /
+// 0x13981800). Chain is header [3:0] for both kinds.
+//   Nonce (NONCE_WORK_ID_OR_CRC set): work_id [30:16] as sent << 3 | midstate
+//     slot; the chip address and core come from the nonce, [23:16] / [31:24].
+//   Register reply (clear): chip address [23:16], register [15:8]; either of
+//     [30:29] set means the reply frame failed its CRC.
+#define FIFO_IS_NONCE(hdr)          (((hdr) & NONCE_WORK_ID_OR_CRC) != 0)
+#define FIFO_CHAIN(hdr)             NONCE_CHAIN_NUMBER(hdr)
+#define FIFO_WORK_ID(hdr)           (((hdr) >> 16) & 0x7FFF)
+#define FIFO_NONCE_CHIP(nonce)      (((nonce) >> 16) & 0xFF)
+#define FIFO_NONCE_CORE(nonce)      ((nonce) >> 24)
+#define FIFO_REPLY_CRC_ERROR        0x60000000
+#define FIFO_REG_CHIP(hdr)          (((hdr) >> 16) & 0xFF)
+#define FIFO_REG_ADDR(hdr)          (((hdr) >> 8) & 0xFF)
+
 //==============================================================================
 // ASIC Register Definitions
 //==============================================================================
@@ -85,6 +107,15 @@
 #define ASIC_REG_VERSION_ROLLING    0xA4
 #define ASIC_REG_SOFT_RESET         0xA8
 
+// Version rolling (0xA4): enable bits | BIP310 version mask >> 13.
+// Reset value is 0x0000FFFF (fpga_buffer_template): mask set, disabled.
+#define VERSION_ROLLING_ENABLE      0x90000000
+#define VERSION_ROLLING_MASK_SHIFT  13
+#define VERSION_ROLLING_MIDSTATES   4
+
+// Returned work_id is (packet work_id << 3) | midstate slot
+#define NONCE_MIDSTATE(work_id)     ((work_id) & 0x3)
+
 // Core configuration values
 #define CORE_CONFIG_BASE            0x80008700
 #define CORE_CONFIG_PULSE_MODE_SHIFT 4
@@ -137,6 +168,157 @@
 // Data Structures
 //==============================================================================
 
+// Work FIFO credit accounting, one per chain. A set REG_BUFFER_SPACE bit is
+// worth credit_grant packets; REG_BUFFER_SPACE is only re-read once they
+// are spent.
+typedef struct {
+    uint32_t credits;                 // Packets that may go out without re-sampling
+    uint32_t credit_grant;            // Credits per ready sample (1 = factory behaviour)
+    uint64_t packets;
+    uint64_t samples;                 // REG_BUFFER_SPACE reads
+    uint64_t stalls;                  // Credits ran out and the FIFO was full
+    uint64_t sleeps;                  // Stalls that outlasted the spin phase
+    uint64_t timeouts;
+    uint64_t backpressure_ns;         // Total time waiting for FIFO space
+    uint64_t max_stall_ns;
+} bm1398_work_flow_t;
+
+// Return FIFO demultiplexer. Every pop of REG_RETURN_NONCE goes through it:
+// register replies complete the matching in-flight read, nonces popped by a
+// register reader are stashed until the next bm1398_read_nonces().
+#define BM1398_REG_SLOTS            16      // Register reads in flight
+#define BM1398_NONCE_STASH          1024    // Nonce entries held for bm1398_read_nonces()
+#define BM1398_ANY_CHIP             -1      // Slot takes the first chip to answer
+
+typedef struct {
+    bool busy;
+    bool done;
+    int chain;
+    int chip_addr;                    // Or BM1398_ANY_CHIP
+    uint8_t reg_addr;
+    uint8_t from_chip;                // Chip that answered
+    uint32_t value;
+} bm1398_reg_slot_t;
+
+// Whole-chain register scan: one register from every chip, replies collected
+// by the demultiplexer as they arrive. Entries are indexed by chip number
+// (address / interval, the enumeration order).
+#define BM1398_SCAN_MAX_CHIPS       256
+#define BM1398_SCAN_TIMEOUT_MS      100     // 114 replies at 115200 baud take ~70ms
+
+typedef struct {
+    int chain;
+    uint8_t reg_addr;
+    int num_chips;
+    int interval;                     // Chip address spacing
+    int responded;
+    int expected;                     // Replies that end the wait early, 0 = num_chips
+    int duplicates;                   // Second replies from a chip, or off-grid addresses
+    uint64_t start_ns;
+    uint64_t elapsed_ns;              // Send to last reply (or timeout)
+    bool present[BM1398_SCAN_MAX_CHIPS];
+    uint32_t value[BM1398_SCAN_MAX_CHIPS];
+} bm1398_chain_scan_t;
+
+typedef struct {
+    pthread_mutex_t lock;             // FIFO pops, slots, stash, scans
+    bm1398_reg_slot_t slots[BM1398_REG_SLOTS];
+    bm1398_chain_scan_t *scans[MAX_CHAINS];   // Scan in progress per chain
+    uint32_t stash[BM1398_NONCE_STASH][2];
+    int stash_count;
+    uint64_t nonces;
+    uint64_t reg_replies;
+    uint64_t unmatched;               // Replies no read was waiting for
+    uint64_t garbled;                 // Replies with FIFO_REPLY_CRC_ERROR
+    uint64_t stash_dropped;
+    bool stream;                      // Kernel nonce stream owns the FIFO pops
+} bm1398_fifo_demux_t;
+
+// PLL0 (ASIC_REG_PLL_PARAM_0), field layout as in other BM13xx drivers:
+//   [30] enable, [28] VCO >= 2400 MHz, [27:16] fbdiv, [13:8] refdiv,
+//   [6:4] postdiv1 - 1, [2:0] postdiv2 - 1
+// VCO = CLKI * fbdiv / refdiv, PLL output = VCO / (postdiv1 * postdiv2).
+// The hashing clock is taken as a quarter of the PLL output. That divider
+// is inferred from the one confirmed setting, 525 MHz = 0x40540100, whose
+// VCO and output are both 2100 MHz.
+#define BM1398_PLL_CLKI_MHZ         25
+#define BM1398_PLL_OUT_DIV          4
+#define BM1398_PLL_VCO_MIN_MHZ      1600
+#define BM1398_PLL_VCO_MAX_MHZ      3200
+#define BM1398_PLL_VCO_HIGH_MHZ     2400
+#define BM1398_PLL_REFDIV_MAX       2
+#define BM1398_PLL_POSTDIV_MAX      7       // postdiv2 <= postdiv1
+#define BM1398_PLL_ENABLE           0x40000000
+#define BM1398_PLL_VCO_HIGH         0x10000000
+
+// bm1398_pll_reg_for() table: standard 5 MHz steps
+#define BM1398_PLL_TABLE_MIN_MHZ    50
+#define BM1398_PLL_TABLE_MAX_MHZ    800
+#define BM1398_PLL_TABLE_STEP_MHZ   5
+#define BM1398_PLL_TABLE_SIZE \
+    ((BM1398_PLL_TABLE_MAX_MHZ - BM1398_PLL_TABLE_MIN_MHZ) / BM1398_PLL_TABLE_STEP_MHZ + 1)
+
+typedef struct {
+    uint8_t refdiv;
+    uint16_t fbdiv;
+    uint8_t postdiv1;
+    uint8_t postdiv2;
+} bm1398_pll_t;
+
+// Frequency ramp: each chip walks from base_mhz to its own target in step_mhz
+// steps, one unicast PLL0 write per chip per step, to the addresses
+// bm1398_enumerate_chips() assigned. After each step the chain's PLL0 is
+// scanned, chips whose reply went missing are asked again, and a chip that
+// stayed silent or did not take the step is written back to its last
+// confirmed frequency and held there.
+#define BM1398_RAMP_BASE_MHZ        400
+#define BM1398_RAMP_STEP_MHZ        25
+#define BM1398_RAMP_SETTLE_MS       10
+#define BM1398_RAMP_RETRIES         3       // Scans a chip may miss before its silence counts
+#define BM1398_PLL_DIV_MASK         0x0FFF3F77      // PLL0 divider fields, compared on readback
+
+#define BM1398_RAMP_ABSENT          0       // No reply at base_mhz in any retry, left alone
+#define BM1398_RAMP_ACTIVE          1       // Still stepping
+#define BM1398_RAMP_DONE            2       // At target
+#define BM1398_RAMP_HELD            3       // Rolled back, answering at freq_mhz
+#define BM1398_RAMP_LOST            4       // Silent even after rollback
+#define BM1398_RAMP_NUM_STATES      5
+
+typedef struct {
+    uint32_t base_mhz;
+    uint32_t step_mhz;
+    uint32_t settle_ms;                       // PLL settle after each step
+    uint32_t target_mhz[BM1398_SCAN_MAX_CHIPS];   // By chip index, 0 = stay at base_mhz
+    // Results
+    uint32_t freq_mhz[BM1398_SCAN_MAX_CHIPS];     // Last frequency the chip confirmed
+    uint8_t state[BM1398_SCAN_MAX_CHIPS];
+    int num_chips;
+    int steps;
+    int writes;                               // Unicast PLL0 writes, rollbacks included
+    int rollbacks;
+    uint64_t elapsed_ns;
+    int result;                               // 0 = ramp ran, -1 = UART/scan failure
+} bm1398_ramp_t;
+
+// ASIC register shadow, per chain and chip address. Every register write
+// sent through bm1398_send_cmd()/bm1398_send_cmd_batch() lands in it, a
+// broadcast in every address, so a read-modify-write needs no UART read.
+// Only registers the driver writes are meaningful: status and counter
+// registers still have to be read from the chips. Like work_flow, a chain's
+// shadow belongs to the thread driving that chain.
+#define BM1398_SHADOW_ADDRS         256
+#define BM1398_SHADOW_REGS          64      // Word-aligned registers 0x00-0xFC
+#define BM1398_SHADOW_BIT(reg)      (1ULL << ((reg) >> 2))
+
+typedef struct {
+    uint32_t value[BM1398_SHADOW_ADDRS][BM1398_SHADOW_REGS];
+    uint64_t valid[BM1398_SHADOW_ADDRS];      // BM1398_SHADOW_BIT per known register
+    uint64_t diverged;                        // Unicast-written since the last broadcast
+    uint64_t hits;                            // Reads answered locally (UART commands saved)
+    uint64_t misses;                          // Reads that went to the chips
+    uint64_t resyncs;
+} bm1398_reg_shadow_t;
+
 typedef struct {
     volatile uint32_t *fpga_regs;     // /dev/axi_fpga_dev mapped region (registers)
     volatile uint8_t *fpga_mem;       // /dev/fpga_mem mapped region (16MB buffer space)
@@ -144,6 +326,12 @@ typedef struct {
     int fd_mem;                       // File descriptor for /dev/fpga_mem
     int num_chains;
     int chips_per_chain[MAX_CHAINS];
+    uint32_t spin_per_us;             // BC_WRITE_COMMAND polls per microsecond (calibrated)
+    pthread_mutex_t lock;             // Shared FPGA resources: BC buffer, return FIFO, work FIFO, reg 13/15
+    bool fixed_delays;                // Init steps ignore predicates, always wait factory delays
+    bm1398_work_flow_t work_flow[MAX_CHAINS];  // Work FIFO credits (single sender per chain)
+    bm1398_fifo_demux_t demux;        // Return FIFO routing (own lock, never held with lock)
+    bm1398_reg_shadow_t *shadow;      // [MAX_CHAINS]; NULL = no shadow, reads go to the chips
     bool initialized;
 } bm1398_context_t;
 
@@ -153,6 +341,7 @@ typedef struct {
     uint8_t chip_id;
     uint8_t core_id;
     uint16_t work_id;
+    uint8_t midstate;           // Midstate slot (version) that found the nonce
 } nonce_response_t;
 
 // Work packet format (148 bytes = 0x94)
@@ -165,17 +354,114 @@ typedef struct __attribute__((packed)) {
     uint8_t midstate[4][32];    // 4x 32-byte SHA256 midstates
 } work_packet_t;
 
+// Work packet as pushed to the work FIFO: 37 words, already byte-swapped
+#define BM1398_WORK_WORDS           37
+#define BM1398_WORK_HEADER_WORD     0   // type, chain | 0x80, 0, 0
+#define BM1398_WORK_ID_WORD         1   // work_id << 3
+#define BM1398_WORK_DATA_WORD       2   // 3 words of block header tail
+#define BM1398_WORK_MIDSTATE_WORD   5   // 4 x 8 words
+
+typedef struct {
+    uint32_t words[BM1398_WORK_WORDS];
+    uint32_t pad[3];                    // 160 bytes: keeps arena packets 16-byte aligned
+} bm1398_work_t;
+
+// Pre-formatted packets for repeated sends (pattern tests, work replay)
+typedef struct {
+    bm1398_work_t *packets;
+    int count;
+} bm1398_work_arena_t;
+
+// /dev/fpga_mem buffer layout (sub_2AB50)
+#define FPGA_MEM_CHAIN_BUFFER       0x14D634    // + 512 * chain: main chain buffer
+#define FPGA_MEM_WORK_BUFFERS       0x14DE4C    // + 0x20000 * chain: work buffer area
+#define FPGA_MEM_WORK_CHAIN_STRIDE  0x20000
+#define FPGA_MEM_WORK_SLOT_SIZE     512
+#define FPGA_MEM_WORK_SLOTS         256
+
+// Prepared UART command: final BIG-ENDIAN BC_COMMAND_BUFFER words (0xC4-0xCC)
+// Build once with bm1398_prepare_*(), send any number of times with
+// bm1398_send_cmd() (three MMIO stores and a trigger).
+typedef struct {
+    uint32_t words[3];
+    uint8_t num_words;
+} bm1398_cmd_t;
+
+// Per-batch result of bm1398_send_cmd_batch()
+typedef struct {
+    int completed;                    // Commands taken by the FPGA
+    uint64_t elapsed_ns;              // First trigger to last completion
+    uint32_t max_polls;               // Worst-case BC_WRITE_COMMAND polls for one command
+} bm1398_batch_stats_t;
+
+// Spacing between address assignments during enumeration. One 5-byte frame
+// at the 115200 power-on baud takes ~434us on the wire; the extra margin
+// lets each chip latch its address before the next frame is relayed.
+#define BM1398_ENUM_GAP_US          500
+
+// Chain bring-up phases (bm1398_init_chains_parallel timing)
+enum {
+    BM1398_PHASE_RESET = 0,           // FPGA reset line sequence
+    BM1398_PHASE_STAGE1,              // First Stage 1 + chain inactive
+    BM1398_PHASE_ENUMERATE,           // Address assignment
+    BM1398_PHASE_BAUD,                // ASIC baud + FPGA enable pulse/divisor
+    BM1398_PHASE_BUFFERS,             // FPGA work buffers
+    BM1398_PHASE_CORE_RESET,          // Software core reset (PLL settle)
+    BM1398_PHASE_FINALIZE,            // Second Stage 1
+    BM1398_NUM_PHASES
+};
+
+// Declarative init steps (bm1398_run_init_steps)
+typedef enum {
+    BM1398_STEP_WRITE_BCAST = 0,      // Broadcast register write (reg, value)
+    BM1398_STEP_CHAIN_INACTIVE,       // 0x53 chain inactive
+    BM1398_STEP_DELAY,                // No command, wait only
+} bm1398_step_op_t;
+
+typedef enum {
+    BM1398_READY_NONE = 0,            // No observable completion: always wait max_us
+    BM1398_READY_FIFO_EMPTY,          // Return FIFO drained (stale entries discarded)
+} bm1398_ready_t;
+
+typedef struct {
+    uint8_t op;                       // bm1398_step_op_t
+    uint8_t ready;                    // bm1398_ready_t
+    uint8_t reg;
+    uint32_t value;
+    uint32_t min_us;                  // Always waited after the command
+    uint32_t max_us;                  // Factory delay, waited if the predicate never holds
+    bool optional;                    // Command failure warns instead of aborting
+    const char *desc;                 // Progress message (NULL = silent)
+} bm1398_init_step_t;
+
+typedef struct {
+    int steps;
+    int early;                        // Predicate held before max_us
+    int timeouts;                     // Predicate never held, waited max_us
+    uint64_t waited_ns;
+    uint64_t worst_case_ns;           // Sum of factory delays
+} bm1398_step_stats_t;
+
+typedef struct {
+    uint64_t phase_ns[BM1398_NUM_PHASES];
+    uint64_t total_ns;
+    int result;                       // 0 = chain up, -1 = failed (phase_ns stops there)
+} bm1398_init_timing_t;
+
 //==============================================================================
 // Function Prototypes
 //==============================================================================
 
 // Initialization and cleanup
 int bm1398_init(bm1398_context_t *ctx);
+void bm1398_init_mapped(bm1398_context_t *ctx, volatile uint32_t *regs,
+                        volatile uint8_t *mem);  // Caller-owned (e.g. simulated) FPGA
 void bm1398_cleanup(bm1398_context_t *ctx);
 
 // FPGA indirect register access (matches bmminer/factory test)
 uint32_t fpga_read_indirect(bm1398_context_t *ctx, int logical_index);
 void fpga_write_indirect(bm1398_context_t *ctx, int logical_index, uint32_t value);
+int fpga_verify_register_accessors(void);
 
 // FPGA operations discovered from PT1 decompilation
 int fpga_toggle_chain_enable(bm1398_context_t *ctx, int chain);
@@ -185,12 +471,29 @@ int bm1398_software_reset_cores(bm1398_context_t *ctx, int chain);
 
 // Low-level UART commands
 uint8_t bm1398_crc5(const uint8_t *data, unsigned int bits);
+uint8_t bm1398_crc5_cmd32(const uint8_t *data);   // 4-byte address commands
+uint8_t bm1398_crc5_cmd64(const uint8_t *data);   // 8-byte register commands
+uint8_t bm1398_crc5_bitwise(const uint8_t *data, unsigned int bits);  // Reference
 int bm1398_send_uart_cmd(bm1398_context_t *ctx, int chain,
                          const uint8_t *cmd, size_t len);
 
+// Prepared commands
+void bm1398_prepare_cmd(bm1398_cmd_t *cmd, const uint8_t *bytes, size_t len);
+void bm1398_prepare_write_register(bm1398_cmd_t *cmd, bool broadcast,
+                                   uint8_t chip_addr, uint8_t reg_addr,
+                                   uint32_t value);
+void bm1398_prepare_read_register(bm1398_cmd_t *cmd, bool broadcast,
+                                  uint8_t chip_addr, uint8_t reg_addr);
+int bm1398_send_cmd(bm1398_context_t *ctx, int chain, const bm1398_cmd_t *cmd);
+int bm1398_send_cmd_batch(bm1398_context_t *ctx, int chain,
+                          const bm1398_cmd_t *cmds, int count,
+                          uint32_t gap_us, bm1398_batch_stats_t *stats);
+void bm1398_calibrate_spin(bm1398_context_t *ctx);
+
 // Chain control
 int bm1398_chain_inactive(bm1398_context_t *ctx, int chain);
 int bm1398_set_chip_address(bm1398_context_t *ctx, int chain, uint8_t addr);
+void bm1398_prepare_set_chip_address(bm1398_cmd_t *cmd, uint8_t addr);
 int bm1398_enumerate_chips(bm1398_context_t *ctx, int chain, int num_chips);
 
 // Hardware reset control (FPGA register 0x034)
@@ -204,10 +507,35 @@ int bm1398_write_register(bm1398_context_t *ctx, int chain, bool broadcast,
 int bm1398_read_register(bm1398_context_t *ctx, int chain, bool broadcast,
                          uint8_t chip_addr, uint8_t reg_addr, uint32_t *value,
                          int timeout_ms);
+// Split read: send now (returns a slot), collect the reply later
+int bm1398_read_register_async(bm1398_context_t *ctx, int chain, bool broadcast,
+                               uint8_t chip_addr, uint8_t reg_addr);
+int bm1398_read_register_wait(bm1398_context_t *ctx, int slot, uint32_t *value,
+                              int timeout_ms);
 int bm1398_read_modify_write_register(bm1398_context_t *ctx, int chain,
                                       uint8_t reg_addr, uint32_t clear_mask,
                                       uint32_t set_mask);
 
+// Register shadow: cached read (chips on a miss), resync from the chips, forget a chain
+int bm1398_read_register_cached(bm1398_context_t *ctx, int chain, uint8_t chip_addr,
+                                uint8_t reg_addr, uint32_t *value);
+int bm1398_shadow_resync(bm1398_context_t *ctx, int chain, uint8_t reg_addr);
+void bm1398_shadow_invalidate(bm1398_context_t *ctx, int chain);
+
+// Whole-chain register scan (one 0x52 broadcast, or a burst of unicast reads)
+int bm1398_scan_chain_begin(bm1398_context_t *ctx, int chain, uint8_t reg_addr,
+                            bool broadcast, bm1398_chain_scan_t *scan);
+int bm1398_scan_chain_wait(bm1398_context_t *ctx, bm1398_chain_scan_t *scan, int timeout_ms);
+int bm1398_scan_chain_register(bm1398_context_t *ctx, int chain, uint8_t reg_addr,
+                               bool broadcast, bm1398_chain_scan_t *scan);
+int bm1398_verify_chain_registers(bm1398_context_t *ctx, int chain);
+
+// Init step engine
+int bm1398_run_init_steps(bm1398_context_t *ctx, int chain,
+                          const bm1398_init_step_t *steps, int count,
+                          bm1398_step_stats_t *stats);
+const bm1398_init_step_t *bm1398_stage1_steps(int *count);
+
 // Chain initialization
 int bm1398_reset_chain_stage1(bm1398_context_t *ctx, int chain);
 int bm1398_configure_chain_stage2(bm1398_context_t *ctx, int chain,
@@ -215,26 +543,79 @@ int bm1398_configure_chain_stage2(bm1398_context_t *ctx, int chain,
 int bm1398_init_chain(bm1398_context_t *ctx, int chain);  // Full init (PT1-style)
 int bm1398_init_chain_pt2_style(bm1398_context_t *ctx, int chain);  // Minimal PT2 init
 int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain);  // Complete PT1 with double Stage 1
+int bm1398_init_chains_parallel(bm1398_context_t *ctx, uint32_t chain_mask,
+                                bm1398_init_timing_t timing[MAX_CHAINS]);
+const char *bm1398_init_phase_name(int phase);
 
 // Baud rate and frequency configuration
 int bm1398_set_baud_rate(bm1398_context_t *ctx, int chain, uint32_t baud_rate);
 int bm1398_set_frequency(bm1398_context_t *ctx, int chain, uint32_t freq_mhz);
 
+// PLL0 solver: closest achievable setting for a hashing clock
+int bm1398_pll_solve(uint32_t freq_mhz, bm1398_pll_t *pll);
+uint32_t bm1398_pll_encode(const bm1398_pll_t *pll);
+int bm1398_pll_decode(uint32_t reg, bm1398_pll_t *pll);
+double bm1398_pll_vco_mhz(const bm1398_pll_t *pll);
+double bm1398_pll_freq_mhz(const bm1398_pll_t *pll);
+uint32_t bm1398_pll_reg_for(uint32_t freq_mhz);     // Table for 5 MHz steps, else solver
+const uint32_t *bm1398_pll_table(int *count);
+
+// Per-chip frequency ramp
+void bm1398_ramp_init(bm1398_ramp_t *ramp, uint32_t target_mhz);
+int bm1398_ramp_chain(bm1398_context_t *ctx, int chain, bm1398_ramp_t *ramp);
+int bm1398_ramp_chains_parallel(bm1398_context_t *ctx, uint32_t chain_mask,
+                                bm1398_ramp_t ramps[MAX_CHAINS]);
+
 // Work submission
 int bm1398_enable_work_send(bm1398_context_t *ctx);
 int bm1398_start_work_gen(bm1398_context_t *ctx);
 int bm1398_check_work_fifo_ready(bm1398_context_t *ctx, int chain);
+int bm1398_set_work_credit_grant(bm1398_context_t *ctx, int chain, uint32_t grant);
+void bm1398_get_work_flow_stats(bm1398_context_t *ctx, int chain, bm1398_work_flow_t *stats);
+void bm1398_reset_work_flow_stats(bm1398_context_t *ctx, int chain);
+void bm1398_print_work_flow_stats(bm1398_context_t *ctx);
 int bm1398_set_ticket_mask(bm1398_context_t *ctx, int chain, uint32_t mask);
+int bm1398_set_version_rolling(bm1398_context_t *ctx, int chain, uint32_t version_mask);
 int bm1398_send_work(bm1398_context_t *ctx, int chain, uint32_t work_id,
                     const uint8_t *work_data_12bytes,
                     const uint8_t midstates[4][32]);
 
+// Prepared work packets: format once, patch id/chain, push as-is
+void bm1398_prepare_work(bm1398_work_t *work, int chain, uint32_t work_id,
+                         const uint8_t *work_data_12bytes,
+                         const uint8_t *midstates, int num_midstates);
+int bm1398_send_prepared_work(bm1398_context_t *ctx, int chain, const bm1398_work_t *work);
+int bm1398_work_arena_init(bm1398_work_arena_t *arena, int count);
+void bm1398_work_arena_free(bm1398_work_arena_t *arena);
+
+// Retarget a prepared packet: only the header and work_id words change
+static inline void bm1398_work_set_id(bm1398_work_t *work, int chain, uint32_t work_id) {
+    // Header bytes 01 (chain|80) 00 00, read little-endian then swapped
+    work->words[BM1398_WORK_HEADER_WORD] = 0x01000000u | ((uint32_t)((chain & 0xFF) | 0x80) << 16);
+    work->words[BM1398_WORK_ID_WORD] = __builtin_bswap32(work_id << 3);
+}
+
 // Nonce collection
 int bm1398_get_nonce_count(bm1398_context_t *ctx);
 int bm1398_read_nonce(bm1398_context_t *ctx, nonce_response_t *nonce);
 int bm1398_read_nonces(bm1398_context_t *ctx, nonce_response_t *nonces,
                       int max_count);
 
+// Route already-popped FIFO entries (e.g. from a capture); returns nonces stored
+int bm1398_demux_fifo_entries(bm1398_context_t *ctx, const uint32_t (*entries)[2],
+                              int count, nonce_response_t *nonces);
+// Kernel stream armed: register reads stop popping the FIFO and wait for
+// bm1398_nonce_stream_read() to route their replies
+void bm1398_demux_use_stream(bm1398_context_t *ctx, bool on);
+void bm1398_print_fifo_demux_stats(bm1398_context_t *ctx);
+
+// Kernel nonce stream (read() on /dev/axi_fpga_dev, see bitmain_axi_nonce.h).
+// Needs the rebuilt bitmain_axi module; the stock driver is mmap-only.
+// Register replies in the stream go to ctx's demultiplexer (dropped if NULL).
+int bm1398_nonce_stream_open(void);
+int bm1398_nonce_stream_read(bm1398_context_t *ctx, int fd, nonce_response_t *nonces,
+                             uint64_t *ts_ns, int max_count, int timeout_ms);
+
 // Utility functions
 uint32_t bm1398_detect_chains(bm1398_context_t *ctx);
 int bm1398_get_crc_error_count(bm1398_context_t *ctx);
@@ -245,4 +626,65 @@ int bm1398_psu_power_on(bm1398_context_t *ctx, uint32_t voltage_mv);
 int bm1398_psu_set_voltage(bm1398_context_t *ctx, uint32_t voltage_mv);
 int bm1398_enable_dc_dc(bm1398_context_t *ctx, int chain);
 
+//==============================================================================
+// Named FPGA Register Accessors
+//==============================================================================
+
+// X(NAME, name, logical index, word offset)
+// Word offset is fpga_register_map[logical index], resolved here at compile
+// time; fpga_verify_register_accessors() checks the two agree at init.
+#define FPGA_INDIRECT_REGISTERS(X) \
+    X(CONTROL,           control,           FPGA_REG_CONTROL,             0) \
+    X(CHAIN_RESET,       chain_reset,       FPGA_REG_CHAIN_RESET,        14) \
+    X(BAUD,              baud,              FPGA_REG_BAUD,               16) \
+    X(TW_WRITE_CMD,      tw_write_cmd,      FPGA_REG_TW_WRITE_CMD_FIRST, 16) \
+    X(SPECIAL_18,        special_18,        FPGA_REG_SPECIAL_18,         33) \
+    X(TIMEOUT,           timeout,           FPGA_REG_TIMEOUT,            35) \
+    X(WORK_CTRL_ENABLE,  work_ctrl_enable,  FPGA_REG_WORK_CTRL_ENABLE,   70) \
+    X(CHAIN_WORK_CONFIG, chain_work_config, FPGA_REG_CHAIN_WORK_CONFIG,  71) \
+    X(WORK_QUEUE_PARAM,  work_queue_param,  FPGA_REG_WORK_QUEUE_PARAM,   80)
+
+enum {
+#define X(NAME, name, index, word) FPGA_WORD_##NAME = (word),
+    FPGA_INDIRECT_REGISTERS(X)
+#undef X
+};
+
+// Build with -DFPGA_REG_CHECKED to validate context and offset on every access
+#ifdef FPGA_REG_CHECKED
+int fpga_reg_checked(const bm1398_context_t *ctx, int logical_index, int word,
+                     const char *name);
+#define FPGA_REG_WORD(ctx, index, word, name) fpga_reg_checked((ctx), (index), (word), (name))
+#else
+#define FPGA_REG_WORD(ctx, index, word, name) (word)
+#endif
+
+// fpga_read_<name>(ctx) / fpga_write_<name>(ctx, value)
+#define X(NAME, name, index, word) \
+static inline uint32_t fpga_read_##name(const bm1398_context_t *ctx) { \
+    return ctx->fpga_regs[FPGA_REG_WORD(ctx, index, word, #name)]; \
+} \
+static inline void fpga_write_##name(bm1398_context_t *ctx, uint32_t value) { \
+    ctx->fpga_regs[FPGA_REG_WORD(ctx, index, word, #name)] = value; \
+    __sync_synchronize();  /* Force write to hardware (not cached) */ \
+}
+FPGA_INDIRECT_REGISTERS(X)
+#undef X
+
+/**
+ * Push words into the work FIFO (0x040). The mapping is uncached device
+ * memory, so stores to the FIFO stay in order; one barrier at the end
+ * replaces the per-word barrier of fpga_write_indirect().
+ */
+static inline void fpga_push_tw_write_cmd(bm1398_context_t *ctx, const uint32_t *words,
+                                          int count) {
+    volatile uint32_t *fifo = &ctx->fpga_regs[FPGA_REG_WORD(ctx, FPGA_REG_TW_WRITE_CMD_FIRST,
+                                                            FPGA_WORD_TW_WRITE_CMD,
+                                                            "tw_write_cmd")];
+    for (int i = 0; i < count; i++) {
+        *fifo = words[i];
+    }
+    __sync_synchronize();
+}
+
 #endif // BM1398_ASIC_H
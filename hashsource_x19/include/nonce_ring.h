@@ -0,0 +1,101 @@
+/*
+ * Nonce Ring - FPGA nonce FIFO fan-out for BM1398 chains
+ *
+ * One reader thread drains the FPGA nonce FIFO in bulk and publishes each
+ * nonce to the lane of the chain that found it. Every lane is a lock-free
+ * single-producer ring with up to NONCE_RING_MAX_CONSUMERS independent read
+ * cursors, so e.g. a validation thread and an accounting thread both see
+ * every nonce of a chain without sharing a lock or a cache line.
+ *
+ * The producer never waits: a nonce that does not fit in its lane (slowest
+ * consumer too far behind) is dropped and counted, just as the FPGA FIFO
+ * would overflow if it were not drained.
+ */
+
+#ifndef NONCE_RING_H
+#define NONCE_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "bm1398_asic.h"
+
+#define NONCE_RING_MAX_CONSUMERS    4
+#define NONCE_RING_DEFAULT_SLOTS    4096    // Per chain, power of 2
+#define NONCE_RING_DRAIN_BATCH      256     // Nonces per FIFO drain pass
+#define NONCE_RING_IDLE_US          100     // Reader sleep when the FIFO is empty
+
+#define NONCE_RING_CACHELINE        64
+
+// Cursor on its own cache line so producer and consumers never false-share
+typedef struct {
+    _Atomic uint64_t pos;
+    uint8_t pad[NONCE_RING_CACHELINE - sizeof(uint64_t)];
+} __attribute__((aligned(NONCE_RING_CACHELINE))) nonce_ring_cursor_t;
+
+typedef struct {
+    nonce_ring_cursor_t head;                               // Written by producer
+    nonce_ring_cursor_t tail[NONCE_RING_MAX_CONSUMERS];     // One per consumer
+    nonce_response_t *slots;
+    uint32_t mask;
+    int num_consumers;
+
+    // Producer-private
+    uint64_t min_tail;          // Cached slowest consumer position
+    uint64_t published;
+    uint64_t dropped;
+    uint32_t high_water;        // Peak occupancy seen by the producer
+} nonce_lane_t;
+
+typedef struct {
+    nonce_lane_t lanes[MAX_CHAINS];
+    uint32_t slots_per_lane;
+
+    // Reader thread
+    bm1398_context_t *ctx;
+    int stream_fd;              // Kernel nonce stream, or -1 for MMIO drain
+    pthread_t thread;
+    volatile bool running;
+    uint64_t drained;           // Nonces taken from the FPGA
+    uint64_t drain_passes;      // Non-empty drain passes
+    uint64_t bad_chain;         // Nonces with chain_id >= MAX_CHAINS
+    uint64_t start_ns;
+} nonce_ring_t;
+
+typedef struct {
+    uint64_t drained;
+    uint64_t drain_passes;
+    uint64_t bad_chain;
+    double drain_rate;          // Nonces/s since nonce_ring_start()
+    uint64_t published[MAX_CHAINS];
+    uint64_t dropped[MAX_CHAINS];
+    uint32_t occupancy[MAX_CHAINS];     // Slowest consumer's backlog now
+    uint32_t high_water[MAX_CHAINS];
+} nonce_ring_stats_t;
+
+// Setup (slots_per_lane rounded up to a power of 2, 0 = default)
+int nonce_ring_init(nonce_ring_t *ring, uint32_t slots_per_lane);
+void nonce_ring_destroy(nonce_ring_t *ring);
+
+// Register a consumer on a chain before starting; returns consumer id
+int nonce_ring_add_consumer(nonce_ring_t *ring, int chain);
+
+// Reader thread: drains ctx's FIFO, or stream_fd if >= 0 (bm1398_nonce_stream_open);
+// in stream mode register replies from the stream go to ctx's demux
+int nonce_ring_start(nonce_ring_t *ring, bm1398_context_t *ctx, int stream_fd);
+void nonce_ring_stop(nonce_ring_t *ring);
+
+// Producer side (reader thread, or a synthetic source when not started)
+int nonce_ring_publish(nonce_ring_t *ring, const nonce_response_t *nonces, int count);
+uint32_t nonce_ring_free(nonce_ring_t *ring, int chain);
+
+// Consumer side; returns number of nonces copied (0 = lane empty)
+int nonce_ring_consume(nonce_ring_t *ring, int chain, int consumer,
+                       nonce_response_t *out, int max_count);
+
+// Statistics
+void nonce_ring_get_stats(nonce_ring_t *ring, nonce_ring_stats_t *stats);
+void nonce_ring_print_stats(nonce_ring_t *ring);
+
+#endif // NONCE_RING_H
@@ -0,0 +1,74 @@
+/*
+ * Pattern File - zero-copy access to btc-asic-XXX.bin test patterns
+ *
+ * Each pattern file is mmap'd read-only and the active patterns are used in
+ * place: pattern i of core c lives at c * ROW_SIZE + ACTIVE_START + i * 116.
+ * Nothing is copied; only the pages holding active patterns are ever
+ * faulted in. Layout as documented in pattern_parser.c.
+ */
+
+#ifndef PATTERN_FILE_H
+#define PATTERN_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Pattern file structure (see pattern_parser.c)
+#define PATTERN_ENTRY_SIZE          0x74    // 116 bytes on disk
+#define PATTERN_FILE_CORES          80
+#define PATTERN_FILE_SLOTS_PER_CORE 62
+#define PATTERN_FILE_ACTIVE         8       // Active patterns at the end of each row
+#define PATTERN_FILE_ROW_SIZE       7238    // Bytes per core row
+#define PATTERN_FILE_ACTIVE_START   6310    // Row offset of the first active pattern
+#define PATTERN_FILE_SIZE           579072
+
+// Pattern entry (116 bytes on disk)
+typedef struct __attribute__((packed)) {
+    uint8_t  header[15];     // Offset 0x00-0x0E: Header/metadata
+    uint8_t  work_data[12];  // Offset 0x0F-0x1A: Last 12 bytes of block header
+    uint8_t  midstate[32];   // Offset 0x1B-0x3A: SHA256 midstate
+    uint8_t  reserved[29];   // Offset 0x3B-0x57: Padding/reserved
+    uint32_t nonce;          // Offset 0x58-0x5B: Expected nonce (little-endian)
+    uint8_t  trailer[24];    // Offset 0x5C-0x73: Additional data
+} test_pattern_t;
+
+// Mapped pattern files for one or more ASICs
+typedef struct {
+    const uint8_t **files;   // One mapping per ASIC
+    size_t *sizes;
+    int num_asics;
+    int num_cores;
+    int patterns_per_core;   // Active patterns used (<= PATTERN_FILE_ACTIVE)
+} pattern_set_t;
+
+// Map btc-asic-%03d.bin for asic_ids[0..num_asics-1] (NULL = 0..num_asics-1)
+int pattern_set_open(pattern_set_t *set, const char *dir, const int *asic_ids,
+                     int num_asics, int num_cores, int patterns_per_core);
+void pattern_set_close(pattern_set_t *set);
+
+// Fault in all active patterns ahead of time (optional)
+void pattern_set_prefetch(const pattern_set_t *set);
+
+// Resident memory of this process in KB: anonymous, and file-backed via file_kb
+long pattern_rss_kb(long *file_kb);
+
+static inline int pattern_set_count(const pattern_set_t *set) {
+    return set->num_asics * set->num_cores * set->patterns_per_core;
+}
+
+/**
+ * Pattern by global index: asic-major, then core, then pattern.
+ * Entries are packed and unaligned; read fields through the struct.
+ */
+static inline const test_pattern_t *pattern_set_get(const pattern_set_t *set, int idx) {
+    int per_asic = set->num_cores * set->patterns_per_core;
+    int asic = idx / per_asic;
+    int core = (idx % per_asic) / set->patterns_per_core;
+    int pat = idx % set->patterns_per_core;
+
+    return (const test_pattern_t *)(set->files[asic] + (size_t)core * PATTERN_FILE_ROW_SIZE +
+                                    PATTERN_FILE_ACTIVE_START +
+                                    (size_t)pat * PATTERN_ENTRY_SIZE);
+}
+
+#endif // PATTERN_FILE_H
@@ -0,0 +1,41 @@
+/*
+ * Pattern Index - O(1) expected-nonce lookup for pattern verification
+ *
+ * Open-addressing (linear probing) hash of expected (nonce, work_id) pairs,
+ * built once after the pattern files are loaded. Lookup follows the PT2
+ * matching rule used by pattern_test: a returned nonce matches the first
+ * loaded pattern with the same nonce whose work_id equals the returned
+ * work_id, or any such pattern if the returned work_id is 0.
+ */
+
+#ifndef PATTERN_INDEX_H
+#define PATTERN_INDEX_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t nonce;
+    uint16_t work_id;       // Expected work_id as returned by the FPGA
+    uint16_t reserved;
+    int32_t value;          // Caller's pattern index, -1 = empty slot
+} pattern_index_entry_t;
+
+typedef struct {
+    pattern_index_entry_t *slots;
+    uint32_t mask;
+    uint32_t shift;         // 32 - log2(capacity)
+    int count;
+    int max_probe;          // Longest probe sequence seen while inserting
+} pattern_index_t;
+
+// Capacity is rounded up to a power of 2 at least twice expected_count
+int pattern_index_init(pattern_index_t *index, int expected_count);
+void pattern_index_free(pattern_index_t *index);
+
+// Insert in pattern order; duplicates are kept (first one wins on lookup)
+int pattern_index_add(pattern_index_t *index, uint32_t nonce, uint16_t work_id, int value);
+
+// Returns the stored value, or -1 if no pattern matches
+int pattern_index_lookup(const pattern_index_t *index, uint32_t nonce, uint16_t work_id);
+
+#endif // PATTERN_INDEX_H
@@ -0,0 +1,69 @@
+/*
+ * SHA-256 for work construction (coinbase, merkle root, header midstate)
+ * and nonce verification
+ *
+ * The *4 / nonce functions run four independent messages side by side, one
+ * per 32-bit vector lane (NEON on the Zynq, generic GCC vectors elsewhere).
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SHA256_LANES    4
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;            // Bytes hashed so far
+    uint8_t block[64];
+    size_t block_len;
+} sha256_ctx_t;
+
+void sha256_init(sha256_ctx_t *ctx);
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len);
+void sha256_final(sha256_ctx_t *ctx, uint8_t digest[32]);
+
+// One compression round over a 64-byte block
+void sha256_transform(uint32_t state[8], const uint8_t block[64]);
+
+void sha256(const void *data, size_t len, uint8_t digest[32]);
+void sha256d(const void *data, size_t len, uint8_t digest[32]);
+
+// sha256d of exactly 64 bytes (a merkle node pair) with fixed padding blocks
+void sha256d_64(const uint8_t data[64], uint8_t digest[32]);
+
+/**
+ * Midstate of an 80-byte block header: state after its first 64 bytes,
+ * serialized big-endian per word (the digest byte order)
+ */
+void sha256_midstate(const uint8_t header[64], uint8_t midstate[32]);
+
+// Four compressions at once: state[lane] advanced over blocks[lane]
+void sha256_transform4(uint32_t state[SHA256_LANES][8], const uint8_t *const blocks[SHA256_LANES]);
+
+// sha256_midstate() of four headers (e.g. four rolled versions)
+void sha256_midstate4(const uint8_t *const headers[SHA256_LANES],
+                      uint8_t midstates[SHA256_LANES][32]);
+
+/**
+ * Block hashes of one 80-byte header under count nonces (nonce at bytes
+ * 76..79, little-endian). The first block is compressed once; the rest
+ * runs four nonces per pass.
+ */
+void sha256d_nonces(const uint8_t header[80], const uint32_t *nonces, int count,
+                    uint8_t (*hashes)[32]);
+
+// Leading zero bits of a block hash read as a little-endian 256-bit number
+int sha256_hash_zero_bits(const uint8_t hash[32]);
+
+/**
+ * Verify returned nonces: valid[i] = hash has at least min_zero_bits
+ * leading zeros (32 for any nonce a chip may return). Returns valid count.
+ */
+int sha256d_check_nonces(const uint8_t header[80], const uint32_t *nonces, int count,
+                         int min_zero_bits, bool *valid);
+
+#endif // SHA256_H
@@ -0,0 +1,218 @@
+/*
+ * Stratum v1 Client - asynchronous pool connection for hashsource_miner
+ *
+ * One thread runs a non-blocking socket under epoll: it connects, sends
+ * mining.subscribe / mining.extranonce.subscribe / mining.authorize, and
+ * turns mining.notify into a stratum_job_t snapshot. Consumers never touch
+ * the socket: they pick up the latest job (stratum_wait_job) and build
+ * work from it on their own thread, and queue shares with stratum_submit,
+ * which only appends to the send buffer and wakes the client thread.
+ *
+ * Version rolling (BIP310): when a mask is requested, mining.configure goes
+ * out ahead of subscribe. With a negotiated mask each work carries four
+ * midstates for four rolled versions (stratum_template_work) and a
+ * share reports the version bits of the midstate that found it.
+ *
+ * Timing: every job records when its notify arrived; the work builder calls
+ * stratum_note_first_work() when the first work from that job is ready, so
+ * notify-to-work latency is measured end to end. Submit round trips are
+ * timed from queueing to the pool's response.
+ */
+
+#ifndef STRATUM_H
+#define STRATUM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "sha256.h"
+
+#define STRATUM_JOB_ID_LEN          64
+#define STRATUM_MAX_COINBASE        1024    // Bytes per coinbase part
+#define STRATUM_MAX_MERKLE          32
+#define STRATUM_MAX_EXTRANONCE      16
+#define STRATUM_RX_BUF              65536
+#define STRATUM_TX_BUF              65536
+#define STRATUM_MAX_PENDING         256     // Requests awaiting a response
+#define STRATUM_RECONNECT_MIN_MS    1000
+#define STRATUM_RECONNECT_MAX_MS    30000
+#define STRATUM_RESPONSE_TIMEOUT_MS 30000
+#define STRATUM_VERSION_MASK        0x1FFFE000  // BIP320 general purpose bits
+#define STRATUM_MIDSTATES           SHA256_LANES    // One sha256_midstate4() call
+
+typedef enum {
+    STRATUM_DISCONNECTED = 0,
+    STRATUM_CONNECTING,
+    STRATUM_SUBSCRIBING,
+    STRATUM_AUTHORIZING,
+    STRATUM_READY
+} stratum_state_t;
+
+// Everything needed to build work for one mining.notify
+typedef struct {
+    char job_id[STRATUM_JOB_ID_LEN];
+    uint8_t prevhash[32];                   // Header byte order
+    uint8_t coinb1[STRATUM_MAX_COINBASE];
+    size_t coinb1_len;
+    uint8_t coinb2[STRATUM_MAX_COINBASE];
+    size_t coinb2_len;
+    uint8_t merkle[STRATUM_MAX_MERKLE][32];
+    int num_merkle;
+    uint32_t version;
+    uint32_t nbits;
+    uint32_t ntime;
+    bool clean;
+    uint32_t version_mask;                  // Negotiated BIP310 mask, 0 = no rolling
+
+    // Session state when the job arrived
+    uint8_t extranonce1[STRATUM_MAX_EXTRANONCE];
+    int extranonce1_len;
+    int extranonce2_size;
+    double difficulty;
+
+    uint32_t seq;                           // Increments with every notify
+    uint64_t received_ns;                   // CLOCK_MONOTONIC at notify
+} stratum_job_t;
+
+typedef struct {
+    uint64_t connects;
+    uint64_t disconnects;
+    uint64_t notifies;
+    uint64_t clean_jobs;
+
+    // Notify -> first work ready
+    uint64_t first_work;
+    uint64_t first_work_ns_total;
+    uint64_t first_work_ns_min;
+    uint64_t first_work_ns_max;
+
+    // Share submits
+    uint64_t submits;
+    uint64_t accepted;
+    uint64_t rejected;
+    uint64_t timeouts;
+    uint64_t rtt_ns_total;
+    uint64_t rtt_ns_min;
+    uint64_t rtt_ns_max;
+} stratum_stats_t;
+
+typedef struct {
+    uint32_t id;
+    int kind;
+    uint64_t sent_ns;
+} stratum_pending_t;
+
+typedef struct {
+    char host[128];
+    char port[16];
+    char user[128];
+    char pass[64];
+    char agent[32];
+    uint32_t version_mask_request;          // 0: don't send mining.configure
+
+    // Client thread
+    int fd;
+    int epfd;
+    int wake_fd;                            // eventfd: submitters kick the loop
+    pthread_t thread;
+    volatile bool running;
+    stratum_state_t state;
+    uint64_t reconnect_at_ns;
+    int reconnect_ms;
+    char rx[STRATUM_RX_BUF];
+    size_t rx_len;
+    bool want_write;
+
+    // Shared with consumers (lock)
+    pthread_mutex_t lock;
+    pthread_cond_t job_cond;
+    char tx[STRATUM_TX_BUF];
+    size_t tx_len;
+    uint32_t next_id;
+    stratum_pending_t pending[STRATUM_MAX_PENDING];
+    int num_pending;
+    uint8_t extranonce1[STRATUM_MAX_EXTRANONCE];
+    int extranonce1_len;
+    int extranonce2_size;
+    double difficulty;
+    uint32_t version_mask;
+    stratum_job_t job;
+    bool has_job;
+    stratum_stats_t stats;
+} stratum_client_t;
+
+int stratum_init(stratum_client_t *c, const char *url, const char *user, const char *pass);
+int stratum_start(stratum_client_t *c);
+// Ask for version rolling within mask on every (re)connect; call before start
+void stratum_set_version_rolling(stratum_client_t *c, uint32_t mask);
+void stratum_stop(stratum_client_t *c);
+
+/**
+ * Copy the current job if it is newer than *seq (updates *seq)
+ * Waits up to timeout_us for a new one; returns true if job was filled.
+ */
+bool stratum_wait_job(stratum_client_t *c, stratum_job_t *job, uint32_t *seq, int timeout_us);
+
+/**
+ * Queue mining.submit; never blocks on the network. Returns -1 if not ready.
+ * version is the rolled header version of the share; its mask bits are
+ * sent as version_bits while version rolling is negotiated.
+ */
+int stratum_submit(stratum_client_t *c, const char *job_id, const uint8_t *extranonce2,
+                   int extranonce2_len, uint32_t ntime, uint32_t nonce, uint32_t version);
+
+void stratum_note_first_work(stratum_client_t *c, const stratum_job_t *job);
+void stratum_get_stats(stratum_client_t *c, stratum_stats_t *stats);
+void stratum_print_stats(stratum_client_t *c);
+const char *stratum_state_name(stratum_state_t state);
+
+/**
+ * Block header for a job and extranonce2 (nonce field left 0)
+ * Coinbase = coinb1 | extranonce1 | extranonce2 | coinb2
+ */
+void stratum_build_header(const stratum_job_t *job, const uint8_t *extranonce2,
+                          uint8_t header[80]);
+
+// Work for bm1398_prepare_work(): header bytes 64..75 and midstate of 0..63
+void stratum_header_to_work(const uint8_t header[80], uint8_t work_data[12],
+                            uint8_t midstate[32]);
+
+/**
+ * Work template for one job: the coinbase SHA-256 state up to the last
+ * whole block before extranonce2, and the remaining coinbase bytes laid
+ * out as padded blocks. A new extranonce2 then costs the tail blocks, one
+ * compression for the second hash and three per merkle branch level.
+ * The job must outlive the template.
+ */
+#define STRATUM_TAIL_BUF    (STRATUM_MAX_COINBASE + 256)
+
+typedef struct {
+    const stratum_job_t *job;
+    uint32_t prefix_state[8];
+    uint8_t tail[STRATUM_TAIL_BUF];
+    int tail_len;                           // Multiple of 64
+    int extranonce2_offset;                 // Where extranonce2 goes in tail
+    int midstates;                          // 4 with a usable version mask, else 1
+    uint8_t extranonce2[STRATUM_MAX_EXTRANONCE];
+    uint8_t header[80];                     // Merkle root of the current extranonce2
+} stratum_template_t;
+
+int stratum_template_init(stratum_template_t *t, const stratum_job_t *job);
+
+// New coinbase and merkle root in t->header
+void stratum_template_set_extranonce2(stratum_template_t *t, const uint8_t *extranonce2);
+
+/**
+ * Four-midstate work for the current extranonce2: versions roll * 4 + 0..3
+ * spread over the job's mask bits (low bits first). versions[i] is the
+ * header version hashed by midstate slot i.
+ *
+ * Returns midstates filled: 4, 1 if the job has fewer than 2 mask bits
+ * (rolling off), -1 once roll has used up the mask.
+ */
+int stratum_template_work(const stratum_template_t *t, uint32_t roll,
+                          uint8_t work_data[12], uint8_t midstates[STRATUM_MIDSTATES][32],
+                          uint32_t versions[STRATUM_MIDSTATES]);
+
+#endif // STRATUM_H
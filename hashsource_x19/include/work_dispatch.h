@@ -0,0 +1,108 @@
+/*
+ * Work Dispatch - per-chain work submission threads for BM1398 chains
+ *
+ * Producers (pool client, test generators) submit prepared work into a
+ * shared pool. Each chain has a submission thread with its own work-stealing
+ * deque: it refills a small batch from the pool, sends from the bottom of
+ * its deque, and when both are empty steals from the top of the busiest
+ * other chain. A chain stuck in work FIFO backpressure therefore only holds
+ * the one packet it is sending; the rest of its batch is taken by chains
+ * that have room.
+ *
+ * Work is chain-agnostic until it is sent: the sending thread patches its
+ * chain and a per-chain work_id into the packet and reports both through
+ * the done callback, which also returns ownership of the item.
+ */
+
+#ifndef WORK_DISPATCH_H
+#define WORK_DISPATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "bm1398_asic.h"
+
+#define WORK_DISPATCH_POOL_SLOTS    1024    // Shared pool capacity, power of 2
+#define WORK_DISPATCH_DEQUE_SLOTS   64      // Per-chain deque capacity, power of 2
+#define WORK_DISPATCH_REFILL        8       // Works taken from the pool per refill
+#define WORK_DISPATCH_IDLE_US       1000    // Wait for new work when everything is empty
+#define WORK_DISPATCH_ID_MASK       0xFFFF  // work_id wraps like nonce_response_t.work_id
+
+#define WORK_DISPATCH_CACHELINE     64
+
+typedef struct {
+    bm1398_work_t packet;       // Prepared packet; chain and work_id set at send
+    uint32_t job_id;            // Caller's tag (e.g. pool job)
+    void *user;
+} dispatch_work_t;
+
+// Called from the sending thread once a work has left the dispatcher.
+// chain < 0: not sent (flushed, stopped or send error).
+typedef void (*dispatch_done_fn)(void *arg, dispatch_work_t *work, int chain, uint32_t work_id);
+
+// Chase-Lev deque: the owner pushes/pops at bottom, thieves take from top
+typedef struct {
+    _Atomic int64_t top;
+    uint8_t pad0[WORK_DISPATCH_CACHELINE - sizeof(int64_t)];
+    _Atomic int64_t bottom;
+    uint8_t pad1[WORK_DISPATCH_CACHELINE - sizeof(int64_t)];
+    _Atomic(dispatch_work_t *) slots[WORK_DISPATCH_DEQUE_SLOTS];
+} __attribute__((aligned(WORK_DISPATCH_CACHELINE))) work_deque_t;
+
+struct work_dispatch;
+
+typedef struct {
+    work_deque_t deque;
+    struct work_dispatch *d;
+    int chain;
+    bool active;
+    pthread_t thread;
+    uint32_t next_work_id;
+
+    // Written by the chain thread only
+    uint64_t sent;
+    uint64_t send_errors;
+    uint64_t refills;
+    uint64_t stolen;            // Works this chain took from other chains
+    uint64_t idle_waits;
+
+    // Reporter state
+    uint64_t last_sent;
+    uint64_t last_report_ns;
+} dispatch_chain_t;
+
+typedef struct work_dispatch {
+    dispatch_chain_t chains[MAX_CHAINS];
+    bm1398_context_t *ctx;
+    dispatch_done_fn done;
+    void *done_arg;
+    volatile bool running;
+
+    // Shared pool (MPMC, mutex protected; touched once per refill batch)
+    pthread_mutex_t pool_lock;
+    pthread_cond_t pool_cond;
+    dispatch_work_t *pool[WORK_DISPATCH_POOL_SLOTS];
+    uint32_t pool_head;
+    uint32_t pool_tail;
+    uint64_t submitted;
+    uint64_t pool_full;
+} work_dispatch_t;
+
+int work_dispatch_init(work_dispatch_t *d, bm1398_context_t *ctx, uint32_t chain_mask,
+                       dispatch_done_fn done, void *done_arg);
+int work_dispatch_start(work_dispatch_t *d);
+void work_dispatch_stop(work_dispatch_t *d);
+void work_dispatch_destroy(work_dispatch_t *d);
+
+// Queue one work; -1 if the pool is full (caller keeps ownership)
+int work_dispatch_submit(work_dispatch_t *d, dispatch_work_t *work);
+int work_dispatch_pool_depth(work_dispatch_t *d);
+
+// Drop all queued work (new block): every item goes to done with chain -1
+int work_dispatch_flush(work_dispatch_t *d);
+
+int work_dispatch_queue_depth(const dispatch_chain_t *c);
+void work_dispatch_print_stats(work_dispatch_t *d);
+
+#endif // WORK_DISPATCH_H
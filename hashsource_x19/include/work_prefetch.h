@@ -0,0 +1,96 @@
+/*
+ * Work Prefetch - background work generation for the dispatcher
+ *
+ * One thread owns the current pool job and keeps the dispatcher's shared
+ * pool topped up to a fixed number of ready works per active chain, so
+ * chain threads never wait on SHA-256. Works are built from a
+ * stratum_template_t: a new extranonce2 costs the coinbase tail and the
+ * merkle branch, and each extranonce2 is stretched over every version roll
+ * the mask allows before moving on. Without a pool the thread generates
+ * random local work instead.
+ *
+ * The thread also owns work items: the dispatcher's done callback
+ * (work_prefetch_done) returns them to a free list, and records each sent
+ * pool work in the work table so its nonces can be turned into shares.
+ */
+
+#ifndef WORK_PREFETCH_H
+#define WORK_PREFETCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "bm1398_asic.h"
+#include "work_dispatch.h"
+#include "stratum.h"
+#include "work_table.h"
+
+#define WORK_PREFETCH_PER_CHAIN     64      // Default ready works per chain
+#define WORK_PREFETCH_POLL_US       200     // Job wait while the pool is full
+
+// Enough items for a full pool plus every chain's deque and in-flight packet
+#define WORK_PREFETCH_ITEMS (WORK_DISPATCH_POOL_SLOTS + MAX_CHAINS * (WORK_DISPATCH_DEQUE_SLOTS + 1))
+
+// Nominal S19 Pro hashrate, for the CPU share projection in the stats
+#define WORK_PREFETCH_FULL_HASHRATE_GHS     110000.0
+
+typedef struct {
+    uint64_t generated;
+    uint64_t jobs;
+    uint64_t extranonce2s;          // Coinbase/merkle rebuilds
+    uint64_t flushed;               // Works dropped by clean jobs
+    uint64_t rejected;              // Works the dispatcher pool refused
+    uint64_t starved;               // Top-ups that found the dispatcher pool empty
+    uint64_t build_ns;              // Thread CPU time spent building works
+} work_prefetch_stats_t;
+
+typedef struct {
+    bm1398_context_t *ctx;
+    work_dispatch_t *dispatch;
+    stratum_client_t *pool;         // NULL: local random work
+    work_table_t *table;            // Sent pool works, or NULL
+    uint32_t chain_mask;
+    int target;                     // Ready works kept in the dispatcher pool
+
+    // Work items (lock)
+    dispatch_work_t *items;
+    work_info_t *info;
+    dispatch_work_t **free;
+    int num_free;
+    pthread_mutex_t lock;
+
+    pthread_t thread;
+    volatile bool running;
+
+    // Generator thread state
+    stratum_job_t job;
+    stratum_template_t tpl;
+    uint32_t job_seq;
+    bool have_job;
+    bool first_work;
+    uint64_t extranonce2;
+    uint32_t roll;
+    uint32_t asic_version_mask;
+    uint32_t generation;
+    uint64_t seed;
+
+    work_prefetch_stats_t stats;
+
+    // Rate reporting
+    uint64_t last_generated;
+    uint64_t last_cpu_ns;
+    uint64_t last_report_ns;
+} work_prefetch_t;
+
+int work_prefetch_init(work_prefetch_t *p, bm1398_context_t *ctx, stratum_client_t *pool,
+                       work_table_t *table, uint32_t chain_mask, int per_chain);
+int work_prefetch_start(work_prefetch_t *p, work_dispatch_t *dispatch);
+void work_prefetch_stop(work_prefetch_t *p);
+void work_prefetch_destroy(work_prefetch_t *p);
+
+// dispatch_done_fn for work_dispatch_init(..., work_prefetch_done, p)
+void work_prefetch_done(void *arg, dispatch_work_t *work, int chain, uint32_t work_id);
+
+void work_prefetch_print_stats(work_prefetch_t *p);
+
+#endif // WORK_PREFETCH_H
@@ -0,0 +1,101 @@
+/*
+ * Work Table - in-flight work per chain, indexed by returned work_id
+ *
+ * A nonce's FIFO header carries the packet's work_id field as the FPGA
+ * sends it, (work_id << 3) | midstate slot. The table keys on five bits of
+ * the dispatcher's work_id, so each chain gets a fixed ring of
+ * WORK_TABLE_SLOTS entries and a nonce resolves to its work with one
+ * shift and mask: no search and no allocation.
+ *
+ * Entries are written by the chain's sending thread as each packet leaves
+ * (work_dispatch done callback) and read by the nonce consumer. Each entry
+ * is a cache-aligned seqlock, so a lookup racing with reuse of the slot
+ * retries instead of reading a half-written work.
+ *
+ * Clean jobs bump the table generation. Works record the generation they
+ * were built under, and a nonce for an older generation resolves as stale
+ * rather than becoming a share the pool would reject.
+ */
+
+#ifndef WORK_TABLE_H
+#define WORK_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "bm1398_asic.h"
+#include "stratum.h"
+
+#define WORK_TABLE_ID_SHIFT     3       // Packet work_id << 3; low bits are the midstate slot
+#define WORK_TABLE_ID_BITS      5       // work_id bits used as the slot
+#define WORK_TABLE_SLOTS        (1 << WORK_TABLE_ID_BITS)
+#define WORK_TABLE_CACHELINE    64
+
+// Table slot of a sent work_id / of a returned nonce's work_id byte
+#define WORK_TABLE_SLOT(work_id)        ((work_id) & (WORK_TABLE_SLOTS - 1))
+#define WORK_TABLE_NONCE_SLOT(work_id)  WORK_TABLE_SLOT((work_id) >> WORK_TABLE_ID_SHIFT)
+
+typedef enum {
+    WORK_TABLE_HIT = 0,
+    WORK_TABLE_STALE,           // Built before the last clean job
+    WORK_TABLE_EMPTY,           // Nothing sent in this slot yet
+    WORK_TABLE_BAD_CHAIN
+} work_table_result_t;
+
+// What a work was built from: enough to check a nonce and submit the share
+typedef struct {
+    char job_id[STRATUM_JOB_ID_LEN];
+    uint32_t job_seq;
+    uint32_t generation;
+    uint8_t header[80];                     // Nonce 0, version of slot 0
+    uint32_t versions[STRATUM_MIDSTATES];   // By NONCE_MIDSTATE() of a returned nonce
+    int midstates;
+    uint8_t extranonce2[STRATUM_MAX_EXTRANONCE];
+    int extranonce2_len;
+    double difficulty;                      // Pool share difficulty for the job
+} work_info_t;
+
+typedef struct {
+    _Atomic uint32_t seq;       // Odd while the sending thread rewrites the entry
+    uint32_t work_id;           // Full dispatcher work_id
+    work_info_t info;
+} __attribute__((aligned(WORK_TABLE_CACHELINE))) work_table_entry_t;
+
+typedef struct {
+    // Lookup side (one nonce consumer)
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t stale;
+    uint64_t empty;
+    uint64_t retries;           // Lookups that raced a rewrite of their slot
+} work_table_stats_t;
+
+typedef struct {
+    work_table_entry_t entries[MAX_CHAINS][WORK_TABLE_SLOTS];
+    _Atomic uint32_t generation;
+    uint64_t recorded[MAX_CHAINS];          // Written by each chain's sending thread
+    work_table_stats_t stats[MAX_CHAINS];
+} work_table_t;
+
+void work_table_init(work_table_t *t);
+
+// Clean job: everything recorded so far becomes stale; returns the new generation
+uint32_t work_table_new_generation(work_table_t *t);
+
+static inline uint32_t work_table_generation(work_table_t *t) {
+    return atomic_load_explicit(&t->generation, memory_order_acquire);
+}
+
+// Sending thread of chain: work_id has just been sent with info
+void work_table_record(work_table_t *t, int chain, uint32_t work_id, const work_info_t *info);
+
+/**
+ * Resolve a nonce to the work it was found on. On WORK_TABLE_HIT and
+ * WORK_TABLE_STALE, *info is a consistent copy of the entry.
+ */
+work_table_result_t work_table_lookup(work_table_t *t, const nonce_response_t *nonce,
+                                      work_info_t *info);
+
+void work_table_print_stats(work_table_t *t);
+
+#endif // WORK_TABLE_H
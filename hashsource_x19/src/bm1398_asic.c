@@ -15,9 +15,16 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <poll.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 #include "../include/bm1398_asic.h"
+#include "../include/bitmain_axi_nonce.h"
 
 //==============================================================================
 // Linux I2C Constants
@@ -32,23 +39,144 @@
 //==============================================================================
 
 /**
- * Calculate CRC5 for BM13xx UART commands
- * Polynomial: Custom 5-bit CRC
+ * Reference bitwise CRC5 for BM13xx UART commands
+ * Polynomial: x^5 + x^2 + 1 (0x05), MSB first
  * Initial value: 0x1F
  *
  * Source: Bitmain single_board_test.c line 28769
+ *
+ * Verified against every BC_COMMAND_BUFFER frame in
+ * docs/single_board_test_pt2_fpga_dump.log (e.g. 52 05 00 00 -> 0x0A,
+ * 51 09 00 18 00 00 BA 01 -> 0x14). The data bit only feeds back; it is not
+ * shifted into the register (an earlier version did, and disagreed with the
+ * dump on every frame).
+ *
+ * Kept as the golden model for the table engine below (see bm1398_bench crc5).
  */
-uint8_t bm1398_crc5(const uint8_t *data, unsigned int bits) {
+uint8_t bm1398_crc5_bitwise(const uint8_t *data, unsigned int bits) {
     uint8_t crc = 0x1F;  // Initial value
 
     for (unsigned int i = 0; i < bits; i++) {
         uint8_t bit = (data[i / 8] >> (7 - (i % 8))) & 1;
-        if ((crc & 0x10) != (bit << 4)) {
-            crc = ((crc << 1) | bit) ^ 0x05;
-        } else {
-            crc = (crc << 1) | bit;
-        }
-        crc &= 0x1F;
+        uint8_t feedback = ((crc >> 4) ^ bit) & 1;
+        crc = ((crc << 1) ^ (feedback ? 0x05 : 0x00)) & 0x1F;
+    }
+
+    return crc;
+}
+
+/*
+ * Byte-wise CRC5 tables
+ *
+ * The bit recurrence above only uses shifts and XORs, so it is linear over
+ * GF(2): feeding one byte v into state c gives step(c, 0) ^ step(0, v).
+ * That splits a byte step into two independent lookups:
+ *
+ *   crc = crc5_state_table[crc] ^ crc5_data_table[byte]
+ *
+ * Both tables are built by the preprocessor from the bit recurrence, so there
+ * are no magic numbers to keep in sync with the reference routine.
+ */
+#define CRC5_BIT(c, b) \
+    ((((c) << 1) ^ (((((c) >> 4) ^ (b)) & 1) ? 0x05 : 0x00)) & 0x1F)
+
+#define CRC5_BYTE(c, v)                                                       \
+    CRC5_BIT(CRC5_BIT(CRC5_BIT(CRC5_BIT(CRC5_BIT(CRC5_BIT(CRC5_BIT(CRC5_BIT(  \
+        (c), ((v) >> 7) & 1), ((v) >> 6) & 1), ((v) >> 5) & 1),              \
+        ((v) >> 4) & 1), ((v) >> 3) & 1), ((v) >> 2) & 1), ((v) >> 1) & 1),  \
+        (v) & 1)
+
+// Basis vectors: image of each single state bit / data bit after one byte
+enum {
+    CRC5_S0 = CRC5_BYTE(0x01, 0), CRC5_S1 = CRC5_BYTE(0x02, 0),
+    CRC5_S2 = CRC5_BYTE(0x04, 0), CRC5_S3 = CRC5_BYTE(0x08, 0),
+    CRC5_S4 = CRC5_BYTE(0x10, 0),
+    CRC5_D0 = CRC5_BYTE(0, 0x01), CRC5_D1 = CRC5_BYTE(0, 0x02),
+    CRC5_D2 = CRC5_BYTE(0, 0x04), CRC5_D3 = CRC5_BYTE(0, 0x08),
+    CRC5_D4 = CRC5_BYTE(0, 0x10), CRC5_D5 = CRC5_BYTE(0, 0x20),
+    CRC5_D6 = CRC5_BYTE(0, 0x40), CRC5_D7 = CRC5_BYTE(0, 0x80),
+};
+
+#define CRC5_S(c)                                                  \
+    (((c) & 0x01 ? CRC5_S0 : 0) ^ ((c) & 0x02 ? CRC5_S1 : 0) ^     \
+     ((c) & 0x04 ? CRC5_S2 : 0) ^ ((c) & 0x08 ? CRC5_S3 : 0) ^     \
+     ((c) & 0x10 ? CRC5_S4 : 0))
+#define CRC5_D(v)                                                  \
+    (((v) & 0x01 ? CRC5_D0 : 0) ^ ((v) & 0x02 ? CRC5_D1 : 0) ^     \
+     ((v) & 0x04 ? CRC5_D2 : 0) ^ ((v) & 0x08 ? CRC5_D3 : 0) ^     \
+     ((v) & 0x10 ? CRC5_D4 : 0) ^ ((v) & 0x20 ? CRC5_D5 : 0) ^     \
+     ((v) & 0x40 ? CRC5_D6 : 0) ^ ((v) & 0x80 ? CRC5_D7 : 0))
+
+#define CRC5_X4(f, n)  f(n), f((n) + 1), f((n) + 2), f((n) + 3)
+#define CRC5_X16(f, n) CRC5_X4(f, n), CRC5_X4(f, (n) + 4), \
+                       CRC5_X4(f, (n) + 8), CRC5_X4(f, (n) + 12)
+#define CRC5_X64(f, n) CRC5_X16(f, n), CRC5_X16(f, (n) + 16), \
+                       CRC5_X16(f, (n) + 32), CRC5_X16(f, (n) + 48)
+
+static const uint8_t crc5_state_table[32] = {
+    CRC5_X16(CRC5_S, 0), CRC5_X16(CRC5_S, 16)
+};
+
+static const uint8_t crc5_data_table[256] = {
+    CRC5_X64(CRC5_D, 0), CRC5_X64(CRC5_D, 64),
+    CRC5_X64(CRC5_D, 128), CRC5_X64(CRC5_D, 192)
+};
+
+#define CRC5_STEP(crc, byte) (crc5_state_table[(crc)] ^ crc5_data_table[(byte)])
+
+/**
+ * CRC5 fast path for 32-bit commands (chain inactive, set address)
+ */
+uint8_t bm1398_crc5_cmd32(const uint8_t *data) {
+    uint8_t crc = 0x1F;
+    crc = CRC5_STEP(crc, data[0]);
+    crc = CRC5_STEP(crc, data[1]);
+    crc = CRC5_STEP(crc, data[2]);
+    crc = CRC5_STEP(crc, data[3]);
+    return crc;
+}
+
+/**
+ * CRC5 fast path for 64-bit commands (register read/write)
+ */
+uint8_t bm1398_crc5_cmd64(const uint8_t *data) {
+    uint8_t crc = 0x1F;
+    crc = CRC5_STEP(crc, data[0]);
+    crc = CRC5_STEP(crc, data[1]);
+    crc = CRC5_STEP(crc, data[2]);
+    crc = CRC5_STEP(crc, data[3]);
+    crc = CRC5_STEP(crc, data[4]);
+    crc = CRC5_STEP(crc, data[5]);
+    crc = CRC5_STEP(crc, data[6]);
+    crc = CRC5_STEP(crc, data[7]);
+    return crc;
+}
+
+/**
+ * Calculate CRC5 for BM13xx UART commands
+ *
+ * Bit-exact with bm1398_crc5_bitwise(). Whole bytes go through the tables,
+ * a trailing partial byte (never used by the BM1398 protocol) falls back to
+ * the bit recurrence.
+ */
+uint8_t bm1398_crc5(const uint8_t *data, unsigned int bits) {
+    if (bits == 64) {
+        return bm1398_crc5_cmd64(data);
+    }
+    if (bits == 32) {
+        return bm1398_crc5_cmd32(data);
+    }
+
+    uint8_t crc = 0x1F;
+    unsigned int bytes = bits / 8;
+
+    for (unsigned int i = 0; i < bytes; i++) {
+        crc = CRC5_STEP(crc, data[i]);
+    }
+
+    for (unsigned int i = bytes * 8; i < bits; i++) {
+        uint8_t bit = (data[i / 8] >> (7 - (i % 8))) & 1;
+        crc = CRC5_BIT(crc, bit);
     }
 
     return crc;
@@ -119,6 +247,49 @@ void fpga_write_indirect(bm1398_context_t *ctx, int logical_index, uint32_t valu
     __sync_synchronize();  // Force write to hardware (not cached)
 }
 
+/**
+ * Check the named accessors (FPGA_INDIRECT_REGISTERS) against the map
+ *
+ * Returns number of mismatching entries (0 = OK)
+ */
+int fpga_verify_register_accessors(void) {
+    int errors = 0;
+
+#define X(NAME, name, index, word) \
+    if ((index) < 0 || (index) >= FPGA_REGISTER_MAP_SIZE || \
+        fpga_register_map[(index)] != (word)) { \
+        fprintf(stderr, "Error: fpga_" #name " uses word %d, map has %d for index %d\n", \
+                (word), (index) < FPGA_REGISTER_MAP_SIZE ? (int)fpga_register_map[(index)] : -1, \
+                (index)); \
+        errors++; \
+    }
+    FPGA_INDIRECT_REGISTERS(X)
+#undef X
+
+    return errors;
+}
+
+#ifdef FPGA_REG_CHECKED
+/**
+ * Checked variant behind the named accessors: same validation as
+ * fpga_read_indirect() plus the descriptor/map cross-check, fatal on error
+ */
+int fpga_reg_checked(const bm1398_context_t *ctx, int logical_index, int word,
+                     const char *name) {
+    if (!ctx || !ctx->fpga_regs) {
+        fprintf(stderr, "Error: Invalid context in fpga_%s\n", name);
+        abort();
+    }
+    if (logical_index < 0 || logical_index >= FPGA_REGISTER_MAP_SIZE ||
+        (int)fpga_register_map[logical_index] != word) {
+        fprintf(stderr, "Error: fpga_%s word %d does not match logical index %d\n",
+                name, word, logical_index);
+        abort();
+    }
+    return word;
+}
+#endif
+
 /**
  * Toggle chain enable bit in FPGA register 13 (SET → CLEAR pulse)
  *
@@ -136,19 +307,24 @@ int fpga_toggle_chain_enable(bm1398_context_t *ctx, int chain) {
         return -1;
     }
 
-    // Read current value of register 13
-    uint32_t reg13_value = fpga_read_indirect(ctx, 13);
-    printf("  FPGA reg 13 before: 0x%08X\n", reg13_value);
+    // Register 13 is shared by all chains: each read-modify-write is locked,
+    // the 500ms holds are not
+    uint32_t chain_bit = (1U << chain);
 
     // SET bit for chain (sub_22BA4)
-    uint32_t chain_bit = (1U << chain);
-    fpga_write_indirect(ctx, 13, reg13_value | chain_bit);
+    pthread_mutex_lock(&ctx->lock);
+    uint32_t reg13_value = fpga_read_chain_reset(ctx);
+    fpga_write_chain_reset(ctx, reg13_value | chain_bit);
+    pthread_mutex_unlock(&ctx->lock);
+    printf("  FPGA reg 13 before: 0x%08X\n", reg13_value);
     printf("  FPGA reg 13 SET bit %d: 0x%08X\n", chain, reg13_value | chain_bit);
     usleep(500000);  // 500ms delay (0x7A120)
 
     // CLEAR bit for chain (sub_22BD0)
-    reg13_value = fpga_read_indirect(ctx, 13);  // Re-read current value
-    fpga_write_indirect(ctx, 13, reg13_value & ~chain_bit);
+    pthread_mutex_lock(&ctx->lock);
+    reg13_value = fpga_read_chain_reset(ctx);  // Re-read current value
+    fpga_write_chain_reset(ctx, reg13_value & ~chain_bit);
+    pthread_mutex_unlock(&ctx->lock);
     printf("  FPGA reg 13 CLEAR bit %d: 0x%08X\n", chain, reg13_value & ~chain_bit);
     usleep(500000);  // 500ms delay
 
@@ -172,9 +348,9 @@ int fpga_set_chain_baud_divisor(bm1398_context_t *ctx, int chain, uint8_t diviso
         return -1;
     }
 
-    // Read current value of register 15
-    uint32_t reg15_value = fpga_read_indirect(ctx, 15);
-    printf("  FPGA reg 15 before: 0x%08X\n", reg15_value);
+    // Read current value of register 15 (shared by all chains)
+    pthread_mutex_lock(&ctx->lock);
+    uint32_t reg15_value = fpga_read_baud(ctx);
 
     // Mask and set the 6-bit divisor value for the appropriate chain
     uint32_t masked_divisor = divisor & 0x3F;  // 6 bits
@@ -194,10 +370,13 @@ int fpga_set_chain_baud_divisor(bm1398_context_t *ctx, int chain, uint8_t diviso
             new_value = (reg15_value & 0xC0FFFFFF) | (masked_divisor << 24);
             break;
         default:
+            pthread_mutex_unlock(&ctx->lock);
             return -1;
     }
 
-    fpga_write_indirect(ctx, 15, new_value);
+    fpga_write_baud(ctx, new_value);
+    pthread_mutex_unlock(&ctx->lock);
+    printf("  FPGA reg 15 before: 0x%08X\n", reg15_value);
     printf("  FPGA reg 15 after (chain %d, divisor %d): 0x%08X\n", chain, divisor, new_value);
 
     return 0;
@@ -270,9 +449,10 @@ int fpga_init_chain_buffers(bm1398_context_t *ctx, int chain) {
     // Work queue buffers: fpga_mem + 0x14DE4C + 0x20000 * chain_id (256 x 512-byte buffers)
 
     // Calculate buffer addresses
-    uint8_t *main_buffer = (uint8_t *)(ctx->fpga_mem + 0x14D634 + 512 * chain);
-    uint8_t *work_buffers_start = (uint8_t *)(ctx->fpga_mem + 0x14DE4C + 0x20000 * chain);
-    uint8_t *work_buffers_end = (uint8_t *)(ctx->fpga_mem + 0x16DE4C + 0x20000 * chain);
+    uint8_t *main_buffer = (uint8_t *)(ctx->fpga_mem + FPGA_MEM_CHAIN_BUFFER + 512 * chain);
+    uint8_t *work_buffers_start = (uint8_t *)(ctx->fpga_mem + FPGA_MEM_WORK_BUFFERS +
+                                              FPGA_MEM_WORK_CHAIN_STRIDE * chain);
+    uint8_t *work_buffers_end = work_buffers_start + FPGA_MEM_WORK_SLOTS * FPGA_MEM_WORK_SLOT_SIZE;
 
     // Copy template to work queue buffers (256 copies)
     uint8_t *ptr = work_buffers_start;
@@ -330,7 +510,7 @@ int bm1398_software_reset_cores(bm1398_context_t *ctx, int chain) {
     // Step 3: CLK_CTRL - set BYTE2 bit 6, clear HIBYTE bits 4-7
     printf("    CLK_CTRL: set byte2 bit 6, clear hibyte...\n");
     uint32_t clk_val;
-    if (bm1398_read_register(ctx, chain, false, 0, ASIC_REG_CLK_CTRL, &clk_val, 100) < 0) {
+    if (bm1398_read_register_cached(ctx, chain, 0, ASIC_REG_CLK_CTRL, &clk_val) < 0) {
         fprintf(stderr, "Error: Failed to read CLK_CTRL\n");
         return -1;
     }
@@ -386,6 +566,57 @@ int bm1398_software_reset_cores(bm1398_context_t *ctx, int chain) {
 // Initialization and Cleanup
 //==============================================================================
 
+/**
+ * Context setup shared by bm1398_init() and bm1398_init_mapped()
+ *
+ * The lock is recursive so a locked sequence (e.g. register read: send +
+ * FIFO response) can reuse the locked single-command send path.
+ */
+static void context_init_common(bm1398_context_t *ctx) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&ctx->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_init(&ctx->demux.lock, NULL);
+
+    ctx->shadow = calloc(MAX_CHAINS, sizeof(*ctx->shadow));
+    if (!ctx->shadow) {
+        fprintf(stderr, "Warning: No memory for register shadow, reads go to the chips\n");
+    }
+
+    ctx->initialized = true;
+    ctx->num_chains = 0;
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        ctx->work_flow[i].credit_grant = 1;
+    }
+
+    if (fpga_verify_register_accessors() != 0) {
+        fprintf(stderr, "Error: FPGA register accessors disagree with register map\n");
+    }
+
+    // Calibrate BC_COMMAND_BUFFER completion polling
+    bm1398_calibrate_spin(ctx);
+}
+
+/**
+ * Initialize a context over already-mapped FPGA regions
+ *
+ * No device is opened and no FPGA init sequence is run. Used by tools that
+ * run the driver against a simulated register file (bm1398_bench). The
+ * caller keeps ownership of regs/mem; bm1398_cleanup() will not unmap them.
+ */
+void bm1398_init_mapped(bm1398_context_t *ctx, volatile uint32_t *regs,
+                        volatile uint8_t *mem) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->fpga_regs = regs;
+    ctx->fpga_mem = mem;
+    ctx->fd_regs = -1;
+    ctx->fd_mem = -1;
+
+    context_init_common(ctx);
+}
+
 int bm1398_init(bm1398_context_t *ctx) {
     if (!ctx) {
         return -1;
@@ -436,8 +667,8 @@ int bm1398_init(bm1398_context_t *ctx) {
     printf("  /dev/axi_fpga_dev: %p (0x%X bytes)\n", (void *)ctx->fpga_regs, FPGA_REG_SIZE);
     printf("  /dev/fpga_mem:     %p (0x%X bytes)\n", (void *)ctx->fpga_mem, FPGA_MEM_SIZE);
 
-    ctx->initialized = true;
-    ctx->num_chains = 0;
+    context_init_common(ctx);
+    printf("  BC poll calibration: %u polls/us\n", ctx->spin_per_us);
 
     // Read and verify FPGA boot state
     // Source: FPGA dump analysis - register 0x080 should toggle during init, then stay at 0x00808000
@@ -481,18 +712,18 @@ int bm1398_init(bm1398_context_t *ctx) {
     // FPGA Register 0: Set bit 30 (0x40000000)
     // Source: bmminer FUN_00045b34, factory test FUN_00022cf0
     // Both binaries do: read register 0, OR with 0x40000000, write back
-    uint32_t reg0 = fpga_read_indirect(ctx, FPGA_REG_CONTROL);
+    uint32_t reg0 = fpga_read_control(ctx);
     printf("  Register 0 before: 0x%08X\n", reg0);
-    fpga_write_indirect(ctx, FPGA_REG_CONTROL, reg0 | 0x40000000);
-    printf("  Register 0 after:  0x%08X\n", fpga_read_indirect(ctx, FPGA_REG_CONTROL));
+    fpga_write_control(ctx, reg0 | 0x40000000);
+    printf("  Register 0 after:  0x%08X\n", fpga_read_control(ctx));
 
     // FPGA Timeout Register (logical index 20 → physical byte offset 0x08C)
     // NOTE: Will be reconfigured after frequency is set during chain initialization
     // For now, set to a safe default (max timeout)
     uint32_t timeout_init = 0x0001FFFF | 0x80000000;  // Max 17-bit timeout + enable bit
-    fpga_write_indirect(ctx, FPGA_REG_TIMEOUT, timeout_init);
+    fpga_write_timeout(ctx, timeout_init);
     printf("  Timeout register init (0x08C): 0x%08X (will be recalculated per chain)\n",
-           fpga_read_indirect(ctx, FPGA_REG_TIMEOUT));
+           fpga_read_timeout(ctx));
 
     // Additional FPGA registers from factory test (may be needed for pattern testing)
     // NOTE: Production bmminer does NOT initialize these (per binary analysis)
@@ -501,25 +732,24 @@ int bm1398_init(bm1398_context_t *ctx) {
     // Register 35 (0x118): Work control/enable
     // Factory test: fpga_write(35, reg35_val & 0xFFFF709F | 0x8060 | flags)
     // We'll use a simple read-modify-write with 0x8060
-    uint32_t reg35 = fpga_read_indirect(ctx, FPGA_REG_WORK_CTRL_ENABLE);
-    fpga_write_indirect(ctx, FPGA_REG_WORK_CTRL_ENABLE,
-                       (reg35 & 0xFFFF709F) | 0x8060);
+    uint32_t reg35 = fpga_read_work_ctrl_enable(ctx);
+    fpga_write_work_ctrl_enable(ctx, (reg35 & 0xFFFF709F) | 0x8060);
     printf("  Work control register (0x118): 0x%08X\n",
-           fpga_read_indirect(ctx, FPGA_REG_WORK_CTRL_ENABLE));
+           fpga_read_work_ctrl_enable(ctx));
 
     // Register 36 (0x11C): Chain/work configuration
     // Factory test uses complex calculation based on config values
     // Using basic default: (114 chips << 8) = 0x7200
-    fpga_write_indirect(ctx, FPGA_REG_CHAIN_WORK_CONFIG, 0x00007200);
+    fpga_write_chain_work_config(ctx, 0x00007200);
     printf("  Chain work config register (0x11C): 0x%08X\n",
-           fpga_read_indirect(ctx, FPGA_REG_CHAIN_WORK_CONFIG));
+           fpga_read_chain_work_config(ctx));
 
     // Register 42 (0x140): Work queue parameter
     // Factory test uses: (value + 32 * config[20])
     // Using basic default based on 114 chips
-    fpga_write_indirect(ctx, FPGA_REG_WORK_QUEUE_PARAM, 0x00003648);
+    fpga_write_work_queue_param(ctx, 0x00003648);
     printf("  Work queue param register (0x140): 0x%08X\n",
-           fpga_read_indirect(ctx, FPGA_REG_WORK_QUEUE_PARAM));
+           fpga_read_work_queue_param(ctx));
 
     // Direct register initialization (non-mapped registers)
     // Match Bitmain's PT2 FPGA boot state EXACTLY
@@ -578,17 +808,17 @@ int bm1398_init(bm1398_context_t *ctx) {
 void bm1398_cleanup(bm1398_context_t *ctx) {
     if (!ctx) return;
 
-    // Unmap FPGA buffer memory
-    if (ctx->fpga_mem && ctx->fpga_mem != MAP_FAILED) {
+    // Unmap FPGA buffer memory (only if we mapped it)
+    if (ctx->fd_mem >= 0 && ctx->fpga_mem && ctx->fpga_mem != MAP_FAILED) {
         munmap((void *)ctx->fpga_mem, 0x1000000);
-        ctx->fpga_mem = NULL;
     }
+    ctx->fpga_mem = NULL;
 
-    // Unmap FPGA registers
-    if (ctx->fpga_regs && ctx->fpga_regs != MAP_FAILED) {
+    // Unmap FPGA registers (only if we mapped them)
+    if (ctx->fd_regs >= 0 && ctx->fpga_regs && ctx->fpga_regs != MAP_FAILED) {
         munmap((void *)ctx->fpga_regs, FPGA_REG_SIZE);
-        ctx->fpga_regs = NULL;
     }
+    ctx->fpga_regs = NULL;
 
     // Close file descriptors
     if (ctx->fd_mem >= 0) {
@@ -600,6 +830,12 @@ void bm1398_cleanup(bm1398_context_t *ctx) {
         ctx->fd_regs = -1;
     }
 
+    if (ctx->initialized) {
+        pthread_mutex_destroy(&ctx->demux.lock);
+        pthread_mutex_destroy(&ctx->lock);
+    }
+    free(ctx->shadow);
+    ctx->shadow = NULL;
     ctx->initialized = false;
 }
 
@@ -607,44 +843,219 @@ void bm1398_cleanup(bm1398_context_t *ctx) {
 // Low-level UART Communication
 //==============================================================================
 
+// BC_COMMAND_BUFFER completion timeout (10ms, same budget as the old
+// 10000 x usleep(1) loop assumed)
+#define BC_TIMEOUT_US           10000
+
+// Busy-poll window before yielding the CPU while waiting for the FPGA
+#define BC_SPIN_US              50
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void cpu_relax(void) {
+#if defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#elif defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
 /**
- * Send UART command to ASIC chain via FPGA BC_COMMAND_BUFFER
+ * Calibrate BC_WRITE_COMMAND polls per microsecond
+ *
+ * usleep(1) rounds up to a scheduler tick (60-100us on the stock kernel),
+ * so command completion is polled with a spin instead. Uncached AXI reads
+ * are the dominant cost of each poll, so calibrate against the real
+ * register rather than a CPU loop.
+ */
+void bm1398_calibrate_spin(bm1398_context_t *ctx) {
+    const int polls = 4096;
+    volatile uint32_t *regs = ctx->fpga_regs;
+    uint32_t sink = 0;
+
+    uint64_t t0 = monotonic_ns();
+    for (int i = 0; i < polls; i++) {
+        sink |= regs[REG_BC_WRITE_COMMAND];
+        cpu_relax();
+    }
+    uint64_t elapsed = monotonic_ns() - t0;
+    (void)sink;
+
+    uint64_t per_us = elapsed ? (uint64_t)polls * 1000 / elapsed : polls;
+    ctx->spin_per_us = per_us ? (uint32_t)per_us : 1;
+}
+
+/**
+ * Wait until BC_COMMAND_BUFFER_READY clears
+ *
+ * Spins for up to BC_SPIN_US (calibrated poll count), which covers a normal
+ * command hand-off, then falls back to sched_yield() polling against the
+ * clock so a stalled FPGA or a busy core does not burn a full timeout.
+ *
+ * Returns number of polls taken, or -1 on timeout
+ */
+static int bc_wait_idle(bm1398_context_t *ctx, uint32_t timeout_us) {
+    volatile uint32_t *regs = ctx->fpga_regs;
+
+    if (ctx->spin_per_us == 0) {
+        bm1398_calibrate_spin(ctx);
+    }
+
+    uint32_t spin_us = timeout_us < BC_SPIN_US ? timeout_us : BC_SPIN_US;
+    uint32_t limit = ctx->spin_per_us * spin_us;
+    uint32_t polls = 0;
+
+    for (; polls < limit; polls++) {
+        if (!(regs[REG_BC_WRITE_COMMAND] & BC_COMMAND_BUFFER_READY)) {
+            return (int)polls;
+        }
+        cpu_relax();
+    }
+
+    uint64_t deadline = monotonic_ns() + (uint64_t)(timeout_us - spin_us) * 1000;
+    do {
+        polls++;
+        if (!(regs[REG_BC_WRITE_COMMAND] & BC_COMMAND_BUFFER_READY)) {
+            return (int)polls;
+        }
+        sched_yield();
+    } while (monotonic_ns() < deadline);
+
+    return -1;
+}
+
+/**
+ * Delay with microsecond accuracy
+ * Sleeps through the bulk of long gaps (timer slack is ~50us), spins the rest
+ */
+static void spin_delay_us(uint32_t us) {
+    if (us == 0) {
+        return;
+    }
+    uint64_t deadline = monotonic_ns() + (uint64_t)us * 1000;
+    if (us > 2 * BC_SPIN_US) {
+        usleep(us - BC_SPIN_US);
+    }
+    while (monotonic_ns() < deadline) {
+        cpu_relax();
+    }
+}
+
+/**
+ * Prepare a UART command for repeated sending
+ *
+ * Packs up to 12 command bytes into the BIG-ENDIAN BC_COMMAND_BUFFER words
+ * the FPGA expects. ARM is little-endian, so the packing happens here once
+ * instead of on every send.
+ * Example: {0x53, 0x05, 0x00, 0x00} -> 0x53050000 (not 0x00000553)
+ */
+void bm1398_prepare_cmd(bm1398_cmd_t *cmd, const uint8_t *bytes, size_t len) {
+    if (len > 12) {
+        len = 12;
+    }
+
+    memset(cmd, 0, sizeof(*cmd));
+    cmd->num_words = (uint8_t)((len + 3) / 4);
+
+    for (size_t i = 0; i < len; i++) {
+        cmd->words[i / 4] |= (uint32_t)bytes[i] << (24 - 8 * (i % 4));
+    }
+}
+
+/**
+ * Prepare a register write command
+ * Command: [0x41/0x51] 0x09 [chip_addr] [reg_addr] [value_be] [CRC5]
+ *
+ * Builds the three FPGA words directly, without an intermediate byte frame.
+ */
+void bm1398_prepare_write_register(bm1398_cmd_t *cmd, bool broadcast,
+                                   uint8_t chip_addr, uint8_t reg_addr,
+                                   uint32_t value) {
+    uint8_t preamble = broadcast ? CMD_PREAMBLE_WRITE_BCAST : CMD_PREAMBLE_WRITE_REG;
+    uint8_t frame[8] = {
+        preamble, CMD_LEN_WRITE_REG, chip_addr, reg_addr,
+        (uint8_t)(value >> 24), (uint8_t)(value >> 16),
+        (uint8_t)(value >> 8), (uint8_t)value
+    };
+
+    cmd->words[0] = ((uint32_t)preamble << 24) | ((uint32_t)CMD_LEN_WRITE_REG << 16) |
+                    ((uint32_t)chip_addr << 8) | reg_addr;
+    cmd->words[1] = value;
+    cmd->words[2] = (uint32_t)bm1398_crc5_cmd64(frame) << 24;
+    cmd->num_words = 3;
+}
+
+/**
+ * Prepare a register read command
+ * Command: [0x42/0x52] 0x09 [chip_addr] [reg_addr] 0x00 0x00 0x00 0x00 [CRC5]
+ */
+void bm1398_prepare_read_register(bm1398_cmd_t *cmd, bool broadcast,
+                                  uint8_t chip_addr, uint8_t reg_addr) {
+    uint8_t preamble = broadcast ? CMD_PREAMBLE_READ_BCAST : CMD_PREAMBLE_READ_REG;
+    uint8_t frame[8] = { preamble, CMD_LEN_WRITE_REG, chip_addr, reg_addr, 0, 0, 0, 0 };
+
+    cmd->words[0] = ((uint32_t)preamble << 24) | ((uint32_t)CMD_LEN_WRITE_REG << 16) |
+                    ((uint32_t)chip_addr << 8) | reg_addr;
+    cmd->words[1] = 0;
+    cmd->words[2] = (uint32_t)bm1398_crc5_cmd64(frame) << 24;
+    cmd->num_words = 3;
+}
+
+// Register writes update the shadow once the FPGA has taken them
+static void shadow_note_cmd(bm1398_context_t *ctx, int chain, const bm1398_cmd_t *cmd) {
+    uint8_t preamble = cmd->words[0] >> 24;
+    uint8_t reg_addr = cmd->words[0] & 0xFF;
+
+    if (!ctx->shadow || cmd->num_words < 2 || (reg_addr & 3) ||
+        (preamble != CMD_PREAMBLE_WRITE_REG && preamble != CMD_PREAMBLE_WRITE_BCAST)) {
+        return;
+    }
+
+    bm1398_reg_shadow_t *sh = &ctx->shadow[chain];
+    uint64_t bit = BM1398_SHADOW_BIT(reg_addr);
+    int r = reg_addr >> 2;
+
+    if (preamble == CMD_PREAMBLE_WRITE_BCAST) {
+        for (int addr = 0; addr < BM1398_SHADOW_ADDRS; addr++) {
+            sh->value[addr][r] = cmd->words[1];
+            sh->valid[addr] |= bit;
+        }
+        sh->diverged &= ~bit;
+    } else {
+        uint8_t addr = (cmd->words[0] >> 8) & 0xFF;
+        sh->value[addr][r] = cmd->words[1];
+        sh->valid[addr] |= bit;
+        sh->diverged |= bit;
+    }
+}
+
+/**
+ * Send a prepared command: word stores, trigger, wait for completion
  *
- * Method: Write command bytes to registers 0xC4-0xCF (3 x 32-bit words)
+ * Method: Write words to registers 0xC4-0xCF (up to 3 x 32-bit words)
  *         Trigger with BC_WRITE_COMMAND (0xC0)
  *         Wait for completion (bit 31 clears)
  *
  * Source: Analysis of S19 FPGA interface + bitmaintech driver
  */
-int bm1398_send_uart_cmd(bm1398_context_t *ctx, int chain,
-                         const uint8_t *cmd, size_t len) {
+int bm1398_send_cmd(bm1398_context_t *ctx, int chain, const bm1398_cmd_t *cmd) {
     if (!ctx || !ctx->initialized || !cmd || chain < 0 || chain >= MAX_CHAINS) {
         return -1;
     }
 
-    if (len == 0 || len > 12) {
-        fprintf(stderr, "Error: Invalid command length %zu (max 12 bytes)\n", len);
-        return -1;
-    }
-
     volatile uint32_t *regs = ctx->fpga_regs;
 
-    // Write command bytes to BC_COMMAND_BUFFER (0xC4, 0xC8, 0xCC)
-    // Up to 12 bytes = 3 x 32-bit words
-    // FPGA expects BIG-ENDIAN byte order!
-    // ARM is little-endian, so we must byte-swap
-    for (size_t i = 0; i < (len + 3) / 4; i++) {
-        uint32_t word = 0;
-        size_t bytes_to_copy = (len - i * 4);
-        if (bytes_to_copy > 4) bytes_to_copy = 4;
-
-        memcpy(&word, &cmd[i * 4], bytes_to_copy);
+    // One BC_COMMAND_BUFFER serves all chains
+    pthread_mutex_lock(&ctx->lock);
 
-        // Byte-swap to big-endian for FPGA
-        // Example: {0x53, 0x05, 0x00, 0x00} -> 0x53050000 (not 0x00000553)
-        word = __builtin_bswap32(word);
-
-        regs[REG_BC_COMMAND_BUFFER + i] = word;
+    for (int i = 0; i < cmd->num_words; i++) {
+        regs[REG_BC_COMMAND_BUFFER + i] = cmd->words[i];
     }
 
     // Trigger command transmission
@@ -652,20 +1063,106 @@ int bm1398_send_uart_cmd(bm1398_context_t *ctx, int chain,
     regs[REG_BC_WRITE_COMMAND] = trigger;
 
     // Wait for completion (bit 31 clears)
-    int timeout = 10000;  // 10ms max
-    while ((regs[REG_BC_WRITE_COMMAND] & BC_COMMAND_BUFFER_READY) && timeout > 0) {
-        usleep(1);
-        timeout--;
-    }
+    int polls = bc_wait_idle(ctx, BC_TIMEOUT_US);
 
-    if (timeout == 0) {
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (polls < 0) {
         fprintf(stderr, "Error: UART command timeout on chain %d\n", chain);
         return -1;
     }
 
+    shadow_note_cmd(ctx, chain, cmd);
     return 0;
 }
 
+/**
+ * Send a batch of prepared commands back-to-back
+ *
+ * The FPGA has a single BC_COMMAND_BUFFER, so each command is loaded as soon
+ * as the previous one has been taken (bit 31 clears) rather than after a
+ * scheduler sleep. gap_us optionally spaces triggers for commands the chips
+ * must relay before the next one arrives (e.g. address assignment).
+ *
+ * Returns number of commands completed (== count on success)
+ */
+int bm1398_send_cmd_batch(bm1398_context_t *ctx, int chain,
+                          const bm1398_cmd_t *cmds, int count,
+                          uint32_t gap_us, bm1398_batch_stats_t *stats) {
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+
+    if (!ctx || !ctx->initialized || !cmds || count < 0 ||
+        chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
+
+    volatile uint32_t *regs = ctx->fpga_regs;
+    uint32_t trigger = BC_COMMAND_BUFFER_READY | BC_CHAIN_ID(chain);
+    uint64_t t0 = monotonic_ns();
+    int completed = 0;
+
+    for (int i = 0; i < count; i++) {
+        const bm1398_cmd_t *cmd = &cmds[i];
+
+        // Lock per command so batches for other chains interleave
+        pthread_mutex_lock(&ctx->lock);
+        for (int w = 0; w < cmd->num_words; w++) {
+            regs[REG_BC_COMMAND_BUFFER + w] = cmd->words[w];
+        }
+        regs[REG_BC_WRITE_COMMAND] = trigger;
+
+        int polls = bc_wait_idle(ctx, BC_TIMEOUT_US);
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (polls < 0) {
+            fprintf(stderr, "Error: UART command timeout on chain %d (batch %d/%d)\n",
+                    chain, i + 1, count);
+            break;
+        }
+
+        completed++;
+        shadow_note_cmd(ctx, chain, cmd);
+        if (stats && (uint32_t)polls > stats->max_polls) {
+            stats->max_polls = (uint32_t)polls;
+        }
+
+        if (i + 1 < count) {
+            spin_delay_us(gap_us);
+        }
+    }
+
+    if (stats) {
+        stats->completed = completed;
+        stats->elapsed_ns = monotonic_ns() - t0;
+    }
+
+    return completed;
+}
+
+/**
+ * Send UART command to ASIC chain via FPGA BC_COMMAND_BUFFER
+ *
+ * Ad-hoc variant of bm1398_send_cmd() for raw command bytes.
+ */
+int bm1398_send_uart_cmd(bm1398_context_t *ctx, int chain,
+                         const uint8_t *cmd, size_t len) {
+    if (!ctx || !ctx->initialized || !cmd || chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
+
+    if (len == 0 || len > 12) {
+        fprintf(stderr, "Error: Invalid command length %zu (max 12 bytes)\n", len);
+        return -1;
+    }
+
+    bm1398_cmd_t prepared;
+    bm1398_prepare_cmd(&prepared, cmd, len);
+
+    return bm1398_send_cmd(ctx, chain, &prepared);
+}
+
 //==============================================================================
 // Chain Control Commands
 //==============================================================================
@@ -681,7 +1178,7 @@ int bm1398_chain_inactive(bm1398_context_t *ctx, int chain) {
     cmd[1] = CMD_LEN_ADDRESS;
     cmd[2] = 0x00;
     cmd[3] = 0x00;
-    cmd[4] = bm1398_crc5(cmd, 32);
+    cmd[4] = bm1398_crc5_cmd32(cmd);
 
     return bm1398_send_uart_cmd(ctx, chain, cmd, sizeof(cmd));
 }
@@ -691,15 +1188,23 @@ int bm1398_chain_inactive(bm1398_context_t *ctx, int chain) {
  * Command: 0x40 0x05 [addr] 0x00 [CRC5]
  */
 int bm1398_set_chip_address(bm1398_context_t *ctx, int chain, uint8_t addr) {
-    uint8_t cmd[5];
+    bm1398_cmd_t cmd;
 
-    cmd[0] = CMD_PREAMBLE_SET_ADDRESS;
-    cmd[1] = CMD_LEN_ADDRESS;
-    cmd[2] = addr;
-    cmd[3] = 0x00;
-    cmd[4] = bm1398_crc5(cmd, 32);
+    bm1398_prepare_set_chip_address(&cmd, addr);
 
-    return bm1398_send_uart_cmd(ctx, chain, cmd, sizeof(cmd));
+    return bm1398_send_cmd(ctx, chain, &cmd);
+}
+
+void bm1398_prepare_set_chip_address(bm1398_cmd_t *cmd, uint8_t addr) {
+    uint8_t frame[5];
+
+    frame[0] = CMD_PREAMBLE_SET_ADDRESS;
+    frame[1] = CMD_LEN_ADDRESS;
+    frame[2] = addr;
+    frame[3] = 0x00;
+    frame[4] = bm1398_crc5_cmd32(frame);
+
+    bm1398_prepare_cmd(cmd, frame, sizeof(frame));
 }
 
 /**
@@ -729,30 +1234,20 @@ int bm1398_enumerate_chips(bm1398_context_t *ctx, int chain, int num_chips) {
 
     printf("  Address interval: %d\n", interval);
 
-    // Assign addresses sequentially
-    int errors = 0;
+    // Assign addresses sequentially as one back-to-back batch
+    bm1398_cmd_t cmds[256];
+    if (num_chips > 256) num_chips = 256;
     for (int i = 0; i < num_chips; i++) {
-        uint8_t addr = i * interval;
-
-        if (bm1398_set_chip_address(ctx, chain, addr) < 0) {
-            fprintf(stderr, "Warning: Failed to set address %d for chip %d\n", addr, i);
-            errors++;
-        }
-
-        // Delay between chip enumeration commands
-        // Factory test uses longer delays to ensure chips have time to process
-        // Each chip must receive, process, and relay the command down the chain
-        usleep(10000);  // 10ms per chip
-
-        // Progress indication every 10 chips
-        if ((i + 1) % 10 == 0) {
-            printf("  Addressed %d/%d chips\r", i + 1, num_chips);
-            fflush(stdout);
-        }
+        bm1398_prepare_set_chip_address(&cmds[i], (uint8_t)(i * interval));
     }
 
-    printf("\n  Enumeration complete: %d chips addressed (%d errors)\n",
-           num_chips, errors);
+    bm1398_batch_stats_t stats;
+    int sent = bm1398_send_cmd_batch(ctx, chain, cmds, num_chips,
+                                     BM1398_ENUM_GAP_US, &stats);
+    int errors = sent < 0 ? num_chips : num_chips - sent;
+
+    printf("  Enumeration complete: %d chips addressed (%d errors) in %.2f ms\n",
+           sent < 0 ? 0 : sent, errors, stats.elapsed_ns / 1e6);
 
     return errors > 0 ? -1 : 0;
 }
@@ -775,13 +1270,18 @@ void bm1398_chain_reset_low(bm1398_context_t *ctx, int chain) {
 
     // Read current value from FPGA register 0x034
     // IDA Pro: fpga_read(0xD, &val) where logical 0xD → physical 0x034
-    uint32_t val = fpga_read_indirect(ctx, 13);
+    pthread_mutex_lock(&ctx->lock);
+    uint32_t val = fpga_read_chain_reset(ctx);
 
     // Set bit for this chain (assert reset)
     // IDA Pro: fpga_write(0xD, val | (1 << chain_id))
     val |= (1 << chain);
 
-    fpga_write_indirect(ctx, 13, val);
+    fpga_write_chain_reset(ctx, val);
+    pthread_mutex_unlock(&ctx->lock);
+
+    // Chips come out of reset with their power-on registers
+    bm1398_shadow_invalidate(ctx, chain);
 }
 
 /**
@@ -796,13 +1296,15 @@ void bm1398_chain_reset_high(bm1398_context_t *ctx, int chain) {
     }
 
     // Read current value from FPGA register 0x034
-    uint32_t val = fpga_read_indirect(ctx, 13);
+    pthread_mutex_lock(&ctx->lock);
+    uint32_t val = fpga_read_chain_reset(ctx);
 
     // Clear bit for this chain (release reset)
     // IDA Pro: fpga_write(0xD, val & ~(1 << chain_id))
     val &= ~(1 << chain);
 
-    fpga_write_indirect(ctx, 13, val);
+    fpga_write_chain_reset(ctx, val);
+    pthread_mutex_unlock(&ctx->lock);
 }
 
 /**
@@ -867,78 +1369,357 @@ int bm1398_write_register(bm1398_context_t *ctx, int chain, bool broadcast,
         return -1;
     }
 
-    uint8_t cmd[9];
+    bm1398_cmd_t cmd;
+    bm1398_prepare_write_register(&cmd, broadcast, chip_addr, reg_addr, value);
 
-    cmd[0] = broadcast ? CMD_PREAMBLE_WRITE_BCAST : CMD_PREAMBLE_WRITE_REG;
-    cmd[1] = CMD_LEN_WRITE_REG;
-    cmd[2] = chip_addr;
-    cmd[3] = reg_addr;
-    cmd[4] = (value >> 24) & 0xFF;  // MSB first (big-endian)
-    cmd[5] = (value >> 16) & 0xFF;
-    cmd[6] = (value >> 8) & 0xFF;
-    cmd[7] = value & 0xFF;          // LSB last
-    cmd[8] = bm1398_crc5(cmd, 64);  // 8 bytes = 64 bits
-
-    return bm1398_send_uart_cmd(ctx, chain, cmd, sizeof(cmd));
+    return bm1398_send_cmd(ctx, chain, &cmd);
 }
 
-/**
- * Read ASIC register
- * Command: [0x42/0x52] 0x09 [chip_addr] [reg_addr] 0x00 0x00 0x00 0x00 [CRC5]
- *
- * Response comes back through FPGA RETURN_NONCE register
- * Response format: [reg_data:32bits] in bits [31:0]
- *
- * Note: This implementation uses polling of NONCE_NUMBER_IN_FIFO
+//==============================================================================
+// Return FIFO Demultiplexer
+//==============================================================================
+
+/*
+ * REG_RETURN_NONCE carries nonces and register read replies in one FIFO.
+ * Whoever pops it (the nonce reader via bm1398_read_nonces(), or a register
+ * read waiting for its reply) does so under demux.lock, a whole entry at a
+ * time, and routes what it finds: replies complete the in-flight read
+ * keyed by chain/chip/register, nonces go back to the caller or into the
+ * stash for the nonce reader. Reads can therefore run while hashing
+ * without eating nonces.
  */
-int bm1398_read_register(bm1398_context_t *ctx, int chain, bool broadcast,
-                         uint8_t chip_addr, uint8_t reg_addr, uint32_t *value,
-                         int timeout_ms) {
-    if (!ctx || !ctx->initialized || !value) {
+
+#define DEMUX_DRAIN_BATCH       64
+
+static void decode_nonce(nonce_response_t *nonce, uint32_t hdr, uint32_t value);
+
+static void demux_reg_reply(bm1398_fifo_demux_t *dm, uint32_t hdr, uint32_t value) {
+    if (hdr & FIFO_REPLY_CRC_ERROR) {
+        dm->garbled++;
+        return;
+    }
+
+    int chain = FIFO_CHAIN(hdr);
+    int chip = FIFO_REG_CHIP(hdr);
+    uint8_t reg = FIFO_REG_ADDR(hdr);
+
+    dm->reg_replies++;
+    for (int i = 0; i < BM1398_REG_SLOTS; i++) {
+        bm1398_reg_slot_t *slot = &dm->slots[i];
+        if (slot->busy && !slot->done && slot->chain == chain && slot->reg_addr == reg &&
+            (slot->chip_addr == BM1398_ANY_CHIP || slot->chip_addr == chip)) {
+            slot->value = value;
+            slot->from_chip = (uint8_t)chip;
+            slot->done = true;
+            return;
+        }
+    }
+
+    bm1398_chain_scan_t *scan = chain < MAX_CHAINS ? dm->scans[chain] : NULL;
+    if (scan && scan->reg_addr == reg) {
+        int idx = chip / scan->interval;
+        if (chip % scan->interval || idx >= scan->num_chips || scan->present[idx]) {
+            scan->duplicates++;
+        } else {
+            scan->present[idx] = true;
+            scan->value[idx] = value;
+            scan->responded++;
+        }
+        return;
+    }
+    dm->unmatched++;
+}
+
+// Caller holds demux.lock. Nonces go to out[] up to max, the rest to the stash.
+static int demux_route(bm1398_fifo_demux_t *dm, const uint32_t (*entries)[2], int count,
+                       nonce_response_t *out, int max) {
+    int n = 0;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t hdr = entries[i][0];
+        uint32_t value = entries[i][1];
+
+        if (!FIFO_IS_NONCE(hdr)) {
+            demux_reg_reply(dm, hdr, value);
+            continue;
+        }
+
+        dm->nonces++;
+        if (n < max) {
+            decode_nonce(&out[n++], hdr, value);
+        } else if (dm->stash_count < BM1398_NONCE_STASH) {
+            dm->stash[dm->stash_count][0] = hdr;
+            dm->stash[dm->stash_count][1] = value;
+            dm->stash_count++;
+        } else {
+            dm->stash_dropped++;
+        }
+    }
+    return n;
+}
+
+// Caller holds demux.lock. Pops at most what the FIFO held on entry, and
+// nothing while the kernel stream owns the FIFO.
+static int demux_drain(bm1398_context_t *ctx, nonce_response_t *out, int max) {
+    volatile uint32_t *regs = ctx->fpga_regs;
+    uint32_t entries[DEMUX_DRAIN_BATCH][2];
+    int available = ctx->demux.stream ? 0 : regs[REG_NONCE_NUMBER_IN_FIFO] & 0x7FFF;
+    int n = 0;
+
+    while (available > 0) {
+        int batch = available < DEMUX_DRAIN_BATCH ? available : DEMUX_DRAIN_BATCH;
+        for (int i = 0; i < batch; i++) {
+            entries[i][0] = regs[REG_RETURN_NONCE];
+            entries[i][1] = regs[REG_RETURN_NONCE_VALUE];
+        }
+        n += demux_route(&ctx->demux, entries, batch, out + n, max - n);
+        available -= batch;
+    }
+    return n;
+}
+
+int bm1398_demux_fifo_entries(bm1398_context_t *ctx, const uint32_t (*entries)[2],
+                              int count, nonce_response_t *nonces) {
+    if (!ctx || !ctx->initialized || !entries || !nonces) {
         return -1;
     }
 
-    // Build read command (same as write but with 0x42/0x52 preamble)
-    uint8_t cmd[9];
-    cmd[0] = broadcast ? CMD_PREAMBLE_READ_BCAST : CMD_PREAMBLE_READ_REG;
-    cmd[1] = CMD_LEN_WRITE_REG;
-    cmd[2] = chip_addr;
-    cmd[3] = reg_addr;
-    cmd[4] = 0x00;  // Placeholder data
-    cmd[5] = 0x00;
-    cmd[6] = 0x00;
-    cmd[7] = 0x00;
-    cmd[8] = bm1398_crc5(cmd, 64);
+    pthread_mutex_lock(&ctx->demux.lock);
+    int n = demux_route(&ctx->demux, entries, count, nonces, count);
+    pthread_mutex_unlock(&ctx->demux.lock);
+    return n;
+}
+
+void bm1398_demux_use_stream(bm1398_context_t *ctx, bool on) {
+    if (!ctx) {
+        return;
+    }
+
+    pthread_mutex_lock(&ctx->demux.lock);
+    ctx->demux.stream = on;
+    pthread_mutex_unlock(&ctx->demux.lock);
+}
 
-    // Send read command
-    if (bm1398_send_uart_cmd(ctx, chain, cmd, sizeof(cmd)) < 0) {
+void bm1398_print_fifo_demux_stats(bm1398_context_t *ctx) {
+    bm1398_fifo_demux_t *dm = &ctx->demux;
+
+    pthread_mutex_lock(&dm->lock);
+    printf("Return FIFO: %llu nonces, %llu register replies (%llu unmatched, %llu garbled), "
+           "%d stashed, %llu stash drops\n",
+           (unsigned long long)dm->nonces, (unsigned long long)dm->reg_replies,
+           (unsigned long long)dm->unmatched, (unsigned long long)dm->garbled,
+           dm->stash_count, (unsigned long long)dm->stash_dropped);
+    pthread_mutex_unlock(&dm->lock);
+}
+
+/**
+ * Read ASIC register
+ * Command: [0x42/0x52] 0x09 [chip_addr] [reg_addr] 0x00 0x00 0x00 0x00 [CRC5]
+ *
+ * The reply comes back through the return FIFO and is matched to the read
+ * by the demultiplexer. A broadcast read completes with the first chip to
+ * answer; later replies count as unmatched.
+ */
+int bm1398_read_register_async(bm1398_context_t *ctx, int chain, bool broadcast,
+                               uint8_t chip_addr, uint8_t reg_addr) {
+    if (!ctx || !ctx->initialized) {
         return -1;
     }
 
-    // Wait for response in FPGA FIFO
-    volatile uint32_t *regs = ctx->fpga_regs;
-    int timeout = timeout_ms * 1000;  // Convert to microseconds
+    bm1398_cmd_t cmd;
+    bm1398_prepare_read_register(&cmd, broadcast, chip_addr, reg_addr);
+
+    // Claim the slot before sending so the reply always has somewhere to go
+    bm1398_fifo_demux_t *dm = &ctx->demux;
+    int slot = -1;
+    pthread_mutex_lock(&dm->lock);
+    for (int i = 0; i < BM1398_REG_SLOTS; i++) {
+        if (!dm->slots[i].busy) {
+            dm->slots[i] = (bm1398_reg_slot_t){
+                .busy = true,
+                .chain = chain,
+                .chip_addr = broadcast ? BM1398_ANY_CHIP : chip_addr,
+                .reg_addr = reg_addr,
+            };
+            slot = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&dm->lock);
 
-    while (timeout > 0) {
-        // Check if response available
-        int available = regs[REG_NONCE_NUMBER_IN_FIFO];
-        if (available > 0) {
-            // Read response from FIFO
-            uint32_t response = regs[REG_RETURN_NONCE];
+    if (slot < 0) {
+        fprintf(stderr, "Error: %d register reads already in flight\n", BM1398_REG_SLOTS);
+        return -1;
+    }
 
-            // Parse response (register data in lower 32 bits)
-            // TODO: Verify this is correct format based on hardware testing
-            *value = response;
-            return 0;
+    if (bm1398_send_cmd(ctx, chain, &cmd) < 0) {
+        pthread_mutex_lock(&dm->lock);
+        dm->slots[slot].busy = false;
+        pthread_mutex_unlock(&dm->lock);
+        return -1;
+    }
+    return slot;
+}
+
+/**
+ * Wait for an async read's reply and release its slot. Drains the FIFO
+ * while waiting, so it works with or without a nonce reader running; with
+ * the kernel stream armed the stream reader delivers the reply instead.
+ */
+int bm1398_read_register_wait(bm1398_context_t *ctx, int slot, uint32_t *value,
+                              int timeout_ms) {
+    if (!ctx || !ctx->initialized || slot < 0 || slot >= BM1398_REG_SLOTS) {
+        return -1;
+    }
+
+    bm1398_fifo_demux_t *dm = &ctx->demux;
+    bm1398_reg_slot_t *s = &dm->slots[slot];
+    int timeout = timeout_ms * 1000;  // Convert to microseconds
+
+    for (;;) {
+        pthread_mutex_lock(&dm->lock);
+        if (!s->done) {
+            demux_drain(ctx, NULL, 0);
+        }
+        if (s->done || timeout <= 0) {
+            bool done = s->done;
+            int chain = s->chain;
+            uint8_t reg_addr = s->reg_addr;
+            if (done && value) {
+                *value = s->value;
+            }
+            s->busy = false;
+            pthread_mutex_unlock(&dm->lock);
+
+            if (done) {
+                return 0;
+            }
+            fprintf(stderr, "Error: Register read timeout (chain %d, reg 0x%02X)\n",
+                    chain, reg_addr);
+            return -1;
         }
+        pthread_mutex_unlock(&dm->lock);
 
         usleep(100);  // Poll every 100us
         timeout -= 100;
     }
+}
 
-    fprintf(stderr, "Error: Register read timeout (chain %d, reg 0x%02X)\n",
-            chain, reg_addr);
-    return -1;
+int bm1398_read_register(bm1398_context_t *ctx, int chain, bool broadcast,
+                         uint8_t chip_addr, uint8_t reg_addr, uint32_t *value,
+                         int timeout_ms) {
+    if (!value) {
+        return -1;
+    }
+
+    int slot = bm1398_read_register_async(ctx, chain, broadcast, chip_addr, reg_addr);
+    if (slot < 0) {
+        return -1;
+    }
+    return bm1398_read_register_wait(ctx, slot, value, timeout_ms);
+}
+
+//==============================================================================
+// Register Shadow
+//==============================================================================
+
+/**
+ * Read a register the driver has written from the shadow; on a miss, read
+ * it from the chip and remember it. Status and counter registers change on
+ * their own and must be read with bm1398_read_register() instead.
+ */
+int bm1398_read_register_cached(bm1398_context_t *ctx, int chain, uint8_t chip_addr,
+                                uint8_t reg_addr, uint32_t *value) {
+    if (!ctx || !ctx->initialized || !value || chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
+
+    bm1398_reg_shadow_t *sh = (ctx->shadow && !(reg_addr & 3)) ? &ctx->shadow[chain] : NULL;
+    uint64_t bit = BM1398_SHADOW_BIT(reg_addr);
+
+    if (sh && (sh->valid[chip_addr] & bit)) {
+        *value = sh->value[chip_addr][reg_addr >> 2];
+        sh->hits++;
+        return 0;
+    }
+
+    if (bm1398_read_register(ctx, chain, false, chip_addr, reg_addr, value, 100) < 0) {
+        fprintf(stderr, "Error: Chip 0x%02X did not return reg 0x%02X on chain %d, nothing cached\n",
+                chip_addr, reg_addr, chain);
+        return -1;
+    }
+    if (sh) {
+        sh->value[chip_addr][reg_addr >> 2] = *value;
+        sh->valid[chip_addr] |= bit;
+        sh->misses++;
+    }
+    return 0;
+}
+
+/**
+ * Reload one register for every chip on the chain from hardware (a chain
+ * scan), e.g. after something outside the driver may have changed it.
+ * The old values are dropped before the scan. If any chip does not answer
+ * the register stays forgotten on the whole chain and is marked diverged,
+ * so later reads and read-modify-writes go to each chip instead of using
+ * a value nobody confirmed.
+ *
+ * Returns number of chips that answered, -1 on error or timeout
+ */
+int bm1398_shadow_resync(bm1398_context_t *ctx, int chain, uint8_t reg_addr) {
+    if (!ctx || !ctx->initialized || !ctx->shadow || (reg_addr & 3) ||
+        chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
+
+    bm1398_reg_shadow_t *sh = &ctx->shadow[chain];
+    uint64_t bit = BM1398_SHADOW_BIT(reg_addr);
+    int r = reg_addr >> 2;
+    int first = -1;
+
+    for (int addr = 0; addr < BM1398_SHADOW_ADDRS; addr++) {
+        sh->valid[addr] &= ~bit;
+    }
+    sh->diverged |= bit;
+
+    bm1398_chain_scan_t scan;
+    int answered = bm1398_scan_chain_register(ctx, chain, reg_addr, true, &scan);
+    if (answered < 0) {
+        fprintf(stderr, "Error: Shadow resync of reg 0x%02X failed on chain %d\n",
+                reg_addr, chain);
+        return -1;
+    }
+    if (answered < scan.num_chips) {
+        fprintf(stderr, "Error: Shadow resync of reg 0x%02X timed out on chain %d "
+                "(%d/%d chips answered), register forgotten\n",
+                reg_addr, chain, answered, scan.num_chips);
+        return -1;
+    }
+
+    sh->diverged &= ~bit;
+    for (int i = 0; i < scan.num_chips; i++) {
+        if (!scan.present[i]) continue;
+        int addr = i * scan.interval;
+        sh->value[addr][r] = scan.value[i];
+        sh->valid[addr] |= bit;
+        if (first < 0) {
+            first = i;
+        } else if (scan.value[i] != scan.value[first]) {
+            sh->diverged |= bit;
+        }
+    }
+    sh->resyncs++;
+    return answered;
+}
+
+void bm1398_shadow_invalidate(bm1398_context_t *ctx, int chain) {
+    if (!ctx || !ctx->shadow || chain < 0 || chain >= MAX_CHAINS) {
+        return;
+    }
+
+    bm1398_reg_shadow_t *sh = &ctx->shadow[chain];
+    memset(sh->valid, 0, sizeof(sh->valid));
+    sh->diverged = 0;
 }
 
 /**
@@ -947,6 +1728,11 @@ int bm1398_read_register(bm1398_context_t *ctx, int chain, bool broadcast,
  * Reads register, clears bits in clear_mask, sets bits in set_mask, writes back.
  * Uses broadcast to affect all chips on chain.
  *
+ * The read comes from the register shadow once the register has been
+ * written, so the usual cost is the single broadcast write. If unicast
+ * writes have left chips holding different values, each chip gets its own
+ * modified value instead.
+ *
  * Example: To set bit 2 and clear bit 5:
  *   clear_mask = (1 << 5)
  *   set_mask = (1 << 2)
@@ -954,14 +1740,45 @@ int bm1398_read_register(bm1398_context_t *ctx, int chain, bool broadcast,
 int bm1398_read_modify_write_register(bm1398_context_t *ctx, int chain,
                                       uint8_t reg_addr, uint32_t clear_mask,
                                       uint32_t set_mask) {
-    if (!ctx || !ctx->initialized) {
+    if (!ctx || !ctx->initialized || chain < 0 || chain >= MAX_CHAINS) {
         return -1;
     }
 
     uint32_t value;
 
-    // Read current value (broadcast read from chip 0 as representative)
-    if (bm1398_read_register(ctx, chain, false, 0, reg_addr, &value, 100) < 0) {
+    if (ctx->shadow && (ctx->shadow[chain].diverged & BM1398_SHADOW_BIT(reg_addr))) {
+        int num_chips = ctx->chips_per_chain[chain];
+        int interval = num_chips > 0 ? 256 / num_chips : 1;
+        bm1398_cmd_t cmds[BM1398_SHADOW_ADDRS];
+
+        if (num_chips <= 0 || num_chips > BM1398_SHADOW_ADDRS) {
+            return -1;
+        }
+        if (interval < 1) interval = 1;
+
+        printf("  Reg 0x%02X differs between chips, modifying each\n", reg_addr);
+        for (int i = 0; i < num_chips; i++) {
+            uint8_t addr = (uint8_t)(i * interval);
+            if (bm1398_read_register_cached(ctx, chain, addr, reg_addr, &value) < 0) {
+                fprintf(stderr, "Error: Read failed in read-modify-write (reg 0x%02X, chip 0x%02X)\n",
+                        reg_addr, addr);
+                return -1;
+            }
+            bm1398_prepare_write_register(&cmds[i], false, addr, reg_addr,
+                                          (value & ~clear_mask) | set_mask);
+        }
+        if (bm1398_send_cmd_batch(ctx, chain, cmds, num_chips, 0, NULL) != num_chips) {
+            fprintf(stderr, "Error: Write failed in read-modify-write (reg 0x%02X)\n",
+                    reg_addr);
+            return -1;
+        }
+
+        usleep(10000);  // 10ms settle time
+        return 0;
+    }
+
+    // Read current value (chip 0 as representative)
+    if (bm1398_read_register_cached(ctx, chain, 0, reg_addr, &value) < 0) {
         fprintf(stderr, "Error: Read failed in read-modify-write (reg 0x%02X)\n",
                 reg_addr);
         return -1;
@@ -987,78 +1804,423 @@ int bm1398_read_modify_write_register(bm1398_context_t *ctx, int chain,
 }
 
 //==============================================================================
-// Chain Initialization Sequences
+// Chain Register Scan
 //==============================================================================
 
 /**
- * Stage 1: Hardware Reset Sequence
+ * Start reading one register from every chip on a chain
  *
- * Source: Bitmain single_board_test.c lines 13617-13633
+ * Broadcast sends a single 0x52 that every chip answers; unicast sends one
+ * 0x42 per enumerated address back-to-back. Either way the replies are
+ * collected by the return FIFO demultiplexer into scan, by chip number,
+ * until bm1398_scan_chain_wait(). One scan per chain at a time.
  */
-int bm1398_reset_chain_stage1(bm1398_context_t *ctx, int chain) {
-    printf("Stage 1: Hardware reset chain %d...\n", chain);
+int bm1398_scan_chain_begin(bm1398_context_t *ctx, int chain, uint8_t reg_addr,
+                            bool broadcast, bm1398_chain_scan_t *scan) {
+    if (!ctx || !ctx->initialized || !scan || chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
 
-    // CRITICAL: Values extracted from single_board_test PT2 FPGA register dump
-    // These exact register values are required for ASIC cores to hash.
-    // DO NOT modify without comparing against working single_board_test behavior!
+    int num_chips = ctx->chips_per_chain[chain];
+    if (num_chips <= 0 || num_chips > BM1398_SCAN_MAX_CHIPS) {
+        fprintf(stderr, "Error: Chain %d has %d chips, cannot scan\n", chain, num_chips);
+        return -1;
+    }
 
-    // Step 1: Send chain inactive to prepare for register writes
-    printf("  Chain inactive...\n");
-    if (bm1398_chain_inactive(ctx, chain) < 0) {
-        fprintf(stderr, "Warning: Chain inactive failed\n");
+    // Same addressing as bm1398_enumerate_chips()
+    memset(scan, 0, sizeof(*scan));
+    scan->chain = chain;
+    scan->reg_addr = reg_addr;
+    scan->num_chips = num_chips;
+    scan->interval = 256 / num_chips;
+    if (scan->interval < 1) scan->interval = 1;
+
+    bm1398_fifo_demux_t *dm = &ctx->demux;
+    pthread_mutex_lock(&dm->lock);
+    if (dm->scans[chain]) {
+        pthread_mutex_unlock(&dm->lock);
+        fprintf(stderr, "Error: Register scan already running on chain %d\n", chain);
+        return -1;
     }
-    usleep(10000);
+    dm->scans[chain] = scan;
+    pthread_mutex_unlock(&dm->lock);
 
-    // Step 2: Configure CLK_CTRL with baud divisor pattern
-    printf("  Write reg 0x18 = 0x0000BA01...\n");
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CLK_CTRL, 0x0000BA01);
-    usleep(10000);
+    int rc;
+    scan->start_ns = monotonic_ns();
+    if (broadcast) {
+        bm1398_cmd_t cmd;
+        bm1398_prepare_read_register(&cmd, true, 0, reg_addr);
+        rc = bm1398_send_cmd(ctx, chain, &cmd);
+    } else {
+        // The FPGA paces the burst: each frame is taken once the last one left
+        bm1398_cmd_t cmds[BM1398_SCAN_MAX_CHIPS];
+        for (int i = 0; i < num_chips; i++) {
+            bm1398_prepare_read_register(&cmds[i], false, (uint8_t)(i * scan->interval), reg_addr);
+        }
+        rc = bm1398_send_cmd_batch(ctx, chain, cmds, num_chips, 0, NULL) == num_chips ? 0 : -1;
+    }
 
-    // Step 3: Configure register 0x34 (exact function unknown, but critical)
-    printf("  Write reg 0x34 = 0x000000F0...\n");
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_RESET_CTRL, 0x000000F0);
-    usleep(10000);
+    if (rc < 0) {
+        pthread_mutex_lock(&dm->lock);
+        dm->scans[chain] = NULL;
+        pthread_mutex_unlock(&dm->lock);
+        return -1;
+    }
+    return 0;
+}
 
-    // Step 4: Update CLK_CTRL (adds bit 14 = 0x4000)
-    printf("  Write reg 0x18 = 0x0040BA01...\n");
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CLK_CTRL, 0x0040BA01);
-    usleep(10000);
+/**
+ * Collect a scan's replies until every chip (or scan->expected of them) has
+ * answered or timeout_ms passes, then detach it. Chips with present[i]
+ * false did not answer.
+ *
+ * Returns number of chips that answered
+ */
+int bm1398_scan_chain_wait(bm1398_context_t *ctx, bm1398_chain_scan_t *scan, int timeout_ms) {
+    if (!ctx || !ctx->initialized || !scan) {
+        return -1;
+    }
 
-    // Step 5: Update CLK_CTRL (sets upper nibble 0xF0)
-    printf("  Write reg 0x18 = 0xF000BA01...\n");
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CLK_CTRL, 0xF000BA01);
-    usleep(10000);
+    bm1398_fifo_demux_t *dm = &ctx->demux;
+    int timeout = timeout_ms * 1000;
+    int want = scan->expected > 0 ? scan->expected : scan->num_chips;
 
-    // Step 6: Final CLK_CTRL adjustment (changes LSB from 0x01 to 0x05)
-    printf("  Write reg 0x18 = 0xF000BA05...\n");
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CLK_CTRL, 0xF000BA05);
-    usleep(10000);
+    for (;;) {
+        pthread_mutex_lock(&dm->lock);
+        if (scan->responded < want) {
+            demux_drain(ctx, NULL, 0);
+        }
+        if (scan->responded >= want || timeout <= 0) {
+            if (dm->scans[scan->chain] == scan) {
+                dm->scans[scan->chain] = NULL;
+            }
+            scan->elapsed_ns = monotonic_ns() - scan->start_ns;
+            pthread_mutex_unlock(&dm->lock);
+            return scan->responded;
+        }
+        pthread_mutex_unlock(&dm->lock);
 
-    // Step 7: Final register 0x34 configuration
-    printf("  Write reg 0x34 = 0x000000F8...\n");
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_RESET_CTRL, 0x000000F8);
-    usleep(10000);
+        usleep(100);
+        timeout -= 100;
+    }
+}
 
-    // Step 8: Set ticket mask to all cores enabled
-    printf("  Setting ticket mask to 0xFFFFFFFF...\n");
-    if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_TICKET_MASK,
-                              TICKET_MASK_ALL_CORES) < 0) {
-        fprintf(stderr, "Error: Failed to set ticket mask\n");
+int bm1398_scan_chain_register(bm1398_context_t *ctx, int chain, uint8_t reg_addr,
+                               bool broadcast, bm1398_chain_scan_t *scan) {
+    if (bm1398_scan_chain_begin(ctx, chain, reg_addr, broadcast, scan) < 0) {
         return -1;
     }
-    usleep(50000);  // 50ms settle time
+    return bm1398_scan_chain_wait(ctx, scan, BM1398_SCAN_TIMEOUT_MS);
+}
 
-    // Step 9: Send chain inactive again (per single_board_test sequence)
-    printf("  Chain inactive (final)...\n");
-    if (bm1398_chain_inactive(ctx, chain) < 0) {
-        fprintf(stderr, "Warning: Final chain inactive failed\n");
+// Value most chips hold (Boyer-Moore vote over the chips that answered)
+static uint32_t scan_majority(const bm1398_chain_scan_t *scan) {
+    uint32_t candidate = 0;
+    int votes = 0;
+
+    for (int i = 0; i < scan->num_chips; i++) {
+        if (!scan->present[i]) continue;
+        if (votes == 0) {
+            candidate = scan->value[i];
+            votes = 1;
+        } else {
+            votes += scan->value[i] == candidate ? 1 : -1;
+        }
+    }
+    return candidate;
+}
+
+/**
+ * Verify PLL, CLK_CTRL and CORE_CONFIG on every chip after init
+ *
+ * All three are written by broadcast, so each chip should hold the value
+ * most of the chain holds. Chips that differ or do not answer are listed.
+ *
+ * Returns number of chips missing or wrong in any register, -1 on error
+ */
+int bm1398_verify_chain_registers(bm1398_context_t *ctx, int chain) {
+    static const struct {
+        uint8_t reg;
+        const char *name;
+    } checks[] = {
+        { ASIC_REG_PLL_PARAM_0, "PLL_PARAM_0" },
+        { ASIC_REG_CLK_CTRL,    "CLK_CTRL" },
+        { ASIC_REG_CORE_CONFIG, "CORE_CONFIG" },
+    };
+    bool bad[BM1398_SCAN_MAX_CHIPS] = {false};
+    bm1398_chain_scan_t scan;
+    uint64_t t0 = monotonic_ns();
+
+    printf("Verifying chip registers on chain %d...\n", chain);
+
+    for (size_t r = 0; r < sizeof(checks) / sizeof(checks[0]); r++) {
+        if (bm1398_scan_chain_register(ctx, chain, checks[r].reg, true, &scan) < 0) {
+            fprintf(stderr, "Error: %s scan failed on chain %d\n", checks[r].name, chain);
+            return -1;
+        }
+
+        uint32_t expected = scan_majority(&scan);
+        int missing = 0, differ = 0;
+        for (int i = 0; i < scan.num_chips; i++) {
+            if (!scan.present[i]) {
+                missing++;
+                bad[i] = true;
+            } else if (scan.value[i] != expected) {
+                differ++;
+                bad[i] = true;
+            }
+        }
+
+        printf("  %-12s 0x%08X on %d/%d chips (%.1f ms)\n", checks[r].name, expected,
+               scan.responded - differ, scan.num_chips, scan.elapsed_ns / 1e6);
+        for (int i = 0; i < scan.num_chips; i++) {
+            if (scan.present[i] && scan.value[i] != expected) {
+                printf("    chip %3d (addr 0x%02X): 0x%08X\n", i, i * scan.interval, scan.value[i]);
+            }
+        }
+        if (missing > 0) {
+            printf("    no reply (%d):", missing);
+            for (int i = 0; i < scan.num_chips; i++) {
+                if (!scan.present[i]) printf(" %d", i);
+            }
+            printf("\n");
+        }
+    }
+
+    int failed = 0;
+    for (int i = 0; i < BM1398_SCAN_MAX_CHIPS; i++) {
+        failed += bad[i];
+    }
+    printf("  %d/%d chips verified in %.1f ms\n", ctx->chips_per_chain[chain] - failed,
+           ctx->chips_per_chain[chain], (monotonic_ns() - t0) / 1e6);
+    return failed;
+}
+
+//==============================================================================
+// Init Step Engine
+//==============================================================================
+
+// Predicate poll interval
+#define STEP_POLL_US            200
+
+static bool step_ready(bm1398_context_t *ctx, const bm1398_init_step_t *step) {
+    switch (step->ready) {
+        case BM1398_READY_FIFO_EMPTY: {
+            // Discard whatever arrived (e.g. garbage after a baud change),
+            // bounded per poll in case the FIFO keeps filling
+            nonce_response_t discard[64];
+            bm1398_read_nonces(ctx, discard, 64);
+            return bm1398_get_nonce_count(ctx) == 0;
+        }
+
+        default:
+            return true;
+    }
+}
+
+/**
+ * Wait out one step: at least min_us, then until the predicate holds, but
+ * never longer than max_us (the factory delay). Steps without an observable
+ * completion, or contexts with fixed_delays set, always wait max_us.
+ *
+ * Returns true if the step finished before max_us
+ */
+static bool step_wait(bm1398_context_t *ctx, const bm1398_init_step_t *step) {
+    uint32_t max_us = step->max_us > step->min_us ? step->max_us : step->min_us;
+
+    if (step->ready == BM1398_READY_NONE || ctx->fixed_delays) {
+        if (max_us) usleep(max_us);
+        return false;
+    }
+
+    uint64_t t0 = monotonic_ns();
+    uint64_t deadline = t0 + (uint64_t)max_us * 1000;
+
+    if (step->min_us) usleep(step->min_us);
+
+    while (monotonic_ns() < deadline) {
+        if (step_ready(ctx, step)) {
+            return true;
+        }
+        usleep(STEP_POLL_US);
+    }
+
+    // One last look: the final poll may have slept past the deadline
+    return step_ready(ctx, step);
+}
+
+/**
+ * Run a declarative init step table on one chain
+ *
+ * Each step sends its command (if any) and then waits via step_wait(), so
+ * sequences advance as soon as the hardware is ready instead of always
+ * paying the factory delays. A failed non-optional command aborts.
+ *
+ * stats: optional, accumulated (caller zeroes)
+ */
+int bm1398_run_init_steps(bm1398_context_t *ctx, int chain,
+                          const bm1398_init_step_t *steps, int count,
+                          bm1398_step_stats_t *stats) {
+    if (!ctx || !ctx->initialized || !steps || chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const bm1398_init_step_t *step = &steps[i];
+        int ret = 0;
+
+        if (step->desc) {
+            printf("  %s...\n", step->desc);
+        }
+
+        switch (step->op) {
+            case BM1398_STEP_WRITE_BCAST:
+                ret = bm1398_write_register(ctx, chain, true, 0, step->reg, step->value);
+                break;
+            case BM1398_STEP_CHAIN_INACTIVE:
+                ret = bm1398_chain_inactive(ctx, chain);
+                break;
+            case BM1398_STEP_DELAY:
+            default:
+                break;
+        }
+
+        if (ret < 0) {
+            if (!step->optional) {
+                fprintf(stderr, "Error: Init step failed: %s\n",
+                        step->desc ? step->desc : "?");
+                return -1;
+            }
+            fprintf(stderr, "Warning: Init step failed: %s\n",
+                    step->desc ? step->desc : "?");
+        }
+
+        uint64_t t0 = monotonic_ns();
+        bool early = step_wait(ctx, step);
+
+        if (stats) {
+            stats->steps++;
+            stats->waited_ns += monotonic_ns() - t0;
+            stats->worst_case_ns += (uint64_t)(step->max_us > step->min_us ?
+                                               step->max_us : step->min_us) * 1000;
+            if (early) {
+                stats->early++;
+            } else if (step->ready != BM1398_READY_NONE && !ctx->fixed_delays) {
+                stats->timeouts++;
+            }
+        }
     }
-    usleep(10000);
 
-    printf("  Stage 1 complete\n");
     return 0;
 }
 
+//==============================================================================
+// Chain Initialization Sequences
+//==============================================================================
+
+/*
+ * Stage 1 register sequence
+ *
+ * CRITICAL: Values extracted from single_board_test PT2 FPGA register dump
+ * (docs/single_board_test_pt2_fpga_dump.log, t=3440.229-3440.297). These
+ * exact register values are required for ASIC cores to hash.
+ * DO NOT modify without comparing against working single_board_test behavior!
+ * (bm1398_bench replay checks this table against the dump.)
+ *
+ * Timing: the factory waits 10ms after each write (50ms after the ticket
+ * mask), and those waits are kept in full. The chips give no sign that a
+ * clock, reset or core setting has taken effect: BC_COMMAND_BUFFER_READY
+ * only says the frame left the FPGA, and bm1398_send_cmd() has already
+ * waited for that.
+ */
+
+static const bm1398_init_step_t stage1_steps[] = {
+    // Chain inactive to prepare for register writes
+    { BM1398_STEP_CHAIN_INACTIVE, BM1398_READY_NONE, 0, 0,
+      10000, 10000, true, "Chain inactive" },
+    // CLK_CTRL with baud divisor pattern
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_CLK_CTRL, 0x0000BA01,
+      10000, 10000, true, "Write reg 0x18 = 0x0000BA01" },
+    // Register 0x34 (exact function unknown, but critical)
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_RESET_CTRL, 0x000000F0,
+      10000, 10000, true, "Write reg 0x34 = 0x000000F0" },
+    // CLK_CTRL: add bit 22
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_CLK_CTRL, 0x0040BA01,
+      10000, 10000, true, "Write reg 0x18 = 0x0040BA01" },
+    // CLK_CTRL: upper nibble 0xF0
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_CLK_CTRL, 0xF000BA01,
+      10000, 10000, true, "Write reg 0x18 = 0xF000BA01" },
+    // CLK_CTRL: LSB 0x01 -> 0x05
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_CLK_CTRL, 0xF000BA05,
+      10000, 10000, true, "Write reg 0x18 = 0xF000BA05" },
+    // Final register 0x34 configuration
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_RESET_CTRL, 0x000000F8,
+      10000, 10000, true, "Write reg 0x34 = 0x000000F8" },
+    // Ticket mask: all cores enabled. Chips have no addresses yet, so a read
+    // here would be answered by the whole chain; factory delay only.
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_TICKET_MASK,
+      TICKET_MASK_ALL_CORES,
+      50000, 50000, false, "Setting ticket mask to 0xFFFFFFFF" },
+    // Chain inactive again (per single_board_test sequence)
+    { BM1398_STEP_CHAIN_INACTIVE, BM1398_READY_NONE, 0, 0,
+      10000, 10000, true, "Chain inactive (final)" },
+};
+
+const bm1398_init_step_t *bm1398_stage1_steps(int *count) {
+    if (count) {
+        *count = (int)(sizeof(stage1_steps) / sizeof(stage1_steps[0]));
+    }
+    return stage1_steps;
+}
+
+/**
+ * Stage 1: Hardware Reset Sequence
+ *
+ * Source: Bitmain single_board_test.c lines 13617-13633
+ */
+int bm1398_reset_chain_stage1(bm1398_context_t *ctx, int chain) {
+    printf("Stage 1: Hardware reset chain %d...\n", chain);
+
+    int count;
+    const bm1398_init_step_t *steps = bm1398_stage1_steps(&count);
+    bm1398_step_stats_t stats = {0};
+
+    if (bm1398_run_init_steps(ctx, chain, steps, count, &stats) < 0) {
+        return -1;
+    }
+
+    printf("  Stage 1 complete (%.1f ms, factory delays %.1f ms)\n",
+           stats.waited_ns / 1e6, stats.worst_case_ns / 1e6);
+    return 0;
+}
+
+#define STEP_COUNT(steps)   ((int)(sizeof(steps) / sizeof((steps)[0])))
+
+// Stage 2 fragments with constant values
+static const bm1398_init_step_t stage2_core_reset_steps[] = {
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_CORE_CONFIG, 0x8000851F,
+      10000, 10000, false, "  Step 1: Write 0x8000851F" },
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_CORE_CONFIG, 0x80000600,
+      10000, 10000, false, "  Step 2: Write 0x80000600" },
+};
+
+static const bm1398_init_step_t stage2_pll_zero_steps[] = {
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_PLL_PARAM_0, 0,
+      10000, 10000, true, NULL },
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_PLL_PARAM_1, 0,
+      10000, 10000, true, NULL },
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_PLL_PARAM_2, 0,
+      10000, 10000, true, NULL },
+    { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_PLL_PARAM_3, 0,
+      10000, 10000, true, NULL },
+};
+
+// Factory test sub_20608 @ 0x20608 drains the RX FIFO right after a baud change
+static const bm1398_init_step_t stage2_fifo_drain_steps[] = {
+    { BM1398_STEP_DELAY, BM1398_READY_FIFO_EMPTY, 0, 0,
+      1000, 10000, true, NULL },
+};
+
 /**
  * Stage 2: Configuration Sequence
  *
@@ -1105,21 +2267,10 @@ int bm1398_configure_chain_stage2(bm1398_context_t *ctx, int chain,
     // 5. Register 0x3C reset sequence BEFORE pulse_mode config
     // Source: Binary Ninja sub_2959c @ 0x2959c - MUST DO THIS!
     printf("  Core config reset sequence (reg 0x3C)...\n");
-    printf("    Step 1: Write 0x8000851F...\n");
-    if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CORE_CONFIG,
-                              0x8000851F) < 0) {
-        fprintf(stderr, "Error: Failed core reset step 1\n");
+    if (bm1398_run_init_steps(ctx, chain, stage2_core_reset_steps,
+                              STEP_COUNT(stage2_core_reset_steps), NULL) < 0) {
         return -1;
     }
-    usleep(10000);
-
-    printf("    Step 2: Write 0x80000600...\n");
-    if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CORE_CONFIG,
-                              0x80000600) < 0) {
-        fprintf(stderr, "Error: Failed core reset step 2\n");
-        return -1;
-    }
-    usleep(10000);
 
     // 6. Set core configuration (pulse_mode=1, clk_sel=0)
     uint32_t core_cfg = CORE_CONFIG_BASE | ((1 & 3) << CORE_CONFIG_PULSE_MODE_SHIFT) | (0 & CORE_CONFIG_CLK_SEL_MASK);
@@ -1162,14 +2313,8 @@ int bm1398_configure_chain_stage2(bm1398_context_t *ctx, int chain,
 
     // 5. Set PLL dividers to 0
     printf("  Setting PLL dividers...\n");
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_PLL_PARAM_0, 0x00000000);
-    usleep(10000);
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_PLL_PARAM_1, 0x00000000);
-    usleep(10000);
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_PLL_PARAM_2, 0x00000000);
-    usleep(10000);
-    bm1398_write_register(ctx, chain, true, 0, ASIC_REG_PLL_PARAM_3, 0x00000000);
-    usleep(10000);
+    bm1398_run_init_steps(ctx, chain, stage2_pll_zero_steps,
+                          STEP_COUNT(stage2_pll_zero_steps), NULL);
 
     // 6. Set frequency (525 MHz)
     printf("  Setting frequency to %d MHz...\n", FREQUENCY_525MHZ);
@@ -1199,14 +2344,11 @@ int bm1398_configure_chain_stage2(bm1398_context_t *ctx, int chain,
     int nonce_count = bm1398_get_nonce_count(ctx);
     if (nonce_count > 0) {
         printf("    Found %d stale entries in nonce FIFO, clearing...\n", nonce_count);
-        nonce_response_t discard_nonces[256];
-        int cleared = bm1398_read_nonces(ctx, discard_nonces,
-                                        nonce_count < 256 ? nonce_count : 256);
-        printf("    Cleared %d stale nonce entries\n", cleared);
     } else {
         printf("    Nonce FIFO already empty\n");
     }
-    usleep(10000);
+    bm1398_run_init_steps(ctx, chain, stage2_fifo_drain_steps,
+                          STEP_COUNT(stage2_fifo_drain_steps), NULL);
 
     // NOTE: PT2 log analysis shows NO second enumeration at high baud
     // Bitmain's PT2 test does NOT re-enumerate chips after baud rate change
@@ -1276,7 +2418,7 @@ int bm1398_configure_chain_stage2(bm1398_context_t *ctx, int chain,
     // where timeout_value calculation is: FPGA_FREQ * 1.3 / (ASIC_FREQ * chip_count)
     // For 525MHz with 114 chips: ~249 cycles
     printf("  FPGA nonce timeout already configured: 0x%08X (keeping bootloader value)\n",
-           fpga_read_indirect(ctx, FPGA_REG_TIMEOUT));
+           fpga_read_timeout(ctx));
     // No write needed - bootloader value is correct
     usleep(10000);
 
@@ -1380,6 +2522,15 @@ int bm1398_init_chain(bm1398_context_t *ctx, int chain) {
     return 0;
 }
 
+// Record elapsed time of a bring-up phase and start the next one
+static void phase_mark(bm1398_init_timing_t *timing, int phase, uint64_t *t_phase) {
+    uint64_t now = monotonic_ns();
+    if (timing) {
+        timing->phase_ns[phase] = now - *t_phase;
+    }
+    *t_phase = now;
+}
+
 /**
  * Complete PT1 initialization with double Stage 1 pattern
  *
@@ -1393,11 +2544,19 @@ int bm1398_init_chain(bm1398_context_t *ctx, int chain) {
  *
  * Source: Decompiled Single_Board_PT1_Test (0x1D468) from IDA Pro
  */
-int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
+static int init_chain_pt1_full(bm1398_context_t *ctx, int chain,
+                               bm1398_init_timing_t *timing) {
     if (!ctx || !ctx->initialized || chain < 0 || chain >= MAX_CHAINS) {
         return -1;
     }
 
+    uint64_t t_start = monotonic_ns();
+    uint64_t t_phase = t_start;
+    if (timing) {
+        memset(timing, 0, sizeof(*timing));
+        timing->result = -1;
+    }
+
     printf("\n====================================\n");
     printf("PT1 Full Initialization - Chain %d\n", chain);
     printf("====================================\n\n");
@@ -1409,6 +2568,8 @@ int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
         return -1;
     }
 
+    phase_mark(timing, BM1398_PHASE_RESET, &t_phase);
+
     // Step 2: FIRST Stage 1 call - Initial register setup
     printf("\nStep 2: Stage 1 (FIRST TIME) - Initial register setup...\n");
     if (bm1398_reset_chain_stage1(ctx, chain) < 0) {
@@ -1423,6 +2584,8 @@ int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
     }
     usleep(10000);  // 10ms delay (from PT1: 0x2710u)
 
+    phase_mark(timing, BM1398_PHASE_STAGE1, &t_phase);
+
     // Step 4: Enumerate ASIC chips (set addresses)
     printf("\nStep 4: Enumerate ASICs (set addresses)...\n");
     int num_chips = CHIPS_PER_CHAIN_S19PRO;
@@ -1432,6 +2595,8 @@ int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
     }
     usleep(10000);  // 10ms delay (from PT1: 0x2710u)
 
+    phase_mark(timing, BM1398_PHASE_ENUMERATE, &t_phase);
+
     // Step 5: Set ASIC baud rate (12 MHz from Config.ini)
     printf("\nStep 5: Set ASIC baud rate to 12MHz...\n");
     if (bm1398_set_baud_rate(ctx, chain, BAUD_RATE_12MHZ) < 0) {
@@ -1455,6 +2620,8 @@ int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
     }
     usleep(10000);  // 10ms delay (from PT1: 0x2710u)
 
+    phase_mark(timing, BM1398_PHASE_BAUD, &t_phase);
+
     // Step 8: Initialize FPGA chain work buffers
     printf("\nStep 8: Initialize FPGA work buffers...\n");
     if (fpga_init_chain_buffers(ctx, chain) < 0) {
@@ -1463,6 +2630,8 @@ int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
     }
     usleep(10000);  // 10ms delay (from PT1: 0x2710u)
 
+    phase_mark(timing, BM1398_PHASE_BUFFERS, &t_phase);
+
     // Step 9: Software core reset (CRITICAL for nonces!)
     printf("\nStep 9: Software core reset...\n");
     if (bm1398_software_reset_cores(ctx, chain) < 0) {
@@ -1470,6 +2639,8 @@ int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
         return -1;
     }
 
+    phase_mark(timing, BM1398_PHASE_CORE_RESET, &t_phase);
+
     // Step 10: SECOND Stage 1 call - Finalize registers after FPGA config
     printf("\nStep 10: Stage 1 (SECOND TIME!) - Finalize after FPGA config...\n");
     if (bm1398_reset_chain_stage1(ctx, chain) < 0) {
@@ -1477,6 +2648,12 @@ int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
         return -1;
     }
 
+    phase_mark(timing, BM1398_PHASE_FINALIZE, &t_phase);
+    if (timing) {
+        timing->total_ns = monotonic_ns() - t_start;
+        timing->result = 0;
+    }
+
     printf("\n====================================\n");
     printf("PT1 Full Initialization Complete\n");
     printf("Chain %d ready for pattern test\n", chain);
@@ -1485,6 +2662,137 @@ int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
     return 0;
 }
 
+int bm1398_init_chain_pt1_full(bm1398_context_t *ctx, int chain) {
+    return init_chain_pt1_full(ctx, chain, NULL);
+}
+
+static const char *init_phase_names[BM1398_NUM_PHASES] = {
+    "reset", "stage1", "enumerate", "baud", "buffers", "core_reset", "finalize"
+};
+
+const char *bm1398_init_phase_name(int phase) {
+    if (phase < 0 || phase >= BM1398_NUM_PHASES) {
+        return "?";
+    }
+    return init_phase_names[phase];
+}
+
+typedef struct {
+    bm1398_context_t *ctx;
+    int chain;
+    bm1398_init_timing_t timing;
+} init_chain_job_t;
+
+static void *init_chain_thread(void *arg) {
+    init_chain_job_t *job = arg;
+    init_chain_pt1_full(job->ctx, job->chain, &job->timing);
+    return NULL;
+}
+
+/**
+ * Initialize several chains concurrently (PT1 full sequence per chain)
+ *
+ * Bring-up is dominated by fixed delays (700ms pre-reset, 2 x 500ms enable
+ * pulse, PLL settles), none of which need the FPGA. One thread per chain
+ * lets those delays overlap; the commands themselves are interleaved on the
+ * single BC_COMMAND_BUFFER (BC_CHAIN_ID selects the target) under ctx->lock.
+ * Total time approaches the slowest chain instead of the sum.
+ *
+ * chain_mask: bit N = initialize chain N
+ * timing:     optional, per-chain phase timing (indexed by chain)
+ *
+ * Returns 0 if every requested chain came up, -1 otherwise
+ */
+int bm1398_init_chains_parallel(bm1398_context_t *ctx, uint32_t chain_mask,
+                                bm1398_init_timing_t timing[MAX_CHAINS]) {
+    if (!ctx || !ctx->initialized) {
+        return -1;
+    }
+
+    init_chain_job_t jobs[MAX_CHAINS];
+    pthread_t threads[MAX_CHAINS];
+    bool started[MAX_CHAINS] = {false};
+    uint64_t shadow_hits[MAX_CHAINS] = {0}, shadow_misses[MAX_CHAINS] = {0};
+    int failed = 0;
+
+    for (int chain = 0; chain < MAX_CHAINS && ctx->shadow; chain++) {
+        shadow_hits[chain] = ctx->shadow[chain].hits;
+        shadow_misses[chain] = ctx->shadow[chain].misses;
+    }
+
+    uint64_t t0 = monotonic_ns();
+
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        if (!(chain_mask & (1U << chain))) {
+            continue;
+        }
+        jobs[chain].ctx = ctx;
+        jobs[chain].chain = chain;
+        memset(&jobs[chain].timing, 0, sizeof(jobs[chain].timing));
+        jobs[chain].timing.result = -1;
+
+        if (pthread_create(&threads[chain], NULL, init_chain_thread, &jobs[chain]) != 0) {
+            fprintf(stderr, "Error: Failed to start init thread for chain %d\n", chain);
+            failed++;
+            continue;
+        }
+        started[chain] = true;
+    }
+
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        if (!started[chain]) {
+            continue;
+        }
+        pthread_join(threads[chain], NULL);
+        if (jobs[chain].timing.result < 0) {
+            failed++;
+        }
+    }
+
+    uint64_t wall_ns = monotonic_ns() - t0;
+    uint64_t sum_ns = 0;
+
+    printf("\n====================================\n");
+    printf("Parallel Chain Init Timing (ms)\n");
+    printf("====================================\n");
+    printf("  Chain");
+    for (int p = 0; p < BM1398_NUM_PHASES; p++) {
+        printf(" %10s", init_phase_names[p]);
+    }
+    printf(" %10s\n", "total");
+
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        if (!(chain_mask & (1U << chain))) {
+            continue;
+        }
+        const bm1398_init_timing_t *t = &jobs[chain].timing;
+        printf("  %5d", chain);
+        for (int p = 0; p < BM1398_NUM_PHASES; p++) {
+            printf(" %10.1f", t->phase_ns[p] / 1e6);
+        }
+        printf(" %10.1f%s\n", t->total_ns / 1e6, t->result < 0 ? "  FAILED" : "");
+        sum_ns += t->total_ns;
+
+        if (timing) {
+            timing[chain] = *t;
+        }
+    }
+
+    printf("  Wall: %.1f ms (sequential sum %.1f ms)\n", wall_ns / 1e6, sum_ns / 1e6);
+
+    for (int chain = 0; chain < MAX_CHAINS && ctx->shadow; chain++) {
+        if (!(chain_mask & (1U << chain))) {
+            continue;
+        }
+        printf("  Chain %d register shadow: %llu reads answered locally (UART commands saved), "
+               "%llu read from chips\n", chain,
+               (unsigned long long)(ctx->shadow[chain].hits - shadow_hits[chain]),
+               (unsigned long long)(ctx->shadow[chain].misses - shadow_misses[chain]));
+    }
+
+    return failed > 0 ? -1 : 0;
+}
+
 //==============================================================================
 // Baud Rate and Frequency Configuration
 //==============================================================================
@@ -1511,179 +2819,461 @@ int bm1398_set_baud_rate(bm1398_context_t *ctx, int chain, uint32_t baud_rate) {
 
         printf("    HIGH-SPEED baud mode (>3MHz)...\n");
 
-        // Calculate divisor: 400MHz / (baud * 8) - 1
-        baud_div = (400000000 / (baud_rate * 8)) - 1;
-        printf("    Baud divisor (high-speed): %u (0x%X)\n", baud_div, baud_div);
+        // Calculate divisor: 400MHz / (baud * 8) - 1
+        baud_div = (400000000 / (baud_rate * 8)) - 1;
+        printf("    Baud divisor (high-speed): %u (0x%X)\n", baud_div, baud_div);
+
+        // Steps 1-2: PLL3 (reg 0x68) for the 400MHz UART clock, then
+        // BAUD_CONFIG (reg 0x28) for high-speed mode. PLL3 has no observable
+        // lock, so both keep their factory delays.
+        static const bm1398_init_step_t hs_clock_steps[] = {
+            { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_PLL_PARAM_3, 0xC0700111,
+              0, 10000, true, "  Configuring PLL3 (reg 0x68) for 400MHz UART clock" },
+            { BM1398_STEP_WRITE_BCAST, BM1398_READY_NONE, ASIC_REG_BAUD_CONFIG, 0x06008F00,
+              0, 10000, true, "  Configuring BAUD_CONFIG (reg 0x28) for high-speed mode" },
+        };
+        bm1398_run_init_steps(ctx, chain, hs_clock_steps, STEP_COUNT(hs_clock_steps), NULL);
+
+        // Step 3: Configure CLK_CTRL register (0x18) with divisor + high-speed bit
+        printf("    Writing CLK_CTRL (reg 0x18) with divisor and high-speed bit...\n");
+
+        // Build CLK_CTRL value from scratch, don't read
+        // Base value: 0xF0000000 (from reset sequence)
+        // Add divisor and high-speed bit
+        reg_val = 0xF0000000 |                          // Base value from reset
+                  (((baud_div >> 5) & 0xF) << 8) |      // Upper 4 bits of divisor to [11:8]
+                  (baud_div & 0x1F) |                   // Lower 5 bits of divisor to [4:0]
+                  0x00010000;                           // Bit 16: high-speed enable
+
+        if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CLK_CTRL, reg_val) < 0) {
+            fprintf(stderr, "Error: Failed to write CLK_CTRL (high-speed)\n");
+            return -1;
+        }
+
+    } else {
+        // Low-speed mode (<= 3 MHz) - uses 25 MHz base clock
+        // Source: Binary Ninja sub_2991c @ 0x2991c
+
+        printf("    LOW-SPEED baud mode (<=3MHz)...\n");
+
+        // Calculate divisor: 25MHz / (baud * 8) - 1
+        baud_div = (25000000 / (baud_rate * 8)) - 1;
+        printf("    Baud divisor (low-speed): %u (0x%X)\n", baud_div, baud_div);
+
+        // Configure CLK_CTRL register (0x18) with divisor, clear high-speed bit
+        printf("    Writing CLK_CTRL (reg 0x18) with divisor, low-speed mode...\n");
+
+        // Build CLK_CTRL value from scratch, don't read
+        // Base value: 0xF0000400 (from reset sequence with soft reset enabled)
+        // Add divisor, ensure high-speed bit is clear
+        reg_val = 0xF0000400 |                          // Base value from reset with soft reset enabled
+                  (((baud_div >> 5) & 0xF) << 8) |      // Upper 4 bits of divisor to [11:8]
+                  (baud_div & 0x1F);                    // Lower 5 bits of divisor to [4:0]
+        // High-speed bit already clear in base value
+
+        if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CLK_CTRL, reg_val) < 0) {
+            fprintf(stderr, "Error: Failed to write CLK_CTRL (low-speed)\n");
+            return -1;
+        }
+    }
+
+    usleep(50000);  // 50ms settle time for baud rate change
+    printf("    Baud rate %u Hz configuration complete\n", baud_rate);
+    return 0;
+}
+
+//==============================================================================
+// PLL0 Step Table
+//==============================================================================
+
+/*
+ * PLL0 values for BM1398_PLL_TABLE_MIN_MHZ..MAX_MHZ in 5 MHz steps, as
+ * bm1398_pll_solve() + bm1398_pll_encode() produce them. The build writes
+ * bm1398_pll_table.h by running pll_table_gen on the host, so the table
+ * cannot drift from the solver; "bm1398_bench pll" checks it again on the
+ * target.
+ */
+static const uint32_t pll_step_table[BM1398_PLL_TABLE_SIZE] = {
+#include "bm1398_pll_table.h"
+};
+
+const uint32_t *bm1398_pll_table(int *count) {
+    if (count) {
+        *count = BM1398_PLL_TABLE_SIZE;
+    }
+    return pll_step_table;
+}
+
+/**
+ * PLL0 value for a hashing clock: table entry for the 5 MHz steps,
+ * solver for anything else. Returns 0 if freq_mhz is 0.
+ */
+uint32_t bm1398_pll_reg_for(uint32_t freq_mhz) {
+    bm1398_pll_t pll;
+
+    if (freq_mhz >= BM1398_PLL_TABLE_MIN_MHZ && freq_mhz <= BM1398_PLL_TABLE_MAX_MHZ &&
+        (freq_mhz - BM1398_PLL_TABLE_MIN_MHZ) % BM1398_PLL_TABLE_STEP_MHZ == 0) {
+        return pll_step_table[(freq_mhz - BM1398_PLL_TABLE_MIN_MHZ) / BM1398_PLL_TABLE_STEP_MHZ];
+    }
+    if (bm1398_pll_solve(freq_mhz, &pll) < 0) {
+        return 0;
+    }
+    return bm1398_pll_encode(&pll);
+}
+
+/**
+ * Set ASIC core frequency
+ *
+ * PLL0 comes from bm1398_pll_reg_for(): the 5 MHz step table, or the
+ * solver for anything in between. Broadcast to every chip on the chain.
+ */
+int bm1398_set_frequency(bm1398_context_t *ctx, int chain, uint32_t freq_mhz) {
+    if (!ctx || !ctx->initialized) {
+        return -1;
+    }
+
+    printf("    Setting frequency to %u MHz...\n", freq_mhz);
+
+    bm1398_pll_t pll;
+    uint32_t pll_value = bm1398_pll_reg_for(freq_mhz);
+    if (pll_value == 0 || bm1398_pll_decode(pll_value, &pll) < 0) {
+        fprintf(stderr, "    Error: No PLL setting for %u MHz\n", freq_mhz);
+        return -1;
+    }
+
+    printf("    PLL config: refdiv=%u, fbdiv=%u, postdiv1=%u, postdiv2=%u\n",
+           pll.refdiv, pll.fbdiv, pll.postdiv1, pll.postdiv2);
+    printf("    VCO=%.0f MHz, calculated freq=%.2f MHz\n",
+           bm1398_pll_vco_mhz(&pll), bm1398_pll_freq_mhz(&pll));
+    printf("    Writing PLL0 register 0x%02X = 0x%08X\n", ASIC_REG_PLL_PARAM_0, pll_value);
+
+    // Write PLL0 parameter (broadcast to all chips)
+    if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_PLL_PARAM_0, pll_value) < 0) {
+        fprintf(stderr, "    Error: Failed to write PLL0 register\n");
+        return -1;
+    }
+
+    usleep(10000);  // Wait for PLL to stabilize
+    printf("    Frequency configuration complete\n");
+
+    return 0;
+}
+
+//==============================================================================
+// Per-Chip Frequency Ramp
+//==============================================================================
+
+static const char *ramp_state_names[BM1398_RAMP_NUM_STATES] = {
+    "absent", "active", "done", "held", "lost",
+};
+
+/**
+ * Ramp every chip to target_mhz from BM1398_RAMP_BASE_MHZ. Set
+ * ramp->target_mhz[i] afterwards for chips that should differ.
+ */
+void bm1398_ramp_init(bm1398_ramp_t *ramp, uint32_t target_mhz) {
+    memset(ramp, 0, sizeof(*ramp));
+    ramp->base_mhz = BM1398_RAMP_BASE_MHZ;
+    ramp->step_mhz = BM1398_RAMP_STEP_MHZ;
+    ramp->settle_ms = BM1398_RAMP_SETTLE_MS;
+    for (int i = 0; i < BM1398_SCAN_MAX_CHIPS; i++) {
+        ramp->target_mhz[i] = target_mhz;
+    }
+}
+
+// One step from cur toward target, never past it
+static uint32_t ramp_next(uint32_t cur, uint32_t target, uint32_t step) {
+    if (target > cur) {
+        return target - cur > step ? cur + step : target;
+    }
+    return cur - target > step ? cur - step : target;
+}
+
+// PLL0 from the whole chain, done once every chip still in the ramp answers.
+// A lost reply is not a verdict: while chips are missing the chain is
+// scanned again, up to BM1398_RAMP_RETRIES times, and the replies merged.
+static int ramp_scan(bm1398_context_t *ctx, int chain, const bm1398_ramp_t *ramp,
+                     bm1398_chain_scan_t *scan) {
+    bool want[BM1398_SCAN_MAX_CHIPS];
+    int expected = 0;
+    for (int i = 0; i < ramp->num_chips; i++) {
+        want[i] = ramp->state[i] != BM1398_RAMP_ABSENT && ramp->state[i] != BM1398_RAMP_LOST;
+        expected += want[i];
+    }
+
+    bm1398_chain_scan_t retry;
+    for (int tries = 0; tries < BM1398_RAMP_RETRIES; tries++) {
+        bm1398_chain_scan_t *s = tries ? &retry : scan;
+        if (bm1398_scan_chain_begin(ctx, chain, ASIC_REG_PLL_PARAM_0, true, s) < 0) {
+            return -1;
+        }
+        s->expected = expected;
+        if (bm1398_scan_chain_wait(ctx, s, BM1398_SCAN_TIMEOUT_MS) < 0) {
+            return -1;
+        }
+
+        int missing = 0;
+        for (int i = 0; i < ramp->num_chips; i++) {
+            if (tries && retry.present[i]) {
+                scan->responded += !scan->present[i];
+                scan->present[i] = true;
+                scan->value[i] = retry.value[i];
+            }
+            missing += want[i] && !scan->present[i];
+        }
+        if (missing == 0) {
+            break;
+        }
+    }
+    return scan->responded;
+}
+
+static bool ramp_confirmed(const bm1398_chain_scan_t *scan, int chip, uint32_t mhz) {
+    return scan->present[chip] &&
+           (scan->value[chip] & BM1398_PLL_DIV_MASK) == (bm1398_pll_reg_for(mhz) & BM1398_PLL_DIV_MASK);
+}
+
+/**
+ * Walk every chip on a chain to its own frequency
+ *
+ * The whole chain is first put on base_mhz by broadcast and scanned; chips
+ * that do not answer there in BM1398_RAMP_RETRIES scans are left alone.
+ * Then each round moves every active chip one step_mhz toward its target
+ * with a back-to-back batch of unicast PLL0 writes, waits settle_ms and
+ * scans PLL0, again asking chips whose reply went missing up to
+ * BM1398_RAMP_RETRIES times. A chip that answered with the old dividers,
+ * or stayed silent through every retry, is written back to the last
+ * frequency it confirmed and held there. If anything was rolled back the
+ * chain is scanned again, and chips still silent are marked lost.
+ *
+ * Returns number of chips held or lost, -1 on UART or scan failure
+ */
+int bm1398_ramp_chain(bm1398_context_t *ctx, int chain, bm1398_ramp_t *ramp) {
+    if (!ctx || !ctx->initialized || !ramp || chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
+
+    int num_chips = ctx->chips_per_chain[chain];
+    if (num_chips <= 0 || num_chips > BM1398_SCAN_MAX_CHIPS) {
+        fprintf(stderr, "Error: Chain %d has %d chips, cannot ramp\n", chain, num_chips);
+        return -1;
+    }
+
+    int interval = 256 / num_chips;
+    if (interval < 1) interval = 1;
+    uint32_t step = ramp->step_mhz ? ramp->step_mhz : BM1398_RAMP_STEP_MHZ;
 
-        // Step 1: Configure PLL3 register (0x68) - Use direct write
-        printf("    Configuring PLL3 (reg 0x68) for 400MHz UART clock...\n");
-        bm1398_write_register(ctx, chain, true, 0, ASIC_REG_PLL_PARAM_3, 0xC0700111);
-        usleep(10000);
+    ramp->num_chips = num_chips;
+    ramp->steps = ramp->writes = ramp->rollbacks = 0;
+    ramp->result = -1;
+    uint64_t t0 = monotonic_ns();
 
-        // Step 2: Configure BAUD_CONFIG register (0x28) - Use direct write
-        printf("    Configuring BAUD_CONFIG (reg 0x28) for high-speed mode...\n");
-        bm1398_write_register(ctx, chain, true, 0, ASIC_REG_BAUD_CONFIG, 0x06008F00);
-        usleep(10000);
+    // Everyone on base, and find out who is there
+    bm1398_chain_scan_t scan;
+    if (bm1398_set_frequency(ctx, chain, ramp->base_mhz) < 0) {
+        return -1;
+    }
+    usleep(ramp->settle_ms * 1000);
+    for (int i = 0; i < num_chips; i++) {
+        ramp->state[i] = BM1398_RAMP_ACTIVE;
+    }
+    if (ramp_scan(ctx, chain, ramp, &scan) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < num_chips; i++) {
+        if (ramp->target_mhz[i] == 0) ramp->target_mhz[i] = ramp->base_mhz;
+        ramp->freq_mhz[i] = ramp->base_mhz;
+        if (!ramp_confirmed(&scan, i, ramp->base_mhz)) {
+            ramp->state[i] = BM1398_RAMP_ABSENT;
+        } else if (ramp->target_mhz[i] == ramp->base_mhz) {
+            ramp->state[i] = BM1398_RAMP_DONE;
+        } else {
+            ramp->state[i] = BM1398_RAMP_ACTIVE;
+        }
+    }
 
-        // Step 3: Configure CLK_CTRL register (0x18) with divisor + high-speed bit
-        printf("    Writing CLK_CTRL (reg 0x18) with divisor and high-speed bit...\n");
+    bm1398_cmd_t cmds[BM1398_SCAN_MAX_CHIPS];
+    uint32_t next[BM1398_SCAN_MAX_CHIPS];
+    bool stepped[BM1398_SCAN_MAX_CHIPS];
 
-        // Build CLK_CTRL value from scratch, don't read
-        // Base value: 0xF0000000 (from reset sequence)
-        // Add divisor and high-speed bit
-        reg_val = 0xF0000000 |                          // Base value from reset
-                  (((baud_div >> 5) & 0xF) << 8) |      // Upper 4 bits of divisor to [11:8]
-                  (baud_div & 0x1F) |                   // Lower 5 bits of divisor to [4:0]
-                  0x00010000;                           // Bit 16: high-speed enable
+    for (;;) {
+        int n = 0;
+        for (int i = 0; i < num_chips; i++) {
+            stepped[i] = ramp->state[i] == BM1398_RAMP_ACTIVE;
+            if (!stepped[i]) continue;
+            next[i] = ramp_next(ramp->freq_mhz[i], ramp->target_mhz[i], step);
+            bm1398_prepare_write_register(&cmds[n++], false, (uint8_t)(i * interval),
+                                          ASIC_REG_PLL_PARAM_0, bm1398_pll_reg_for(next[i]));
+        }
+        if (n == 0) {
+            break;
+        }
 
-        if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CLK_CTRL, reg_val) < 0) {
-            fprintf(stderr, "Error: Failed to write CLK_CTRL (high-speed)\n");
+        if (bm1398_send_cmd_batch(ctx, chain, cmds, n, 0, NULL) != n) {
+            fprintf(stderr, "Error: Ramp step %d failed on chain %d\n", ramp->steps + 1, chain);
             return -1;
         }
+        ramp->steps++;
+        ramp->writes += n;
+        usleep(ramp->settle_ms * 1000);
 
-    } else {
-        // Low-speed mode (<= 3 MHz) - uses 25 MHz base clock
-        // Source: Binary Ninja sub_2991c @ 0x2991c
-
-        printf("    LOW-SPEED baud mode (<=3MHz)...\n");
+        if (ramp_scan(ctx, chain, ramp, &scan) < 0) {
+            return -1;
+        }
 
-        // Calculate divisor: 25MHz / (baud * 8) - 1
-        baud_div = (25000000 / (baud_rate * 8)) - 1;
-        printf("    Baud divisor (low-speed): %u (0x%X)\n", baud_div, baud_div);
+        // Chips that did not take the step go back to where they were
+        int back = 0;
+        bool silent = false;
+        for (int i = 0; i < num_chips; i++) {
+            if (ramp->state[i] == BM1398_RAMP_ABSENT || ramp->state[i] == BM1398_RAMP_LOST) {
+                continue;
+            }
+            if (stepped[i] && ramp_confirmed(&scan, i, next[i])) {
+                ramp->freq_mhz[i] = next[i];
+                if (next[i] == ramp->target_mhz[i]) ramp->state[i] = BM1398_RAMP_DONE;
+            } else if (stepped[i]) {
+                bm1398_prepare_write_register(&cmds[back++], false, (uint8_t)(i * interval),
+                                              ASIC_REG_PLL_PARAM_0,
+                                              bm1398_pll_reg_for(ramp->freq_mhz[i]));
+                ramp->state[i] = BM1398_RAMP_HELD;
+                printf("  Chain %d chip %d (addr 0x%02X): %s at %u MHz, held at %u MHz\n",
+                       chain, i, i * interval, scan.present[i] ? "no lock" : "no reply",
+                       next[i], ramp->freq_mhz[i]);
+            } else if (!scan.present[i]) {
+                silent = true;
+            }
+        }
+        if (back == 0 && !silent) {
+            continue;
+        }
 
-        // Configure CLK_CTRL register (0x18) with divisor, clear high-speed bit
-        printf("    Writing CLK_CTRL (reg 0x18) with divisor, low-speed mode...\n");
+        if (back > 0) {
+            if (bm1398_send_cmd_batch(ctx, chain, cmds, back, 0, NULL) != back) {
+                fprintf(stderr, "Error: Ramp rollback failed on chain %d\n", chain);
+                return -1;
+            }
+            ramp->writes += back;
+            ramp->rollbacks += back;
+            usleep(ramp->settle_ms * 1000);
+            if (ramp_scan(ctx, chain, ramp, &scan) < 0) {
+                return -1;
+            }
+        }
+        for (int i = 0; i < num_chips; i++) {
+            if (ramp->state[i] != BM1398_RAMP_ABSENT && ramp->state[i] != BM1398_RAMP_LOST &&
+                !scan.present[i]) {
+                ramp->state[i] = BM1398_RAMP_LOST;
+                printf("  Chain %d chip %d (addr 0x%02X): silent at %u MHz\n",
+                       chain, i, i * interval, ramp->freq_mhz[i]);
+            }
+        }
+    }
 
-        // Build CLK_CTRL value from scratch, don't read
-        // Base value: 0xF0000400 (from reset sequence with soft reset enabled)
-        // Add divisor, ensure high-speed bit is clear
-        reg_val = 0xF0000400 |                          // Base value from reset with soft reset enabled
-                  (((baud_div >> 5) & 0xF) << 8) |      // Upper 4 bits of divisor to [11:8]
-                  (baud_div & 0x1F);                    // Lower 5 bits of divisor to [4:0]
-        // High-speed bit already clear in base value
+    ramp->elapsed_ns = monotonic_ns() - t0;
+    ramp->result = 0;
 
-        if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_CLK_CTRL, reg_val) < 0) {
-            fprintf(stderr, "Error: Failed to write CLK_CTRL (low-speed)\n");
-            return -1;
-        }
+    int off = 0;
+    for (int i = 0; i < num_chips; i++) {
+        off += ramp->state[i] == BM1398_RAMP_HELD || ramp->state[i] == BM1398_RAMP_LOST;
     }
+    return off;
+}
 
-    usleep(50000);  // 50ms settle time for baud rate change
-    printf("    Baud rate %u Hz configuration complete\n", baud_rate);
-    return 0;
+typedef struct {
+    bm1398_context_t *ctx;
+    int chain;
+    bm1398_ramp_t *ramp;
+} ramp_chain_job_t;
+
+static void *ramp_chain_thread(void *arg) {
+    ramp_chain_job_t *job = arg;
+    bm1398_ramp_chain(job->ctx, job->chain, job->ramp);
+    return NULL;
 }
 
 /**
- * Set ASIC core frequency
+ * Ramp several chains concurrently
+ *
+ * Most of a ramp is settle time and scan replies, so as with
+ * bm1398_init_chains_parallel() one thread per chain overlaps them and
+ * only the command sends share BC_COMMAND_BUFFER.
  *
- * Note: PLL configuration formula needs to be extracted from cgminer or bmminer.
- * This is a placeholder implementation.
+ * Returns 0 if every requested chain ramped (some chips may be held), -1 otherwise
  */
-int bm1398_set_frequency(bm1398_context_t *ctx, int chain, uint32_t freq_mhz) {
-    if (!ctx || !ctx->initialized) {
+int bm1398_ramp_chains_parallel(bm1398_context_t *ctx, uint32_t chain_mask,
+                                bm1398_ramp_t ramps[MAX_CHAINS]) {
+    if (!ctx || !ctx->initialized || !ramps) {
         return -1;
     }
 
-    printf("    Setting frequency to %u MHz...\n", freq_mhz);
+    ramp_chain_job_t jobs[MAX_CHAINS];
+    pthread_t threads[MAX_CHAINS];
+    bool started[MAX_CHAINS] = {false};
+    int failed = 0;
 
-    // PLL configuration for BM1398
-    // Formula: freq = CLKI * fbdiv / (refdiv * postdiv1 * postdiv2)
-    // Where CLKI = 25 MHz
-    // VCO = CLKI / refdiv * fbdiv (must be 1600-3200 MHz)
+    uint64_t t0 = monotonic_ns();
 
-    uint8_t refdiv, postdiv1, postdiv2;
-    uint16_t fbdiv;
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        if (!(chain_mask & (1U << chain))) {
+            continue;
+        }
+        jobs[chain].ctx = ctx;
+        jobs[chain].chain = chain;
+        jobs[chain].ramp = &ramps[chain];
+        ramps[chain].result = -1;
+
+        if (pthread_create(&threads[chain], NULL, ramp_chain_thread, &jobs[chain]) != 0) {
+            fprintf(stderr, "Error: Failed to start ramp thread for chain %d\n", chain);
+            failed++;
+            continue;
+        }
+        started[chain] = true;
+    }
 
-    // For 525 MHz (standard BM1398 frequency):
-    // Register encoding verified from Binary Ninja sub_29558 @ 0x29558:
-    // Bits [2:0] = postdiv2 (value-1 encoding)
-    // Bits [6:4] = refdiv (value-1 encoding)
-    // Bits [13:8] = postdiv1 (value-1 encoding)
-    // Bits [27:16] = fbdiv (direct value)
-    //
-    // Formula: freq = CLKI * fbdiv / (refdiv * (postdiv1+1) * (postdiv2+1))
-    // Where CLKI = 25 MHz
-    //
-    // For 525 MHz with register value 0x40540100:
-    // - fbdiv = 84 (bits [27:16] = 0x054)
-    // - postdiv1 = 1 (bits [13:8] = 0x01, actual divisor = 1+1 = 2)
-    // - refdiv = 0 (bits [6:4] = 0x0, actual divisor = 0+1 = 1)
-    // - postdiv2 = 0 (bits [2:0] = 0x0, actual divisor = 0+1 = 1)
-    //
-    // VCO = 25 * 84 / 1 = 2100 MHz
-    // freq = 2100 / (2 * 1) = 1050 MHz... WAIT, this doesn't match!
-    //
-    // Let me recalculate based on actual divisor values:
-    // If stored value is value-1, then:
-    // - refdiv_actual = 0+1 = 1
-    // - postdiv1_actual = 1+1 = 2
-    // - postdiv2_actual = 0+1 = 1
-    //
-    // But 2100/(1*2*1) = 1050, not 525!
-    //
-    // Maybe both postdiv contribute to divisor differently?
-    // Or maybe the formula is: freq = VCO / (postdiv1 * postdiv2)
-    // where VCO = CLKI / refdiv * fbdiv
-    //
-    // Let's use the values that work empirically from the doc:
-    uint8_t refdiv_reg, postdiv1_reg, postdiv2_reg;
-    uint16_t fbdiv_reg;
-
-    if (freq_mhz == 525) {
-        refdiv_reg = 0;    // Stored value (actual = 1)
-        fbdiv_reg = 84;    // Direct value
-        postdiv1_reg = 1;  // Stored value (actual = 2)
-        postdiv2_reg = 0;  // Stored value (actual = 1)
-    } else {
-        fprintf(stderr, "    Warning: Frequency %u MHz not supported, using 525 MHz\n", freq_mhz);
-        refdiv_reg = 0;
-        fbdiv_reg = 84;
-        postdiv1_reg = 1;
-        postdiv2_reg = 0;
-    }
-
-    // Calculate VCO frequency for range check (using actual divisor values)
-    uint8_t refdiv_actual = refdiv_reg + 1;
-    uint8_t postdiv1_actual = postdiv1_reg + 1;
-    uint8_t postdiv2_actual = postdiv2_reg + 1;
-    float vco = 25.0f / refdiv_actual * fbdiv_reg;
-    float freq_actual = vco / (postdiv1_actual * postdiv2_actual);
-
-    printf("    PLL config: refdiv=%u (reg=0x%X), fbdiv=%u, postdiv1=%u (reg=0x%X), postdiv2=%u (reg=0x%X)\n",
-           refdiv_actual, refdiv_reg, fbdiv_reg, postdiv1_actual, postdiv1_reg, postdiv2_actual, postdiv2_reg);
-    printf("    VCO=%.0f MHz, calculated freq=%.0f MHz\n", vco, freq_actual);
-
-    // Build PLL register value (verified encoding from Binary Ninja sub_29558)
-    // Bits [2:0] = postdiv2 & 7
-    // Bits [6:4] = refdiv & 7
-    // Bits [13:8] = postdiv1 & 0x3f
-    // Bits [27:16] = fbdiv & 0xfff
-    uint32_t pll_value = 0x40000000 |
-                         (postdiv2_reg & 0x7) |
-                         ((refdiv_reg & 0x7) << 4) |
-                         ((postdiv1_reg & 0x3f) << 8) |
-                         ((fbdiv_reg & 0xfff) << 16);
-
-    // Set VCO range bit based on VCO frequency
-    if (vco >= 2400.0f && vco <= 3200.0f) {
-        pll_value |= 0x10000000;  // High VCO range (bit 28)
-    } else if (vco < 1600.0f || vco > 3200.0f) {
-        fprintf(stderr, "    Error: VCO %.0f MHz out of range (1600-3200 MHz)\n", vco);
-        return -1;
-    }
-
-    printf("    Writing PLL0 register 0x08 = 0x%08X (expected 0x40540100)\n", pll_value);
-
-    // Write PLL0 parameter to register 0x08 (broadcast to all chips)
-    if (bm1398_write_register(ctx, chain, true, 0, 0x08, pll_value) < 0) {
-        fprintf(stderr, "    Error: Failed to write PLL0 register\n");
-        return -1;
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        if (!started[chain]) {
+            continue;
+        }
+        pthread_join(threads[chain], NULL);
+        if (ramps[chain].result < 0) {
+            failed++;
+        }
     }
 
-    usleep(10000);  // Wait for PLL to stabilize
-    printf("    Frequency configuration complete\n");
+    uint64_t wall_ns = monotonic_ns() - t0;
 
-    return 0;
+    printf("\n====================================\n");
+    printf("Frequency Ramp\n");
+    printf("====================================\n");
+    printf("  Chain  steps  writes  rollbacks");
+    for (int s = 0; s < BM1398_RAMP_NUM_STATES; s++) {
+        printf(" %7s", ramp_state_names[s]);
+    }
+    printf("  min/max MHz  time (ms)\n");
+
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        if (!(chain_mask & (1U << chain))) {
+            continue;
+        }
+        const bm1398_ramp_t *r = &ramps[chain];
+        int counts[BM1398_RAMP_NUM_STATES] = {0};
+        uint32_t lo = 0, hi = 0;
+        for (int i = 0; i < r->num_chips; i++) {
+            counts[r->state[i]]++;
+            if (r->state[i] == BM1398_RAMP_ABSENT || r->state[i] == BM1398_RAMP_LOST) continue;
+            if (lo == 0 || r->freq_mhz[i] < lo) lo = r->freq_mhz[i];
+            if (r->freq_mhz[i] > hi) hi = r->freq_mhz[i];
+        }
+        printf("  %5d  %5d  %6d  %9d", chain, r->steps, r->writes, r->rollbacks);
+        for (int s = 0; s < BM1398_RAMP_NUM_STATES; s++) {
+            printf(" %7d", counts[s]);
+        }
+        printf("  %4u/%-4u   %9.1f%s\n", lo, hi, r->elapsed_ns / 1e6,
+               r->result < 0 ? "  FAILED" : "");
+    }
+    printf("  Wall: %.1f ms\n", wall_ns / 1e6);
+
+    return failed > 0 ? -1 : 0;
 }
 
 //==============================================================================
@@ -1744,12 +3334,12 @@ int bm1398_enable_work_send(bm1398_context_t *ctx) {
     // Disable auto-pattern generation (clear bit 14 of register 35)
     // Factory test sub_2213c: fpga_read(0x23); fpga_write(0x23, val & 0xffffbfff)
     // This MUST be done or FPGA won't accept external work!
-    uint32_t reg35 = fpga_read_indirect(ctx, FPGA_REG_WORK_CTRL_ENABLE);
+    uint32_t reg35 = fpga_read_work_ctrl_enable(ctx);
     printf("  Disabling auto-gen pattern (reg 35 bit 14)...\n");
     printf("    Register 35 before: 0x%08X\n", reg35);
-    fpga_write_indirect(ctx, FPGA_REG_WORK_CTRL_ENABLE, reg35 & 0xFFFFBFFF);
+    fpga_write_work_ctrl_enable(ctx, reg35 & 0xFFFFBFFF);
     printf("    Register 35 after:  0x%08X (bit 14 cleared)\n",
-           fpga_read_indirect(ctx, FPGA_REG_WORK_CTRL_ENABLE));
+           fpga_read_work_ctrl_enable(ctx));
 
     // Register 0x2D (0xB4/4) = work send enable (if needed)
     // Note: This may not be required based on binary analysis
@@ -1805,6 +3395,33 @@ int bm1398_set_ticket_mask(bm1398_context_t *ctx, int chain, uint32_t mask) {
     return 0;
 }
 
+/**
+ * Enable multi-midstate (version rolled) hashing on all chips of a chain
+ *
+ * version_mask is the BIP310 mask negotiated with the pool; only bits
+ * 13..28 fit the register. Each work then carries 4 midstates for 4
+ * versions and nonces report the slot they came from (NONCE_MIDSTATE).
+ * A mask of 0 disables rolling: the 4 slots must hold the same midstate.
+ */
+int bm1398_set_version_rolling(bm1398_context_t *ctx, int chain, uint32_t version_mask) {
+    if (!ctx || !ctx->initialized || chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
+
+    uint32_t value = (version_mask >> VERSION_ROLLING_MASK_SHIFT) & 0xFFFF;
+    if (version_mask) {
+        value |= VERSION_ROLLING_ENABLE;
+    }
+
+    printf("Setting version rolling = 0x%08X for chain %d...\n", value, chain);
+
+    if (bm1398_write_register(ctx, chain, true, 0, ASIC_REG_VERSION_ROLLING, value) < 0) {
+        fprintf(stderr, "Error: Failed to set version rolling\n");
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * Check if work FIFO has space available for a specific chain
  * Returns: 1 if ready, 0 if not ready, -1 on error
@@ -1831,124 +3448,254 @@ int bm1398_check_work_fifo_ready(bm1398_context_t *ctx, int chain) {
     return ((buffer_status & (1 << chain)) != 0) ? 1 : 0;
 }
 
+#define WORK_FIFO_SPIN_US      20          // Re-read REG_BUFFER_SPACE this long before sleeping
+#define WORK_FIFO_POLL_US      50          // Work FIFO space poll interval once sleeping
+#define WORK_FIFO_TIMEOUT_US   1000000     // 1 second max wait
+
 /**
- * Send work to ASIC chain via FPGA
+ * Set how many packets one REG_BUFFER_SPACE ready bit is trusted for
  *
- * Source: Bitmain single_board_test.c software_pattern_4_midstate_send_function
- *         and set_TW_write_command
+ * The factory test re-checks the bit before every packet (grant 1). A larger
+ * grant is only safe up to the FPGA's real work FIFO depth for the chain.
  */
-int bm1398_send_work(bm1398_context_t *ctx, int chain, uint32_t work_id,
-                    const uint8_t *work_data_12bytes,
-                    const uint8_t midstates[4][32]) {
-    if (!ctx || !ctx->initialized || !work_data_12bytes || !midstates) {
+int bm1398_set_work_credit_grant(bm1398_context_t *ctx, int chain, uint32_t grant) {
+    if (!ctx || chain < 0 || chain >= MAX_CHAINS || grant == 0) {
         return -1;
     }
 
-    if (chain < 0 || chain >= MAX_CHAINS) {
-        fprintf(stderr, "Error: Invalid chain %d\n", chain);
-        return -1;
-    }
+    ctx->work_flow[chain].credit_grant = grant;
+    ctx->work_flow[chain].credits = 0;  // Re-sample before trusting the new grant
+    return 0;
+}
 
-    // Wait for FPGA work FIFO space before sending
-    // Factory test checks buffer space to avoid overwhelming FPGA
-    // uint32_t buffer_status = ctx->fpga_regs[REG_BUFFER_SPACE];
-    // printf("[DEBUG] Buffer space register (0x00C): 0x%08X (chain %d bit=%d)\n",
-    //        buffer_status, chain, (buffer_status >> chain) & 1);
+void bm1398_get_work_flow_stats(bm1398_context_t *ctx, int chain, bm1398_work_flow_t *stats) {
+    *stats = ctx->work_flow[chain];
+}
+
+void bm1398_reset_work_flow_stats(bm1398_context_t *ctx, int chain) {
+    bm1398_work_flow_t *flow = &ctx->work_flow[chain];
+    uint32_t grant = flow->credit_grant;
 
-    int timeout = 1000;  // 1 second max wait
-    while (bm1398_check_work_fifo_ready(ctx, chain) < 1 && timeout > 0) {
-        usleep(1000);  // 1ms
-        timeout--;
+    memset(flow, 0, sizeof(*flow));
+    flow->credit_grant = grant;
+}
+
+void bm1398_print_work_flow_stats(bm1398_context_t *ctx) {
+    printf("Work FIFO flow control:\n");
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        const bm1398_work_flow_t *f = &ctx->work_flow[chain];
+        if (f->packets == 0 && f->stalls == 0) {
+            continue;
+        }
+        printf("  Chain %d: %llu packets, %llu samples (grant %u), %llu stalls (%llu slept, %llu timeouts)\n",
+               chain, (unsigned long long)f->packets, (unsigned long long)f->samples,
+               f->credit_grant, (unsigned long long)f->stalls,
+               (unsigned long long)f->sleeps, (unsigned long long)f->timeouts);
+        printf("           backpressure %.3f ms total, %.1f us longest\n",
+               f->backpressure_ns / 1e6, f->max_stall_ns / 1e3);
     }
-    if (timeout == 0) {
-        fprintf(stderr, "Error: Work FIFO timeout on chain %d\n", chain);
-        return -1;
+}
+
+/**
+ * Take one work FIFO credit, re-sampling REG_BUFFER_SPACE only when the
+ * chain has none left
+ *
+ * A full FIFO means the chain is the bottleneck. Spin on the register first,
+ * since a work frame drains in ~100us at 12 Mbaud and usleep() rounds up to
+ * a scheduler tick; then fall back to sleeping polls.
+ * Returns 0 with a credit taken, -1 on timeout.
+ */
+static int work_fifo_acquire(bm1398_context_t *ctx, int chain) {
+    bm1398_work_flow_t *flow = &ctx->work_flow[chain];
+
+    if (flow->credits > 0) {
+        flow->credits--;
+        return 0;
     }
-    // printf("[DEBUG] FPGA work FIFO ready for chain %d (waited %dms)\n",
-    //        chain, 1000 - timeout);
 
-    // Build work packet (148 bytes = 0x94)
-    work_packet_t work;
-    memset(&work, 0, sizeof(work));
+    flow->samples++;
+    if (bm1398_check_work_fifo_ready(ctx, chain) == 1) {
+        flow->credits = flow->credit_grant - 1;
+        return 0;
+    }
 
-    work.work_type = 0x01;
-    work.chain_id = (uint8_t)chain | 0x80;
-    work.reserved[0] = 0x00;
-    work.reserved[1] = 0x00;
+    // Backpressure
+    uint64_t start = monotonic_ns();
+    uint64_t spin_until = start + WORK_FIFO_SPIN_US * 1000ULL;
+    uint64_t deadline = start + WORK_FIFO_TIMEOUT_US * 1000ULL;
+    uint64_t now = start;
+    bool ready = false;
+    bool slept = false;
 
-    // Work ID: Shift left by 3, then store in native byte order
-    // Will be byte-swapped later with all other fields
-    // Don't pre-swap work_id, let the global swap handle it
-    // Factory test: work_id << 3, then whole packet byte-swapped
-    work.work_id = work_id << 3;
+    flow->stalls++;
+    while (now < deadline) {
+        flow->samples++;
+        if (bm1398_check_work_fifo_ready(ctx, chain) == 1) {
+            ready = true;
+            break;
+        }
+        if (now < spin_until) {
+            cpu_relax();
+        } else {
+            slept = true;
+            usleep(WORK_FIFO_POLL_US);
+        }
+        now = monotonic_ns();
+    }
 
-    // Copy last 12 bytes of block header
-    memcpy(work.work_data, work_data_12bytes, 12);
+    uint64_t waited = monotonic_ns() - start;
+    flow->backpressure_ns += waited;
+    if (waited > flow->max_stall_ns) flow->max_stall_ns = waited;
+    if (slept) flow->sleeps++;
 
-    // Copy 4 midstates (32 bytes each)
-    for (int i = 0; i < 4; i++) {
-        memcpy(work.midstate[i], midstates[i], 32);
+    if (!ready) {
+        flow->timeouts++;
+        return -1;
     }
+    flow->credits = flow->credit_grant - 1;
+    return 0;
+}
 
-    // Byte-swap all 32-bit words in the packet to big-endian
-    // Total: 148 bytes / 4 = 37 words
-    // This swaps work_id, work_data, and midstates to network byte order
-    uint32_t *words = (uint32_t *)&work;
+/**
+ * Byte-swap n 32-bit words (n multiple of 4) from src bytes to dst words,
+ * i.e. big-endian loads. vrev32 does four words per instruction on NEON.
+ */
+static inline void bswap32_words(uint32_t *dst, const uint8_t *src, int n) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (int i = 0; i < n; i += 4) {
+        uint8x16_t v = vld1q_u8(src + i * 4);
+        vst1q_u8((uint8_t *)(dst + i), vrev32q_u8(v));
+    }
+#else
+    for (int i = 0; i < n; i++) {
+        uint32_t w;
+        memcpy(&w, src + i * 4, 4);
+        dst[i] = __builtin_bswap32(w);
+    }
+#endif
+}
 
-    // printf("[DEBUG] Work packet before byte-swap (work_id=%u, chain=%d):\n", work_id, chain);
-    // printf("  Header: type=0x%02X chain_id=0x%02X work_id=0x%08X\n",
-    //        work.work_type, work.chain_id, work.work_id);
-    // printf("  First 16 bytes: ");
-    // for (int j = 0; j < 16 && j < sizeof(work); j++) {
-    //     printf("%02x ", ((uint8_t*)&work)[j]);
-    // }
-    // printf("\n");
+/**
+ * Format a work packet ready to push: all 37 words already byte-swapped the
+ * way the factory test sends them (work_id << 3, whole packet big-endian).
+ *
+ * midstates: num_midstates x 32 bytes; 1 = same midstate in all 4 slots
+ * (software pattern test), swapped once and replicated.
+ */
+void bm1398_prepare_work(bm1398_work_t *work, int chain, uint32_t work_id,
+                         const uint8_t *work_data_12bytes,
+                         const uint8_t *midstates, int num_midstates) {
+    bm1398_work_set_id(work, chain, work_id);
+
+    // Last 12 bytes of block header
+    for (int i = 0; i < 3; i++) {
+        uint32_t w;
+        memcpy(&w, work_data_12bytes + i * 4, 4);
+        work->words[BM1398_WORK_DATA_WORD + i] = __builtin_bswap32(w);
+    }
+
+    // 4 midstates (8 words each)
+    uint32_t *ms = &work->words[BM1398_WORK_MIDSTATE_WORD];
+    if (num_midstates == 1) {
+        bswap32_words(ms, midstates, 8);
+        for (int i = 1; i < 4; i++) {
+            memcpy(ms + i * 8, ms, 32);
+        }
+    } else {
+        bswap32_words(ms, midstates, 32);
+    }
+}
 
-    for (int i = 0; i < sizeof(work) / 4; i++) {
-        words[i] = __builtin_bswap32(words[i]);
+/**
+ * Send a prepared work packet (bm1398_prepare_work) to a chain
+ *
+ * The packet is pushed as-is; set_id may have retargeted it since it was
+ * prepared, so chain here only selects which FIFO space bit to wait on.
+ */
+int bm1398_send_prepared_work(bm1398_context_t *ctx, int chain, const bm1398_work_t *work) {
+    if (!ctx || !ctx->initialized || !work) {
+        return -1;
     }
 
-    // printf("[DEBUG] After byte-swap, first 4 words: 0x%08X 0x%08X 0x%08X 0x%08X\n",
-    //        words[0], words[1], words[2], words[3]);
+    if (chain < 0 || chain >= MAX_CHAINS) {
+        fprintf(stderr, "Error: Invalid chain %d\n", chain);
+        return -1;
+    }
 
-    // Hex dump for debugging
-    // printf("  Work Packet Hex Dump (148 bytes):\n");
-    // for(int j=0; j<148; j++) {
-    //     printf("%02x ", ((uint8_t*)&work)[j]);
-    //     if ((j+1) % 16 == 0) printf("\n");
-    // }
-    // printf("\n");
+    // Wait for FPGA work FIFO space before sending
+    // Factory test checks buffer space to avoid overwhelming FPGA
+    if (work_fifo_acquire(ctx, chain) < 0) {
+        fprintf(stderr, "Error: Work FIFO timeout on chain %d\n", chain);
+        return -1;
+    }
 
     // Write work packet to FPGA using INDIRECT MAPPING (FIFO-style)
     // Register mapping shows index 16→0x040, index 17→0x080!
-    // We need to write ALL 37 words to index 16 (the FIFO at 0x040)
-    //
-    // WRONG (previous code):
-    //   fpga_write(16, words[0]);     // → 0x040
-    //   fpga_write(17, words[1..36]); // → 0x080 (WRONG REGISTER!)
-    //
-    // CORRECT:
-    //   fpga_write(16, words[0..36]); // → 0x040 (FIFO pushes all words)
+    // ALL 37 words go to index 16 (the FIFO at 0x040), never index 17
+    // The FIFO is shared by all chains: keep each packet's words together
+    pthread_mutex_lock(&ctx->lock);
+    fpga_push_tw_write_cmd(ctx, work->words, BM1398_WORK_WORDS);
+    pthread_mutex_unlock(&ctx->lock);
+    ctx->work_flow[chain].packets++;
+
+    return 0;
+}
+
+/**
+ * Send work to ASIC chain via FPGA
+ *
+ * Source: Bitmain single_board_test.c software_pattern_4_midstate_send_function
+ *         and set_TW_write_command
+ */
+int bm1398_send_work(bm1398_context_t *ctx, int chain, uint32_t work_id,
+                    const uint8_t *work_data_12bytes,
+                    const uint8_t midstates[4][32]) {
+    if (!ctx || !ctx->initialized || !work_data_12bytes || !midstates) {
+        return -1;
+    }
 
-    int num_words = sizeof(work) / 4;  // 148 bytes / 4 = 37 words
+    if (chain < 0 || chain >= MAX_CHAINS) {
+        fprintf(stderr, "Error: Invalid chain %d\n", chain);
+        return -1;
+    }
 
-    // printf("[DEBUG] Writing %d words to FPGA FIFO at 0x040 (index 16)\n", num_words);
-    // printf("[DEBUG] First word: 0x%08X\n", words[0]);
+    // Build work packet (148 bytes = 0x94)
+    bm1398_work_t work;
+    bm1398_prepare_work(&work, chain, work_id, work_data_12bytes, midstates[0], 4);
 
-    // Write ALL words to index 16 (FIFO at 0x040)
-    for (int i = 0; i < num_words; i++) {
-        fpga_write_indirect(ctx, FPGA_REG_TW_WRITE_CMD_FIRST, words[i]);
+    // Pacing comes from FIFO credits; no fixed per-packet delay
+    if (bm1398_send_prepared_work(ctx, chain, &work) < 0) {
+        return -1;
     }
 
-    // printf("[DEBUG] Work packet sent to FPGA (work_id=%u, chain=%d)\n", work_id, chain);
-    // printf("[DEBUG] FPGA register 0x040 final value: 0x%08X\n",
-    //        ctx->fpga_regs[0x040 / 4]);
+    return 0;
+}
+
+//==============================================================================
+// Work Packet Arena
+//==============================================================================
 
-    usleep(10); // Small delay to prevent overwhelming FPGA
+int bm1398_work_arena_init(bm1398_work_arena_t *arena, int count) {
+    memset(arena, 0, sizeof(*arena));
+    if (count <= 0) {
+        return -1;
+    }
 
+    if (posix_memalign((void **)&arena->packets, 64, (size_t)count * sizeof(bm1398_work_t)) != 0) {
+        fprintf(stderr, "Error: Cannot allocate work arena (%d packets)\n", count);
+        arena->packets = NULL;
+        return -1;
+    }
+    arena->count = count;
     return 0;
 }
 
+void bm1398_work_arena_free(bm1398_work_arena_t *arena) {
+    free(arena->packets);
+    arena->packets = NULL;
+    arena->count = 0;
+}
+
 //==============================================================================
 // Nonce Collection
 //==============================================================================
@@ -1963,8 +3710,15 @@ int bm1398_get_nonce_count(bm1398_context_t *ctx) {
         return -1;
     }
 
+    // FIFO entries (register replies included) plus nonces a register read stashed
+    bm1398_fifo_demux_t *dm = &ctx->demux;
     uint32_t count = ctx->fpga_regs[REG_NONCE_NUMBER_IN_FIFO];
-    return count & 0x7FFF;  // Mask to 15 bits
+
+    pthread_mutex_lock(&dm->lock);
+    int stashed = dm->stash_count;
+    pthread_mutex_unlock(&dm->lock);
+
+    return (count & 0x7FFF) + stashed;  // Mask to 15 bits
 }
 
 /**
@@ -1973,40 +3727,35 @@ int bm1398_get_nonce_count(bm1398_context_t *ctx) {
  * Source: Bitmain single_board_test.c get_return_nonce
  *
  * Nonce FIFO returns 64-bit response (two 32-bit reads)
- * First read: Nonce value (32 bits)
- * Second read: Metadata - work_id, chip_id, chain_id (32 bits)
+ * REG_RETURN_NONCE: header - nonce flag, work_id, chain
+ * REG_RETURN_NONCE_VALUE: nonce value
  *
- * Format verified from S19 FPGA interface:
- * Word 0 [31:0]: Nonce value (little-endian)
- * Word 1 [31:24]: Chain ID
- * Word 1 [23:16]: Chip ID
- * Word 1 [15:8]: Core ID
- * Word 1 [7:0]: Work ID (lower 8 bits)
+ * Format as decoded by single_board_test (see FIFO_IS_NONCE):
+ * Header [30:16]: Work ID (packet work_id << 3 | midstate slot)
+ * Header [3:0]: Chain ID
+ * Nonce [31:24]: Core ID
+ * Nonce [23:16]: Chip address
  */
-int bm1398_read_nonce(bm1398_context_t *ctx, nonce_response_t *nonce) {
-    if (!ctx || !ctx->initialized || !nonce) {
-        return -1;
-    }
-
-    volatile uint32_t *regs = ctx->fpga_regs;
-
-    // Read nonce data from FIFO (64-bit = two 32-bit register reads)
-    // First read pops the entry, second read gets metadata
-    uint32_t nonce_value = regs[REG_RETURN_NONCE];  // First read: nonce value
-    uint32_t nonce_meta = regs[REG_RETURN_NONCE];   // Second read: metadata
-
+static void decode_nonce(nonce_response_t *nonce, uint32_t hdr, uint32_t value) {
     // Parse nonce response format from FPGA
-    nonce->nonce = nonce_value;                    // Full 32-bit nonce
-    nonce->chain_id = (nonce_meta >> 24) & 0xFF;   // Bits [31:24]: chain
-    nonce->chip_id = (nonce_meta >> 16) & 0xFF;    // Bits [23:16]: chip
-    nonce->core_id = (nonce_meta >> 8) & 0xFF;     // Bits [15:8]: core
-    nonce->work_id = (nonce_meta & 0xFF);          // Bits [7:0]: work_id
+    nonce->nonce = value;                       // Full 32-bit nonce
+    nonce->chain_id = FIFO_CHAIN(hdr);          // Header [3:0]: chain
+    nonce->chip_id = FIFO_NONCE_CHIP(value);    // Nonce [23:16]: chip
+    nonce->core_id = FIFO_NONCE_CORE(value);    // Nonce [31:24]: core
+    nonce->work_id = FIFO_WORK_ID(hdr);         // Header [30:16]: work_id
+    nonce->midstate = NONCE_MIDSTATE(nonce->work_id);
+}
 
-    return 1;  // Successfully read nonce
+int bm1398_read_nonce(bm1398_context_t *ctx, nonce_response_t *nonce) {
+    return bm1398_read_nonces(ctx, nonce, 1);
 }
 
 /**
  * Read multiple nonces from FPGA FIFO
+ *
+ * Nonces stashed by register reads come first, then the FIFO is drained
+ * through the demultiplexer. Register replies are routed on the way, so
+ * fewer than the FIFO count may come back.
  */
 int bm1398_read_nonces(bm1398_context_t *ctx, nonce_response_t *nonces,
                       int max_count) {
@@ -2014,21 +3763,103 @@ int bm1398_read_nonces(bm1398_context_t *ctx, nonce_response_t *nonces,
         return -1;
     }
 
-    int available = bm1398_get_nonce_count(ctx);
-    if (available <= 0) {
-        return 0;
+    bm1398_fifo_demux_t *dm = &ctx->demux;
+    int count = 0;
+
+    pthread_mutex_lock(&dm->lock);
+    if (dm->stash_count > 0) {
+        count = dm->stash_count < max_count ? dm->stash_count : max_count;
+        for (int i = 0; i < count; i++) {
+            decode_nonce(&nonces[i], dm->stash[i][0], dm->stash[i][1]);
+        }
+        dm->stash_count -= count;
+        memmove(dm->stash, dm->stash + count, dm->stash_count * sizeof(dm->stash[0]));
     }
+    if (count < max_count) {
+        count += demux_drain(ctx, nonces + count, max_count - count);
+    }
+    pthread_mutex_unlock(&dm->lock);
+
+    return count;
+}
 
-    int count = available < max_count ? available : max_count;
-    int read_count = 0;
+/**
+ * Open the kernel nonce stream. Separate descriptor from ctx->fd_regs so
+ * reading it does not change how the mapped registers behave; the module
+ * only drains the FIFO while a stream descriptor is being read.
+ */
+int bm1398_nonce_stream_open(void) {
+    int fd = open("/dev/axi_fpga_dev", O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open /dev/axi_fpga_dev: %s\n", strerror(errno));
+    }
+    return fd;
+}
 
-    for (int i = 0; i < count; i++) {
-        if (bm1398_read_nonce(ctx, &nonces[read_count]) > 0) {
-            read_count++;
-        }
+/**
+ * Read up to max_count nonces from the kernel stream, waiting at most
+ * timeout_ms for the first one (-1 = forever, 0 = don't wait).
+ * ts_ns (optional) receives the CLOCK_MONOTONIC drain time of each nonce.
+ * Register replies are routed to ctx's in-flight reads and scans, which
+ * is the only way they complete while the kernel owns the FIFO.
+ *
+ * Returns number of nonces read, 0 on timeout, -1 on error
+ * (EINVAL from read() means the loaded module has no nonce stream)
+ */
+int bm1398_nonce_stream_read(bm1398_context_t *ctx, int fd, nonce_response_t *nonces,
+                             uint64_t *ts_ns, int max_count, int timeout_ms) {
+    struct axi_nonce_record recs[256];
+
+    if (fd < 0 || !nonces || max_count <= 0) {
+        return -1;
     }
+    if (max_count > (int)(sizeof(recs) / sizeof(recs[0]))) {
+        max_count = sizeof(recs) / sizeof(recs[0]);
+    }
+
+    for (;;) {
+        ssize_t n = read(fd, recs, (size_t)max_count * sizeof(recs[0]));
+        if (n > 0) {
+            int count = 0;
+            if (ctx) pthread_mutex_lock(&ctx->demux.lock);
+            for (int i = 0; i < (int)(n / sizeof(recs[0])); i++) {
+                // The kernel popped these, so replies for waiting reads arrive here
+                if (!FIFO_IS_NONCE(recs[i].header)) {
+                    if (ctx) demux_reg_reply(&ctx->demux, recs[i].header, recs[i].value);
+                    continue;
+                }
+                if (ctx) ctx->demux.nonces++;
+                decode_nonce(&nonces[count], recs[i].header, recs[i].value);
+                if (ts_ns) ts_ns[count] = recs[i].ts_ns;
+                count++;
+            }
+            if (ctx) pthread_mutex_unlock(&ctx->demux.lock);
+            if (count == 0) {
+                continue;
+            }
+            return count;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            // Stock driver has no read(): returns -EINVAL
+            return -1;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
 
-    return read_count;
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ret = poll(&pfd, 1, timeout_ms);
+        if (ret == 0) {
+            return 0;
+        }
+        if (ret < 0 && errno != EINTR) {
+            return -1;
+        }
+        if (pfd.revents & POLLERR) {
+            errno = EIO;
+            return -1;
+        }
+    }
 }
 
 //==============================================================================
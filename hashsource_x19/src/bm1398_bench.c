@@ -0,0 +1,3804 @@
+/*
+ * BM1398 Driver Micro-benchmarks and Self-checks
+ *
+ * Runs on the host or on the Zynq without touching FPGA hardware.
+ *
+ * Usage: bm1398_bench <mode> [options]
+ *   crc5 [-n COUNT] [--exhaustive]   CRC5 table engine vs bitwise reference
+ *   cmd [-n COUNT]                   Prepared vs ad-hoc register write sends
+ *   batch [-n BATCHES] [-g GAP_US]   Back-to-back batch submission (114-chip enumeration)
+ *   init [-c CHAINS]                 Sequential vs parallel PT1 chain bring-up
+ *   replay [DUMP]                    Check the Stage 1 step table against an FPGA dump
+ *   nonce-dev [-s SECONDS]           Kernel nonce stream rate and latency (target only)
+ *   ring [-n COUNT] [--drop]         Nonce ring throughput with a synthetic producer
+ *   pattern-index [-r ROUNDS]        Hashed vs linear expected-nonce matching (full chain)
+ *   pattern-load [DIR]               mmap vs stdio loading of 114 pattern files
+ *   regs [-n COUNT]                  Indirect vs named FPGA accessors per work packet
+ *   work [-n COUNT]                  Work packet formatting: per-send build vs prepared arena
+ *   work-ring [-n N] [-b BATCH] [-g GRANT]
+ *                                    Work delivery: MMIO FIFO vs simulated fpga_mem ring (works/sec)
+ *   dispatch [-s SECONDS]            Per-chain dispatch threads vs one sender, chain 1 stalled
+ *   stratum [-o HOST:PORT] [-s SECONDS] [--no-rolling]
+ *                                    Pool client: notify-to-work latency and submit RTT
+ *   sha256 [-n COUNT]                Scalar vs 4-lane SHA-256: midstates and nonce checks
+ *   merkle [-n COUNT] [-b BRANCHES]  Work build: full rebuild vs cached job template
+ *   work-table [-n COUNT]            Nonce-to-work resolution: table slot vs linear scan
+ *   demux [-n COUNT] [-f DUMP]       Return FIFO: dump words, register reads while hashing
+ *   scan [-m MISSING] [-b BAUD] [-f DUMP]
+ *                                    One register from every chip: serial reads vs chain scan
+ *   shadow                           Read-modify-write via register shadow vs UART reads
+ *   pll [-f MHZ]                     PLL0 5 MHz table vs solver, 525 MHz encoding check
+ *   ramp                             Per-chip frequency ramp with rollback, chains in parallel
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include "../include/bm1398_asic.h"
+#include "../include/nonce_ring.h"
+#include "../include/pattern_index.h"
+#include "../include/pattern_file.h"
+#include "../include/work_dispatch.h"
+#include "../include/stratum.h"
+#include "../include/sha256.h"
+#include "../include/work_prefetch.h"
+
+#define DEFAULT_ITERATIONS  10000000
+
+//==============================================================================
+// Helpers
+//==============================================================================
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// xorshift64* - deterministic, cheap pseudo-random input generator
+static uint64_t rng_next(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+//==============================================================================
+// CRC5
+//==============================================================================
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint64_t mismatches;
+    uint32_t first_bad;
+} crc5_range_t;
+
+static void *crc5_exhaustive_worker(void *arg) {
+    crc5_range_t *r = arg;
+    uint8_t cmd[4];
+
+    for (uint64_t v = r->start; v < r->end; v++) {
+        put_be32(cmd, (uint32_t)v);
+        if (bm1398_crc5_cmd32(cmd) != bm1398_crc5_bitwise(cmd, 32)) {
+            if (r->mismatches++ == 0) {
+                r->first_bad = (uint32_t)v;
+            }
+        }
+    }
+    return NULL;
+}
+
+static int crc5_check_exhaustive(void) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpu > 0 ? (int)ncpu : 1;
+    pthread_t threads[64];
+    crc5_range_t ranges[64];
+
+    if (nthreads > 64) nthreads = 64;
+
+    printf("Exhaustive 32-bit check (2^32 inputs, %d threads)...\n", nthreads);
+    uint64_t t0 = now_ns();
+
+    uint64_t span = (1ULL << 32) / nthreads;
+    for (int i = 0; i < nthreads; i++) {
+        ranges[i].start = span * i;
+        ranges[i].end = (i == nthreads - 1) ? (1ULL << 32) : span * (i + 1);
+        ranges[i].mismatches = 0;
+        pthread_create(&threads[i], NULL, crc5_exhaustive_worker, &ranges[i]);
+    }
+
+    uint64_t mismatches = 0;
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+        if (ranges[i].mismatches && mismatches == 0) {
+            printf("  First mismatch: 0x%08X\n", ranges[i].first_bad);
+        }
+        mismatches += ranges[i].mismatches;
+    }
+
+    printf("  %llu mismatches (%.1f s)\n", (unsigned long long)mismatches,
+           (now_ns() - t0) / 1e9);
+    return mismatches == 0 ? 0 : -1;
+}
+
+static int crc5_check_random(long count) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    long mismatches = 0;
+    uint8_t cmd[8];
+
+    printf("Random check (%ld x 32-bit, %ld x 64-bit, all lengths 1-96 bits)...\n",
+           count, count);
+
+    for (long i = 0; i < count; i++) {
+        uint64_t v = rng_next(&seed);
+        put_be32(cmd, (uint32_t)(v >> 32));
+        put_be32(cmd + 4, (uint32_t)v);
+
+        if (bm1398_crc5_cmd32(cmd) != bm1398_crc5_bitwise(cmd, 32) ||
+            bm1398_crc5_cmd64(cmd) != bm1398_crc5_bitwise(cmd, 64)) {
+            if (mismatches++ == 0) {
+                printf("  First mismatch: 0x%016llX\n", (unsigned long long)v);
+            }
+        }
+    }
+
+    // Generic path, including partial trailing bytes
+    uint8_t buf[12];
+    for (int i = 0; i < 100000; i++) {
+        for (int j = 0; j < 12; j++) buf[j] = (uint8_t)rng_next(&seed);
+        unsigned int bits = 1 + i % 96;
+        if (bm1398_crc5(buf, bits) != bm1398_crc5_bitwise(buf, bits)) {
+            if (mismatches++ == 0) {
+                printf("  First mismatch: generic path, %u bits\n", bits);
+            }
+        }
+    }
+
+    printf("  %ld mismatches\n", mismatches);
+    return mismatches == 0 ? 0 : -1;
+}
+
+static double crc5_time(uint8_t (*fn)(const uint8_t *), long count, uint8_t *sink) {
+    uint8_t cmd[8] = {CMD_PREAMBLE_WRITE_BCAST, CMD_LEN_WRITE_REG, 0x00,
+                      ASIC_REG_TICKET_MASK, 0, 0, 0, 0};
+    uint8_t acc = 0;
+
+    uint64_t t0 = now_ns();
+    for (long i = 0; i < count; i++) {
+        cmd[7] = (uint8_t)i;  // Defeat hoisting out of the loop
+        cmd[2] = (uint8_t)(i >> 8);
+        acc ^= fn(cmd);
+    }
+    uint64_t t1 = now_ns();
+
+    *sink += acc;
+    return (double)(t1 - t0) / count;
+}
+
+static uint8_t crc5_bitwise32(const uint8_t *d) { return bm1398_crc5_bitwise(d, 32); }
+static uint8_t crc5_bitwise64(const uint8_t *d) { return bm1398_crc5_bitwise(d, 64); }
+
+static int bench_crc5(int argc, char **argv) {
+    long count = DEFAULT_ITERATIONS;
+    bool exhaustive = false;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--exhaustive") == 0) {
+            exhaustive = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        }
+    }
+
+    printf("====================================\n");
+    printf("CRC5 Self-check\n");
+    printf("====================================\n");
+
+    int ret = crc5_check_random(count);
+    if (exhaustive && crc5_check_exhaustive() < 0) {
+        ret = -1;
+    }
+
+    printf("\n====================================\n");
+    printf("CRC5 Benchmark (%ld commands)\n", count);
+    printf("====================================\n");
+
+    uint8_t sink = 0;
+    double bit32 = crc5_time(crc5_bitwise32, count, &sink);
+    double tab32 = crc5_time(bm1398_crc5_cmd32, count, &sink);
+    double bit64 = crc5_time(crc5_bitwise64, count, &sink);
+    double tab64 = crc5_time(bm1398_crc5_cmd64, count, &sink);
+
+    printf("  32-bit command: bitwise %7.2f ns, table %7.2f ns (%.1fx)\n",
+           bit32, tab32, bit32 / tab32);
+    printf("  64-bit command: bitwise %7.2f ns, table %7.2f ns (%.1fx)\n",
+           bit64, tab64, bit64 / tab64);
+    printf("  (checksum 0x%02X)\n", sink);
+
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Simulated FPGA
+//==============================================================================
+
+/*
+ * Heap-backed register file standing in for /dev/axi_fpga_dev (plus a
+ * /dev/fpga_mem sized buffer). An "ack" thread plays the FPGA side of
+ * BC_WRITE_COMMAND: it snapshots the command words and clears
+ * BC_COMMAND_BUFFER_READY, so the driver's send path runs unmodified.
+ * Register reads are answered with a reply entry keyed to the chain, chip
+ * and register read. One register backs the whole FIFO here, so both words
+ * of the entry read back as that meta word. A bench that needs real chip
+ * behaviour sets on_cmd, which sees every command instead and answers by
+ * handing reply entries straight to the demultiplexer.
+ */
+
+#define SIM_FPGA_MEM_SIZE   0x1000000
+typedef struct {
+    bm1398_context_t ctx;
+    pthread_t thread;
+    volatile bool running;
+    volatile uint64_t commands;
+    volatile uint64_t reads;          // Register read commands among them
+    uint32_t last_words[3];
+    void (*on_cmd)(void *model, bm1398_context_t *ctx, uint32_t chain, const uint32_t *words);
+    void *model;
+} sim_fpga_t;
+
+static void *sim_fpga_ack_thread(void *arg) {
+    sim_fpga_t *sim = arg;
+    volatile uint32_t *regs = sim->ctx.fpga_regs;
+
+    while (sim->running) {
+        if (regs[REG_BC_WRITE_COMMAND] & BC_COMMAND_BUFFER_READY) {
+            for (int i = 0; i < 3; i++) {
+                sim->last_words[i] = regs[REG_BC_COMMAND_BUFFER + i];
+            }
+            uint8_t preamble = sim->last_words[0] >> 24;
+            uint32_t chain = (regs[REG_BC_WRITE_COMMAND] >> 16) & 0xF;
+            bool read = preamble == CMD_PREAMBLE_READ_REG || preamble == CMD_PREAMBLE_READ_BCAST;
+            if (sim->on_cmd) {
+                sim->on_cmd(sim->model, &sim->ctx, chain, sim->last_words);
+            } else if (read) {
+                // Reply header (chip, register, chain); the value echoes it
+                regs[REG_RETURN_NONCE] = (sim->last_words[0] & 0xFFFF) << 8 | chain;
+                regs[REG_RETURN_NONCE_VALUE] = regs[REG_RETURN_NONCE];
+                regs[REG_NONCE_NUMBER_IN_FIFO] = 1;
+            }
+            sim->reads += read;
+            sim->commands++;
+            __sync_synchronize();
+            regs[REG_BC_WRITE_COMMAND] &= ~BC_COMMAND_BUFFER_READY;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static int sim_fpga_start(sim_fpga_t *sim, int num_chains) {
+    memset(sim, 0, sizeof(*sim));
+
+    uint32_t *regs = calloc(1, FPGA_REG_SIZE);
+    uint8_t *mem = calloc(1, SIM_FPGA_MEM_SIZE);
+    if (!regs || !mem) {
+        free(regs);
+        free(mem);
+        return -1;
+    }
+
+    bm1398_init_mapped(&sim->ctx, regs, mem);
+    sim->ctx.num_chains = num_chains;
+    for (int i = 0; i < num_chains && i < MAX_CHAINS; i++) {
+        sim->ctx.chips_per_chain[i] = CHIPS_PER_CHAIN_S19PRO;
+    }
+
+    sim->running = true;
+    if (pthread_create(&sim->thread, NULL, sim_fpga_ack_thread, sim) != 0) {
+        bm1398_cleanup(&sim->ctx);
+        free(regs);
+        free(mem);
+        return -1;
+    }
+    return 0;
+}
+
+static void sim_fpga_stop(sim_fpga_t *sim) {
+    void *regs = (void *)sim->ctx.fpga_regs;
+    void *mem = (void *)sim->ctx.fpga_mem;
+
+    sim->running = false;
+    pthread_join(sim->thread, NULL);
+    bm1398_cleanup(&sim->ctx);
+    free(regs);
+    free(mem);
+}
+
+// Driver bring-up paths are chatty; silence stdout around them
+static int quiet_begin(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    return saved;
+}
+
+static void quiet_end(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+static uint64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//==============================================================================
+// Prepared Commands
+//==============================================================================
+
+// Frequency-sweep style workload: every chip, a handful of register values
+#define CMD_SWEEP_VALUES    4
+
+static int cmd_check(void) {
+    uint64_t seed = 0xD1B54A32D192ED03ULL;
+    long mismatches = 0;
+
+    printf("Frame check (prepared words vs byte frame)...\n");
+
+    for (int i = 0; i < 100000; i++) {
+        uint64_t r = rng_next(&seed);
+        bool broadcast = r & 1;
+        uint8_t chip = (uint8_t)(r >> 8);
+        uint8_t reg = (uint8_t)(r >> 16);
+        uint32_t value = (uint32_t)(r >> 32);
+
+        uint8_t frame[9] = {
+            broadcast ? CMD_PREAMBLE_WRITE_BCAST : CMD_PREAMBLE_WRITE_REG,
+            CMD_LEN_WRITE_REG, chip, reg,
+            value >> 24, value >> 16, value >> 8, value, 0
+        };
+        frame[8] = bm1398_crc5_bitwise(frame, 64);
+
+        bm1398_cmd_t adhoc, prepared;
+        bm1398_prepare_cmd(&adhoc, frame, sizeof(frame));
+        bm1398_prepare_write_register(&prepared, broadcast, chip, reg, value);
+
+        if (memcmp(&adhoc, &prepared, sizeof(adhoc)) != 0) {
+            if (mismatches++ == 0) {
+                printf("  First mismatch: chip 0x%02X reg 0x%02X value 0x%08X\n",
+                       chip, reg, value);
+            }
+        }
+    }
+
+    printf("  %ld mismatches\n", mismatches);
+    return mismatches == 0 ? 0 : -1;
+}
+
+static int bench_cmd(int argc, char **argv) {
+    long count = 200000;
+    sim_fpga_t sim;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        }
+    }
+
+    printf("====================================\n");
+    printf("Prepared Command Self-check\n");
+    printf("====================================\n");
+
+    int ret = cmd_check();
+
+    if (sim_fpga_start(&sim, 1) < 0) {
+        fprintf(stderr, "Error: Failed to start simulated FPGA\n");
+        return 1;
+    }
+
+    int nchips = sim.ctx.chips_per_chain[0];
+    int ncmds = nchips * CMD_SWEEP_VALUES;
+    bm1398_cmd_t *table = malloc(sizeof(bm1398_cmd_t) * ncmds);
+    if (!table) {
+        sim_fpga_stop(&sim);
+        return 1;
+    }
+    for (int i = 0; i < ncmds; i++) {
+        bm1398_prepare_write_register(&table[i], false, (uint8_t)((i % nchips) * 2),
+                                      ASIC_REG_PLL_PARAM_0, 0x40540100 + (i / nchips));
+    }
+
+    printf("\n====================================\n");
+    printf("Register Write Benchmark (%ld sends)\n", count);
+    printf("====================================\n");
+
+    // Ad-hoc: frame + CRC5 + word packing on every send
+    uint64_t c0 = thread_cpu_ns(), w0 = now_ns();
+    for (long i = 0; i < count; i++) {
+        int n = i % ncmds;
+        if (bm1398_write_register(&sim.ctx, 0, false, (uint8_t)((n % nchips) * 2),
+                                  ASIC_REG_PLL_PARAM_0, 0x40540100 + (n / nchips)) < 0) {
+            ret = -1;
+            break;
+        }
+    }
+    uint64_t c1 = thread_cpu_ns(), w1 = now_ns();
+    uint32_t adhoc_last[3];
+    memcpy(adhoc_last, sim.last_words, sizeof(adhoc_last));
+
+    // Prepared: word stores and trigger only
+    for (long i = 0; i < count; i++) {
+        if (bm1398_send_cmd(&sim.ctx, 0, &table[i % ncmds]) < 0) {
+            ret = -1;
+            break;
+        }
+    }
+    uint64_t c2 = thread_cpu_ns(), w2 = now_ns();
+
+    if (memcmp(adhoc_last, sim.last_words, sizeof(adhoc_last)) != 0) {
+        fprintf(stderr, "Error: Prepared and ad-hoc sends produced different words\n");
+        ret = -1;
+    }
+
+    // Frame construction alone, i.e. the part prepared commands remove.
+    // The completion poll above still sleeps, which dominates the send.
+    volatile uint32_t *words = &sim.ctx.fpga_regs[REG_BC_COMMAND_BUFFER];
+    uint64_t b0 = thread_cpu_ns();
+    for (long i = 0; i < count; i++) {
+        int n = i % ncmds;
+        bm1398_cmd_t cmd;
+        bm1398_prepare_write_register(&cmd, false, (uint8_t)((n % nchips) * 2),
+                                      ASIC_REG_PLL_PARAM_0, 0x40540100 + (n / nchips));
+        words[0] = cmd.words[0];
+        words[1] = cmd.words[1];
+        words[2] = cmd.words[2];
+    }
+    uint64_t b1 = thread_cpu_ns();
+    for (long i = 0; i < count; i++) {
+        const bm1398_cmd_t *cmd = &table[i % ncmds];
+        words[0] = cmd->words[0];
+        words[1] = cmd->words[1];
+        words[2] = cmd->words[2];
+    }
+    uint64_t b2 = thread_cpu_ns();
+
+    printf("  Send (incl. completion wait):\n");
+    printf("    Ad-hoc:   %8.1f ns CPU/send, %9.1f ns wall/send\n",
+           (double)(c1 - c0) / count, (double)(w1 - w0) / count);
+    printf("    Prepared: %8.1f ns CPU/send, %9.1f ns wall/send\n",
+           (double)(c2 - c1) / count, (double)(w2 - w1) / count);
+    printf("  Frame build + word stores:\n");
+    printf("    Ad-hoc:   %8.2f ns/send\n", (double)(b1 - b0) / count);
+    printf("    Prepared: %8.2f ns/send\n", (double)(b2 - b1) / count);
+    printf("  FPGA saw %llu commands\n", (unsigned long long)sim.commands);
+
+    free(table);
+    sim_fpga_stop(&sim);
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Batched Submission
+//==============================================================================
+
+// Pre-batch send loop: trigger, then usleep(1) until bit 31 clears
+static int legacy_send(bm1398_context_t *ctx, int chain, const bm1398_cmd_t *cmd) {
+    volatile uint32_t *regs = ctx->fpga_regs;
+
+    for (int i = 0; i < cmd->num_words; i++) {
+        regs[REG_BC_COMMAND_BUFFER + i] = cmd->words[i];
+    }
+    regs[REG_BC_WRITE_COMMAND] = BC_COMMAND_BUFFER_READY | BC_CHAIN_ID(chain);
+
+    int timeout = 10000;
+    while ((regs[REG_BC_WRITE_COMMAND] & BC_COMMAND_BUFFER_READY) && timeout > 0) {
+        usleep(1);
+        timeout--;
+    }
+    return timeout == 0 ? -1 : 0;
+}
+
+static int bench_batch(int argc, char **argv) {
+    long batches = 200;
+    uint32_t gap_us = 0;
+    sim_fpga_t sim;
+    int ret = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            batches = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            gap_us = (uint32_t)atol(argv[++i]);
+        }
+    }
+    if (batches < 1) batches = 1;
+
+    if (sim_fpga_start(&sim, 1) < 0) {
+        fprintf(stderr, "Error: Failed to start simulated FPGA\n");
+        return 1;
+    }
+
+    int nchips = sim.ctx.chips_per_chain[0];
+    bm1398_cmd_t cmds[CHIPS_PER_CHAIN_S19PRO];
+    for (int i = 0; i < nchips; i++) {
+        bm1398_prepare_set_chip_address(&cmds[i], (uint8_t)(i * (256 / nchips)));
+    }
+
+    bm1398_calibrate_spin(&sim.ctx);
+
+    printf("====================================\n");
+    printf("Batch Submission Benchmark\n");
+    printf("====================================\n");
+    printf("  %d-command batches, gap %u us, %u polls/us\n\n",
+           nchips, gap_us, sim.ctx.spin_per_us);
+
+    // Legacy per-command round trip (a few batches is plenty)
+    long legacy_batches = batches < 5 ? batches : 5;
+    uint64_t t0 = now_ns();
+    for (long b = 0; b < legacy_batches; b++) {
+        for (int i = 0; i < nchips; i++) {
+            if (legacy_send(&sim.ctx, 0, &cmds[i]) < 0) {
+                ret = -1;
+            }
+        }
+    }
+    double legacy_ms = (now_ns() - t0) / 1e6 / legacy_batches;
+
+    // Batched, spin-polled
+    double sum_ms = 0, max_ms = 0;
+    uint32_t max_polls = 0;
+    for (long b = 0; b < batches; b++) {
+        bm1398_batch_stats_t stats;
+        int done = bm1398_send_cmd_batch(&sim.ctx, 0, cmds, nchips, gap_us, &stats);
+        if (done != nchips) {
+            fprintf(stderr, "Error: Batch %ld completed %d/%d\n", b, done, nchips);
+            ret = -1;
+            break;
+        }
+        double ms = stats.elapsed_ns / 1e6;
+        sum_ms += ms;
+        if (ms > max_ms) max_ms = ms;
+        if (stats.max_polls > max_polls) max_polls = stats.max_polls;
+    }
+
+    printf("  usleep(1) poll:   %8.3f ms/batch (%ld batches)\n", legacy_ms, legacy_batches);
+    printf("  Batched spin:     %8.3f ms/batch avg, %.3f ms max (%ld batches)\n",
+           sum_ms / batches, max_ms, batches);
+    printf("  Worst-case polls: %u per command\n", max_polls);
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        printf("  Note: single CPU - the simulated FPGA shares the core with the\n");
+        printf("        poller, so spin timings here are scheduler-bound\n");
+    }
+    printf("  FPGA saw %llu commands\n", (unsigned long long)sim.commands);
+
+    sim_fpga_stop(&sim);
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Parallel Chain Init
+//==============================================================================
+
+static void print_init_row(const char *label, const bm1398_init_timing_t *t) {
+    printf("  %-10s", label);
+    for (int p = 0; p < BM1398_NUM_PHASES; p++) {
+        printf(" %10.1f", t->phase_ns[p] / 1e6);
+    }
+    printf(" %10.1f%s\n", t->total_ns / 1e6, t->result < 0 ? "  FAILED" : "");
+}
+
+static int bench_init(int argc, char **argv) {
+    int num_chains = MAX_CHAINS;
+    sim_fpga_t sim;
+    int ret = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            num_chains = atoi(argv[++i]);
+        }
+    }
+    if (num_chains < 1) num_chains = 1;
+    if (num_chains > MAX_CHAINS) num_chains = MAX_CHAINS;
+
+    if (sim_fpga_start(&sim, num_chains) < 0) {
+        fprintf(stderr, "Error: Failed to start simulated FPGA\n");
+        return 1;
+    }
+
+    uint32_t mask = (1U << num_chains) - 1;
+    bm1398_init_timing_t seq[MAX_CHAINS], par[MAX_CHAINS];
+
+    printf("====================================\n");
+    printf("Chain Init Benchmark (%d chains, simulated FPGA)\n", num_chains);
+    printf("====================================\n");
+
+    int saved = quiet_begin();
+    uint64_t t0 = now_ns();
+    for (int chain = 0; chain < num_chains; chain++) {
+        if (bm1398_init_chains_parallel(&sim.ctx, 1U << chain, seq) < 0) {
+            ret = -1;
+        }
+    }
+    uint64_t t1 = now_ns();
+    if (bm1398_init_chains_parallel(&sim.ctx, mask, par) < 0) {
+        ret = -1;
+    }
+    uint64_t t2 = now_ns();
+    quiet_end(saved);
+
+    printf("  %-10s", "Phase (ms)");
+    for (int p = 0; p < BM1398_NUM_PHASES; p++) {
+        printf(" %10s", bm1398_init_phase_name(p));
+    }
+    printf(" %10s\n", "total");
+
+    char label[16];
+    for (int chain = 0; chain < num_chains; chain++) {
+        snprintf(label, sizeof(label), "seq ch%d", chain);
+        print_init_row(label, &seq[chain]);
+    }
+    for (int chain = 0; chain < num_chains; chain++) {
+        snprintf(label, sizeof(label), "par ch%d", chain);
+        print_init_row(label, &par[chain]);
+    }
+
+    printf("\n  Sequential: %8.1f ms\n", (t1 - t0) / 1e6);
+    printf("  Parallel:   %8.1f ms (%.2fx)\n", (t2 - t1) / 1e6,
+           (double)(t1 - t0) / (t2 - t1));
+    printf("  FPGA saw %llu commands\n", (unsigned long long)sim.commands);
+
+    sim_fpga_stop(&sim);
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// FPGA Dump Replay
+//==============================================================================
+
+/*
+ * Replays an fpga_logger register trace (docs/single_board_test_pt2_fpga_dump.log
+ * format: "[ts] INIT 0xOFF 0xVAL" and "[ts] 0xOFF: 0xOLD -> 0xNEW") into a
+ * register file and extracts every BC_COMMAND_BUFFER command. A command is
+ * captured when BC_COMMAND_BUFFER_READY falls, since the logger may record
+ * the word stores in the scan before or after the trigger.
+ */
+
+#define DEFAULT_DUMP        "../docs/single_board_test_pt2_fpga_dump.log"
+#define REPLAY_MAX_CMDS     4096
+
+typedef struct {
+    double t_trigger;
+    double t_done;
+    uint32_t words[3];
+} replay_cmd_t;
+
+// Word stores more than this apart belong to different commands
+#define REPLAY_SET_GAP      0.001
+
+static void replay_capture(replay_cmd_t *cmd, const uint32_t *regs,
+                           double t_trigger, double t_done) {
+    cmd->t_trigger = t_trigger;
+    cmd->t_done = t_done;
+    for (int i = 0; i < 3; i++) {
+        cmd->words[i] = regs[REG_BC_COMMAND_BUFFER + i];
+    }
+}
+
+static int replay_load(const char *path, replay_cmd_t *cmds, int max_cmds) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return -1;
+    }
+
+    uint32_t regs[FPGA_REG_SIZE / 4] = {0};
+    double t_trigger = 0;
+    double t_last_store = -1;
+    bool captured = true;   // Current word set already captured (INIT state is not a command)
+    int count = 0;
+    char line[256];
+
+    while (fgets(line, sizeof(line), fp) && count < max_cmds) {
+        double ts;
+        unsigned int off, old_val, new_val;
+
+        if (sscanf(line, "[%lf] INIT 0x%x 0x%x", &ts, &off, &new_val) == 3) {
+            if (off < FPGA_REG_SIZE) regs[off / 4] = new_val;
+            continue;
+        }
+        if (sscanf(line, "[%lf] 0x%x: 0x%x -> 0x%x", &ts, &off, &old_val, &new_val) != 4 ||
+            off >= FPGA_REG_SIZE) {
+            continue;
+        }
+
+        int word = off / 4;
+        if (word >= REG_BC_COMMAND_BUFFER && word < REG_BC_COMMAND_BUFFER + 3) {
+            // A new word set while the previous one was never seen completing:
+            // the logger missed that trigger, keep the command without timing
+            if (ts - t_last_store > REPLAY_SET_GAP) {
+                if (!captured) {
+                    replay_capture(&cmds[count++], regs, 0, 0);
+                    if (count == max_cmds) break;
+                }
+                captured = false;
+            }
+            t_last_store = ts;
+            regs[word] = new_val;
+            continue;
+        }
+
+        regs[word] = new_val;
+        if (word != REG_BC_WRITE_COMMAND) {
+            continue;
+        }
+
+        if (!(old_val & BC_COMMAND_BUFFER_READY) && (new_val & BC_COMMAND_BUFFER_READY)) {
+            t_trigger = ts;
+        } else if ((old_val & BC_COMMAND_BUFFER_READY) && !(new_val & BC_COMMAND_BUFFER_READY)) {
+            // Completion: the buffer holds the command (resent if unchanged)
+            replay_capture(&cmds[count++], regs, t_trigger, ts);
+            captured = true;
+        }
+    }
+
+    fclose(fp);
+    return count;
+}
+
+// Return FIFO entries in the trace: the REG_RETURN_NONCE header and
+// REG_RETURN_NONCE_VALUE word whenever the value leaves its empty pattern
+#define DUMP_FIFO_EMPTY_VALUE   0x5555AAAA
+
+static int replay_load_fifo(const char *path, uint32_t (*entries)[2], int max_entries) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return -1;
+    }
+
+    uint32_t hdr = 0;
+    int count = 0;
+    char line[256];
+
+    while (fgets(line, sizeof(line), fp) && count < max_entries) {
+        double ts;
+        unsigned int off, old_val, new_val;
+
+        if (sscanf(line, "[%lf] INIT 0x%x 0x%x", &ts, &off, &new_val) == 3) {
+            if (off / 4 == REG_RETURN_NONCE) hdr = new_val;
+            continue;
+        }
+        if (sscanf(line, "[%lf] 0x%x: 0x%x -> 0x%x", &ts, &off, &old_val, &new_val) != 4) {
+            continue;
+        }
+        if (off / 4 == REG_RETURN_NONCE) {
+            hdr = new_val;
+        } else if (off / 4 == REG_RETURN_NONCE_VALUE && new_val != DUMP_FIFO_EMPTY_VALUE) {
+            entries[count][0] = hdr;
+            entries[count][1] = new_val;
+            count++;
+        }
+    }
+
+    fclose(fp);
+    return count;
+}
+
+// Frame length from the length byte; words beyond it are stale buffer contents
+static int replay_cmd_len(const uint32_t words[3]) {
+    int len = (words[0] >> 16) & 0xFF;
+    return (len >= 5 && len <= 12) ? len : 12;
+}
+
+static bool replay_cmd_equal(const uint32_t a[3], const uint32_t b[3]) {
+    int len = replay_cmd_len(a);
+    for (int i = 0; i < len; i++) {
+        int shift = 24 - 8 * (i % 4);
+        if (((a[i / 4] >> shift) & 0xFF) != ((b[i / 4] >> shift) & 0xFF)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void replay_format(const uint32_t words[3], char *buf, size_t size) {
+    int len = replay_cmd_len(words);
+    size_t pos = 0;
+    for (int i = 0; i < len && pos + 3 < size; i++) {
+        pos += snprintf(buf + pos, size - pos, "%02X ",
+                        (words[i / 4] >> (24 - 8 * (i % 4))) & 0xFF);
+    }
+}
+
+static bool replay_crc_ok(const uint32_t words[3]) {
+    uint8_t bytes[12];
+    int len = replay_cmd_len(words);
+    for (int i = 0; i < len; i++) {
+        bytes[i] = (words[i / 4] >> (24 - 8 * (i % 4))) & 0xFF;
+    }
+    return bm1398_crc5(bytes, (len - 1) * 8) == (bytes[len - 1] & 0x1F);
+}
+
+static void step_prepare(const bm1398_init_step_t *step, bm1398_cmd_t *cmd) {
+    if (step->op == BM1398_STEP_CHAIN_INACTIVE) {
+        uint8_t frame[5] = {CMD_PREAMBLE_CHAIN_INACTIVE, CMD_LEN_ADDRESS, 0, 0, 0};
+        frame[4] = bm1398_crc5_cmd32(frame);
+        bm1398_prepare_cmd(cmd, frame, sizeof(frame));
+    } else {
+        bm1398_prepare_write_register(cmd, true, 0, step->reg, step->value);
+    }
+}
+
+static int bench_replay(int argc, char **argv) {
+    const char *path = argc > 0 ? argv[0] : DEFAULT_DUMP;
+    replay_cmd_t *cmds = calloc(REPLAY_MAX_CMDS, sizeof(replay_cmd_t));
+    char text[48];
+    int ret = 0;
+
+    if (!cmds) {
+        return 1;
+    }
+
+    int ncmds = replay_load(path, cmds, REPLAY_MAX_CMDS);
+    if (ncmds < 0) {
+        free(cmds);
+        return 1;
+    }
+
+    printf("====================================\n");
+    printf("FPGA Dump Replay: %s\n", path);
+    printf("====================================\n");
+    printf("  %d BC commands captured\n\n", ncmds);
+
+    int bad_crc = 0;
+    printf("  %-12s %-8s %-38s %s\n", "Trigger", "Busy", "Frame", "CRC");
+    for (int i = 0; i < ncmds; i++) {
+        bool ok = replay_crc_ok(cmds[i].words);
+        replay_format(cmds[i].words, text, sizeof(text));
+        if (cmds[i].t_done == 0) {
+            printf("  %-12s %-8s %-38s %s\n", "(missed)", "-", text, ok ? "ok" : "BAD");
+        } else {
+            printf("  %-12.6f %5.2fms  %-38s %s\n", cmds[i].t_trigger,
+                   (cmds[i].t_done - cmds[i].t_trigger) * 1e3, text, ok ? "ok" : "BAD");
+        }
+        if (!ok) bad_crc++;
+    }
+
+    // Align the Stage 1 table with the trace on its first register write
+    int nsteps;
+    const bm1398_init_step_t *steps = bm1398_stage1_steps(&nsteps);
+    int first_write = 0;
+    while (first_write < nsteps && steps[first_write].op != BM1398_STEP_WRITE_BCAST) {
+        first_write++;
+    }
+
+    bm1398_cmd_t cmd;
+    step_prepare(&steps[first_write], &cmd);
+    int pos = 0;
+    while (pos < ncmds && !replay_cmd_equal(cmds[pos].words, cmd.words)) {
+        pos++;
+    }
+
+    printf("\n  Stage 1 table vs trace:\n");
+    if (pos == ncmds) {
+        printf("    First register write not found in trace\n");
+        free(cmds);
+        return 1;
+    }
+
+    int matched = 0, table_only = 0, mismatched = 0;
+    for (int i = first_write; i < nsteps; i++) {
+        const bm1398_init_step_t *step = &steps[i];
+        if (step->op == BM1398_STEP_DELAY) {
+            continue;
+        }
+
+        step_prepare(step, &cmd);
+        replay_format(cmd.words, text, sizeof(text));
+
+        if (pos < ncmds && replay_cmd_equal(cmds[pos].words, cmd.words)) {
+            if (pos + 1 < ncmds && cmds[pos].t_done != 0 && cmds[pos + 1].t_done != 0) {
+                printf("    %-38s match, trace gap %6.2f ms, table %5.1f-%5.1f ms\n", text,
+                       (cmds[pos + 1].t_trigger - cmds[pos].t_done) * 1e3,
+                       step->min_us / 1e3, step->max_us / 1e3);
+            } else {
+                printf("    %-38s match, trace gap    n/a, table %5.1f-%5.1f ms\n", text,
+                       step->min_us / 1e3, step->max_us / 1e3);
+            }
+            matched++;
+            pos++;
+        } else if (step->op == BM1398_STEP_CHAIN_INACTIVE) {
+            printf("    %-38s table only (not in trace)\n", text);
+            table_only++;
+        } else {
+            printf("    %-38s MISMATCH\n", text);
+            mismatched++;
+        }
+    }
+
+    printf("\n  %d matched, %d table-only, %d mismatched, %d trace CRC errors\n",
+           matched, table_only, mismatched, bad_crc);
+
+    if (mismatched || bad_crc) {
+        ret = -1;
+    }
+
+    free(cmds);
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Main
+//==============================================================================
+
+//==============================================================================
+// Kernel Nonce Stream
+//==============================================================================
+
+#define NONCE_DEV_MAX_SAMPLES   1000000
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Block on the kernel nonce stream and report delivery rate and
+ * drain-to-user latency. Load bitmain_axi with nonce_sim_rate=N to run
+ * without hashboards.
+ */
+static int bench_nonce_dev(int argc, char **argv) {
+    int seconds = 5;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        }
+    }
+    if (seconds < 1) seconds = 1;
+
+    int fd = bm1398_nonce_stream_open();
+    if (fd < 0) {
+        return 1;
+    }
+
+    uint64_t *lat = malloc(NONCE_DEV_MAX_SAMPLES * sizeof(*lat));
+    if (!lat) {
+        close(fd);
+        return 1;
+    }
+
+    printf("====================================\n");
+    printf("Kernel Nonce Stream Benchmark\n");
+    printf("====================================\n");
+    printf("  Reading for %d s...\n\n", seconds);
+
+    nonce_response_t nonces[256];
+    uint64_t ts[256];
+    uint64_t total = 0, wakeups = 0;
+    int samples = 0;
+    int ret = 0;
+    uint64_t t0 = now_ns();
+    uint64_t end = t0 + (uint64_t)seconds * 1000000000ULL;
+
+    while (now_ns() < end) {
+        int n = bm1398_nonce_stream_read(NULL, fd, nonces, ts, 256, 100);
+        if (n < 0) {
+            fprintf(stderr, "Error: Nonce stream read failed (module without nonce stream?)\n");
+            ret = -1;
+            break;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        uint64_t now = now_ns();
+        for (int i = 0; i < n && samples < NONCE_DEV_MAX_SAMPLES; i++) {
+            lat[samples++] = now - ts[i];
+        }
+        total += n;
+        wakeups++;
+    }
+    double elapsed = (now_ns() - t0) / 1e9;
+
+    printf("  Nonces:           %llu (%.0f/s)\n", (unsigned long long)total, total / elapsed);
+    printf("  Reads:            %llu (%.1f nonces/read)\n", (unsigned long long)wakeups,
+           wakeups ? (double)total / wakeups : 0.0);
+    if (samples > 0) {
+        qsort(lat, samples, sizeof(*lat), cmp_u64);
+        printf("  Latency p50:      %8.1f us\n", lat[samples / 2] / 1e3);
+        printf("  Latency p99:      %8.1f us\n", lat[(int)(samples * 0.99)] / 1e3);
+        printf("  Latency max:      %8.1f us\n", lat[samples - 1] / 1e3);
+    }
+
+    free(lat);
+    close(fd);
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Nonce Ring
+//==============================================================================
+
+#define RING_BATCH          64      // Synthetic FIFO drain size
+
+typedef struct {
+    nonce_ring_t *ring;
+    int chain;
+    int id;
+    volatile bool *producer_done;
+    uint64_t count;
+    uint64_t checksum;              // Validation stand-in
+    uint64_t per_chip[256];         // Accounting stand-in
+    uint64_t order_errors;
+} ring_consumer_t;
+
+static void *ring_consumer_thread(void *arg) {
+    ring_consumer_t *c = arg;
+    nonce_response_t buf[256];
+    uint32_t expect = 0;
+    bool first = true;
+
+    for (;;) {
+        bool done = *c->producer_done;
+        int n = nonce_ring_consume(c->ring, c->chain, c->id, buf, 256);
+        if (n <= 0) {
+            if (done) break;
+            sched_yield();
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            // Nonce values per chain are sequential unless the producer dropped
+            if (!first && buf[i].nonce != expect) c->order_errors++;
+            expect = buf[i].nonce + 1;
+            first = false;
+            if (c->id == 0) {
+                c->checksum += buf[i].nonce ^ buf[i].work_id;
+            } else {
+                c->per_chip[buf[i].chip_id]++;
+            }
+        }
+        c->count += n;
+    }
+    return NULL;
+}
+
+/**
+ * Push synthetic nonces through the ring: one producer, two consumers per
+ * chain (validation and accounting). By default the producer waits for
+ * space, which measures transfer throughput; --drop makes it behave like the
+ * FIFO reader and count overflow instead.
+ */
+static int bench_ring(int argc, char **argv) {
+    long total = 5000000;
+    bool drop = false;
+    nonce_ring_t ring;
+    volatile bool producer_done = false;
+    ring_consumer_t consumers[MAX_CHAINS * 2];
+    pthread_t threads[MAX_CHAINS * 2];
+    int ret = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            total = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--drop") == 0) {
+            drop = true;
+        }
+    }
+    if (total < RING_BATCH) total = RING_BATCH;
+
+    if (nonce_ring_init(&ring, 0) < 0) {
+        return 1;
+    }
+
+    printf("====================================\n");
+    printf("Nonce Ring Benchmark\n");
+    printf("====================================\n");
+    printf("  %ld nonces, %d chains x 2 consumers, %u slots/chain, %s\n\n",
+           total, MAX_CHAINS, ring.slots_per_lane, drop ? "drop on full" : "producer waits");
+
+    int nconsumers = 0;
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        for (int k = 0; k < 2; k++) {
+            ring_consumer_t *rc = &consumers[nconsumers];
+            memset(rc, 0, sizeof(*rc));
+            rc->ring = &ring;
+            rc->chain = c;
+            rc->id = nonce_ring_add_consumer(&ring, c);
+            rc->producer_done = &producer_done;
+            pthread_create(&threads[nconsumers], NULL, ring_consumer_thread, rc);
+            nconsumers++;
+        }
+    }
+
+    nonce_response_t batch[RING_BATCH];
+    uint32_t next[MAX_CHAINS] = { 0 };
+    uint64_t seed = 0x243F6A8885A308D3ULL;
+    uint64_t t0 = now_ns();
+
+    for (long sent = 0; sent < total; sent += RING_BATCH) {
+        for (int i = 0; i < RING_BATCH; i++) {
+            uint64_t r = rng_next(&seed);
+            int chain = r % MAX_CHAINS;
+            batch[i].chain_id = chain;
+            batch[i].chip_id = (r >> 8) % CHIPS_PER_CHAIN_S19PRO;
+            batch[i].core_id = (r >> 16) & 0x7F;
+            batch[i].work_id = (r >> 24) & 0xFF;
+            batch[i].nonce = next[chain]++;
+        }
+        if (!drop) {
+            for (int c = 0; c < MAX_CHAINS; c++) {
+                while (nonce_ring_free(&ring, c) < RING_BATCH) {
+                    sched_yield();
+                }
+            }
+        }
+        nonce_ring_publish(&ring, batch, RING_BATCH);
+    }
+    uint64_t t_pub = now_ns();
+
+    producer_done = true;
+    for (int i = 0; i < nconsumers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    uint64_t t_end = now_ns();
+
+    nonce_ring_stats_t stats;
+    nonce_ring_get_stats(&ring, &stats);
+
+    uint64_t published = 0, dropped = 0, consumed = 0, order_errors = 0;
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        published += stats.published[c];
+        dropped += stats.dropped[c];
+    }
+    for (int i = 0; i < nconsumers; i++) {
+        consumed += consumers[i].count;
+        order_errors += consumers[i].order_errors;
+    }
+
+    double pub_s = (t_pub - t0) / 1e9;
+    double all_s = (t_end - t0) / 1e9;
+    printf("  Publish:          %8.2f Mnonces/s (%.3f s)\n", published / pub_s / 1e6, pub_s);
+    printf("  End to end:       %8.2f Mnonces/s (%.3f s, all consumers drained)\n",
+           published / all_s / 1e6, all_s);
+    printf("  Consumed:         %llu of %llu (x2 consumers)\n",
+           (unsigned long long)consumed, (unsigned long long)(published - dropped) * 2);
+    printf("  Dropped:          %llu\n", (unsigned long long)dropped);
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        printf("  Chain %d peak:     %u/%u slots\n", c, stats.high_water[c], ring.slots_per_lane);
+    }
+
+    // Every stored nonce reaches both consumers, in order
+    if (consumed != (published - dropped) * 2) {
+        fprintf(stderr, "Error: Consumers saw %llu nonces, expected %llu\n",
+                (unsigned long long)consumed, (unsigned long long)(published - dropped) * 2);
+        ret = -1;
+    }
+    if (!drop && order_errors) {
+        fprintf(stderr, "Error: %llu out-of-order nonces\n", (unsigned long long)order_errors);
+        ret = -1;
+    }
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        printf("  Note: single CPU - producer and consumers take turns on one core\n");
+    }
+
+    nonce_ring_destroy(&ring);
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Pattern Index
+//==============================================================================
+
+#define PIDX_CORES          80      // BM1398 cores per ASIC
+#define PIDX_PATTERNS       8       // Patterns per core (Config.ini)
+#define PIDX_LINEAR_SAMPLE  2000    // Linear scan is O(n); time a sample only
+
+// Same rule pattern_test used before the index
+static int pidx_linear(const uint32_t *expect, int n, uint32_t nonce, uint16_t work_id) {
+    for (int idx = 0; idx < n; idx++) {
+        if (expect[idx] == nonce) {
+            uint16_t expected_work_id = (idx << 3) & 0xFF;
+            if (work_id == expected_work_id || work_id == 0) {
+                return idx;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * Full-chain PT2 verification load: 114 ASICs x 80 cores x 8 patterns of
+ * expected nonces, every pattern returned once plus 10% unknown nonces and
+ * some work_id 0 returns, matched by hash index and by the old linear scan.
+ */
+static int bench_pattern_index(int argc, char **argv) {
+    int rounds = 10;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        }
+    }
+    if (rounds < 1) rounds = 1;
+
+    int n = CHIPS_PER_CHAIN_S19PRO * PIDX_CORES * PIDX_PATTERNS;
+    int nret = n + n / 10;
+    uint32_t *expect = malloc(n * sizeof(*expect));
+    nonce_response_t *ret_nonces = malloc(nret * sizeof(*ret_nonces));
+    int *want = malloc(nret * sizeof(*want));
+    pattern_index_t index;
+    int ret = 0;
+
+    if (!expect || !ret_nonces || !want || pattern_index_init(&index, n) < 0) {
+        free(expect);
+        free(ret_nonces);
+        free(want);
+        return 1;
+    }
+
+    uint64_t seed = 0x13198A2E03707344ULL;
+    for (int i = 0; i < n; i++) {
+        expect[i] = (uint32_t)rng_next(&seed);
+    }
+
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        pattern_index_add(&index, expect[i], (i << 3) & 0xFF, i);
+    }
+    double build_ms = (now_ns() - t0) / 1e6;
+
+    // Returns: each pattern once (1 in 16 with work_id 0), then unknowns, shuffled
+    for (int i = 0; i < nret; i++) {
+        if (i < n) {
+            ret_nonces[i].nonce = expect[i];
+            ret_nonces[i].work_id = (i % 16 == 0) ? 0 : (i << 3) & 0xFF;
+            ret_nonces[i].chip_id = i / (PIDX_CORES * PIDX_PATTERNS);
+        } else {
+            ret_nonces[i].nonce = (uint32_t)rng_next(&seed);
+            ret_nonces[i].work_id = (uint16_t)(rng_next(&seed) & 0xF8);
+            ret_nonces[i].chip_id = 0;
+        }
+        ret_nonces[i].chain_id = 0;
+        ret_nonces[i].core_id = 0;
+    }
+    for (int i = nret - 1; i > 0; i--) {
+        int j = rng_next(&seed) % (i + 1);
+        nonce_response_t t = ret_nonces[i];
+        ret_nonces[i] = ret_nonces[j];
+        ret_nonces[j] = t;
+    }
+
+    printf("====================================\n");
+    printf("Pattern Index Benchmark\n");
+    printf("====================================\n");
+    printf("  %d expected nonces (%d ASICs x %d cores x %d patterns)\n",
+           n, CHIPS_PER_CHAIN_S19PRO, PIDX_CORES, PIDX_PATTERNS);
+    printf("  %d returned nonces per round, %d rounds\n\n", nret, rounds);
+
+    // Reference answers from the linear scan on a sample, checked against the index
+    int sample = nret < PIDX_LINEAR_SAMPLE ? nret : PIDX_LINEAR_SAMPLE;
+    t0 = now_ns();
+    for (int i = 0; i < sample; i++) {
+        want[i] = pidx_linear(expect, n, ret_nonces[i].nonce, ret_nonces[i].work_id);
+    }
+    double linear_ns = (double)(now_ns() - t0) / sample;
+
+    int mismatches = 0;
+    for (int i = 0; i < sample; i++) {
+        if (pattern_index_lookup(&index, ret_nonces[i].nonce, ret_nonces[i].work_id) != want[i]) {
+            mismatches++;
+        }
+    }
+
+    int matched = 0;
+    t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        matched = 0;
+        for (int i = 0; i < nret; i++) {
+            if (pattern_index_lookup(&index, ret_nonces[i].nonce, ret_nonces[i].work_id) >= 0) {
+                matched++;
+            }
+        }
+    }
+    double hash_ns = (double)(now_ns() - t0) / ((double)nret * rounds);
+
+    printf("  Index build:      %8.2f ms (%u slots, longest probe %d)\n",
+           build_ms, index.mask + 1, index.max_probe);
+    printf("  Linear scan:      %8.1f ns/nonce (%d sampled)\n", linear_ns, sample);
+    printf("  Hash lookup:      %8.1f ns/nonce (%.1fx, %.1f M nonces/s)\n",
+           hash_ns, linear_ns / hash_ns, 1e3 / hash_ns);
+    printf("  Matched:          %d of %d (%d expected)\n", matched, nret, n);
+    printf("  Disagreements:    %d of %d sampled\n", mismatches, sample);
+
+    if (mismatches || matched < n) {
+        fprintf(stderr, "Error: Index results differ from linear scan\n");
+        ret = -1;
+    }
+
+    pattern_index_free(&index);
+    free(expect);
+    free(ret_nonces);
+    free(want);
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Pattern File Loading
+//==============================================================================
+
+// Old in-memory work entry: full pattern copy plus state (124 bytes)
+typedef struct {
+    test_pattern_t pattern;
+    uint32_t work_id;
+    uint8_t nonce_returned;
+    uint8_t padding[3];
+} pload_copy_t;
+
+// Write CHIPS_PER_CHAIN_S19PRO synthetic full-size pattern files into dir
+static int pload_make_files(const char *dir) {
+    uint8_t *buf = calloc(1, PATTERN_FILE_SIZE);
+    uint64_t seed = 0xA4093822299F31D0ULL;
+    char path[256];
+
+    if (!buf) return -1;
+
+    for (int asic = 0; asic < CHIPS_PER_CHAIN_S19PRO; asic++) {
+        for (size_t i = 0; i + 8 <= PATTERN_FILE_SIZE; i += 8) {
+            uint64_t r = rng_next(&seed);
+            memcpy(buf + i, &r, 8);
+        }
+        snprintf(path, sizeof(path), "%s/btc-asic-%03d.bin", dir, asic);
+        FILE *fp = fopen(path, "wb");
+        if (!fp || fwrite(buf, 1, PATTERN_FILE_SIZE, fp) != PATTERN_FILE_SIZE) {
+            if (fp) fclose(fp);
+            free(buf);
+            return -1;
+        }
+        fclose(fp);
+    }
+
+    free(buf);
+    return 0;
+}
+
+// Previous loader: fread every slot, copy the active ones into 124-byte entries
+static int pload_stdio(const char *dir, pload_copy_t *works) {
+    uint8_t temp[PATTERN_ENTRY_SIZE];
+    char path[256];
+
+    for (int asic = 0; asic < CHIPS_PER_CHAIN_S19PRO; asic++) {
+        snprintf(path, sizeof(path), "%s/btc-asic-%03d.bin", dir, asic);
+        FILE *fp = fopen(path, "rb");
+        if (!fp) return -1;
+
+        for (int core = 0; core < PATTERN_FILE_CORES; core++) {
+            if (fseek(fp, (long)core * PATTERN_FILE_ROW_SIZE, SEEK_SET) != 0) break;
+            // Skip inactive slots the way skip_rows does, one fread each
+            for (int skip = 0; skip < PATTERN_FILE_SLOTS_PER_CORE - PATTERN_FILE_ACTIVE; skip++) {
+                if (fread(temp, 1, PATTERN_ENTRY_SIZE, fp) != PATTERN_ENTRY_SIZE) break;
+            }
+            fseek(fp, (long)core * PATTERN_FILE_ROW_SIZE + PATTERN_FILE_ACTIVE_START, SEEK_SET);
+            for (int pat = 0; pat < PATTERN_FILE_ACTIVE; pat++) {
+                if (fread(&works->pattern, 1, PATTERN_ENTRY_SIZE, fp) != PATTERN_ENTRY_SIZE) {
+                    fclose(fp);
+                    return -1;
+                }
+                works->work_id = pat;
+                works->nonce_returned = 0;
+                works++;
+            }
+        }
+        fclose(fp);
+    }
+    return 0;
+}
+
+/**
+ * Load time and RSS growth for the full-chain pattern set (114 files),
+ * mmap + strided view vs the previous stdio copy. Uses DIR if given,
+ * otherwise synthetic files in a temporary directory (warm page cache).
+ */
+static int bench_pattern_load(int argc, char **argv) {
+    char tmpdir[] = "/tmp/bm1398-pattern-XXXXXX";
+    const char *dir = argc > 0 ? argv[0] : NULL;
+    bool made = false;
+    int ret = 0;
+
+    if (!dir) {
+        if (!mkdtemp(tmpdir) || pload_make_files(tmpdir) < 0) {
+            fprintf(stderr, "Error: Cannot create synthetic pattern files in %s\n", tmpdir);
+            return 1;
+        }
+        dir = tmpdir;
+        made = true;
+    }
+
+    int count = CHIPS_PER_CHAIN_S19PRO * PATTERN_FILE_CORES * PATTERN_FILE_ACTIVE;
+
+    printf("====================================\n");
+    printf("Pattern File Loading Benchmark\n");
+    printf("====================================\n");
+    printf("  %d files from %s%s, %d active patterns\n\n", CHIPS_PER_CHAIN_S19PRO, dir,
+           made ? " (synthetic)" : "", count);
+
+    // mmap + strided view, all active patterns touched
+    int saved = quiet_begin();
+    long file0, file_mmap, file1, file_stdio;
+    long rss0 = pattern_rss_kb(&file0);
+    uint64_t t0 = now_ns();
+    pattern_set_t set;
+    int rc = pattern_set_open(&set, dir, NULL, CHIPS_PER_CHAIN_S19PRO,
+                              PATTERN_FILE_CORES, PATTERN_FILE_ACTIVE);
+    uint64_t t_open = now_ns();
+    if (rc == 0) pattern_set_prefetch(&set);
+    uint64_t t_mmap = now_ns();
+    long rss_mmap = pattern_rss_kb(&file_mmap);
+    quiet_end(saved);
+
+    if (rc < 0) {
+        fprintf(stderr, "Error: pattern_set_open failed (%d)\n", rc);
+        ret = -1;
+        goto out;
+    }
+
+    // State array that replaces the copies
+    size_t state_bytes = (size_t)count * 8;
+
+    // Keep a few nonces to cross-check the stdio path
+    uint32_t check[3] = { pattern_set_get(&set, 0)->nonce,
+                          pattern_set_get(&set, count / 2)->nonce,
+                          pattern_set_get(&set, count - 1)->nonce };
+    pattern_set_close(&set);
+
+    // Previous stdio copy
+    long rss1 = pattern_rss_kb(&file1);
+    uint64_t t1 = now_ns();
+    pload_copy_t *copies = calloc(count, sizeof(*copies));
+    if (!copies || pload_stdio(dir, copies) < 0) {
+        fprintf(stderr, "Error: stdio load failed\n");
+        free(copies);
+        ret = -1;
+        goto out;
+    }
+    uint64_t t_stdio = now_ns();
+    long rss_stdio = pattern_rss_kb(&file_stdio);
+
+    if (copies[0].pattern.nonce != check[0] || copies[count / 2].pattern.nonce != check[1] ||
+        copies[count - 1].pattern.nonce != check[2]) {
+        fprintf(stderr, "Error: mmap view and stdio copy disagree\n");
+        ret = -1;
+    }
+    free(copies);
+
+    printf("  stdio copy:       %8.2f ms, private RSS +%ld KB, file RSS +%ld KB (%zu KB of copies)\n",
+           (t_stdio - t1) / 1e6, rss_stdio - rss1, file_stdio - file1,
+           (size_t)count * sizeof(pload_copy_t) / 1024);
+    printf("  mmap view:        %8.2f ms (%.2f to map), private RSS +%ld KB, file RSS +%ld KB\n",
+           (t_mmap - t0) / 1e6, (t_open - t0) / 1e6, rss_mmap - rss0, file_mmap - file0);
+    printf("                    plus %zu KB work state; file RSS is clean shared page cache\n",
+           state_bytes / 1024);
+
+out:
+    if (made) {
+        char path[256];
+        for (int asic = 0; asic < CHIPS_PER_CHAIN_S19PRO; asic++) {
+            snprintf(path, sizeof(path), "%s/btc-asic-%03d.bin", tmpdir, asic);
+            unlink(path);
+        }
+        rmdir(tmpdir);
+    }
+    return ret == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// FPGA Register Accessors
+//==============================================================================
+
+#define WORK_PACKET_WORDS   37      // 148-byte work packet
+
+// CPU clock for converting ns to cycles, 0 if unknown
+static double cpu_mhz(void) {
+    FILE *fp = fopen("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_cur_freq", "r");
+    long khz = 0;
+
+    if (!fp) {
+        fp = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "r");
+    }
+    if (fp) {
+        if (fscanf(fp, "%ld", &khz) != 1) khz = 0;
+        fclose(fp);
+    }
+    return khz / 1000.0;
+}
+
+/**
+ * Per-packet cost of pushing a work packet into the work FIFO: 37 calls to
+ * fpga_write_indirect() (checks, map lookup, barrier each) against the
+ * compile-time resolved fpga_push_tw_write_cmd(). Also times a register
+ * read-modify-write both ways.
+ */
+static int bench_regs(int argc, char **argv) {
+    long count = 1000000;
+    sim_fpga_t sim;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        }
+    }
+    if (count < 1) count = 1;
+
+    if (sim_fpga_start(&sim, 1) < 0) {
+        fprintf(stderr, "Error: Failed to start simulated FPGA\n");
+        return 1;
+    }
+
+    uint32_t words[WORK_PACKET_WORDS];
+    uint64_t seed = 0xBE5466CF34E90C6CULL;
+    for (int i = 0; i < WORK_PACKET_WORDS; i++) {
+        words[i] = (uint32_t)rng_next(&seed);
+    }
+
+    int errors = fpga_verify_register_accessors();
+
+    uint64_t t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        words[0] = (uint32_t)n;
+        for (int i = 0; i < WORK_PACKET_WORDS; i++) {
+            fpga_write_indirect(&sim.ctx, FPGA_REG_TW_WRITE_CMD_FIRST, words[i]);
+        }
+    }
+    double indirect_ns = (double)(now_ns() - t0) / count;
+    uint32_t last_indirect = sim.ctx.fpga_regs[FPGA_WORD_TW_WRITE_CMD];
+
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        words[0] = (uint32_t)n;
+        fpga_push_tw_write_cmd(&sim.ctx, words, WORK_PACKET_WORDS);
+    }
+    double named_ns = (double)(now_ns() - t0) / count;
+    uint32_t last_named = sim.ctx.fpga_regs[FPGA_WORD_TW_WRITE_CMD];
+
+    // Read-modify-write of a shared register (chain reset bits)
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        uint32_t v = fpga_read_indirect(&sim.ctx, FPGA_REG_CHAIN_RESET);
+        fpga_write_indirect(&sim.ctx, FPGA_REG_CHAIN_RESET, v ^ 1);
+    }
+    double rmw_indirect_ns = (double)(now_ns() - t0) / count;
+
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        uint32_t v = fpga_read_chain_reset(&sim.ctx);
+        fpga_write_chain_reset(&sim.ctx, v ^ 1);
+    }
+    double rmw_named_ns = (double)(now_ns() - t0) / count;
+
+    double mhz = cpu_mhz();
+
+    printf("====================================\n");
+    printf("FPGA Register Accessor Benchmark\n");
+    printf("====================================\n");
+    printf("  %ld iterations, simulated register file", count);
+    if (mhz > 0) {
+        printf(", CPU %.0f MHz", mhz);
+    }
+    printf("\n\n");
+    printf("  Work packet (%d words):\n", WORK_PACKET_WORDS);
+    printf("    fpga_write_indirect x%d: %8.1f ns", WORK_PACKET_WORDS, indirect_ns);
+    if (mhz > 0) printf(" (%.0f cycles)", indirect_ns * mhz / 1e3);
+    printf("\n    fpga_push_tw_write_cmd:  %8.1f ns", named_ns);
+    if (mhz > 0) printf(" (%.0f cycles)", named_ns * mhz / 1e3);
+    printf("  %.1fx\n", indirect_ns / named_ns);
+    printf("  Read-modify-write:\n");
+    printf("    indirect:                %8.1f ns\n", rmw_indirect_ns);
+    printf("    named:                   %8.1f ns  %.1fx\n", rmw_named_ns,
+           rmw_indirect_ns / rmw_named_ns);
+    printf("  Descriptor check:          %s\n", errors ? "MISMATCH" : "all entries match fpga_register_map");
+
+    if (last_indirect != last_named) {
+        fprintf(stderr, "Error: Accessors wrote different words (0x%08X vs 0x%08X)\n",
+                last_indirect, last_named);
+        errors++;
+    }
+
+    sim_fpga_stop(&sim);
+    return errors == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Work packet formatting
+//==============================================================================
+
+// Per-send build as bm1398_send_work did it before prepared packets
+static void legacy_build_work(uint32_t words[WORK_PACKET_WORDS], int chain, uint32_t work_id,
+                              const uint8_t *work_data, const uint8_t midstates[4][32]) {
+    work_packet_t work;
+    memset(&work, 0, sizeof(work));
+
+    work.work_type = 0x01;
+    work.chain_id = (uint8_t)chain | 0x80;
+    work.work_id = work_id << 3;
+    memcpy(work.work_data, work_data, 12);
+    for (int i = 0; i < 4; i++) {
+        memcpy(work.midstate[i], midstates[i], 32);
+    }
+
+    // Copy out rather than alias the packed struct as words
+    memcpy(words, &work, sizeof(work));
+    for (int i = 0; i < WORK_PACKET_WORDS; i++) {
+        words[i] = __builtin_bswap32(words[i]);
+    }
+}
+
+static int bench_work(int argc, char **argv) {
+    long count = 10000000;
+    const int num_packets = 1024;   // Working set of distinct patterns, like one chip's worth
+    uint32_t sink = 0;
+    int errors = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        }
+    }
+    if (count < num_packets) count = num_packets;
+
+    uint8_t (*data)[12] = malloc(num_packets * sizeof(*data));
+    uint8_t (*mids)[4][32] = malloc(num_packets * sizeof(*mids));
+    bm1398_work_arena_t arena;
+    if (!data || !mids || bm1398_work_arena_init(&arena, num_packets) < 0) {
+        fprintf(stderr, "Error: Failed to allocate work packets\n");
+        free(data);
+        free(mids);
+        return 1;
+    }
+
+    uint64_t seed = 0x5A17C0DE00000094ULL;
+    for (int p = 0; p < num_packets; p++) {
+        for (int i = 0; i < 12; i++) data[p][i] = (uint8_t)rng_next(&seed);
+        for (int i = 0; i < 32; i++) mids[p][0][i] = (uint8_t)rng_next(&seed);
+        for (int m = 1; m < 4; m++) memcpy(mids[p][m], mids[p][0], 32);
+    }
+
+    // Output check: every path must produce the legacy words exactly
+    for (int p = 0; p < num_packets; p++) {
+        uint32_t ref[WORK_PACKET_WORDS];
+        bm1398_work_t four, one;
+        legacy_build_work(ref, p % MAX_CHAINS, p, data[p], (const uint8_t (*)[32])mids[p]);
+        bm1398_prepare_work(&four, p % MAX_CHAINS, p, data[p], &mids[p][0][0], 4);
+        bm1398_prepare_work(&one, p % MAX_CHAINS, p, data[p], mids[p][0], 1);
+        bm1398_prepare_work(&arena.packets[p], 0, 0, data[p], mids[p][0], 1);
+        bm1398_work_set_id(&arena.packets[p], p % MAX_CHAINS, p);
+        if (memcmp(ref, four.words, sizeof(ref)) != 0 ||
+            memcmp(ref, one.words, sizeof(ref)) != 0 ||
+            memcmp(ref, arena.packets[p].words, sizeof(ref)) != 0) {
+            if (errors++ < 5) {
+                fprintf(stderr, "Error: Packet %d differs from legacy build\n", p);
+            }
+        }
+    }
+
+    uint32_t words[WORK_PACKET_WORDS];
+    uint64_t t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        int p = n & (num_packets - 1);
+        legacy_build_work(words, 0, (uint32_t)n, data[p], (const uint8_t (*)[32])mids[p]);
+        sink += words[n % WORK_PACKET_WORDS];
+    }
+    double legacy_ns = (double)(now_ns() - t0) / count;
+
+    bm1398_work_t work;
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        int p = n & (num_packets - 1);
+        bm1398_prepare_work(&work, 0, (uint32_t)n, data[p], &mids[p][0][0], 4);
+        sink += work.words[n % WORK_PACKET_WORDS];
+    }
+    double four_ns = (double)(now_ns() - t0) / count;
+
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        int p = n & (num_packets - 1);
+        bm1398_prepare_work(&work, 0, (uint32_t)n, data[p], mids[p][0], 1);
+        sink += work.words[n % WORK_PACKET_WORDS];
+    }
+    double one_ns = (double)(now_ns() - t0) / count;
+
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        bm1398_work_t *packet = &arena.packets[n & (num_packets - 1)];
+        bm1398_work_set_id(packet, 0, (uint32_t)n);
+        sink += packet->words[n % WORK_PACKET_WORDS];
+    }
+    double patch_ns = (double)(now_ns() - t0) / count;
+
+    double mhz = cpu_mhz();
+
+    printf("====================================\n");
+    printf("Work Packet Formatting Benchmark\n");
+    printf("====================================\n");
+    printf("  %ld packets over %d distinct patterns", count, num_packets);
+    if (mhz > 0) {
+        printf(", CPU %.0f MHz", mhz);
+    }
+    printf("\n  Byte swap: %s\n\n",
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+           "NEON vrev32"
+#else
+           "scalar"
+#endif
+           );
+    printf("    legacy build + swap:      %8.1f ns\n", legacy_ns);
+    printf("    prepare (4 midstates):    %8.1f ns  %.1fx\n", four_ns, legacy_ns / four_ns);
+    printf("    prepare (1 midstate x4):  %8.1f ns  %.1fx\n", one_ns, legacy_ns / one_ns);
+    printf("    arena, patch id only:     %8.1f ns  %.1fx\n", patch_ns, legacy_ns / patch_ns);
+    printf("  Output check:               %s\n", errors ? "MISMATCH" : "identical to legacy build");
+    printf("  (sink %08X)\n", sink);
+
+    bm1398_work_arena_free(&arena);
+    free(data);
+    free(mids);
+    return errors == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Work delivery: FIFO vs fpga_mem ring
+//==============================================================================
+
+/*
+ * What bulk delivery through fpga_mem could buy if the FPGA consumed a ring:
+ * packets copied into a chain's 512-byte work buffer slots, the producer
+ * index published with one store per batch instead of 37 FIFO register
+ * writes per work. The stock FPGA has no such consumer (only the buffer
+ * area is known, from sub_2AB50) and fpga_init_chain_buffers() fills those
+ * slots with the factory template, so this lives in the simulator only and
+ * runs against the heap-backed fpga_mem of sim_fpga_t.
+ *
+ * Slots 0..254 carry packets, slot 255 holds the control block. One slot is
+ * always left empty, so producer == consumer means empty.
+ */
+
+#define WORK_RING_SLOTS         (FPGA_MEM_WORK_SLOTS - 1)
+#define WORK_RING_MAGIC         0x57524E47  // "WRNG"
+#define WORK_RING_SPIN_POLLS    64          // Yielding polls before sleeping when full
+#define WORK_RING_POLL_US       50
+
+typedef struct {
+    volatile uint32_t magic;
+    volatile uint32_t producer;         // Next slot the host fills (host writes: doorbell)
+    volatile uint32_t consumer;         // Next slot the FPGA reads (FPGA writes)
+    volatile uint32_t slot_size;
+    volatile uint32_t num_slots;
+    volatile uint32_t packet_words;
+} work_ring_ctrl_t;
+
+typedef struct {
+    volatile uint8_t *slots;
+    volatile work_ring_ctrl_t *ctrl;
+    uint32_t producer;                  // Local copy, published on doorbell
+    uint32_t consumer;                  // Last consumer index read back
+    uint64_t submitted;
+    uint64_t doorbells;
+    uint64_t full_waits;
+} work_ring_t;
+
+static void work_ring_init(sim_fpga_t *sim, work_ring_t *ring, int chain) {
+    memset(ring, 0, sizeof(*ring));
+    ring->slots = sim->ctx.fpga_mem + FPGA_MEM_WORK_BUFFERS + FPGA_MEM_WORK_CHAIN_STRIDE * chain;
+    ring->ctrl = (volatile work_ring_ctrl_t *)(ring->slots +
+                                               WORK_RING_SLOTS * FPGA_MEM_WORK_SLOT_SIZE);
+
+    ring->ctrl->producer = 0;
+    ring->ctrl->consumer = 0;
+    ring->ctrl->slot_size = FPGA_MEM_WORK_SLOT_SIZE;
+    ring->ctrl->num_slots = WORK_RING_SLOTS;
+    ring->ctrl->packet_words = BM1398_WORK_WORDS;
+    __sync_synchronize();
+    ring->ctrl->magic = WORK_RING_MAGIC;
+}
+
+// Slots the consumer has not taken yet
+static int work_ring_pending(work_ring_t *ring) {
+    ring->consumer = ring->ctrl->consumer;
+    return (ring->producer + WORK_RING_SLOTS - ring->consumer) % WORK_RING_SLOTS;
+}
+
+// Queue up to count packets, one doorbell per batch. Less than count only on timeout.
+static int work_ring_submit(work_ring_t *ring, const bm1398_work_t *works, int count,
+                            int timeout_ms) {
+    uint64_t deadline = now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    int done = 0;
+    int polls = 0;
+
+    while (done < count) {
+        int space = WORK_RING_SLOTS - 1 - work_ring_pending(ring);
+        if (space == 0) {
+            if (now_ns() >= deadline) {
+                fprintf(stderr, "Error: Work ring timeout (%d of %d queued)\n", done, count);
+                break;
+            }
+            if (polls++ == 0) ring->full_waits++;
+            if (polls < WORK_RING_SPIN_POLLS) {
+                sched_yield();
+            } else {
+                usleep(WORK_RING_POLL_US);
+            }
+            continue;
+        }
+        polls = 0;
+
+        int batch = count - done < space ? count - done : space;
+        uint32_t producer = ring->producer;
+        for (int i = 0; i < batch; i++) {
+            memcpy((void *)(ring->slots + producer * FPGA_MEM_WORK_SLOT_SIZE),
+                   works[done + i].words, BM1398_WORK_WORDS * 4);
+            if (++producer == WORK_RING_SLOTS) producer = 0;
+        }
+
+        // Doorbell: packet data must be visible before the new index
+        __sync_synchronize();
+        ring->ctrl->producer = producer;
+        ring->producer = producer;
+
+        done += batch;
+        ring->submitted += batch;
+        ring->doorbells++;
+    }
+    return done;
+}
+
+// FPGA side of the work ring: drain slots, check work_id order
+typedef struct {
+    work_ring_t *ring;
+    volatile bool running;
+    uint64_t consumed;
+    uint64_t out_of_order;
+} ring_fpga_t;
+
+static void *ring_fpga_thread(void *arg) {
+    ring_fpga_t *f = arg;
+    volatile work_ring_ctrl_t *ctrl = f->ring->ctrl;
+    uint32_t consumer = ctrl->consumer;
+
+    while (f->running || consumer != ctrl->producer) {
+        uint32_t producer = ctrl->producer;
+        if (consumer == producer) {
+            sched_yield();
+            continue;
+        }
+        __sync_synchronize();
+        while (consumer != producer) {
+            const volatile uint32_t *words = (const volatile uint32_t *)
+                (f->ring->slots + consumer * FPGA_MEM_WORK_SLOT_SIZE);
+            uint32_t work_id = __builtin_bswap32(words[BM1398_WORK_ID_WORD]) >> 3;
+            if (work_id != (uint32_t)(f->consumed & 0x1FFFFFFF)) {
+                f->out_of_order++;
+            }
+            f->consumed++;
+            if (++consumer == WORK_RING_SLOTS) consumer = 0;
+        }
+        __sync_synchronize();
+        ctrl->consumer = consumer;
+    }
+    return NULL;
+}
+
+static int bench_work_ring(int argc, char **argv) {
+    long count = 2000000;
+    int batch = 64;
+    int grant = 1;
+    sim_fpga_t sim;
+    int errors = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            grant = atoi(argv[++i]);
+        }
+    }
+    if (count < 1) count = 1;
+    if (batch < 1) batch = 1;
+
+    if (sim_fpga_start(&sim, 1) < 0) {
+        fprintf(stderr, "Error: Failed to start simulated FPGA\n");
+        return 1;
+    }
+    sim.ctx.fpga_regs[REG_BUFFER_SPACE] = 0x7;  // FIFO always has space
+    if (grant > 1) {
+        bm1398_set_work_credit_grant(&sim.ctx, 0, grant);
+    }
+
+    bm1398_work_t *works = NULL;
+    if (posix_memalign((void **)&works, 64, (size_t)batch * sizeof(*works)) != 0) {
+        fprintf(stderr, "Error: Failed to allocate work batch\n");
+        sim_fpga_stop(&sim);
+        return 1;
+    }
+    uint8_t data[12] = {0}, midstate[32];
+    uint64_t seed = 0x0014DE4C00020000ULL;
+    for (int i = 0; i < 32; i++) midstate[i] = (uint8_t)rng_next(&seed);
+    for (int i = 0; i < batch; i++) {
+        bm1398_prepare_work(&works[i], 0, 0, data, midstate, 1);
+    }
+
+    // MMIO FIFO: FIFO space check + 37 register stores per work
+    uint64_t t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        bm1398_work_t *work = &works[n % batch];
+        bm1398_work_set_id(work, 0, (uint32_t)n);
+        if (bm1398_send_prepared_work(&sim.ctx, 0, work) < 0) {
+            errors++;
+            break;
+        }
+    }
+    double fifo_s = (double)(now_ns() - t0) / 1e9;
+    bm1398_work_flow_t flow;
+    bm1398_get_work_flow_stats(&sim.ctx, 0, &flow);
+
+    // fpga_mem ring: slot copies, one doorbell per batch
+    work_ring_t ring;
+    ring_fpga_t fpga = {0};
+    pthread_t consumer;
+    work_ring_init(&sim, &ring, 0);
+    fpga.ring = &ring;
+    fpga.running = true;
+    pthread_create(&consumer, NULL, ring_fpga_thread, &fpga);
+
+    t0 = now_ns();
+    for (long n = 0; n < count; n += batch) {
+        int todo = count - n < batch ? (int)(count - n) : batch;
+        for (int i = 0; i < todo; i++) {
+            bm1398_work_set_id(&works[i], 0, (uint32_t)(n + i));
+        }
+        if (work_ring_submit(&ring, works, todo, 1000) != todo) {
+            errors++;
+            break;
+        }
+    }
+    double ring_submit_s = (double)(now_ns() - t0) / 1e9;
+    fpga.running = false;
+    pthread_join(consumer, NULL);
+    double ring_s = (double)(now_ns() - t0) / 1e9;
+
+    printf("====================================\n");
+    printf("Work Delivery Benchmark\n");
+    printf("====================================\n");
+    printf("  %ld works, batch %d, ring %d slots, simulated FPGA\n\n",
+           count, batch, WORK_RING_SLOTS);
+    printf("  MMIO FIFO (0x040):     %10.0f works/s  (%d stores + space check per work)\n",
+           count / fifo_s, BM1398_WORK_WORDS);
+    printf("    credit grant %u: %.2f REG_BUFFER_SPACE reads per work\n",
+           flow.credit_grant, (double)flow.samples / count);
+    printf("  fpga_mem ring:         %10.0f works/s  %.1fx  (submit %.0f works/s)\n",
+           count / ring_s, fifo_s / ring_s, count / ring_submit_s);
+    printf("  Doorbells:             %llu (%.1f works each), ring full %llu times\n",
+           (unsigned long long)ring.doorbells, (double)ring.submitted / ring.doorbells,
+           (unsigned long long)ring.full_waits);
+    printf("  FPGA side consumed:    %llu, out of order %llu\n",
+           (unsigned long long)fpga.consumed, (unsigned long long)fpga.out_of_order);
+    printf("  Host stores are cached here; on the Zynq each FIFO store is an\n"
+           "  uncached AXI write, so the gap there is wider.\n");
+    printf("  The ring consumer is simulated: the stock FPGA does not read one,\n"
+           "  so the ring exists only in this bench.\n");
+
+    if (fpga.consumed != (uint64_t)count || fpga.out_of_order) {
+        fprintf(stderr, "Error: Ring delivered %llu of %ld works (%llu out of order)\n",
+                (unsigned long long)fpga.consumed, count,
+                (unsigned long long)fpga.out_of_order);
+        errors++;
+    }
+
+    free(works);
+    sim_fpga_stop(&sim);
+    return errors == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// Work dispatch
+//==============================================================================
+
+#define DISPATCH_STALL_CHAIN    1
+#define DISPATCH_STALL_MS       15      // Chain 1 FIFO full this long...
+#define DISPATCH_READY_MS       5       // ...then accepting this long
+#define DISPATCH_WORKS          (2 * WORK_DISPATCH_REFILL)
+
+typedef struct {
+    volatile uint32_t *regs;
+    volatile bool running;
+} fifo_stall_t;
+
+// Keep chains 0/2 ready; chain 1 is backpressured 75% of the time
+static void *fifo_stall_thread(void *arg) {
+    fifo_stall_t *f = arg;
+    const uint32_t all = (1U << MAX_CHAINS) - 1;
+
+    while (f->running) {
+        f->regs[REG_BUFFER_SPACE] = all & ~(1U << DISPATCH_STALL_CHAIN);
+        usleep(DISPATCH_STALL_MS * 1000);
+        f->regs[REG_BUFFER_SPACE] = all;
+        usleep(DISPATCH_READY_MS * 1000);
+    }
+    return NULL;
+}
+
+// Closed loop: every sent work goes straight back into the pool
+static void dispatch_resubmit(void *arg, dispatch_work_t *work, int chain, uint32_t work_id) {
+    (void)work_id;
+    if (chain >= 0) {
+        work_dispatch_submit(arg, work);
+    }
+}
+
+static int bench_dispatch(int argc, char **argv) {
+    int seconds = 2;
+    sim_fpga_t sim;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        }
+    }
+    if (seconds < 1) seconds = 1;
+
+    if (sim_fpga_start(&sim, MAX_CHAINS) < 0) {
+        fprintf(stderr, "Error: Failed to start simulated FPGA\n");
+        return 1;
+    }
+    fifo_stall_t stall = { sim.ctx.fpga_regs, true };
+    pthread_t stall_thread;
+    pthread_create(&stall_thread, NULL, fifo_stall_thread, &stall);
+
+    // Fewer works in circulation than the chains' refill batches hold, so
+    // chains run dry and must steal what the stalled chain took
+    static dispatch_work_t items[DISPATCH_WORKS];
+    uint8_t data[12] = {0}, midstate[32] = {0};
+    for (int i = 0; i < DISPATCH_WORKS; i++) {
+        bm1398_prepare_work(&items[i].packet, 0, 0, data, midstate, 1);
+    }
+
+    // One thread, chains in turn: a stalled chain holds up the others
+    uint64_t serial[MAX_CHAINS] = {0};
+    uint64_t t0 = now_ns();
+    uint64_t end = t0 + (uint64_t)seconds * 1000000000ULL;
+    for (uint32_t n = 0; now_ns() < end; n++) {
+        int chain = n % MAX_CHAINS;
+        bm1398_work_set_id(&items[0].packet, chain, n);
+        if (bm1398_send_prepared_work(&sim.ctx, chain, &items[0].packet) == 0) {
+            serial[chain]++;
+        }
+    }
+    double serial_s = (now_ns() - t0) / 1e9;
+
+    // Dispatcher: one thread per chain, stealing from a shared pool
+    work_dispatch_t d;
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        bm1398_reset_work_flow_stats(&sim.ctx, i);
+    }
+    work_dispatch_init(&d, &sim.ctx, (1U << MAX_CHAINS) - 1, dispatch_resubmit, &d);
+    for (int i = 0; i < DISPATCH_WORKS; i++) {
+        work_dispatch_submit(&d, &items[i]);
+    }
+    t0 = now_ns();
+    if (work_dispatch_start(&d) < 0) {
+        stall.running = false;
+        pthread_join(stall_thread, NULL);
+        sim_fpga_stop(&sim);
+        return 1;
+    }
+    sleep(seconds);
+    work_dispatch_stop(&d);
+    double dispatch_s = (now_ns() - t0) / 1e9;
+
+    printf("====================================\n");
+    printf("Work Dispatch Benchmark\n");
+    printf("====================================\n");
+    printf("  %ds per run, chain %d FIFO full %dms of every %dms\n\n",
+           seconds, DISPATCH_STALL_CHAIN, DISPATCH_STALL_MS, DISPATCH_STALL_MS + DISPATCH_READY_MS);
+    printf("  Chain   Single sender    Dispatch threads   stolen   queue\n");
+    uint64_t serial_total = 0, dispatch_total = 0;
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        dispatch_chain_t *c = &d.chains[i];
+        printf("    %d    %10.0f/s     %10.0f/s    %8llu   %4d\n", i,
+               serial[i] / serial_s, c->sent / dispatch_s,
+               (unsigned long long)c->stolen, work_dispatch_queue_depth(c));
+        serial_total += serial[i];
+        dispatch_total += c->sent;
+    }
+    printf("  Total  %10.0f/s     %10.0f/s\n\n", serial_total / serial_s,
+           dispatch_total / dispatch_s);
+    work_dispatch_print_stats(&d);
+
+    work_dispatch_destroy(&d);
+    stall.running = false;
+    pthread_join(stall_thread, NULL);
+    sim_fpga_stop(&sim);
+    return dispatch_total > serial_total ? 0 : 1;
+}
+
+//==============================================================================
+// Stratum client
+//==============================================================================
+
+#define STRATUM_DEFAULT_POOL    "127.0.0.1:3333"
+#define STRATUM_BENCH_DRAIN_MS  500     // Wait for outstanding submit responses
+
+// Against stratum_pool (or a real pool): notify -> first work latency and
+// submit round trips for one fake share per job
+static int bench_stratum(int argc, char **argv) {
+    const char *url = STRATUM_DEFAULT_POOL;
+    int seconds = 10;
+    bool rolling = true;
+    stratum_client_t *client;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            url = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-rolling") == 0) {
+            rolling = false;
+        }
+    }
+    if (seconds < 1) seconds = 1;
+
+    client = malloc(sizeof(*client));
+    if (!client || stratum_init(client, url, "bench.worker", "x") < 0) {
+        free(client);
+        return 1;
+    }
+    if (rolling) {
+        stratum_set_version_rolling(client, STRATUM_VERSION_MASK);
+    }
+    if (stratum_start(client) < 0) {
+        free(client);
+        return 1;
+    }
+
+    printf("====================================\n");
+    printf("Stratum Client Benchmark\n");
+    printf("====================================\n");
+    printf("  Pool %s, %ds\n\n", url, seconds);
+
+    stratum_job_t *job = malloc(sizeof(*job));
+    stratum_template_t *tpl = malloc(sizeof(*tpl));
+    uint32_t seq = 0;
+    uint32_t jobs = 0;
+    uint32_t rolled_jobs = 0;
+    uint64_t build_ns = 0;
+    uint64_t seed = 0x5eed;
+    uint64_t end = now_ns() + (uint64_t)seconds * 1000000000ULL;
+
+    while (job && tpl && now_ns() < end) {
+        if (!stratum_wait_job(client, job, &seq, 100000)) {
+            continue;
+        }
+
+        // First work of the job: coinbase, merkle root, midstates, packet
+        uint8_t extranonce2[STRATUM_MAX_EXTRANONCE] = {0};
+        uint8_t work_data[12], midstates[STRATUM_MIDSTATES][32];
+        uint32_t versions[STRATUM_MIDSTATES];
+        bm1398_work_t work;
+        uint64_t t0 = now_ns();
+        stratum_template_init(tpl, job);
+        stratum_template_set_extranonce2(tpl, extranonce2);
+        int count = stratum_template_work(tpl, 0, work_data, midstates, versions);
+        bm1398_prepare_work(&work, 0, 0, work_data, &midstates[0][0], count);
+        build_ns += now_ns() - t0;
+        stratum_note_first_work(client, job);
+        jobs++;
+        if (count > 1) rolled_jobs++;
+
+        // Fake share from a random midstate slot
+        uint64_t r = rng_next(&seed);
+        stratum_submit(client, job->job_id, extranonce2, job->extranonce2_size,
+                       job->ntime, (uint32_t)r, versions[(r >> 32) % count]);
+    }
+
+    // Let the last submits come back
+    usleep(STRATUM_BENCH_DRAIN_MS * 1000);
+    stratum_stop(client);
+    stratum_print_stats(client);
+    if (jobs) {
+        printf("  Work build: %.1f us per work, %u/%u jobs with %d rolled versions\n",
+               build_ns / 1e3 / jobs, rolled_jobs, jobs, STRATUM_MIDSTATES);
+    }
+
+    stratum_stats_t stats;
+    stratum_get_stats(client, &stats);
+    free(tpl);
+    free(job);
+    free(client);
+    return jobs > 0 && stats.accepted + stats.rejected > 0 ? 0 : 1;
+}
+
+//==============================================================================
+// SHA-256 engine
+//==============================================================================
+
+#define SHA_BENCH_HEADERS   256
+
+// Bitcoin genesis block header; its nonce is 0x7c2bac1d
+static const uint8_t genesis_header[80] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e,
+    0x67, 0x76, 0x8f, 0x61, 0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa,
+    0x4b, 0x1e, 0x5e, 0x4a, 0x29, 0xab, 0x5f, 0x49, 0xff, 0xff, 0x00, 0x1d, 0x1d, 0xac, 0x2b, 0x7c
+};
+
+// Scalar reference vs 4-lane engine: midstates and nonce double hashes
+static int bench_sha256(int argc, char **argv) {
+    long count = 1000000;
+    uint32_t sink = 0;
+    int errors = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        }
+    }
+    count &= ~(long)(SHA256_LANES - 1);
+    if (count < SHA_BENCH_HEADERS) count = SHA_BENCH_HEADERS;
+
+    static uint8_t headers[SHA_BENCH_HEADERS][80];
+    static uint32_t nonces[SHA_BENCH_HEADERS];
+    uint64_t seed = 0x5A256A256A256ULL;
+    for (int h = 0; h < SHA_BENCH_HEADERS; h++) {
+        for (int i = 0; i < 80; i++) headers[h][i] = (uint8_t)rng_next(&seed);
+        nonces[h] = (uint32_t)rng_next(&seed);
+    }
+
+    // Genesis block: its nonce must verify, its neighbours must not
+    uint32_t genesis_nonces[5] = { 0x7c2bac1c, 0x7c2bac1d, 0x7c2bac1e, 0, 0xFFFFFFFF };
+    bool valid[5];
+    if (sha256d_check_nonces(genesis_header, genesis_nonces, 5, 32, valid) != 1 || !valid[1]) {
+        fprintf(stderr, "Error: Genesis nonce check failed\n");
+        errors++;
+    }
+
+    // Output check: both engines agree on every header
+    for (int h = 0; h < SHA_BENCH_HEADERS; h += SHA256_LANES) {
+        const uint8_t *lanes[SHA256_LANES];
+        uint8_t mid4[SHA256_LANES][32], hash4[SHA256_LANES][32];
+        for (int l = 0; l < SHA256_LANES; l++) lanes[l] = headers[h + l];
+        sha256_midstate4(lanes, mid4);
+        sha256d_nonces(headers[h], &nonces[h], SHA256_LANES, hash4);
+
+        for (int l = 0; l < SHA256_LANES; l++) {
+            uint8_t mid[32], hash[32], header[80];
+            sha256_midstate(headers[h + l], mid);
+            memcpy(header, headers[h], 76);
+            memcpy(header + 76, &nonces[h + l], 4);
+            sha256d(header, 80, hash);
+            if ((memcmp(mid, mid4[l], 32) != 0 || memcmp(hash, hash4[l], 32) != 0) &&
+                errors++ < 5) {
+                fprintf(stderr, "Error: Header %d differs between engines\n", h + l);
+            }
+        }
+    }
+
+    // Midstates: one compression each
+    uint8_t mid[SHA256_LANES][32];
+    uint64_t t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        sha256_midstate(headers[n & (SHA_BENCH_HEADERS - 1)], mid[0]);
+        sink += mid[0][n & 31];
+    }
+    double mid_scalar = count / ((now_ns() - t0) / 1e9);
+
+    t0 = now_ns();
+    for (long n = 0; n < count; n += SHA256_LANES) {
+        int h = n & (SHA_BENCH_HEADERS - 1);
+        const uint8_t *lanes[SHA256_LANES] = {
+            headers[h], headers[h + 1], headers[h + 2], headers[h + 3]
+        };
+        sha256_midstate4(lanes, mid);
+        sink += mid[n & 3][n & 31];
+    }
+    double mid_vector = count / ((now_ns() - t0) / 1e9);
+
+    // Nonce verification: double SHA-256 of a full header per nonce
+    uint8_t header[80], hash[32];
+    memcpy(header, headers[0], 80);
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        memcpy(header + 76, &nonces[n & (SHA_BENCH_HEADERS - 1)], 4);
+        sha256d(header, 80, hash);
+        sink += hash[n & 31];
+    }
+    double verify_scalar = count / ((now_ns() - t0) / 1e9);
+
+    static uint8_t hashes[SHA_BENCH_HEADERS][32];
+    t0 = now_ns();
+    for (long n = 0; n < count; n += SHA_BENCH_HEADERS) {
+        int batch = count - n < SHA_BENCH_HEADERS ? (int)(count - n) : SHA_BENCH_HEADERS;
+        sha256d_nonces(headers[0], nonces, batch, hashes);
+        sink += hashes[n & (SHA_BENCH_HEADERS - 1)][n & 31];
+    }
+    double verify_vector = count / ((now_ns() - t0) / 1e9);
+
+    double mhz = cpu_mhz();
+
+    printf("====================================\n");
+    printf("SHA-256 Engine Benchmark\n");
+    printf("====================================\n");
+    printf("  %ld hashes per run", count);
+    if (mhz > 0) {
+        printf(", CPU %.0f MHz", mhz);
+    }
+    printf("\n  4-lane engine: %s\n\n",
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+           "NEON"
+#else
+           "generic vectors"
+#endif
+           );
+    printf("                        Scalar           4-lane      Speedup\n");
+    printf("  Midstate         %10.0f/s     %10.0f/s      %.2fx\n",
+           mid_scalar, mid_vector, mid_vector / mid_scalar);
+    printf("  Nonce sha256d    %10.0f/s     %10.0f/s      %.2fx\n",
+           verify_scalar, verify_vector, verify_vector / verify_scalar);
+    printf("\n  Output check: %s (sink %u)\n", errors ? "FAILED" : "identical", sink);
+
+    return errors ? 1 : 0;
+}
+
+//==============================================================================
+// Merkle root / work build
+//==============================================================================
+
+#define MERKLE_BENCH_CHECKS     64
+
+// Synthetic job shaped like a mainnet pool job: coinbase around 300 bytes
+static void merkle_bench_job(stratum_job_t *job, int branches, uint64_t *seed) {
+    memset(job, 0, sizeof(*job));
+    snprintf(job->job_id, sizeof(job->job_id), "bench");
+    for (int i = 0; i < 32; i++) job->prevhash[i] = (uint8_t)rng_next(seed);
+    job->coinb1_len = 105;
+    job->coinb2_len = 186;
+    for (size_t i = 0; i < job->coinb1_len; i++) job->coinb1[i] = (uint8_t)rng_next(seed);
+    for (size_t i = 0; i < job->coinb2_len; i++) job->coinb2[i] = (uint8_t)rng_next(seed);
+    job->num_merkle = branches;
+    for (int b = 0; b < branches; b++) {
+        for (int i = 0; i < 32; i++) job->merkle[b][i] = (uint8_t)rng_next(seed);
+    }
+    job->version = 0x20000000;
+    job->nbits = 0x17034219;
+    job->ntime = 0x66000000;
+    job->version_mask = STRATUM_VERSION_MASK;
+    job->extranonce1_len = 4;
+    for (int i = 0; i < 4; i++) job->extranonce1[i] = (uint8_t)rng_next(seed);
+    job->extranonce2_size = 8;
+}
+
+static void merkle_bench_extranonce2(uint8_t *extranonce2, uint64_t n) {
+    memset(extranonce2, 0, STRATUM_MAX_EXTRANONCE);
+    for (int i = 0; i < 8; i++) extranonce2[i] = (uint8_t)(n >> (i * 8));
+}
+
+// Per-work full rebuild vs the job template, with and without version rolling
+static int bench_merkle(int argc, char **argv) {
+    long count = 200000;
+    int branches = 12;
+    uint64_t seed = 0x3e4c1e;
+    uint32_t sink = 0;
+    int errors = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            branches = atoi(argv[++i]);
+        }
+    }
+    if (count < 1000) count = 1000;
+    if (branches < 0) branches = 0;
+    if (branches > STRATUM_MAX_MERKLE) branches = STRATUM_MAX_MERKLE;
+
+    static stratum_job_t job;
+    static stratum_template_t tpl;
+    uint8_t extranonce2[STRATUM_MAX_EXTRANONCE];
+    uint8_t header[80], work_data[12], data[12];
+    uint8_t midstates[STRATUM_MIDSTATES][32], midstate[32];
+    uint32_t versions[STRATUM_MIDSTATES];
+
+    merkle_bench_job(&job, branches, &seed);
+    stratum_template_init(&tpl, &job);
+
+    // Template against the full rebuild: root, header tail and every midstate
+    for (int n = 0; n < MERKLE_BENCH_CHECKS; n++) {
+        merkle_bench_extranonce2(extranonce2, rng_next(&seed));
+        stratum_build_header(&job, extranonce2, header);
+        stratum_template_set_extranonce2(&tpl, extranonce2);
+        uint32_t roll = n % 3 == 0 ? 0 : (uint32_t)rng_next(&seed) & 0x3FFF;
+        if (stratum_template_work(&tpl, roll, work_data, midstates, versions) != STRATUM_MIDSTATES ||
+            memcmp(tpl.header + 36, header + 36, 32) != 0) {
+            errors++;
+            continue;
+        }
+        for (int i = 0; i < STRATUM_MIDSTATES; i++) {
+            for (int b = 0; b < 4; b++) header[b] = (uint8_t)(versions[i] >> (b * 8));
+            stratum_header_to_work(header, data, midstate);
+            if ((versions[i] & ~job.version_mask) != job.version ||
+                memcmp(data, work_data, 12) != 0 || memcmp(midstate, midstates[i], 32) != 0) {
+                errors++;
+            }
+        }
+    }
+
+    // Full rebuild: coinbase, every branch and four midstates per work
+    uint64_t t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        merkle_bench_extranonce2(extranonce2, n);
+        stratum_build_header(&job, extranonce2, header);
+        for (int i = 0; i < STRATUM_MIDSTATES; i++) {
+            header[3] = 0x20 | (uint8_t)i;
+            stratum_header_to_work(header, work_data, midstates[i]);
+        }
+        sink += midstates[n & 3][0];
+    }
+    double full = count / ((now_ns() - t0) / 1e9);
+
+    // Template, a new extranonce2 per work
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        merkle_bench_extranonce2(extranonce2, n);
+        stratum_template_set_extranonce2(&tpl, extranonce2);
+        stratum_template_work(&tpl, 0, work_data, midstates, versions);
+        sink += midstates[n & 3][0];
+    }
+    double fresh = count / ((now_ns() - t0) / 1e9);
+
+    // Template as the prefetcher uses it: roll versions, then the next extranonce2
+    uint64_t next = 0;
+    uint32_t roll = 0;
+    merkle_bench_extranonce2(extranonce2, next++);
+    stratum_template_set_extranonce2(&tpl, extranonce2);
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        while (stratum_template_work(&tpl, roll, work_data, midstates, versions) < 0) {
+            merkle_bench_extranonce2(extranonce2, next++);
+            stratum_template_set_extranonce2(&tpl, extranonce2);
+            roll = 0;
+        }
+        roll++;
+        sink += midstates[n & 3][0];
+    }
+    double rolled = count / ((now_ns() - t0) / 1e9);
+
+    // Each work is 2^32 nonces per midstate on one chain
+    double needed = WORK_PREFETCH_FULL_HASHRATE_GHS * 1e9 / (4294967296.0 * STRATUM_MIDSTATES);
+
+    printf("====================================\n");
+    printf("Merkle Root / Work Build Benchmark\n");
+    printf("====================================\n");
+    printf("  %ld works, coinbase %zu bytes, %d merkle branches, %d midstates per work",
+           count, job.coinb1_len + job.extranonce1_len + job.extranonce2_size + job.coinb2_len,
+           branches, STRATUM_MIDSTATES);
+    double mhz = cpu_mhz();
+    if (mhz > 0) {
+        printf(", CPU %.0f MHz", mhz);
+    }
+    printf("\n\n");
+    printf("                                  Works/s    us/work   CPU at %.0f TH/s\n",
+           WORK_PREFETCH_FULL_HASHRATE_GHS / 1000);
+    printf("  Full rebuild per work        %10.0f   %8.2f   %6.2f%%\n",
+           full, 1e6 / full, needed / full * 100);
+    printf("  Template, new extranonce2    %10.0f   %8.2f   %6.2f%%\n",
+           fresh, 1e6 / fresh, needed / fresh * 100);
+    printf("  Template, version rolled     %10.0f   %8.2f   %6.2f%%\n",
+           rolled, 1e6 / rolled, needed / rolled * 100);
+    printf("\n  Full hashrate needs %.0f works/s (%d chains)\n", needed, MAX_CHAINS);
+    printf("  Output check: %s (sink %u)\n", errors ? "FAILED" : "identical", sink);
+
+    return errors ? 1 : 0;
+}
+
+//==============================================================================
+// In-flight work table
+//==============================================================================
+
+#define WORK_TABLE_BENCH_RACE_MS    500
+
+// Linear resolution as pattern_test does it: compare the returned byte
+typedef struct {
+    uint8_t work_id_byte;
+    work_info_t info;
+} scan_work_t;
+
+static int scan_lookup(const scan_work_t *works, int count, uint8_t work_id, work_info_t *info) {
+    for (int i = 0; i < count; i++) {
+        if (works[i].work_id_byte == (work_id & ~0x7)) {
+            *info = works[i].info;
+            return i;
+        }
+    }
+    return -1;
+}
+
+typedef struct {
+    work_table_t *table;
+    volatile bool running;
+    uint64_t written;
+} table_writer_t;
+
+// Chain 0's sending thread: every entry's contents derive from its work_id
+static void *table_writer_thread(void *arg) {
+    table_writer_t *w = arg;
+    work_info_t info;
+
+    memset(&info, 0, sizeof(info));
+    for (uint32_t id = 0; w->running; id = (id + 1) & WORK_DISPATCH_ID_MASK) {
+        info.job_seq = id;
+        memset(info.header, (uint8_t)id, sizeof(info.header));
+        info.versions[3] = id;
+        work_table_record(w->table, 0, id, &info);
+        w->written++;
+    }
+    return NULL;
+}
+
+// Table lookups vs a scan of in-flight works; stale and torn-read checks
+static int bench_work_table(int argc, char **argv) {
+    long count = 10000000;
+    uint64_t seed = 0x7AB1E;
+    uint32_t sink = 0;
+    int errors = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        }
+    }
+    if (count < 1000) count = 1000;
+
+    static work_table_t table;
+    static scan_work_t scan[WORK_TABLE_SLOTS];
+    work_info_t info;
+    nonce_response_t nonce = {0};
+
+    work_table_init(&table);
+    memset(&info, 0, sizeof(info));
+
+    // Nothing sent yet
+    nonce.chain_id = 1;
+    if (work_table_lookup(&table, &nonce, &info) != WORK_TABLE_EMPTY) errors++;
+
+    // Send more than a ring's worth per chain: the newest work per slot wins
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        for (uint32_t id = 0; id < 3 * WORK_TABLE_SLOTS + 5; id++) {
+            info.job_seq = (uint32_t)chain << 16 | id;
+            work_table_record(&table, chain, id, &info);
+        }
+    }
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        for (uint32_t id = 2 * WORK_TABLE_SLOTS + 5; id < 3 * WORK_TABLE_SLOTS + 5; id++) {
+            for (int slot = 0; slot < VERSION_ROLLING_MIDSTATES; slot++) {
+                nonce.chain_id = chain;
+                nonce.work_id = ((id << WORK_TABLE_ID_SHIFT) | slot) & 0xFF;
+                if (work_table_lookup(&table, &nonce, &info) != WORK_TABLE_HIT ||
+                    info.job_seq != ((uint32_t)chain << 16 | id)) {
+                    errors++;
+                }
+            }
+        }
+    }
+    nonce.chain_id = MAX_CHAINS;
+    if (work_table_lookup(&table, &nonce, &info) != WORK_TABLE_BAD_CHAIN) errors++;
+
+    // Clean job: sent works go stale, works built afterwards resolve
+    info.generation = work_table_new_generation(&table);
+    nonce.chain_id = 2;
+    nonce.work_id = 7 << WORK_TABLE_ID_SHIFT;
+    if (work_table_lookup(&table, &nonce, &info) != WORK_TABLE_STALE) errors++;
+    info.generation = work_table_generation(&table);
+    work_table_record(&table, 2, 7, &info);
+    if (work_table_lookup(&table, &nonce, &info) != WORK_TABLE_HIT) errors++;
+
+    // Genesis block as a sent work: its nonce from slot 1 resolves and verifies
+    memcpy(info.header, genesis_header, sizeof(info.header));
+    info.midstates = VERSION_ROLLING_MIDSTATES;
+    for (int i = 0; i < VERSION_ROLLING_MIDSTATES; i++) info.versions[i] = i == 1 ? 1 : 0x20000000;
+    work_table_record(&table, 0, 0x1234, &info);
+    nonce.chain_id = 0;
+    nonce.nonce = 0x7c2bac1d;
+    nonce.work_id = ((0x1234 << WORK_TABLE_ID_SHIFT) | 1) & 0xFF;
+    nonce.midstate = NONCE_MIDSTATE(nonce.work_id);
+    bool valid = false;
+    if (work_table_lookup(&table, &nonce, &info) != WORK_TABLE_HIT) {
+        errors++;
+    } else {
+        uint32_t version = info.versions[nonce.midstate];
+        for (int i = 0; i < 4; i++) info.header[i] = (uint8_t)(version >> (i * 8));
+        sha256d_check_nonces(info.header, &nonce.nonce, 1, 32, &valid);
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: Genesis nonce did not resolve through the work table\n");
+        errors++;
+    }
+
+    // Lookup cost with a full ring in flight on every chain
+    for (int i = 0; i < WORK_TABLE_SLOTS; i++) {
+        scan[i].work_id_byte = (uint8_t)(i << WORK_TABLE_ID_SHIFT);
+        scan[i].info.job_seq = i;
+    }
+    static nonce_response_t returned[4096];
+    for (int i = 0; i < 4096; i++) {
+        uint64_t r = rng_next(&seed);
+        returned[i].chain_id = r % MAX_CHAINS;
+        returned[i].work_id = (r >> 8) & 0xFF;
+        returned[i].midstate = NONCE_MIDSTATE(returned[i].work_id);
+    }
+
+    uint64_t t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        const nonce_response_t *r = &returned[n & 4095];
+        int idx = scan_lookup(scan, WORK_TABLE_SLOTS, (uint8_t)r->work_id, &info);
+        sink += idx + info.job_seq;
+    }
+    double scan_rate = count / ((now_ns() - t0) / 1e9);
+
+    t0 = now_ns();
+    for (long n = 0; n < count; n++) {
+        sink += work_table_lookup(&table, &returned[n & 4095], &info) + info.job_seq;
+    }
+    double table_rate = count / ((now_ns() - t0) / 1e9);
+
+    // Reader racing the sending thread on the same chain row
+    table_writer_t writer = { &table, true, 0 };
+    pthread_t thread;
+    uint64_t torn = 0, reads = 0;
+    work_table_init(&table);
+    pthread_create(&thread, NULL, table_writer_thread, &writer);
+    uint64_t end = now_ns() + WORK_TABLE_BENCH_RACE_MS * 1000000ULL;
+    nonce.chain_id = 0;
+    while (now_ns() < end) {
+        nonce.work_id = (uint16_t)(rng_next(&seed) & 0xFF);
+        if (work_table_lookup(&table, &nonce, &info) != WORK_TABLE_HIT) continue;
+        uint8_t b = (uint8_t)info.job_seq;
+        if (info.header[0] != b || info.header[79] != b || info.versions[3] != info.job_seq ||
+            WORK_TABLE_NONCE_SLOT(nonce.work_id) != WORK_TABLE_SLOT(info.job_seq)) {
+            torn++;
+        }
+        reads++;
+    }
+    writer.running = false;
+    pthread_join(thread, NULL);
+    if (torn) errors++;
+
+    printf("====================================\n");
+    printf("In-flight Work Table Benchmark\n");
+    printf("====================================\n");
+    printf("  %ld nonces, %d chains x %d slots, %zu-byte entries\n\n",
+           count, MAX_CHAINS, WORK_TABLE_SLOTS, sizeof(work_table_entry_t));
+    printf("  Linear scan (pattern_test style)  %10.0f nonces/s  %6.1f ns\n",
+           scan_rate, 1e9 / scan_rate);
+    printf("  Work table (slot from work_id)    %10.0f nonces/s  %6.1f ns   %.1fx\n",
+           table_rate, 1e9 / table_rate, table_rate / scan_rate);
+    printf("\n  Race with sending thread: %llu reads against %llu writes, %llu torn, %llu retries\n",
+           (unsigned long long)reads, (unsigned long long)writer.written,
+           (unsigned long long)torn, (unsigned long long)table.stats[0].retries);
+    printf("  Resolution/stale/genesis checks: %s (sink %u)\n", errors ? "FAILED" : "passed", sink);
+
+    return errors ? 1 : 0;
+}
+
+//==============================================================================
+// Return FIFO Demultiplexer
+//==============================================================================
+
+/*
+ * Register reads issued while chips are hashing: each reply lands in the
+ * return FIFO behind whatever nonces were already queued. A synthetic
+ * stream (random nonces on all chains, one reply per in-flight read, plus
+ * an unexpected and a garbled reply) is fed to the old single-pop read and
+ * to the demultiplexer.
+ */
+
+#define DEMUX_BENCH_READS       BM1398_REG_SLOTS
+#define DEMUX_BENCH_ENTRIES     4096
+#define DEMUX_BENCH_BATCH       64
+#define DEMUX_BENCH_LAG         4       // Nonces queued ahead of a reply, at most
+#define DEMUX_BENCH_REPLY_RATE  256     // Throughput stream: one reply per this many entries
+
+typedef struct {
+    int chain;
+    uint8_t chip;
+    uint8_t reg;
+    uint32_t value;
+    int pos;                    // Reply index in the stream
+    int lag;                    // Nonces ahead of it when the read was sent
+    int slot;
+} demux_read_t;
+
+static uint32_t demux_reply_header(int chain, uint8_t chip, uint8_t reg) {
+    return (uint32_t)chip << 16 | (uint32_t)reg << 8 | (uint32_t)chain;
+}
+
+static uint32_t demux_nonce_header(uint64_t r) {
+    return NONCE_WORK_ID_OR_CRC | ((uint32_t)(r >> 8) & 0x7FFF) << 16 | (uint32_t)(r % MAX_CHAINS);
+}
+
+static void demux_sim_silent(void *model, bm1398_context_t *ctx, uint32_t chain,
+                             const uint32_t *words) {
+    (void)model;
+    (void)ctx;
+    (void)chain;
+    (void)words;
+}
+
+/*
+ * The chip ID read from docs/single_board_test_pt2_fpga_dump.log: a
+ * broadcast read of register 0x00 on chain 0, answered by the entries the
+ * trace caught in the FIFO. The first 0x1398 reply completes it, later
+ * ones are strays; PT2 sent no work, so nothing may come out as a nonce.
+ */
+#define DEMUX_DUMP_MAX_ENTRIES  64
+#define DEMUX_DUMP_CHIP_ID      0x13981800
+
+static int demux_dump_check(sim_fpga_t *sim, const char *path) {
+    bm1398_context_t *ctx = &sim->ctx;
+    uint32_t entries[DEMUX_DUMP_MAX_ENTRIES][2];
+    nonce_response_t out[DEMUX_DUMP_MAX_ENTRIES];
+    int errors = 0;
+
+    int count = replay_load_fifo(path, entries, DEMUX_DUMP_MAX_ENTRIES);
+    if (count <= 0) {
+        fprintf(stderr, "Error: No FIFO entries in %s\n", path);
+        return 1;
+    }
+
+    // Chips answer from the trace only
+    sim->on_cmd = demux_sim_silent;
+    int slot = bm1398_read_register_async(ctx, 0, true, 0x00, ASIC_REG_CHIP_ADDR);
+    uint64_t replies = ctx->demux.reg_replies;
+    uint64_t unmatched = ctx->demux.unmatched;
+    uint64_t nonces = ctx->demux.nonces;
+    int n = bm1398_demux_fifo_entries(ctx, entries, count, out);
+
+    uint32_t value = 0;
+    int ret = slot < 0 ? -1 : bm1398_read_register_wait(ctx, slot, &value, 0);
+    sim->on_cmd = NULL;
+
+    printf("  Dump FIFO entries (%s):\n", path);
+    for (int i = 0; i < count; i++) {
+        uint32_t hdr = entries[i][0];
+        if (FIFO_IS_NONCE(hdr)) {
+            printf("    0x%08X 0x%08X  nonce, chain %d\n", hdr, entries[i][1], FIFO_CHAIN(hdr));
+        } else {
+            printf("    0x%08X 0x%08X  reply, chain %d chip 0x%02X reg 0x%02X\n",
+                   hdr, entries[i][1], FIFO_CHAIN(hdr), FIFO_REG_CHIP(hdr), FIFO_REG_ADDR(hdr));
+        }
+    }
+    printf("  Chip ID read: %s 0x%08X\n\n", ret == 0 ? "completed," : "timed out,", value);
+
+    if (ret < 0 || value != DEMUX_DUMP_CHIP_ID) errors++;
+    if (n != 0 || ctx->demux.nonces != nonces) errors++;
+    if (ctx->demux.reg_replies - replies != (uint64_t)count) errors++;
+    if (ctx->demux.unmatched - unmatched != (uint64_t)count - 1) errors++;
+    return errors;
+}
+
+static int bench_demux(int argc, char **argv) {
+    const char *dump = DEFAULT_DUMP;
+    long count = 10000000;
+    uint64_t seed = 0xF1F0;
+    int errors = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            dump = argv[++i];
+        }
+    }
+    if (count < DEMUX_BENCH_ENTRIES) count = DEMUX_BENCH_ENTRIES;
+
+    static uint32_t stream[DEMUX_BENCH_ENTRIES][2];
+    static uint32_t expected[DEMUX_BENCH_ENTRIES];
+    static const uint8_t regs_read[] = {
+        ASIC_REG_PLL_PARAM_0, ASIC_REG_CLK_CTRL, ASIC_REG_CORE_CONFIG, ASIC_REG_TICKET_MASK,
+    };
+    demux_read_t reads[DEMUX_BENCH_READS];
+    nonce_response_t out[DEMUX_BENCH_BATCH];
+    int num_expected = 0;
+
+    // Stream: replies spread evenly, nonces everywhere else, two strays at the end
+    int spacing = (DEMUX_BENCH_ENTRIES - 2) / (DEMUX_BENCH_READS + 1);
+    for (int i = 0; i < DEMUX_BENCH_READS; i++) {
+        uint64_t r = rng_next(&seed);
+        reads[i].chain = i % MAX_CHAINS;
+        reads[i].chip = (uint8_t)(((r >> 8) % CHIPS_PER_CHAIN_S19PRO) * 2);
+        reads[i].reg = regs_read[i % sizeof(regs_read)];
+        reads[i].value = (uint32_t)(r >> 32);
+        reads[i].pos = (i + 1) * spacing;
+        reads[i].lag = r % (DEMUX_BENCH_LAG + 1);
+    }
+    for (int i = 0, next = 0; i < DEMUX_BENCH_ENTRIES - 2; i++) {
+        if (next < DEMUX_BENCH_READS && i == reads[next].pos) {
+            stream[i][0] = demux_reply_header(reads[next].chain, reads[next].chip, reads[next].reg);
+            stream[i][1] = reads[next].value;
+            next++;
+        } else {
+            uint64_t r = rng_next(&seed);
+            stream[i][0] = demux_nonce_header(r);
+            stream[i][1] = (uint32_t)(r >> 32);
+            expected[num_expected++] = stream[i][1];
+        }
+    }
+    stream[DEMUX_BENCH_ENTRIES - 2][0] = demux_reply_header(1, 0x02, ASIC_REG_HASH_COUNTING);
+    stream[DEMUX_BENCH_ENTRIES - 2][1] = 0x12345678;
+    stream[DEMUX_BENCH_ENTRIES - 1][0] = demux_reply_header(2, 0x04, ASIC_REG_CLK_CTRL) |
+                                         FIFO_REPLY_CRC_ERROR;
+    stream[DEMUX_BENCH_ENTRIES - 1][1] = 0x9ABCDEF0;
+
+    // Old read: pops one entry right after sending; anything else is a nonce
+    int legacy_lost = 0, legacy_wrong = 0, legacy_bogus = 0;
+    for (int i = 0; i < DEMUX_BENCH_READS; i++) {
+        if (reads[i].lag > 0) {
+            legacy_lost++;
+            legacy_wrong++;
+            legacy_bogus++;
+        }
+    }
+    legacy_bogus += 2;
+
+    // Demux against the simulated FPGA
+    sim_fpga_t sim;
+    if (sim_fpga_start(&sim, MAX_CHAINS) < 0) {
+        fprintf(stderr, "Error: Failed to set up simulated FPGA\n");
+        return 1;
+    }
+    bm1398_context_t *ctx = &sim.ctx;
+
+    printf("====================================\n");
+    printf("Return FIFO Demultiplexer Benchmark\n");
+    printf("====================================\n");
+
+    // Real FIFO words first: the classifier must agree with the hardware
+    int dump_errors = demux_dump_check(&sim, dump);
+    uint64_t dump_unmatched = ctx->demux.unmatched;
+    errors += dump_errors;
+
+    // Blocking reads through the simulated UART, unicast and broadcast
+    uint32_t value = 0;
+    if (bm1398_read_register(ctx, 1, false, 0x0A, ASIC_REG_PLL_PARAM_0, &value, 100) < 0 ||
+        value != demux_reply_header(1, 0x0A, ASIC_REG_PLL_PARAM_0)) {
+        fprintf(stderr, "Error: Unicast read returned 0x%08X\n", value);
+        errors++;
+    }
+    if (bm1398_read_register(ctx, 2, true, 0x00, ASIC_REG_CORE_CONFIG, &value, 100) < 0 ||
+        value != demux_reply_header(2, 0x00, ASIC_REG_CORE_CONFIG)) {
+        fprintf(stderr, "Error: Broadcast read returned 0x%08X\n", value);
+        errors++;
+    }
+
+    // Fill every slot, then hand the stream to the demux as the drain would
+    for (int i = 0; i < DEMUX_BENCH_READS; i++) {
+        reads[i].slot = bm1398_read_register_async(ctx, reads[i].chain, false,
+                                                   reads[i].chip, reads[i].reg);
+        if (reads[i].slot < 0) errors++;
+    }
+    if (bm1398_read_register_async(ctx, 0, true, 0x00, ASIC_REG_CHIP_ADDR) >= 0) {
+        fprintf(stderr, "Error: Read accepted with every slot in flight\n");
+        errors++;
+    }
+    ctx->fpga_regs[REG_NONCE_NUMBER_IN_FIFO] = 0;
+
+    int got = 0, mismatched = 0;
+    for (int i = 0; i < DEMUX_BENCH_ENTRIES; i += DEMUX_BENCH_BATCH) {
+        int n = bm1398_demux_fifo_entries(ctx, &stream[i], DEMUX_BENCH_BATCH, out);
+        for (int j = 0; j < n; j++, got++) {
+            if (got >= num_expected || out[j].nonce != expected[got]) mismatched++;
+        }
+    }
+    int wrong = 0;
+    for (int i = 0; i < DEMUX_BENCH_READS; i++) {
+        value = 0;
+        if (reads[i].slot < 0 || bm1398_read_register_wait(ctx, reads[i].slot, &value, 0) < 0 ||
+            value != reads[i].value) {
+            wrong++;
+        }
+    }
+    uint64_t unmatched = ctx->demux.unmatched - dump_unmatched;
+    uint64_t garbled = ctx->demux.garbled;
+    if (got != num_expected || mismatched || wrong || garbled != 1) errors++;
+
+    // Routing cost with no reads in flight and with a reply every so often
+    static uint32_t plain[DEMUX_BENCH_ENTRIES][2];
+    static uint32_t mixed[DEMUX_BENCH_ENTRIES][2];
+    for (int i = 0; i < DEMUX_BENCH_ENTRIES; i++) {
+        uint64_t r = rng_next(&seed);
+        plain[i][0] = mixed[i][0] = demux_nonce_header(r);
+        plain[i][1] = mixed[i][1] = (uint32_t)(r >> 32);
+        if (i % DEMUX_BENCH_REPLY_RATE == 0) {
+            mixed[i][0] = demux_reply_header(i % MAX_CHAINS, 0x00, ASIC_REG_CLK_CTRL);
+        }
+    }
+    uint32_t sink = 0;
+    uint64_t t0 = now_ns();
+    for (long n = 0; n < count; n += DEMUX_BENCH_BATCH) {
+        int base = n & (DEMUX_BENCH_ENTRIES - 1);
+        sink += bm1398_demux_fifo_entries(ctx, &plain[base], DEMUX_BENCH_BATCH, out);
+        sink += out[0].nonce;
+    }
+    double plain_rate = count / ((now_ns() - t0) / 1e9);
+
+    t0 = now_ns();
+    for (long n = 0; n < count; n += DEMUX_BENCH_BATCH) {
+        int base = n & (DEMUX_BENCH_ENTRIES - 1);
+        sink += bm1398_demux_fifo_entries(ctx, &mixed[base], DEMUX_BENCH_BATCH, out);
+        sink += out[0].nonce;
+    }
+    double mixed_rate = count / ((now_ns() - t0) / 1e9);
+
+    printf("  %d entries, %d register reads in flight (up to %d nonces ahead of each reply)\n\n",
+           DEMUX_BENCH_ENTRIES, DEMUX_BENCH_READS, DEMUX_BENCH_LAG);
+    printf("                  nonces lost   wrong values   replies taken as nonces\n");
+    printf("  Single pop      %11d   %12d   %23d\n", legacy_lost, legacy_wrong, legacy_bogus);
+    printf("  Demux           %11d   %12d   %23d\n",
+           num_expected - got + mismatched, wrong, 0);
+    printf("\n  Strays: %llu unmatched, %llu garbled\n",
+           (unsigned long long)unmatched, (unsigned long long)garbled);
+    printf("\n  Routing, nonces only        %10.0f entries/s  %5.1f ns\n",
+           plain_rate, 1e9 / plain_rate);
+    printf("  Routing, 1/%d replies      %10.0f entries/s  %5.1f ns\n",
+           DEMUX_BENCH_REPLY_RATE, mixed_rate, 1e9 / mixed_rate);
+    printf("  Dump replay check: %s\n", dump_errors ? "FAILED" : "passed");
+    printf("  Sim reads/slot/order checks: %s (sink %u)\n",
+           errors > dump_errors ? "FAILED" : "passed", sink);
+
+    sim_fpga_stop(&sim);
+    return errors ? 1 : 0;
+}
+
+//==============================================================================
+// Chain Register Scan
+//==============================================================================
+
+/*
+ * One register from all 114 chips of a chain: serial bm1398_read_register()
+ * calls against the simulated FPGA, then a broadcast and a unicast scan
+ * whose replies (some chips silent, one stale value, one repeated reply,
+ * nonces in between) are fed through the demultiplexer. The projection
+ * puts UART frame times and the 100 ms per-read timeout back in.
+ */
+
+#define SCAN_BENCH_READ_TIMEOUT_MS  100     // What serial callers pass today
+#define SCAN_BENCH_POLL_US          100     // bm1398_read_register_wait() poll
+#define SCAN_BENCH_READ_BYTES       9
+#define SCAN_BENCH_REPLY_BYTES      7
+#define SCAN_BENCH_REGS             3       // PLL_PARAM_0, CLK_CTRL, CORE_CONFIG
+
+// Replies for every chip but the first `missing`, shuffled, a nonce after each
+static int scan_bench_stream(uint32_t (*stream)[2], const bm1398_chain_scan_t *scan,
+                             int missing, uint32_t value, uint64_t *seed) {
+    int order[BM1398_SCAN_MAX_CHIPS];
+    int n = 0;
+
+    for (int i = 0; i < scan->num_chips; i++) order[i] = i;
+    for (int i = scan->num_chips - 1; i > 0; i--) {
+        int j = rng_next(seed) % (i + 1);
+        int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (int i = 0; i < scan->num_chips; i++) {
+        int chip = order[i];
+        if (chip < missing) continue;
+        stream[n][0] = demux_reply_header(scan->chain, (uint8_t)(chip * scan->interval),
+                                          scan->reg_addr);
+        stream[n][1] = chip == scan->num_chips - 1 ? ~value : value;
+        n++;
+        uint64_t r = rng_next(seed);
+        stream[n][0] = demux_nonce_header(r);
+        stream[n][1] = (uint32_t)(r >> 32);
+        n++;
+    }
+    stream[n][0] = demux_reply_header(scan->chain, (uint8_t)(missing * scan->interval),
+                                      scan->reg_addr);
+    stream[n][1] = value;                   // Chip 0 address again
+    return n + 1;
+}
+
+static int scan_bench_check(const bm1398_chain_scan_t *scan, int missing, uint32_t value) {
+    int errors = 0;
+
+    if (scan->responded != scan->num_chips - missing || scan->duplicates != 1) errors++;
+    for (int i = 0; i < scan->num_chips; i++) {
+        uint32_t want = i == scan->num_chips - 1 ? ~value : value;
+        if (scan->present[i] != (i >= missing) || (scan->present[i] && scan->value[i] != want)) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/*
+ * A chip ID scan fed the FIFO entries of the PT2 dump, which was taken
+ * before the chain was addressed: every chip still answers as address 0.
+ * The first 0x00 reply fills chip 0, the repeats count as duplicates and
+ * the register 0x40 replies are not the scan's.
+ */
+#define SCAN_DUMP_MAX_ENTRIES   64
+
+static int scan_dump_check(bm1398_context_t *ctx, const char *path, bm1398_chain_scan_t *scan) {
+    uint32_t entries[SCAN_DUMP_MAX_ENTRIES][2];
+    nonce_response_t nonces[SCAN_DUMP_MAX_ENTRIES];
+    int errors = 0;
+
+    int count = replay_load_fifo(path, entries, SCAN_DUMP_MAX_ENTRIES);
+    if (count <= 0) {
+        fprintf(stderr, "Error: No FIFO entries in %s\n", path);
+        return 1;
+    }
+
+    int chip_id = 0;
+    for (int i = 0; i < count; i++) {
+        if (!FIFO_IS_NONCE(entries[i][0]) && FIFO_REG_ADDR(entries[i][0]) == ASIC_REG_CHIP_ADDR) {
+            chip_id++;
+        }
+    }
+
+    if (bm1398_scan_chain_begin(ctx, 0, ASIC_REG_CHIP_ADDR, true, scan) < 0) {
+        return 1;
+    }
+    ctx->fpga_regs[REG_NONCE_NUMBER_IN_FIFO] = 0;
+    uint64_t unmatched = ctx->demux.unmatched;
+
+    if (bm1398_demux_fifo_entries(ctx, entries, count, nonces) != 0) errors++;
+    if (bm1398_scan_chain_wait(ctx, scan, 0) != 1) errors++;
+    if (!scan->present[0] || scan->value[0] >> 16 != 0x1398 ||
+        (scan->value[0] & 0xFF) != 0) {
+        errors++;                       // Chip ID, address byte 0
+    }
+    if (scan->duplicates != chip_id - 1) errors++;
+    if (ctx->demux.unmatched - unmatched != (uint64_t)(count - chip_id)) errors++;
+    return errors;
+}
+
+static int bench_scan(int argc, char **argv) {
+    const char *dump = DEFAULT_DUMP;
+    int missing = 2;
+    uint32_t baud = 115200;
+    uint64_t seed = 0x5CA7;
+    int errors = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            missing = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            baud = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            dump = argv[++i];
+        }
+    }
+    if (missing < 0) missing = 0;
+    if (missing > CHIPS_PER_CHAIN_S19PRO - 1) missing = CHIPS_PER_CHAIN_S19PRO - 1;
+    if (baud == 0) baud = 115200;
+
+    sim_fpga_t sim;
+    if (sim_fpga_start(&sim, 1) < 0) {
+        fprintf(stderr, "Error: Failed to set up simulated FPGA\n");
+        return 1;
+    }
+    bm1398_context_t *ctx = &sim.ctx;
+    int num_chips = ctx->chips_per_chain[0];
+    int interval = 256 / num_chips;
+
+    // Serial: one round trip per chip
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < num_chips; i++) {
+        uint32_t value = 0;
+        uint8_t addr = (uint8_t)(i * interval);
+        if (bm1398_read_register(ctx, 0, false, addr, ASIC_REG_CLK_CTRL, &value,
+                                 SCAN_BENCH_READ_TIMEOUT_MS) < 0 ||
+            value != demux_reply_header(0, addr, ASIC_REG_CLK_CTRL)) {
+            errors++;
+        }
+    }
+    double serial_ms = (now_ns() - t0) / 1e6;
+
+    // Broadcast and unicast scans, replies through the demux
+    static uint32_t stream[2 * BM1398_SCAN_MAX_CHIPS + 1][2];
+    nonce_response_t nonces[2 * BM1398_SCAN_MAX_CHIPS + 1];
+    bm1398_chain_scan_t scan;
+    double scan_ms[2];
+    uint64_t sent[2];
+    int got_nonces = 0;
+
+    for (int unicast = 0; unicast < 2; unicast++) {
+        uint32_t value = 0xF0000000 | (uint32_t)unicast;
+        uint64_t commands = sim.commands;
+
+        t0 = now_ns();
+        if (bm1398_scan_chain_begin(ctx, 0, ASIC_REG_CLK_CTRL, !unicast, &scan) < 0) {
+            errors++;
+            break;
+        }
+        sent[unicast] = sim.commands - commands;
+        ctx->fpga_regs[REG_NONCE_NUMBER_IN_FIFO] = 0;
+
+        bm1398_chain_scan_t other;
+        if (bm1398_scan_chain_begin(ctx, 0, ASIC_REG_CORE_CONFIG, true, &other) == 0) {
+            fprintf(stderr, "Error: Second scan started on a busy chain\n");
+            errors++;
+        }
+
+        int n = scan_bench_stream(stream, &scan, missing, value, &seed);
+        got_nonces += bm1398_demux_fifo_entries(ctx, stream, n, nonces);
+        if (bm1398_scan_chain_wait(ctx, &scan, 0) != num_chips - missing) errors++;
+        scan_ms[unicast] = (now_ns() - t0) / 1e6;
+        errors += scan_bench_check(&scan, missing, value);
+    }
+    if (got_nonces != 2 * (num_chips - missing)) errors++;
+    if (sent[0] != 1 || sent[1] != (uint64_t)num_chips) errors++;
+
+    // Real FIFO words through the same scan path
+    int dump_errors = scan_dump_check(ctx, dump, &scan);
+    int dump_dups = scan.duplicates;
+    errors += dump_errors;
+
+    sim_fpga_stop(&sim);
+
+    // On the wire: every serial read waits out its round trip (or timeout)
+    double frame_ms = 10.0 * 1000 / baud;
+    double serial_hw = (num_chips - missing) *
+                       ((SCAN_BENCH_READ_BYTES + SCAN_BENCH_REPLY_BYTES) * frame_ms +
+                        SCAN_BENCH_POLL_US / 1000.0) +
+                       missing * (double)SCAN_BENCH_READ_TIMEOUT_MS;
+    double scan_hw = missing > 0 ? BM1398_SCAN_TIMEOUT_MS :
+                     (SCAN_BENCH_READ_BYTES + num_chips * SCAN_BENCH_REPLY_BYTES) * frame_ms;
+    int scans = SCAN_BENCH_REGS * MAX_CHAINS;
+
+    printf("====================================\n");
+    printf("Chain Register Scan Benchmark\n");
+    printf("====================================\n");
+    printf("  %d chips, address interval %d, %d silent\n\n", num_chips, interval, missing);
+    printf("  Simulated FPGA (software cost, one register):\n");
+    printf("    Serial reads      %8.2f ms   %3d commands\n", serial_ms, num_chips);
+    printf("    Broadcast scan    %8.2f ms   %3llu command\n", scan_ms[0],
+           (unsigned long long)sent[0]);
+    printf("    Unicast scan      %8.2f ms   %3llu commands\n", scan_ms[1],
+           (unsigned long long)sent[1]);
+    printf("\n  Projected at %u baud, %d registers x %d chains:\n", baud, SCAN_BENCH_REGS,
+           MAX_CHAINS);
+    printf("    Serial reads      %8.1f ms\n", serial_hw * scans);
+    printf("    Broadcast scan    %8.1f ms   %.1fx\n", scan_hw * scans, serial_hw / scan_hw);
+    printf("\n  Dump chip ID scan: %d/%d answered, 0x%08X, %d repeats: %s\n",
+           scan.responded, scan.num_chips, scan.value[0], dump_dups,
+           dump_errors ? "FAILED" : "passed");
+    printf("  Silent/stale/repeat/nonce checks: %s\n", errors > dump_errors ? "FAILED" : "passed");
+
+    return errors ? 1 : 0;
+}
+
+//==============================================================================
+// Register Shadow
+//==============================================================================
+
+/*
+ * Stage 1 followed by the software core reset (four read-modify-writes and
+ * a CLK_CTRL read), with and without the register shadow, counting the
+ * UART commands the simulated FPGA sees. Then a register left different
+ * on one chip, and a resync.
+ */
+
+#define SHADOW_BENCH_CHIP       0x08    // Chip given its own CLK_CTRL
+#define SHADOW_BENCH_FRAME_MS   (16 * 10 * 1000.0 / 115200)    // Read + reply at 115200 baud
+
+static int bench_shadow(int argc, char **argv) {
+    int errors = 0;
+
+    (void)argc;
+    (void)argv;
+
+    sim_fpga_t sim;
+    if (sim_fpga_start(&sim, 1) < 0) {
+        fprintf(stderr, "Error: Failed to set up simulated FPGA\n");
+        return 1;
+    }
+    bm1398_context_t *ctx = &sim.ctx;
+    bm1398_reg_shadow_t *shadow = ctx->shadow;
+    if (!shadow) {
+        sim_fpga_stop(&sim);
+        return 1;
+    }
+
+    uint64_t commands[2], reads[2];
+    double ms[2];
+    for (int use = 0; use < 2; use++) {
+        ctx->shadow = use ? shadow : NULL;
+        int saved = quiet_begin();
+        bm1398_reset_chain_stage1(ctx, 0);
+        uint64_t c0 = sim.commands, r0 = sim.reads;
+        uint64_t t0 = now_ns();
+        if (bm1398_software_reset_cores(ctx, 0) < 0) errors++;
+        ms[use] = (now_ns() - t0) / 1e6;
+        quiet_end(saved);
+        commands[use] = sim.commands - c0;
+        reads[use] = sim.reads - r0;
+    }
+    ctx->shadow = shadow;
+
+    // Stage 1 leaves 0xF000BA05 / 0xF8; the core reset must end where it started
+    bm1398_reg_shadow_t *sh = &shadow[0];
+    uint32_t clk = sh->value[0][ASIC_REG_CLK_CTRL >> 2];
+    uint32_t reset = sh->value[0][ASIC_REG_RESET_CTRL >> 2];
+    if (reads[1] != 0 || clk != 0xF000BA05 || reset != 0x000000F8 ||
+        sh->value[BM1398_SHADOW_ADDRS - 2][ASIC_REG_CLK_CTRL >> 2] != clk) {
+        errors++;
+    }
+
+    // One chip with its own value: each chip gets its own value modified
+    int saved = quiet_begin();
+    bm1398_write_register(ctx, 0, false, SHADOW_BENCH_CHIP, ASIC_REG_CLK_CTRL, 0x0000BA01);
+    uint64_t c0 = sim.commands, r0 = sim.reads;
+    if (bm1398_read_modify_write_register(ctx, 0, ASIC_REG_CLK_CTRL, 0x01, 0x02) < 0) errors++;
+    quiet_end(saved);
+    uint64_t diverged_cmds = sim.commands - c0;
+    if (sim.reads != r0 || diverged_cmds != (uint64_t)ctx->chips_per_chain[0] ||
+        sh->value[0][ASIC_REG_CLK_CTRL >> 2] != 0xF000BA06 ||
+        sh->value[SHADOW_BENCH_CHIP][ASIC_REG_CLK_CTRL >> 2] != 0x0000BA02) {
+        errors++;
+    }
+
+    // Resync: the simulator only ever answers as chip 0, so the scan times out
+    // and nothing, not even chip 0's reply, stays cached
+    int answered = bm1398_shadow_resync(ctx, 0, ASIC_REG_CLK_CTRL);
+    uint64_t bit = BM1398_SHADOW_BIT(ASIC_REG_CLK_CTRL);
+    if (answered != -1 || (sh->valid[0] & bit) || (sh->valid[SHADOW_BENCH_CHIP] & bit) ||
+        !(sh->diverged & bit)) {
+        errors++;
+    }
+
+    // The next read goes to the chip again
+    uint32_t value = 0;
+    r0 = sim.reads;
+    if (bm1398_read_register_cached(ctx, 0, 0, ASIC_REG_CLK_CTRL, &value) < 0 ||
+        sim.reads != r0 + 1 || !(sh->valid[0] & bit)) {
+        errors++;
+    }
+
+    // Reset line: everything forgotten
+    bm1398_chain_reset_low(ctx, 0);
+    bm1398_chain_reset_high(ctx, 0);
+    if (sh->valid[0] != 0) errors++;
+
+    sim_fpga_stop(&sim);
+
+    printf("====================================\n");
+    printf("Register Shadow Benchmark\n");
+    printf("====================================\n");
+    printf("  Software core reset after Stage 1 (simulated FPGA):\n");
+    printf("    %-16s %8s %8s %10s\n", "", "commands", "reads", "time (ms)");
+    printf("    %-16s %8llu %8llu %10.1f\n", "UART reads", (unsigned long long)commands[0],
+           (unsigned long long)reads[0], ms[0]);
+    printf("    %-16s %8llu %8llu %10.1f\n", "Shadow", (unsigned long long)commands[1],
+           (unsigned long long)reads[1], ms[1]);
+    printf("    %llu UART commands saved per chain (~%.1f ms of wire time at 115200 baud)\n",
+           (unsigned long long)(commands[0] - commands[1]),
+           (commands[0] - commands[1]) * SHADOW_BENCH_FRAME_MS);
+    printf("\n  Diverged register: %llu unicast writes, 0 reads\n",
+           (unsigned long long)diverged_cmds);
+    printf("  Resync with silent chips: %s\n", answered < 0 ? "failed, register forgotten" :
+           "accepted");
+    printf("  Value/diverge/resync/reset checks: %s\n", errors ? "FAILED" : "passed");
+
+    return errors ? 1 : 0;
+}
+
+//==============================================================================
+// PLL Solver
+//==============================================================================
+
+/*
+ * The 5 MHz PLL0 table against the solver it was generated from (on the
+ * build host, by pll_table_gen), the known 525 MHz value, encode/decode
+ * round trips, and the cost of a table lookup vs a solve.
+ */
+
+#define PLL_BENCH_REG_525       0x40540100      // Stock 525 MHz PLL0 value
+
+static int bench_pll(int argc, char **argv) {
+    uint32_t freq = 0;
+    int errors = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            freq = (uint32_t)atol(argv[++i]);
+        }
+    }
+
+    int count = 0;
+    const uint32_t *table = bm1398_pll_table(&count);
+    bm1398_pll_t pll, back;
+
+    // Known value: both paths, and what it decodes to
+    if (bm1398_pll_reg_for(FREQUENCY_525MHZ) != PLL_BENCH_REG_525 ||
+        bm1398_pll_solve(FREQUENCY_525MHZ, &pll) < 0 ||
+        bm1398_pll_encode(&pll) != PLL_BENCH_REG_525) {
+        fprintf(stderr, "Error: 525 MHz does not give 0x%08X\n", PLL_BENCH_REG_525);
+        errors++;
+    }
+    if (bm1398_pll_decode(PLL_BENCH_REG_525, &pll) < 0 || pll.refdiv != 1 || pll.fbdiv != 84 ||
+        pll.postdiv1 != 1 || pll.postdiv2 != 1 || bm1398_pll_freq_mhz(&pll) != 525.0) {
+        fprintf(stderr, "Error: 0x%08X does not decode to 525 MHz\n", PLL_BENCH_REG_525);
+        errors++;
+    }
+
+    // Table vs solver, every step
+    double worst = 0, sum = 0;
+    uint32_t worst_mhz = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t mhz = BM1398_PLL_TABLE_MIN_MHZ + (uint32_t)i * BM1398_PLL_TABLE_STEP_MHZ;
+        if (bm1398_pll_solve(mhz, &pll) < 0 || bm1398_pll_encode(&pll) != table[i]) {
+            fprintf(stderr, "Error: Table entry for %u MHz is 0x%08X, solver gives 0x%08X\n",
+                    mhz, table[i], bm1398_pll_encode(&pll));
+            errors++;
+        }
+        double err = bm1398_pll_freq_mhz(&pll) - mhz;
+        if (err < 0) err = -err;
+        sum += err;
+        if (err > worst) {
+            worst = err;
+            worst_mhz = mhz;
+        }
+    }
+
+    // Every MHz the solver covers: valid, in range, and survives decode
+    int off_table = 0;
+    for (uint32_t mhz = 1; mhz <= BM1398_PLL_TABLE_MAX_MHZ; mhz++) {
+        uint32_t reg = bm1398_pll_reg_for(mhz);
+        double vco;
+        if (reg == 0 || bm1398_pll_decode(reg, &back) < 0 || bm1398_pll_encode(&back) != reg) {
+            fprintf(stderr, "Error: %u MHz gives undecodable 0x%08X\n", mhz, reg);
+            errors++;
+            continue;
+        }
+        vco = bm1398_pll_vco_mhz(&back);
+        if (vco < BM1398_PLL_VCO_MIN_MHZ || vco > BM1398_PLL_VCO_MAX_MHZ) errors++;
+        if (mhz % BM1398_PLL_TABLE_STEP_MHZ) off_table++;
+    }
+    if (bm1398_pll_reg_for(0) != 0 || bm1398_pll_decode(0x00540100, &back) == 0) errors++;
+
+    // Lookup vs solve
+    uint32_t sink = 0;
+    int rounds = 1000;
+    uint64_t t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) {
+            sink += bm1398_pll_reg_for(BM1398_PLL_TABLE_MIN_MHZ +
+                                       (uint32_t)i * BM1398_PLL_TABLE_STEP_MHZ);
+        }
+    }
+    double table_ns = (double)(now_ns() - t0) / ((double)rounds * count);
+
+    t0 = now_ns();
+    for (int r = 0; r < rounds / 10; r++) {
+        for (int i = 0; i < count; i++) {
+            bm1398_pll_solve(BM1398_PLL_TABLE_MIN_MHZ + (uint32_t)i * BM1398_PLL_TABLE_STEP_MHZ,
+                             &pll);
+            sink += pll.fbdiv;
+        }
+    }
+    double solve_ns = (double)(now_ns() - t0) / ((double)(rounds / 10) * count);
+
+    printf("====================================\n");
+    printf("PLL Solver Benchmark\n");
+    printf("====================================\n");
+    printf("  CLKI %d MHz, VCO %d-%d MHz, refdiv <= %d, postdiv <= %d, output /%d\n\n",
+           BM1398_PLL_CLKI_MHZ, BM1398_PLL_VCO_MIN_MHZ, BM1398_PLL_VCO_MAX_MHZ,
+           BM1398_PLL_REFDIV_MAX, BM1398_PLL_POSTDIV_MAX, BM1398_PLL_OUT_DIV);
+    printf("  Table: %d entries, %d-%d MHz in %d MHz steps\n", count, BM1398_PLL_TABLE_MIN_MHZ,
+           BM1398_PLL_TABLE_MAX_MHZ, BM1398_PLL_TABLE_STEP_MHZ);
+    printf("    Error mean %.3f MHz, worst %.3f MHz (at %u MHz)\n", sum / count, worst, worst_mhz);
+    printf("    %d in-between frequencies solved\n", off_table);
+    printf("  Table lookup   %8.1f ns\n", table_ns);
+    printf("  Solve          %8.1f ns   %.0fx\n", solve_ns, solve_ns / table_ns);
+
+    if (freq > 0) {
+        uint32_t reg = bm1398_pll_reg_for(freq);
+        if (reg && bm1398_pll_decode(reg, &pll) == 0) {
+            printf("\n  %u MHz: 0x%08X  refdiv=%u fbdiv=%u postdiv1=%u postdiv2=%u\n", freq, reg,
+                   pll.refdiv, pll.fbdiv, pll.postdiv1, pll.postdiv2);
+            printf("    VCO %.0f MHz, hashing clock %.3f MHz\n", bm1398_pll_vco_mhz(&pll),
+                   bm1398_pll_freq_mhz(&pll));
+        }
+    }
+    printf("  525 MHz/table/round-trip checks: %s (sink %u)\n",
+           errors ? "FAILED" : "passed", sink);
+
+    return errors ? 1 : 0;
+}
+
+//==============================================================================
+// Frequency Ramp
+//==============================================================================
+
+/*
+ * Per-chip ramp against a chip model behind the simulated FPGA: every chip
+ * keeps its own PLL0, answers PLL0 reads through the demultiplexer, and
+ * goes silent above the fastest clock it locks at. Targets are spread over
+ * 500-650 MHz, a few chips per chain top out below theirs, and one chip on
+ * the last chain never answers. Two chips per chain each lose one PLL0
+ * reply, one at the base scan and one at a step's read-back; both must
+ * still reach their targets. Chains ramped one after another, then in
+ * parallel; the result is compared with the single broadcast clock every
+ * chip survives.
+ */
+
+#define RAMP_BENCH_TARGET_MIN   500
+#define RAMP_BENCH_TARGET_MAX   650
+#define RAMP_BENCH_WEAK         3       // Chips per chain that cannot reach their target
+#define RAMP_BENCH_WEAK_MHZ     40      // How far short they fall
+#define RAMP_BENCH_ABSENT_CHIP  57      // On the last chain
+#define RAMP_BENCH_FLAKY_BASE   1       // Broadcast read lost by the first flaky chip (base scan)
+#define RAMP_BENCH_FLAKY_STEP   3       // And by the second (first step's read-back)
+
+typedef struct {
+    int interval;
+    uint32_t pll[MAX_CHAINS][BM1398_SCAN_MAX_CHIPS];
+    uint32_t limit_mhz[MAX_CHAINS][BM1398_SCAN_MAX_CHIPS];   // Fastest lock, 0 = absent
+    uint32_t reads[MAX_CHAINS];                              // Broadcast reads so far
+    uint32_t lose_read[MAX_CHAINS][BM1398_SCAN_MAX_CHIPS];   // Read left unanswered, 0 = none
+} ramp_model_t;
+
+static bool ramp_model_alive(const ramp_model_t *m, int chain, int chip) {
+    bm1398_pll_t pll;
+    return m->limit_mhz[chain][chip] > 0 && bm1398_pll_decode(m->pll[chain][chip], &pll) == 0 &&
+           bm1398_pll_freq_mhz(&pll) <= m->limit_mhz[chain][chip];
+}
+
+// Runs on the ack thread: PLL0 writes land in the model, reads are answered
+static void ramp_model_cmd(void *arg, bm1398_context_t *ctx, uint32_t chain,
+                           const uint32_t *words) {
+    ramp_model_t *m = arg;
+    uint8_t preamble = words[0] >> 24;
+    uint8_t addr = (words[0] >> 8) & 0xFF;
+    uint8_t reg = words[0] & 0xFF;
+    int chip = addr / m->interval;
+    bool unicast_ok = addr % m->interval == 0 && chip < CHIPS_PER_CHAIN_S19PRO;
+
+    if (chain >= MAX_CHAINS || reg != ASIC_REG_PLL_PARAM_0) {
+        return;
+    }
+
+    uint32_t replies[BM1398_SCAN_MAX_CHIPS][2];
+    nonce_response_t out[1];
+    int n = 0;
+
+    switch (preamble) {
+    case CMD_PREAMBLE_WRITE_BCAST:
+        for (int i = 0; i < CHIPS_PER_CHAIN_S19PRO; i++) m->pll[chain][i] = words[1];
+        break;
+    case CMD_PREAMBLE_WRITE_REG:
+        if (unicast_ok) m->pll[chain][chip] = words[1];
+        break;
+    case CMD_PREAMBLE_READ_BCAST:
+    case CMD_PREAMBLE_READ_REG:
+        if (preamble == CMD_PREAMBLE_READ_BCAST) m->reads[chain]++;
+        for (int i = 0; i < CHIPS_PER_CHAIN_S19PRO; i++) {
+            if (preamble == CMD_PREAMBLE_READ_REG && (!unicast_ok || i != chip)) continue;
+            if (!ramp_model_alive(m, chain, i)) continue;
+            if (preamble == CMD_PREAMBLE_READ_BCAST &&
+                m->lose_read[chain][i] == m->reads[chain]) {
+                continue;
+            }
+            replies[n][0] = demux_reply_header(chain, (uint8_t)(i * m->interval), reg);
+            replies[n][1] = m->pll[chain][i];
+            n++;
+        }
+        bm1398_demux_fifo_entries(ctx, replies, n, out);
+        break;
+    }
+}
+
+// Where the ramp should leave a chip: the last step at or below its limit
+static uint32_t ramp_bench_expected(uint32_t target, uint32_t limit) {
+    uint32_t f = BM1398_RAMP_BASE_MHZ;
+    while (f != target) {
+        uint32_t next = target - f > BM1398_RAMP_STEP_MHZ ? f + BM1398_RAMP_STEP_MHZ : target;
+        if (next > limit) break;
+        f = next;
+    }
+    return f;
+}
+
+static int bench_ramp(int argc, char **argv) {
+    uint64_t seed = 0xF7E9;
+    int errors = 0;
+
+    (void)argc;
+    (void)argv;
+
+    sim_fpga_t sim;
+    if (sim_fpga_start(&sim, MAX_CHAINS) < 0) {
+        fprintf(stderr, "Error: Failed to set up simulated FPGA\n");
+        return 1;
+    }
+    bm1398_context_t *ctx = &sim.ctx;
+    int num_chips = ctx->chips_per_chain[0];
+
+    static ramp_model_t model;
+    static bm1398_ramp_t ramps[MAX_CHAINS];
+    uint32_t chain_mask = (1U << MAX_CHAINS) - 1;
+    uint32_t board_mhz = RAMP_BENCH_TARGET_MAX;
+    int weak = 0;
+
+    model.interval = 256 / num_chips;
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        bm1398_ramp_init(&ramps[c], 0);
+        for (int i = 0; i < num_chips; i++) {
+            uint32_t steps = (RAMP_BENCH_TARGET_MAX - RAMP_BENCH_TARGET_MIN) / 5 + 1;
+            ramps[c].target_mhz[i] = RAMP_BENCH_TARGET_MIN + (uint32_t)(rng_next(&seed) % steps) * 5;
+            model.limit_mhz[c][i] = BM1398_PLL_TABLE_MAX_MHZ;
+        }
+        for (int w = 0; w < RAMP_BENCH_WEAK; w++) {
+            int i = (int)(rng_next(&seed) % num_chips);
+            if (model.limit_mhz[c][i] < BM1398_PLL_TABLE_MAX_MHZ) continue;
+            model.limit_mhz[c][i] = ramps[c].target_mhz[i] - RAMP_BENCH_WEAK_MHZ;
+            weak++;
+        }
+    }
+    model.limit_mhz[MAX_CHAINS - 1][RAMP_BENCH_ABSENT_CHIP] = 0;
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        model.lose_read[c][c * 7 + 1] = RAMP_BENCH_FLAKY_BASE;
+        model.lose_read[c][c * 7 + 2] = RAMP_BENCH_FLAKY_STEP;
+    }
+
+    // One clock for the whole board: the slowest chip's limit or target
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        for (int i = 0; i < num_chips; i++) {
+            uint32_t top = model.limit_mhz[c][i] < ramps[c].target_mhz[i] ?
+                           model.limit_mhz[c][i] : ramps[c].target_mhz[i];
+            if (model.limit_mhz[c][i] > 0 && top < board_mhz) board_mhz = top - top % 5;
+        }
+    }
+
+    sim.model = &model;
+    sim.on_cmd = ramp_model_cmd;
+
+    // Chain after chain, then all at once
+    static bm1398_ramp_t saved[MAX_CHAINS];
+    memcpy(saved, ramps, sizeof(ramps));
+    double ms[2];
+    uint64_t commands[2];
+    for (int parallel = 0; parallel < 2; parallel++) {
+        memcpy(ramps, saved, sizeof(ramps));
+        memset(model.reads, 0, sizeof(model.reads));
+        uint64_t c0 = sim.commands;
+        int quiet = quiet_begin();
+        uint64_t t0 = now_ns();
+        if (parallel) {
+            if (bm1398_ramp_chains_parallel(ctx, chain_mask, ramps) < 0) errors++;
+        } else {
+            for (int c = 0; c < MAX_CHAINS; c++) {
+                if (bm1398_ramp_chain(ctx, c, &ramps[c]) < 0) errors++;
+            }
+        }
+        ms[parallel] = (now_ns() - t0) / 1e6;
+        quiet_end(quiet);
+        commands[parallel] = sim.commands - c0;
+    }
+
+    // Every chip where the model says it should be, holding what was written
+    int counts[BM1398_RAMP_NUM_STATES] = {0};
+    int rollbacks = 0;
+    double sum_mhz = 0;
+    int hashing = 0;
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        rollbacks += ramps[c].rollbacks;
+        for (int i = 0; i < num_chips; i++) {
+            uint32_t limit = model.limit_mhz[c][i];
+            uint32_t want = ramp_bench_expected(ramps[c].target_mhz[i], limit);
+            int want_state = limit == 0 ? BM1398_RAMP_ABSENT :
+                             want == ramps[c].target_mhz[i] ? BM1398_RAMP_DONE : BM1398_RAMP_HELD;
+            counts[ramps[c].state[i]]++;
+            if (ramps[c].state[i] != want_state) {
+                fprintf(stderr, "Error: Chain %d chip %d ended %d, expected %d\n", c, i,
+                        ramps[c].state[i], want_state);
+                errors++;
+            }
+            if (limit == 0) continue;
+            if (ramps[c].freq_mhz[i] != want ||
+                model.pll[c][i] != bm1398_pll_reg_for(ramps[c].freq_mhz[i])) {
+                fprintf(stderr, "Error: Chain %d chip %d at %u MHz (0x%08X), expected %u MHz\n",
+                        c, i, ramps[c].freq_mhz[i], model.pll[c][i], want);
+                errors++;
+            }
+            sum_mhz += ramps[c].freq_mhz[i];
+            hashing++;
+        }
+    }
+    if (rollbacks != weak) errors++;
+
+    sim_fpga_stop(&sim);
+
+    double mean_mhz = hashing ? sum_mhz / hashing : 0;
+
+    printf("====================================\n");
+    printf("Frequency Ramp Benchmark\n");
+    printf("====================================\n");
+    printf("  %d chains x %d chips, %u MHz base, %u MHz steps, targets %d-%d MHz\n",
+           MAX_CHAINS, num_chips, BM1398_RAMP_BASE_MHZ, BM1398_RAMP_STEP_MHZ,
+           RAMP_BENCH_TARGET_MIN, RAMP_BENCH_TARGET_MAX);
+    printf("  %d weak chips, 1 silent chip, %d lost replies (simulated FPGA + chip model)\n\n",
+           weak, 2 * MAX_CHAINS);
+    printf("  Sequential     %8.1f ms   %llu commands\n", ms[0], (unsigned long long)commands[0]);
+    printf("  Parallel       %8.1f ms   %llu commands   %.2fx\n", ms[1],
+           (unsigned long long)commands[1], ms[0] / ms[1]);
+    printf("\n  Chips: %d done, %d held, %d lost, %d absent; %d rollbacks\n",
+           counts[BM1398_RAMP_DONE], counts[BM1398_RAMP_HELD], counts[BM1398_RAMP_LOST],
+           counts[BM1398_RAMP_ABSENT], rollbacks);
+    printf("  Broadcast clock every chip survives: %u MHz\n", board_mhz);
+    printf("  Per-chip clocks: mean %.1f MHz (%+.1f%% hashrate)\n", mean_mhz,
+           board_mhz ? (mean_mhz / board_mhz - 1) * 100 : 0);
+    printf("  Target/hold/rollback/absent/retry checks: %s\n", errors ? "FAILED" : "passed");
+
+    return errors ? 1 : 0;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s <mode> [options]\n", prog);
+    printf("\n");
+    printf("Modes:\n");
+    printf("  crc5 [-n COUNT] [--exhaustive]   CRC5 table engine vs bitwise reference\n");
+    printf("  cmd [-n COUNT]                   Prepared vs ad-hoc register write sends\n");
+    printf("  batch [-n BATCHES] [-g GAP_US]   Back-to-back batch submission (114-chip enumeration)\n");
+    printf("  init [-c CHAINS]                 Sequential vs parallel PT1 chain bring-up\n");
+    printf("  replay [DUMP]                    Check the Stage 1 step table against an FPGA dump\n");
+    printf("  nonce-dev [-s SECONDS]           Kernel nonce stream rate and latency (target only)\n");
+    printf("  ring [-n COUNT] [--drop]         Nonce ring throughput with a synthetic producer\n");
+    printf("  pattern-index [-r ROUNDS]        Hashed vs linear expected-nonce matching (full chain)\n");
+    printf("  pattern-load [DIR]               mmap vs stdio loading of 114 pattern files\n");
+    printf("  regs [-n COUNT]                  Indirect vs named FPGA accessors per work packet\n");
+    printf("  work [-n COUNT]                  Work packet formatting: per-send build vs prepared arena\n");
+    printf("  work-ring [-n N] [-b BATCH] [-g GRANT]\n");
+    printf("                                   Work delivery: MMIO FIFO vs simulated fpga_mem ring (works/sec)\n");
+    printf("  dispatch [-s SECONDS]            Per-chain dispatch threads vs one sender, chain 1 stalled\n");
+    printf("  stratum [-o HOST:PORT] [-s SECONDS] [--no-rolling]\n");
+    printf("                                   Pool client: notify-to-work latency and submit RTT\n");
+    printf("  sha256 [-n COUNT]                Scalar vs 4-lane SHA-256: midstates and nonce checks\n");
+    printf("  merkle [-n COUNT] [-b BRANCHES]  Work build: full rebuild vs cached job template\n");
+    printf("  work-table [-n COUNT]            Nonce-to-work resolution: table slot vs linear scan\n");
+    printf("  demux [-n COUNT] [-f DUMP]       Return FIFO: dump words, register reads while hashing\n");
+    printf("  scan [-m MISSING] [-b BAUD] [-f DUMP]\n");
+    printf("                                   One register from every chip: serial reads vs chain scan\n");
+    printf("  shadow                           Read-modify-write via register shadow vs UART reads\n");
+    printf("  pll [-f MHZ]                     PLL0 5 MHz table vs solver, 525 MHz encoding check\n");
+    printf("  ramp                             Per-chip frequency ramp with rollback, chains in parallel\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s crc5\n", prog);
+    printf("  %s crc5 --exhaustive\n", prog);
+    printf("  %s cmd -n 100000\n", prog);
+    printf("  %s batch -g 500\n", prog);
+    printf("  %s init -c 3\n", prog);
+    printf("  %s replay %s\n", prog, DEFAULT_DUMP);
+    printf("  %s nonce-dev -s 10\n", prog);
+    printf("  %s ring -n 10000000\n", prog);
+    printf("  %s pattern-index\n", prog);
+    printf("  %s pattern-load /mnt/card/BM1398-pattern\n", prog);
+    printf("  %s regs\n", prog);
+    printf("  %s work -n 10000000\n", prog);
+    printf("  %s work-ring -b 128\n", prog);
+    printf("  %s dispatch -s 5\n", prog);
+    printf("  %s stratum -o 127.0.0.1:3333 -s 10   (with stratum_pool running)\n", prog);
+    printf("  %s sha256 -n 4000000\n", prog);
+    printf("  %s merkle -b 13\n", prog);
+    printf("  %s work-table\n", prog);
+    printf("  %s demux -n 10000000\n", prog);
+    printf("  %s scan -m 0 -b 12000000\n", prog);
+    printf("  %s shadow\n", prog);
+    printf("  %s pll -f 537\n", prog);
+    printf("  %s ramp\n", prog);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "crc5") == 0) {
+        return bench_crc5(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "cmd") == 0) {
+        return bench_cmd(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "batch") == 0) {
+        return bench_batch(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "init") == 0) {
+        return bench_init(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "replay") == 0) {
+        return bench_replay(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "nonce-dev") == 0) {
+        return bench_nonce_dev(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "ring") == 0) {
+        return bench_ring(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "pattern-index") == 0) {
+        return bench_pattern_index(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "pattern-load") == 0) {
+        return bench_pattern_load(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "regs") == 0) {
+        return bench_regs(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "work") == 0) {
+        return bench_work(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "work-ring") == 0) {
+        return bench_work_ring(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "dispatch") == 0) {
+        return bench_dispatch(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "stratum") == 0) {
+        return bench_stratum(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "sha256") == 0) {
+        return bench_sha256(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "merkle") == 0) {
+        return bench_merkle(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "work-table") == 0) {
+        return bench_work_table(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "demux") == 0) {
+        return bench_demux(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "scan") == 0) {
+        return bench_scan(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "shadow") == 0) {
+        return bench_shadow(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "pll") == 0) {
+        return bench_pll(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "ramp") == 0) {
+        return bench_ramp(argc - 2, argv + 2);
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,101 @@
+/*
+ * BM1398 PLL0 Solver
+ *
+ * Divider search and PLL0 encoding, without FPGA access: linked into the
+ * driver and into pll_table_gen, the build host tool that writes
+ * bm1398_asic.c's 5 MHz step table from it.
+ */
+
+#include <stdint.h>
+#include "../include/bm1398_asic.h"
+
+// Pack dividers into a PLL0 value, VCO range bit included
+uint32_t bm1398_pll_encode(const bm1398_pll_t *pll) {
+    uint32_t reg = BM1398_PLL_ENABLE |
+                   ((uint32_t)(pll->fbdiv & 0xFFF) << 16) |
+                   ((uint32_t)(pll->refdiv & 0x3F) << 8) |
+                   ((uint32_t)((pll->postdiv1 - 1) & 0x7) << 4) |
+                   ((pll->postdiv2 - 1) & 0x7);
+
+    if (bm1398_pll_vco_mhz(pll) >= BM1398_PLL_VCO_HIGH_MHZ) {
+        reg |= BM1398_PLL_VCO_HIGH;
+    }
+    return reg;
+}
+
+/**
+ * Split a PLL0 value into its dividers
+ *
+ * Returns 0, or -1 if the value is not one the solver could produce
+ * (divider out of range, VCO out of range or range bit wrong)
+ */
+int bm1398_pll_decode(uint32_t reg, bm1398_pll_t *pll) {
+    pll->fbdiv = (reg >> 16) & 0xFFF;
+    pll->refdiv = (reg >> 8) & 0x3F;
+    pll->postdiv1 = ((reg >> 4) & 0x7) + 1;
+    pll->postdiv2 = (reg & 0x7) + 1;
+
+    if (!(reg & BM1398_PLL_ENABLE) || pll->refdiv < 1 || pll->refdiv > BM1398_PLL_REFDIV_MAX ||
+        pll->postdiv2 > pll->postdiv1) {
+        return -1;
+    }
+
+    double vco = bm1398_pll_vco_mhz(pll);
+    if (vco < BM1398_PLL_VCO_MIN_MHZ || vco > BM1398_PLL_VCO_MAX_MHZ ||
+        !(reg & BM1398_PLL_VCO_HIGH) != (vco < BM1398_PLL_VCO_HIGH_MHZ)) {
+        return -1;
+    }
+    return 0;
+}
+
+double bm1398_pll_vco_mhz(const bm1398_pll_t *pll) {
+    return (double)BM1398_PLL_CLKI_MHZ * pll->fbdiv / pll->refdiv;
+}
+
+double bm1398_pll_freq_mhz(const bm1398_pll_t *pll) {
+    return bm1398_pll_vco_mhz(pll) / (pll->postdiv1 * pll->postdiv2 * BM1398_PLL_OUT_DIV);
+}
+
+/**
+ * Find the PLL0 dividers whose hashing clock is closest to freq_mhz
+ *
+ * Every (refdiv, postdiv1, postdiv2) is tried with the nearest fbdiv that
+ * keeps the VCO in range. Ties go to the first found: lowest refdiv, then
+ * lowest post-divider (lowest VCO), which keeps the reference comparison
+ * frequency high. Frequencies outside 8-800 MHz get the nearest end.
+ *
+ * Returns 0 on success, -1 if freq_mhz is 0
+ */
+int bm1398_pll_solve(uint32_t freq_mhz, bm1398_pll_t *pll) {
+    if (freq_mhz == 0 || !pll) {
+        return -1;
+    }
+
+    double best_err = -1;
+
+    for (int refdiv = 1; refdiv <= BM1398_PLL_REFDIV_MAX; refdiv++) {
+        // fbdiv range that keeps the VCO in range for this refdiv
+        int fb_min = (BM1398_PLL_VCO_MIN_MHZ * refdiv + BM1398_PLL_CLKI_MHZ - 1) / BM1398_PLL_CLKI_MHZ;
+        int fb_max = BM1398_PLL_VCO_MAX_MHZ * refdiv / BM1398_PLL_CLKI_MHZ;
+
+        for (int postdiv1 = 1; postdiv1 <= BM1398_PLL_POSTDIV_MAX; postdiv1++) {
+            for (int postdiv2 = 1; postdiv2 <= postdiv1; postdiv2++) {
+                int div = refdiv * postdiv1 * postdiv2 * BM1398_PLL_OUT_DIV;
+                int fbdiv = (int)((double)freq_mhz * div / BM1398_PLL_CLKI_MHZ + 0.5);
+                if (fbdiv < fb_min) fbdiv = fb_min;
+                if (fbdiv > fb_max) fbdiv = fb_max;
+
+                double err = (double)BM1398_PLL_CLKI_MHZ * fbdiv / div - freq_mhz;
+                if (err < 0) err = -err;
+                if (best_err < 0 || err < best_err - 1e-9) {
+                    best_err = err;
+                    pll->refdiv = (uint8_t)refdiv;
+                    pll->fbdiv = (uint16_t)fbdiv;
+                    pll->postdiv1 = (uint8_t)postdiv1;
+                    pll->postdiv2 = (uint8_t)postdiv2;
+                }
+            }
+        }
+    }
+    return 0;
+}
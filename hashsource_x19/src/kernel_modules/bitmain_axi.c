@@ -6,6 +6,16 @@
  *
  * Reimplemented from Bitmain stock driver with extensive debug logging
  * to trace all register access from single_board_test and bmminer
+ *
+ * Nonce stream: read()/poll() on the same device return nonces drained from
+ * the FPGA nonce FIFO (struct axi_nonce_record, include/bitmain_axi_nonce.h).
+ * Draining starts on the first read()/poll() and stops when the last reading
+ * file is closed, so mmap-only users (bmminer, fpga_logger, the test tools)
+ * still see the FIFO exactly as with the stock driver. The FIFO is drained
+ * from the PL nonce interrupt's thread if nonce_irq is given, otherwise from
+ * a work item an hrtimer queues every nonce_poll_us; never with interrupts
+ * off. nonce_sim_rate replaces the FPGA FIFO with a synthetic one so the
+ * read path can be exercised without hashboards.
  */
 
 #include <linux/module.h>
@@ -17,6 +27,17 @@
 #include <linux/io.h>
 #include <linux/ioport.h>
 #include <linux/slab.h>
+#include <linux/interrupt.h>
+#include <linux/hrtimer.h>
+#include <linux/kfifo.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+
+#include "bitmain_axi_nonce.h"
 
 #define DEVICE_NAME "axi_fpga_dev"
 #define CLASS_NAME  "axi_fpga_dev"  /* Must match stock driver */
@@ -24,6 +45,42 @@
 #define FPGA_PHYS_ADDR 0x40000000  /* Physical address of FPGA registers */
 #define FPGA_SIZE      0x1400       /* 5120 bytes */
 
+/* Nonce FIFO registers (byte offsets, see include/bm1398_asic.h) */
+#define REG_RETURN_NONCE            0x010
+#define REG_RETURN_NONCE_VALUE      0x014
+#define REG_NONCE_NUMBER_IN_FIFO    0x018
+#define REG_NONCE_FIFO_INTERRUPT    0x01C
+#define NONCE_COUNT_MASK            0x7FFF
+
+#define NONCE_RING_RECORDS          8192    /* Power of 2 (kfifo) */
+#define NONCE_DRAIN_MAX             4096    /* Records per drain call */
+#define NONCE_DRAIN_BATCH           64      /* Records per nonce_drain_lock hold */
+
+/* Nonce stream parameters */
+static int nonce_irq = -1;
+module_param(nonce_irq, int, 0444);
+MODULE_PARM_DESC(nonce_irq, "Linux IRQ of the PL nonce FIFO interrupt (-1 = hrtimer polling)");
+
+static uint nonce_irq_enable;
+module_param(nonce_irq_enable, uint, 0444);
+MODULE_PARM_DESC(nonce_irq_enable, "Value written to REG_NONCE_FIFO_INTERRUPT while draining (0 = leave as is)");
+
+static uint nonce_poll_us = 200;
+module_param(nonce_poll_us, uint, 0644);
+MODULE_PARM_DESC(nonce_poll_us, "hrtimer drain period in microseconds");
+
+static uint nonce_sim_rate;
+module_param(nonce_sim_rate, uint, 0444);
+MODULE_PARM_DESC(nonce_sim_rate, "Synthetic nonces per second instead of the FPGA FIFO (test harness)");
+
+static ulong nonce_drained;
+module_param(nonce_drained, ulong, 0444);
+MODULE_PARM_DESC(nonce_drained, "Nonces drained from the FIFO");
+
+static ulong nonce_dropped;
+module_param(nonce_dropped, ulong, 0444);
+MODULE_PARM_DESC(nonce_dropped, "Nonces dropped because the ring was full");
+
 /* Global variables (match original driver) */
 static dev_t axi_fpga_dev_num;
 static struct cdev *p_axi_fpga_dev;
@@ -34,6 +91,175 @@ static void *base_vir_mem_addr;          /* Memory region structure */
 /* Debug: Track mmap operations (simple counter, no atomics needed) */
 static int mmap_count = 0;
 
+/* Nonce stream state */
+static DEFINE_KFIFO(nonce_ring, struct axi_nonce_record, NONCE_RING_RECORDS);
+static DECLARE_WAIT_QUEUE_HEAD(nonce_wq);
+static DEFINE_MUTEX(nonce_arm_lock);     /* nonce_readers, start/stop */
+static DEFINE_MUTEX(nonce_read_lock);    /* Single kfifo consumer */
+static DEFINE_MUTEX(nonce_drain_lock);   /* Single kfifo producer */
+static int nonce_readers;
+static bool nonce_irq_active;
+static struct hrtimer nonce_timer;
+static u64 nonce_sim_start_ns;
+static u64 nonce_sim_emitted;
+
+#define NONCE_FILE_ARMED    ((void *)1)
+
+/* Up to NONCE_DRAIN_BATCH records under nonce_drain_lock; returns how many */
+static u32 axi_nonce_drain_batch(void)
+{
+    struct axi_nonce_record rec;
+    u64 now;
+    u32 count, i;
+
+    mutex_lock(&nonce_drain_lock);
+    now = ktime_get_ns();
+
+    if (nonce_sim_rate) {
+        u64 due = div_u64((now - nonce_sim_start_ns) * nonce_sim_rate, NSEC_PER_SEC);
+        count = min_t(u64, due - nonce_sim_emitted, NONCE_DRAIN_BATCH);
+    } else {
+        count = readl(base_vir_addr + REG_NONCE_NUMBER_IN_FIFO) & NONCE_COUNT_MASK;
+        count = min_t(u32, count, NONCE_DRAIN_BATCH);
+    }
+
+    for (i = 0; i < count; i++) {
+        if (nonce_sim_rate) {
+            u64 n = nonce_sim_emitted++;
+            rec.header = 0x80000000 | ((u32)(n & 0x7FFF) << 16) | (u32)(n % 3);
+            rec.value = ((u32)(n % 80) << 24) | ((u32)((n / 3) % 114) << 16) |
+                        ((u32)(n * 2654435761u) & 0xFFFF);
+        } else {
+            /* Header (nonce flag, work_id, chain), then nonce or register value */
+            rec.header = readl(base_vir_addr + REG_RETURN_NONCE);
+            rec.value = readl(base_vir_addr + REG_RETURN_NONCE_VALUE);
+        }
+        rec.ts_ns = now;
+
+        if (!kfifo_put(&nonce_ring, rec))
+            nonce_dropped++;
+    }
+
+    nonce_drained += count;
+    mutex_unlock(&nonce_drain_lock);
+
+    return count;
+}
+
+/*
+ * Drain the nonce FIFO into the ring. The IRQ thread, the drain work and
+ * axi_nonce_start() can all get here, all in process context, so
+ * nonce_drain_lock keeps one kfifo producer at a time and the header and
+ * value reads of an entry together. The lock is dropped every
+ * NONCE_DRAIN_BATCH records so a full FIFO (two readl per record) never
+ * holds it for long. Entries are popped from the FPGA even when the ring is
+ * full so the hardware FIFO never backs up; those are counted in
+ * nonce_dropped.
+ */
+static void axi_nonce_drain(void)
+{
+    u32 total = 0, count;
+
+    do {
+        count = axi_nonce_drain_batch();
+        total += count;
+        if (count)
+            wake_up_interruptible(&nonce_wq);
+        cond_resched();
+    } while (count == NONCE_DRAIN_BATCH && total < NONCE_DRAIN_MAX);
+}
+
+static void axi_nonce_drain_work_fn(struct work_struct *work)
+{
+    axi_nonce_drain();
+}
+
+static DECLARE_WORK(nonce_drain_work, axi_nonce_drain_work_fn);
+
+static irqreturn_t axi_nonce_irq_thread(int irq, void *dev_id)
+{
+    axi_nonce_drain();
+    return IRQ_HANDLED;
+}
+
+/* Hardirq context: only kicks the drain work */
+static enum hrtimer_restart axi_nonce_timer_fn(struct hrtimer *timer)
+{
+    queue_work(system_highpri_wq, &nonce_drain_work);
+    hrtimer_forward_now(timer, ns_to_ktime((u64)max(nonce_poll_us, 20u) * NSEC_PER_USEC));
+    return HRTIMER_RESTART;
+}
+
+/* Called with nonce_arm_lock held when the first reader arrives */
+static int axi_nonce_start(void)
+{
+    int ret;
+
+    kfifo_reset(&nonce_ring);
+    nonce_sim_start_ns = ktime_get_ns();
+    nonce_sim_emitted = 0;
+
+    if (nonce_irq >= 0 && !nonce_sim_rate) {
+        ret = request_threaded_irq(nonce_irq, NULL, axi_nonce_irq_thread,
+                                   IRQF_ONESHOT, "axi_fpga_nonce", NULL);
+        if (ret == 0) {
+            if (nonce_irq_enable)
+                writel(nonce_irq_enable, base_vir_addr + REG_NONCE_FIFO_INTERRUPT);
+            nonce_irq_active = true;
+            pr_info("[AXI_FPGA] Nonce stream started (IRQ %d)\n", nonce_irq);
+            /* Entries queued before the IRQ was armed */
+            axi_nonce_drain();
+            return 0;
+        }
+        pr_warn("[AXI_FPGA] request_irq(%d) failed: %d, using hrtimer\n", nonce_irq, ret);
+    }
+
+    hrtimer_start(&nonce_timer, ns_to_ktime((u64)max(nonce_poll_us, 20u) * NSEC_PER_USEC),
+                  HRTIMER_MODE_REL);
+    pr_info("[AXI_FPGA] Nonce stream started (hrtimer %u us%s)\n", nonce_poll_us,
+            nonce_sim_rate ? ", simulated FIFO" : "");
+    return 0;
+}
+
+/* Called with nonce_arm_lock held when the last reader leaves */
+static void axi_nonce_stop(void)
+{
+    if (nonce_irq_active) {
+        /* Nobody drains once the handler is gone; mmap users poll again */
+        if (nonce_irq_enable)
+            writel(0, base_vir_addr + REG_NONCE_FIFO_INTERRUPT);
+        free_irq(nonce_irq, NULL);
+        nonce_irq_active = false;
+    } else {
+        hrtimer_cancel(&nonce_timer);
+        cancel_work_sync(&nonce_drain_work);
+    }
+    pr_info("[AXI_FPGA] Nonce stream stopped (drained %lu, dropped %lu)\n",
+            nonce_drained, nonce_dropped);
+}
+
+/* Mark this file as a nonce reader; starts draining for the first one */
+static int axi_nonce_arm(struct file *filp)
+{
+    int ret = 0;
+
+    if (filp->private_data == NONCE_FILE_ARMED)
+        return 0;
+
+    mutex_lock(&nonce_arm_lock);
+    if (filp->private_data != NONCE_FILE_ARMED) {
+        if (nonce_readers == 0)
+            ret = axi_nonce_start();
+        if (ret == 0) {
+            nonce_readers++;
+            filp->private_data = NONCE_FILE_ARMED;
+        }
+    }
+    mutex_unlock(&nonce_arm_lock);
+
+    return ret;
+}
+
 /* File operations */
 static int axi_fpga_dev_open(struct inode *inode, struct file *filp)
 {
@@ -42,9 +268,62 @@ static int axi_fpga_dev_open(struct inode *inode, struct file *filp)
 
 static int axi_fpga_dev_release(struct inode *inode, struct file *filp)
 {
+    if (filp->private_data == NONCE_FILE_ARMED) {
+        mutex_lock(&nonce_arm_lock);
+        if (--nonce_readers == 0)
+            axi_nonce_stop();
+        mutex_unlock(&nonce_arm_lock);
+    }
     return 0;  /* Match stock driver - no logging */
 }
 
+/*
+ * read(): whole struct axi_nonce_record entries only. Blocks until at least
+ * one nonce is available unless O_NONBLOCK is set.
+ */
+static ssize_t axi_fpga_dev_read(struct file *filp, char __user *buf,
+                                 size_t len, loff_t *ppos)
+{
+    unsigned int copied;
+    int ret;
+
+    if (len < sizeof(struct axi_nonce_record))
+        return -EINVAL;
+
+    ret = axi_nonce_arm(filp);
+    if (ret)
+        return ret;
+
+    for (;;) {
+        if (mutex_lock_interruptible(&nonce_read_lock))
+            return -ERESTARTSYS;
+
+        ret = kfifo_to_user(&nonce_ring, buf,
+                            len - len % sizeof(struct axi_nonce_record), &copied);
+        mutex_unlock(&nonce_read_lock);
+
+        if (ret)
+            return ret;
+        if (copied)
+            return copied;
+
+        if (filp->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+        if (wait_event_interruptible(nonce_wq, !kfifo_is_empty(&nonce_ring)))
+            return -ERESTARTSYS;
+    }
+}
+
+static unsigned int axi_fpga_dev_poll(struct file *filp, poll_table *wait)
+{
+    if (axi_nonce_arm(filp))
+        return POLLERR;
+
+    poll_wait(filp, &nonce_wq, wait);
+
+    return kfifo_is_empty(&nonce_ring) ? 0 : (POLLIN | POLLRDNORM);
+}
+
 static int axi_fpga_dev_mmap(struct file *filp, struct vm_area_struct *vma)
 {
     unsigned long size = vma->vm_end - vma->vm_start;
@@ -67,6 +346,8 @@ static const struct file_operations axi_fpga_dev_fops = {
     .owner   = THIS_MODULE,
     .open    = axi_fpga_dev_open,
     .release = axi_fpga_dev_release,
+    .read    = axi_fpga_dev_read,
+    .poll    = axi_fpga_dev_poll,
     .mmap    = axi_fpga_dev_mmap,
 };
 
@@ -78,6 +359,9 @@ static int __init axi_fpga_dev_init(void)
 
     printk(KERN_INFO "In axi fpga driver!\n");  /* Match stock driver */
 
+    hrtimer_init(&nonce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    nonce_timer.function = axi_nonce_timer_fn;
+
     /* Allocate character device number */
     ret = alloc_chrdev_region(&axi_fpga_dev_num, 0, 1, DEVICE_NAME);
     if (ret < 0) {
@@ -159,6 +443,9 @@ static int __init axi_fpga_dev_init(void)
     pr_info("[AXI_FPGA] ======================================\n");
     pr_info("[AXI_FPGA] Driver initialized successfully!\n");
     pr_info("[AXI_FPGA] Ready to serve mmap() requests\n");
+    pr_info("[AXI_FPGA] Nonce stream: %s%s\n",
+            nonce_irq >= 0 ? "IRQ" : "hrtimer",
+            nonce_sim_rate ? " (simulated FIFO)" : "");
     pr_info("[AXI_FPGA] ======================================\n");
 
     return 0;
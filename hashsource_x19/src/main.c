@@ -1,3 +1,439 @@
-int main() {
+/*
+ * HashSource X19 Miner
+ *
+ * Brings up the selected hash chains and runs one work submission thread
+ * per chain (work_dispatch), fed by a background prefetch thread
+ * (work_prefetch) that keeps -w ready works per chain. With -o, work is
+ * built from the pool's current Stratum job: each work carries four
+ * midstates for four rolled block versions (BIP310, unless -R or the pool
+ * refuses), and the next work rolls further version bits before moving to
+ * a new extranonce2. Without a pool, chains are fed with locally generated
+ * work so the submission path can be run and measured on hardware.
+ *
+ * With -f (and optionally -F for per-chip targets) every chip is walked
+ * from a safe base clock to its own frequency before work starts; chips
+ * that stop answering on the way are held at their last good step.
+ *
+ * Returned nonces come in through the nonce ring. Pool work is resolved
+ * through the work table (work_id -> job, extranonce2, version), checked
+ * with SHA-256d, and submitted when it meets the pool difficulty.
+ *
+ * Usage: hashsource_miner [-c CHAIN_MASK] [-t SECONDS] [-s STATS_SEC] [-g GRANT] [-w WORKS]
+ *                         [-f MHZ [-F FILE]] [-o URL -u USER [-p PASS] [-R]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/bm1398_asic.h"
+#include "../include/work_dispatch.h"
+#include "../include/stratum.h"
+#include "../include/work_prefetch.h"
+#include "../include/work_table.h"
+#include "../include/nonce_ring.h"
+
+#define PRE_OPEN_CORE_VOLTAGE_MV    15000
+#define WORKING_VOLTAGE_MV          13600
+#define VOLTAGE_STEP_MV             200
+
+#define NONCE_BATCH                 64
+#define NONCE_IDLE_US               1000
+#define DIFF1_ZERO_BITS             32      // Any nonce a chip returns
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+//==============================================================================
+// Shares
+//==============================================================================
+
+typedef struct {
+    uint64_t nonces;
+    uint64_t submitted;
+    uint64_t below_target;      // Valid, but under the pool difficulty
+    uint64_t hw_errors;         // Hash fails difficulty 1, or slot not in the work
+    uint64_t stale;
+    uint64_t unknown;           // No work recorded for the work_id
+} share_stats_t;
+
+// Leading zero bits a hash needs at a pool difficulty (rounded down, so
+// the pool may still reject a share just above a power of two)
+static int difficulty_zero_bits(double difficulty) {
+    int bits = DIFF1_ZERO_BITS;
+    while (difficulty >= 2.0) {
+        difficulty /= 2.0;
+        bits++;
+    }
+    return bits;
+}
+
+static void handle_nonce(const nonce_response_t *nonce, work_table_t *table,
+                         stratum_client_t *pool, share_stats_t *stats) {
+    work_info_t info;
+
+    stats->nonces++;
+    switch (work_table_lookup(table, nonce, &info)) {
+    case WORK_TABLE_HIT:
+        break;
+    case WORK_TABLE_STALE:
+        stats->stale++;
+        return;
+    default:
+        stats->unknown++;
+        return;
+    }
+    if (nonce->midstate >= info.midstates) {
+        stats->hw_errors++;
+        return;
+    }
+
+    // Header as hashed by the midstate slot that found the nonce
+    uint32_t version = info.versions[nonce->midstate];
+    uint8_t hash[1][32];
+    for (int i = 0; i < 4; i++) {
+        info.header[i] = (uint8_t)(version >> (i * 8));
+    }
+    sha256d_nonces(info.header, &nonce->nonce, 1, hash);
+
+    int zero_bits = sha256_hash_zero_bits(hash[0]);
+    if (zero_bits < DIFF1_ZERO_BITS) {
+        stats->hw_errors++;
+        return;
+    }
+    if (zero_bits < difficulty_zero_bits(info.difficulty)) {
+        stats->below_target++;
+        return;
+    }
+
+    uint32_t ntime = info.header[68] | (info.header[69] << 8) |
+                     (info.header[70] << 16) | ((uint32_t)info.header[71] << 24);
+    if (stratum_submit(pool, info.job_id, info.extranonce2, info.extranonce2_len,
+                       ntime, nonce->nonce, version) == 0) {
+        stats->submitted++;
+    }
+}
+
+static void print_share_stats(const share_stats_t *s) {
+    printf("Nonces: %llu, %llu shares submitted, %llu below target, %llu HW errors, "
+           "%llu stale, %llu unknown work\n",
+           (unsigned long long)s->nonces, (unsigned long long)s->submitted,
+           (unsigned long long)s->below_target, (unsigned long long)s->hw_errors,
+           (unsigned long long)s->stale, (unsigned long long)s->unknown);
+}
+
+//==============================================================================
+// Chain bring-up
+//==============================================================================
+
+/*
+ * Per-chip frequency targets, one "CHAIN CHIP MHZ" per line (CHIP is the
+ * enumeration index, 0-113). Lines starting with # are skipped. Chips not
+ * listed keep the -f frequency.
+ */
+static int load_chip_targets(const char *path, bm1398_ramp_t ramps[MAX_CHAINS]) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[128];
+    int lineno = 0, loaded = 0;
+    while (fgets(line, sizeof(line), f)) {
+        int chain, chip;
+        unsigned mhz;
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') continue;
+        if (sscanf(line, "%d %d %u", &chain, &chip, &mhz) != 3 || chain < 0 ||
+            chain >= MAX_CHAINS || chip < 0 || chip >= BM1398_SCAN_MAX_CHIPS || mhz == 0) {
+            fprintf(stderr, "%s:%d: expected CHAIN CHIP MHZ\n", path, lineno);
+            fclose(f);
+            return -1;
+        }
+        ramps[chain].target_mhz[chip] = mhz;
+        loaded++;
+    }
+    fclose(f);
+    printf("Loaded %d per-chip frequency targets from %s\n", loaded, path);
+    return 0;
+}
+
+static int bring_up_chains(bm1398_context_t *ctx, uint32_t chain_mask, bm1398_ramp_t *ramps) {
+    printf("Powering on PSU (%.2fV)\n", PRE_OPEN_CORE_VOLTAGE_MV / 1000.0);
+    if (bm1398_psu_power_on(ctx, PRE_OPEN_CORE_VOLTAGE_MV) < 0) {
+        fprintf(stderr, "Error: Failed to power on PSU\n");
+        return -1;
+    }
+
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        if (!(chain_mask & (1U << chain))) continue;
+        if (bm1398_enable_dc_dc(ctx, chain) < 0) {
+            printf("Warning: DC-DC enable failed on chain %d\n", chain);
+        }
+    }
+
+    // FPGA reset after PIC enable (as in the PT1/PT2 sequence)
+    ctx->fpga_regs[0x034 / 4] = 0x0000FFF8;
+    __sync_synchronize();
+    usleep(100000);
+
+    bm1398_init_timing_t timing[MAX_CHAINS];
+    if (bm1398_init_chains_parallel(ctx, chain_mask, timing) < 0) {
+        fprintf(stderr, "Error: Chain initialization failed\n");
+        return -1;
+    }
+
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        if (!(chain_mask & (1U << chain))) continue;
+        int bad = bm1398_verify_chain_registers(ctx, chain);
+        if (bad < 0) {
+            printf("Warning: Register check failed on chain %d\n", chain);
+        } else if (bad > 0) {
+            printf("Warning: Chain %d register check found %d bad chips\n", chain, bad);
+        }
+    }
+
+    for (uint32_t v = PRE_OPEN_CORE_VOLTAGE_MV; v >= WORKING_VOLTAGE_MV; v -= VOLTAGE_STEP_MV) {
+        if (bm1398_psu_set_voltage(ctx, v) < 0) {
+            fprintf(stderr, "Warning: Failed to set voltage to %umV\n", v);
+            break;
+        }
+        usleep(100000);
+    }
+    sleep(2);
+
+    // Chips held back on the way still hash, just slower
+    if (ramps && bm1398_ramp_chains_parallel(ctx, chain_mask, ramps) < 0) {
+        fprintf(stderr, "Warning: Frequency ramp failed, chips may be on mixed clocks\n");
+    }
+
+    if (bm1398_enable_work_send(ctx) < 0) {
+        fprintf(stderr, "Error: Failed to enable work send\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [-c CHAIN_MASK] [-t SECONDS] [-s STATS_SEC] [-g GRANT] [-w WORKS]\n", prog);
+    printf("       %*s [-f MHZ [-F FILE]] [-o URL -u USER [-p PASS] [-R]]\n", (int)strlen(prog), "");
+    printf("  -c CHAIN_MASK   Chains to run (default 0x7)\n");
+    printf("  -t SECONDS      Run time, 0 = until interrupted (default 0)\n");
+    printf("  -s STATS_SEC    Statistics interval (default 10)\n");
+    printf("  -g GRANT        Work FIFO credits per ready sample (default 1)\n");
+    printf("  -w WORKS        Ready works prefetched per chain (default %d)\n", WORK_PREFETCH_PER_CHAIN);
+    printf("  -f MHZ          Ramp every chip from %d MHz to MHZ (default: stay at %d)\n",
+           BM1398_RAMP_BASE_MHZ, FREQUENCY_525MHZ);
+    printf("  -F FILE         Per-chip targets for the ramp, \"CHAIN CHIP MHZ\" per line\n");
+    printf("  -o URL          Stratum pool, stratum+tcp://host:port (default: local work)\n");
+    printf("  -u USER         Pool worker name\n");
+    printf("  -p PASS         Pool password (default x)\n");
+    printf("  -R              No version rolling (one midstate per work)\n");
+}
+
+int main(int argc, char **argv) {
+    uint32_t chain_mask = (1U << MAX_CHAINS) - 1;
+    int run_secs = 0;
+    int stats_secs = 10;
+    int grant = 1;
+    int prefetch = WORK_PREFETCH_PER_CHAIN;
+    const char *pool_url = NULL;
+    const char *pool_user = NULL;
+    const char *pool_pass = "x";
+    bool version_rolling = true;
+    uint32_t freq_mhz = 0;
+    const char *targets_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:t:s:g:w:f:F:o:u:p:Rh")) != -1) {
+        switch (opt) {
+        case 'c': chain_mask = strtoul(optarg, NULL, 0); break;
+        case 't': run_secs = atoi(optarg); break;
+        case 's': stats_secs = atoi(optarg); break;
+        case 'g': grant = atoi(optarg); break;
+        case 'w': prefetch = atoi(optarg); break;
+        case 'f': freq_mhz = strtoul(optarg, NULL, 0); break;
+        case 'F': targets_path = optarg; break;
+        case 'o': pool_url = optarg; break;
+        case 'u': pool_user = optarg; break;
+        case 'p': pool_pass = optarg; break;
+        case 'R': version_rolling = false; break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    chain_mask &= (1U << MAX_CHAINS) - 1;
+    if (chain_mask == 0 || stats_secs <= 0 || grant <= 0 || prefetch <= 0 ||
+        (pool_url && !pool_user) || (targets_path && freq_mhz == 0)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    printf("====================================\n");
+    printf("HashSource X19 Miner\n");
+    printf("====================================\n");
+    printf("Chains: 0x%X\n", chain_mask);
+    if (freq_mhz > 0) {
+        printf("Clock:  %u MHz%s%s\n", freq_mhz, targets_path ? ", per-chip targets from " : "",
+               targets_path ? targets_path : "");
+    }
+    printf("Pool:   %s\n\n", pool_url ? pool_url : "none (local work)");
+
+    static bm1398_ramp_t ramps[MAX_CHAINS];
+    if (freq_mhz > 0) {
+        for (int chain = 0; chain < MAX_CHAINS; chain++) {
+            bm1398_ramp_init(&ramps[chain], freq_mhz);
+        }
+        if (targets_path && load_chip_targets(targets_path, ramps) < 0) {
+            return 1;
+        }
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    // Connect while the chains come up; the client thread reconnects on its own
+    static stratum_client_t pool;
+    if (pool_url) {
+        if (stratum_init(&pool, pool_url, pool_user, pool_pass) < 0) {
+            return 1;
+        }
+        if (version_rolling) {
+            stratum_set_version_rolling(&pool, STRATUM_VERSION_MASK);
+        }
+        if (stratum_start(&pool) < 0) {
+            return 1;
+        }
+    }
+
+    bm1398_context_t ctx;
+    if (bm1398_init(&ctx) < 0) {
+        fprintf(stderr, "Error: Failed to initialize driver\n");
+        if (pool_url) stratum_stop(&pool);
+        return 1;
+    }
+
+    static work_table_t table;
+    work_table_init(&table);
+
+    static work_prefetch_t prefetcher;
+    if (work_prefetch_init(&prefetcher, &ctx, pool_url ? &pool : NULL, &table,
+                           chain_mask, prefetch) < 0) {
+        fprintf(stderr, "Error: Failed to allocate work items\n");
+        bm1398_cleanup(&ctx);
+        if (pool_url) stratum_stop(&pool);
+        return 1;
+    }
+
+    if (bring_up_chains(&ctx, chain_mask, freq_mhz > 0 ? ramps : NULL) < 0) {
+        work_prefetch_destroy(&prefetcher);
+        bm1398_cleanup(&ctx);
+        if (pool_url) stratum_stop(&pool);
+        return 1;
+    }
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        bm1398_set_work_credit_grant(&ctx, chain, grant);
+    }
+
+    work_dispatch_t dispatch;
+    if (work_dispatch_init(&dispatch, &ctx, chain_mask, work_prefetch_done, &prefetcher) < 0 ||
+        work_dispatch_start(&dispatch) < 0 ||
+        work_prefetch_start(&prefetcher, &dispatch) < 0) {
+        fprintf(stderr, "Error: Failed to start work dispatch\n");
+        work_dispatch_destroy(&dispatch);
+        work_prefetch_destroy(&prefetcher);
+        bm1398_cleanup(&ctx);
+        if (pool_url) stratum_stop(&pool);
+        return 1;
+    }
+
+    // Nonce reader thread; this loop is the one consumer of each chain's lane
+    static nonce_ring_t ring;
+    int consumer[MAX_CHAINS];
+    if (nonce_ring_init(&ring, 0) < 0) {
+        work_prefetch_stop(&prefetcher);
+        work_dispatch_destroy(&dispatch);
+        work_prefetch_destroy(&prefetcher);
+        bm1398_cleanup(&ctx);
+        if (pool_url) stratum_stop(&pool);
+        return 1;
+    }
+    for (int chain = 0; chain < MAX_CHAINS; chain++) {
+        consumer[chain] = (chain_mask & (1U << chain)) ? nonce_ring_add_consumer(&ring, chain) : -1;
+    }
+    if (nonce_ring_start(&ring, &ctx, -1) < 0) {
+        nonce_ring_destroy(&ring);
+        work_prefetch_stop(&prefetcher);
+        work_dispatch_destroy(&dispatch);
+        work_prefetch_destroy(&prefetcher);
+        bm1398_cleanup(&ctx);
+        if (pool_url) stratum_stop(&pool);
+        return 1;
+    }
+
+    printf("\nMining (%s)...\n", pool_url ? "pool work" : "local work");
+    time_t start = time(NULL);
+    time_t next_stats = start + stats_secs;
+    share_stats_t shares = {0};
+    nonce_response_t nonces[NONCE_BATCH];
+
+    while (running && (run_secs == 0 || time(NULL) - start < run_secs)) {
+        int got = 0;
+        for (int chain = 0; chain < MAX_CHAINS; chain++) {
+            if (consumer[chain] < 0) continue;
+            int n = nonce_ring_consume(&ring, chain, consumer[chain], nonces, NONCE_BATCH);
+            for (int i = 0; i < n; i++) {
+                if (pool_url) {
+                    handle_nonce(&nonces[i], &table, &pool, &shares);
+                } else {
+                    shares.nonces++;
+                }
+            }
+            got += n;
+        }
+
+        if (time(NULL) >= next_stats) {
+            work_dispatch_print_stats(&dispatch);
+            work_prefetch_print_stats(&prefetcher);
+            print_share_stats(&shares);
+            if (pool_url) stratum_print_stats(&pool);
+            next_stats += stats_secs;
+        }
+        if (got == 0) {
+            usleep(NONCE_IDLE_US);
+        }
+    }
+
+    printf("\nStopping...\n");
+    work_prefetch_stop(&prefetcher);
+    work_dispatch_stop(&dispatch);
+    nonce_ring_stop(&ring);
+    work_dispatch_print_stats(&dispatch);
+    work_prefetch_print_stats(&prefetcher);
+    print_share_stats(&shares);
+    if (pool_url) work_table_print_stats(&table);
+    nonce_ring_print_stats(&ring);
+    bm1398_print_fifo_demux_stats(&ctx);
+    nonce_ring_destroy(&ring);
+    bm1398_print_work_flow_stats(&ctx);
+    work_dispatch_destroy(&dispatch);
+
+    if (pool_url) {
+        stratum_stop(&pool);
+        stratum_print_stats(&pool);
+    }
+    bm1398_cleanup(&ctx);
+    work_prefetch_destroy(&prefetcher);
     return 0;
 }
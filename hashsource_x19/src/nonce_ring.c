@@ -0,0 +1,335 @@
+/*
+ * Nonce Ring - FPGA nonce FIFO fan-out for BM1398 chains
+ *
+ * Lane protocol (per chain):
+ *   producer: write slots[head & mask], then store-release head
+ *   consumer: load-acquire head, copy slots[tail & mask], store-release tail
+ * A slot is free once every consumer's tail has passed it. The producer keeps
+ * a cached minimum of the tails and only rescans them when the cache says the
+ * lane is full, so the common path touches no consumer cache line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include "../include/nonce_ring.h"
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//==============================================================================
+// Setup
+//==============================================================================
+
+int nonce_ring_init(nonce_ring_t *ring, uint32_t slots_per_lane) {
+    if (!ring) {
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->stream_fd = -1;
+
+    uint32_t slots = 1;
+    while (slots < (slots_per_lane ? slots_per_lane : NONCE_RING_DEFAULT_SLOTS)) {
+        slots <<= 1;
+    }
+    ring->slots_per_lane = slots;
+
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        nonce_lane_t *lane = &ring->lanes[c];
+        lane->slots = calloc(slots, sizeof(nonce_response_t));
+        if (!lane->slots) {
+            fprintf(stderr, "Error: Cannot allocate nonce ring (%u slots)\n", slots);
+            nonce_ring_destroy(ring);
+            return -1;
+        }
+        lane->mask = slots - 1;
+        atomic_init(&lane->head.pos, 0);
+        for (int i = 0; i < NONCE_RING_MAX_CONSUMERS; i++) {
+            atomic_init(&lane->tail[i].pos, 0);
+        }
+    }
+
+    return 0;
+}
+
+void nonce_ring_destroy(nonce_ring_t *ring) {
+    if (!ring) {
+        return;
+    }
+
+    nonce_ring_stop(ring);
+
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        free(ring->lanes[c].slots);
+        ring->lanes[c].slots = NULL;
+    }
+}
+
+/**
+ * Register a consumer on a chain lane. Must be called before anything is
+ * published to that lane; the new cursor starts at the beginning.
+ */
+int nonce_ring_add_consumer(nonce_ring_t *ring, int chain) {
+    if (!ring || chain < 0 || chain >= MAX_CHAINS) {
+        return -1;
+    }
+
+    nonce_lane_t *lane = &ring->lanes[chain];
+    if (lane->num_consumers >= NONCE_RING_MAX_CONSUMERS) {
+        fprintf(stderr, "Error: Chain %d already has %d nonce consumers\n",
+                chain, NONCE_RING_MAX_CONSUMERS);
+        return -1;
+    }
+
+    return lane->num_consumers++;
+}
+
+//==============================================================================
+// Producer
+//==============================================================================
+
+static uint64_t lane_min_tail(nonce_lane_t *lane) {
+    uint64_t min = atomic_load_explicit(&lane->head.pos, memory_order_relaxed);
+
+    for (int i = 0; i < lane->num_consumers; i++) {
+        uint64_t t = atomic_load_explicit(&lane->tail[i].pos, memory_order_acquire);
+        if (t < min) min = t;
+    }
+
+    return min;
+}
+
+/**
+ * Free slots in a chain lane, as seen by the producer
+ */
+uint32_t nonce_ring_free(nonce_ring_t *ring, int chain) {
+    if (!ring || chain < 0 || chain >= MAX_CHAINS) {
+        return 0;
+    }
+
+    nonce_lane_t *lane = &ring->lanes[chain];
+    uint64_t head = atomic_load_explicit(&lane->head.pos, memory_order_relaxed);
+    lane->min_tail = lane_min_tail(lane);
+
+    return ring->slots_per_lane - (uint32_t)(head - lane->min_tail);
+}
+
+/**
+ * Publish nonces to their chain lanes. Single producer only.
+ * Lanes without consumers just count the nonces as published.
+ *
+ * Returns number of nonces stored (the rest were dropped)
+ */
+int nonce_ring_publish(nonce_ring_t *ring, const nonce_response_t *nonces, int count) {
+    uint64_t head[MAX_CHAINS];
+    bool dirty[MAX_CHAINS] = { false };
+    int stored = 0;
+
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        head[c] = atomic_load_explicit(&ring->lanes[c].head.pos, memory_order_relaxed);
+    }
+
+    for (int i = 0; i < count; i++) {
+        int chain = nonces[i].chain_id;
+        if (chain >= MAX_CHAINS) {
+            ring->bad_chain++;
+            continue;
+        }
+
+        nonce_lane_t *lane = &ring->lanes[chain];
+        lane->published++;
+        if (lane->num_consumers == 0) {
+            continue;
+        }
+
+        if (head[chain] - lane->min_tail >= ring->slots_per_lane) {
+            lane->min_tail = lane_min_tail(lane);
+            if (head[chain] - lane->min_tail >= ring->slots_per_lane) {
+                lane->dropped++;
+                continue;
+            }
+        }
+
+        lane->slots[head[chain] & lane->mask] = nonces[i];
+        head[chain]++;
+        dirty[chain] = true;
+        stored++;
+
+        uint32_t used = (uint32_t)(head[chain] - lane->min_tail);
+        if (used > lane->high_water) lane->high_water = used;
+    }
+
+    // One release per lane per batch: consumers see the whole batch at once
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        if (dirty[c]) {
+            atomic_store_explicit(&ring->lanes[c].head.pos, head[c], memory_order_release);
+        }
+    }
+
+    return stored;
+}
+
+//==============================================================================
+// Consumer
+//==============================================================================
+
+int nonce_ring_consume(nonce_ring_t *ring, int chain, int consumer,
+                       nonce_response_t *out, int max_count) {
+    if (!ring || chain < 0 || chain >= MAX_CHAINS || !out || max_count <= 0) {
+        return -1;
+    }
+
+    nonce_lane_t *lane = &ring->lanes[chain];
+    if (consumer < 0 || consumer >= lane->num_consumers) {
+        return -1;
+    }
+
+    uint64_t tail = atomic_load_explicit(&lane->tail[consumer].pos, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&lane->head.pos, memory_order_acquire);
+
+    uint64_t avail = head - tail;
+    int count = avail < (uint64_t)max_count ? (int)avail : max_count;
+    if (count == 0) {
+        return 0;
+    }
+
+    // Copy in at most two runs (wrap-around)
+    uint32_t start = tail & lane->mask;
+    int first = ring->slots_per_lane - start;
+    if (first > count) first = count;
+
+    memcpy(out, &lane->slots[start], first * sizeof(nonce_response_t));
+    if (count > first) {
+        memcpy(out + first, &lane->slots[0], (count - first) * sizeof(nonce_response_t));
+    }
+
+    atomic_store_explicit(&lane->tail[consumer].pos, tail + count, memory_order_release);
+
+    return count;
+}
+
+//==============================================================================
+// Reader Thread
+//==============================================================================
+
+static void *nonce_reader_thread(void *arg) {
+    nonce_ring_t *ring = arg;
+    nonce_response_t batch[NONCE_RING_DRAIN_BATCH];
+
+    while (ring->running) {
+        int n;
+
+        if (ring->stream_fd >= 0) {
+            // Kernel drains the FIFO; wait there instead of sleeping
+            n = bm1398_nonce_stream_read(ring->ctx, ring->stream_fd, batch, NULL,
+                                         NONCE_RING_DRAIN_BATCH, 100);
+            if (n < 0) {
+                fprintf(stderr, "Error: Nonce stream read failed: %s\n", strerror(errno));
+                break;
+            }
+        } else {
+            n = bm1398_read_nonces(ring->ctx, batch, NONCE_RING_DRAIN_BATCH);
+            if (n <= 0) {
+                usleep(NONCE_RING_IDLE_US);
+                continue;
+            }
+        }
+
+        if (n > 0) {
+            ring->drained += n;
+            ring->drain_passes++;
+            nonce_ring_publish(ring, batch, n);
+        }
+    }
+
+    return NULL;
+}
+
+int nonce_ring_start(nonce_ring_t *ring, bm1398_context_t *ctx, int stream_fd) {
+    if (!ring || ring->running || (stream_fd < 0 && (!ctx || !ctx->initialized))) {
+        return -1;
+    }
+
+    ring->ctx = ctx;
+    ring->stream_fd = stream_fd;
+    ring->start_ns = monotonic_ns();
+    ring->running = true;
+
+    // Register reads must not pop the FIFO under the kernel's feet
+    if (stream_fd >= 0) {
+        bm1398_demux_use_stream(ctx, true);
+    }
+
+    if (pthread_create(&ring->thread, NULL, nonce_reader_thread, ring) != 0) {
+        fprintf(stderr, "Error: Cannot start nonce reader thread\n");
+        ring->running = false;
+        if (stream_fd >= 0) {
+            bm1398_demux_use_stream(ctx, false);
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+void nonce_ring_stop(nonce_ring_t *ring) {
+    if (!ring || !ring->running) {
+        return;
+    }
+
+    ring->running = false;
+    pthread_join(ring->thread, NULL);
+
+    if (ring->stream_fd >= 0) {
+        bm1398_demux_use_stream(ring->ctx, false);
+    }
+}
+
+//==============================================================================
+// Statistics
+//==============================================================================
+
+void nonce_ring_get_stats(nonce_ring_t *ring, nonce_ring_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    stats->drained = ring->drained;
+    stats->drain_passes = ring->drain_passes;
+    stats->bad_chain = ring->bad_chain;
+    if (ring->start_ns) {
+        double secs = (monotonic_ns() - ring->start_ns) / 1e9;
+        stats->drain_rate = secs > 0 ? ring->drained / secs : 0;
+    }
+
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        nonce_lane_t *lane = &ring->lanes[c];
+        uint64_t head = atomic_load_explicit(&lane->head.pos, memory_order_acquire);
+
+        stats->published[c] = lane->published;
+        stats->dropped[c] = lane->dropped;
+        stats->occupancy[c] = (uint32_t)(head - lane_min_tail(lane));
+        stats->high_water[c] = lane->high_water;
+    }
+}
+
+void nonce_ring_print_stats(nonce_ring_t *ring) {
+    nonce_ring_stats_t stats;
+    nonce_ring_get_stats(ring, &stats);
+
+    printf("Nonce ring: %llu drained (%.0f/s, %.1f per pass), %llu bad chain id\n",
+           (unsigned long long)stats.drained, stats.drain_rate,
+           stats.drain_passes ? (double)stats.drained / stats.drain_passes : 0.0,
+           (unsigned long long)stats.bad_chain);
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        printf("  Chain %d: %llu published, %llu dropped, occupancy %u/%u (peak %u)\n",
+               c, (unsigned long long)stats.published[c],
+               (unsigned long long)stats.dropped[c],
+               stats.occupancy[c], ring->slots_per_lane, stats.high_water[c]);
+    }
+}
@@ -0,0 +1,138 @@
+/*
+ * Pattern File - zero-copy access to btc-asic-XXX.bin test patterns
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/pattern_file.h"
+
+/**
+ * Map pattern files for a set of ASICs
+ * Messages follow parse_bin_file_to_pattern_ex in single_board_test
+ *
+ * Returns 0 on success, -3 if a file is missing, -4 if it cannot be opened
+ * or mapped, -1 if it is too short for the requested cores
+ */
+int pattern_set_open(pattern_set_t *set, const char *dir, const int *asic_ids,
+                     int num_asics, int num_cores, int patterns_per_core) {
+    char filename[256];
+
+    memset(set, 0, sizeof(*set));
+    if (num_asics <= 0 || num_cores <= 0 || num_cores > PATTERN_FILE_CORES ||
+        patterns_per_core <= 0 || patterns_per_core > PATTERN_FILE_ACTIVE) {
+        return -1;
+    }
+
+    set->files = calloc(num_asics, sizeof(*set->files));
+    set->sizes = calloc(num_asics, sizeof(*set->sizes));
+    if (!set->files || !set->sizes) {
+        pattern_set_close(set);
+        return -1;
+    }
+    set->num_cores = num_cores;
+    set->patterns_per_core = patterns_per_core;
+
+    size_t needed = (size_t)(num_cores - 1) * PATTERN_FILE_ROW_SIZE +
+                    PATTERN_FILE_ACTIVE_START + PATTERN_FILE_ACTIVE * PATTERN_ENTRY_SIZE;
+
+    for (int i = 0; i < num_asics; i++) {
+        snprintf(filename, sizeof(filename), "%s/btc-asic-%03d.bin",
+                 dir, asic_ids ? asic_ids[i] : i);
+
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                printf("parse_bin_file_to_pattern_ex : pattern file: %s don't exist!!!\n", filename);
+                pattern_set_close(set);
+                return -3;
+            }
+            printf("parse_bin_file_to_pattern_ex : Open pattern file: %s failed !!!\n", filename);
+            pattern_set_close(set);
+            return -4;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < needed) {
+            printf("parse_bin_file_to_pattern_ex : pattern file: %s too short (%ld bytes)\n",
+                   filename, (long)st.st_size);
+            close(fd);
+            pattern_set_close(set);
+            return -1;
+        }
+        if (st.st_size != PATTERN_FILE_SIZE) {
+            printf("parse_bin_file_to_pattern_ex : Warning: %s is %ld bytes, expected %d\n",
+                   filename, (long)st.st_size, PATTERN_FILE_SIZE);
+        }
+
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);  // Mapping keeps the file referenced
+        if (map == MAP_FAILED) {
+            printf("parse_bin_file_to_pattern_ex : mmap pattern file: %s failed: %s\n",
+                   filename, strerror(errno));
+            pattern_set_close(set);
+            return -4;
+        }
+
+        // Only the tail of each row is read: don't let readahead pull the rest
+        madvise(map, st.st_size, MADV_RANDOM);
+
+        set->files[i] = map;
+        set->sizes[i] = st.st_size;
+        set->num_asics = i + 1;
+    }
+
+    printf("parse_bin_file_to_pattern_ex : Mapped %d file(s), %d cores, %d patterns per core\n",
+           num_asics, num_cores, patterns_per_core);
+    return 0;
+}
+
+void pattern_set_close(pattern_set_t *set) {
+    if (set->files) {
+        for (int i = 0; i < set->num_asics; i++) {
+            munmap((void *)set->files[i], set->sizes[i]);
+        }
+    }
+    free(set->files);
+    free(set->sizes);
+    memset(set, 0, sizeof(*set));
+}
+
+void pattern_set_prefetch(const pattern_set_t *set) {
+    volatile uint32_t sink = 0;
+    int count = pattern_set_count(set);
+
+    for (int i = 0; i < count; i++) {
+        sink += pattern_set_get(set, i)->nonce;
+    }
+    (void)sink;
+}
+
+/**
+ * Private (anonymous) resident memory in KB; file_kb receives resident
+ * file-backed pages. Mapped pattern pages are clean page cache: the kernel
+ * maps neighbouring cached pages on each fault, so file_kb can approach the
+ * full file size while costing no private memory.
+ */
+long pattern_rss_kb(long *file_kb) {
+    char line[128];
+    long anon = -1, file = -1;
+    FILE *fp = fopen("/proc/self/status", "r");
+
+    if (!fp) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        sscanf(line, "RssAnon: %ld", &anon);
+        sscanf(line, "RssFile: %ld", &file);
+    }
+    fclose(fp);
+
+    if (file_kb) *file_kb = file;
+    return anon;
+}
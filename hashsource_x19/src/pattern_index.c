@@ -0,0 +1,87 @@
+/*
+ * Pattern Index - O(1) expected-nonce lookup for pattern verification
+ *
+ * All entries with the same nonce hash to the same home slot, and linear
+ * probing places later inserts further along the same sequence, so a probe
+ * visits duplicates in insertion (pattern) order. That keeps the "first
+ * matching pattern wins" behaviour of the original linear scan.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/pattern_index.h"
+
+// Fibonacci hashing: top bits of nonce * 2^32/phi
+static inline uint32_t index_slot(const pattern_index_t *index, uint32_t nonce) {
+    return (nonce * 0x9E3779B1u) >> index->shift;
+}
+
+int pattern_index_init(pattern_index_t *index, int expected_count) {
+    uint32_t capacity = 16;
+    uint32_t bits = 4;
+
+    while (capacity < (uint32_t)expected_count * 2) {
+        capacity <<= 1;
+        bits++;
+    }
+
+    index->slots = malloc(capacity * sizeof(pattern_index_entry_t));
+    if (!index->slots) {
+        fprintf(stderr, "Error: Cannot allocate pattern index (%u slots)\n", capacity);
+        return -1;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+        index->slots[i].value = -1;
+    }
+
+    index->mask = capacity - 1;
+    index->shift = 32 - bits;
+    index->count = 0;
+    index->max_probe = 0;
+    return 0;
+}
+
+void pattern_index_free(pattern_index_t *index) {
+    free(index->slots);
+    index->slots = NULL;
+}
+
+int pattern_index_add(pattern_index_t *index, uint32_t nonce, uint16_t work_id, int value) {
+    // Keep load factor <= 1/2 so probes stay short
+    if ((uint32_t)(index->count + 1) * 2 > index->mask + 1) {
+        fprintf(stderr, "Error: Pattern index full (%d entries)\n", index->count);
+        return -1;
+    }
+
+    uint32_t slot = index_slot(index, nonce);
+    int probe = 0;
+
+    while (index->slots[slot].value >= 0) {
+        slot = (slot + 1) & index->mask;
+        probe++;
+    }
+
+    index->slots[slot].nonce = nonce;
+    index->slots[slot].work_id = work_id;
+    index->slots[slot].reserved = 0;
+    index->slots[slot].value = value;
+    index->count++;
+    if (probe > index->max_probe) index->max_probe = probe;
+
+    return 0;
+}
+
+int pattern_index_lookup(const pattern_index_t *index, uint32_t nonce, uint16_t work_id) {
+    uint32_t slot = index_slot(index, nonce);
+
+    for (;;) {
+        const pattern_index_entry_t *e = &index->slots[slot];
+        if (e->value < 0) {
+            return -1;
+        }
+        if (e->nonce == nonce && (e->work_id == work_id || work_id == 0)) {
+            return e->value;
+        }
+        slot = (slot + 1) & index->mask;
+    }
+}
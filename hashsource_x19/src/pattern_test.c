@@ -3,6 +3,11 @@
  *
  * This implementation precisely replicates the Bitmain factory test
  * pattern test methodology, verified against single_board_test binary.
+ *
+ * Usage: pattern_test [chain] [pattern_dir] [--all]
+ *   --all  Full-chain PT2: load btc-asic-000..113.bin, stream every pattern
+ *          while a verifier thread matches nonces, then print a per-chip /
+ *          per-core pass matrix judged by Least_Nonce_Per_Core and Nonce_Rate
  */
 
 #include <stdio.h>
@@ -12,7 +17,11 @@
 #include <unistd.h>
 #include <time.h>
 #include <endian.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "../include/bm1398_asic.h"
+#include "../include/pattern_index.h"
+#include "../include/pattern_file.h"
 
 // Configuration (matches single_board_test Config.ini)
 #define TEST_CHAIN 0
@@ -21,89 +30,64 @@
 #define TEST_ASIC_ID 0       // Test first ASIC only for initial verification
 #define NONCE_TIMEOUT_SEC 60
 
-// Pattern file structure (verified from binary @ 0x1C890)
-#define PATTERN_ENTRY_SIZE 0x74    // 116 bytes on disk
-#define PATTERN_MEM_SIZE   0x7C    // 124 bytes in memory
-#define PATTERNS_PER_CORE_ROW 8    // 8 pattern slots per core
-
-// Pattern entry (116 bytes on disk)
-typedef struct __attribute__((packed)) {
-    uint8_t  header[15];     // Offset 0x00-0x0E: Header/metadata
-    uint8_t  work_data[12];  // Offset 0x0F-0x1A: Last 12 bytes of block header
-    uint8_t  midstate[32];   // Offset 0x1B-0x3A: SHA256 midstate
-    uint8_t  reserved[29];   // Offset 0x3B-0x57: Padding/reserved
-    uint32_t nonce;          // Offset 0x58-0x5B: Expected nonce (little-endian)
-    uint8_t  trailer[24];    // Offset 0x5C-0x73: Additional data
-} test_pattern_t;
-
-// Work entry in memory (124 bytes)
+// Full-chain pass criteria (Config.ini Test_Standard)
+#define LEAST_NONCE_PER_CORE 6   // Least_Nonce_Per_Core
+#define NONCE_RATE 9950          // Nonce_Rate, in 1/10000 of expected nonces
+#define NONCE_IDLE_SEC 5         // Full chain: stop once sent and quiet this long
+#define PATTERNS_PER_ASIC (CORES_PER_ASIC * PATTERNS_PER_CORE)
+
+// The FIFO keeps 12 bits of the sent work_id, shifted over the midstate slot
+// (FIFO_WORK_ID); patterns are indexed by that value with the slot cleared
+#define PATTERN_RETURNED_ID(work_id)  (((work_id) << 3) & 0x7FFF)
+#define PATTERN_ID_KEY(fifo_work_id)  ((fifo_work_id) & 0x7FF8)
+
+// Per-work state; the pattern itself stays in the mapped file (pattern_file.h)
 typedef struct {
-    test_pattern_t pattern;  // 116 bytes
-    uint32_t work_id;        // 4 bytes - calculated work ID
-    uint8_t  nonce_returned; // 1 byte - flag
-    uint8_t  padding[3];     // 3 bytes - alignment
+    uint32_t work_id;        // Calculated work ID
+    uint8_t  nonce_returned; // Nonces seen for this work
 } pattern_work_t;
 
 /**
- * Load pattern file for one ASIC
- * Matches sub_1C890 (parse_bin_file_to_pattern_ex) exactly
+ * Index expected nonces for O(1) matching of returned nonces
+ * Keyed by nonce and the work_id the FIFO will return for the pattern
  */
-int load_asic_patterns(const char *filename, int num_cores, int patterns_per_core,
-                      pattern_work_t *works) {
-    FILE *fp;
-    int core, pat, skip_count;
-    uint8_t temp_buf[PATTERN_ENTRY_SIZE];
-    pattern_work_t *work_ptr;
-
-    // Check file exists (as single_board_test does)
-    if (access(filename, 0) != 0) {
-        printf("parse_bin_file_to_pattern_ex : pattern file: %s don't exist!!!\n", filename);
-        return -3;
+int build_pattern_index(pattern_index_t *index, const pattern_set_t *set,
+                        const pattern_work_t *works, int num_works) {
+    if (pattern_index_init(index, num_works) < 0) {
+        return -1;
     }
 
-    fp = fopen(filename, "rb");
-    if (!fp) {
-        printf("parse_bin_file_to_pattern_ex : Open pattern file: %s failed !!!\n", filename);
-        return -4;
+    for (int idx = 0; idx < num_works; idx++) {
+        if (pattern_index_add(index, pattern_set_get(set, idx)->nonce,
+                               PATTERN_RETURNED_ID(works[idx].work_id), idx) < 0) {
+            pattern_index_free(index);
+            return -1;
+        }
     }
 
-    printf("parse_bin_file_to_pattern_ex : Loading %d cores, %d patterns per core\n",
-           num_cores, patterns_per_core);
-
-    work_ptr = works;
-
-    // Read patterns for each core
-    for (core = 0; core < num_cores; core++) {
-        // Read active patterns (patterns_per_core patterns)
-        for (pat = 0; pat < patterns_per_core; pat++) {
-            // Read 116 bytes from file (0x74)
-            if (fread(&work_ptr->pattern, 1, PATTERN_ENTRY_SIZE, fp) != PATTERN_ENTRY_SIZE) {
-                printf("parse_bin_file_to_pattern_ex : fread pattern failed!\n");
-                fclose(fp);
-                return -1;
-            }
-
-            // Calculate work_id (matches sub_2B254 call in single_board_test)
-            // work_id is pattern index, NOT shifted here
-            work_ptr->work_id = pat;
-            work_ptr->nonce_returned = 0;
+    printf("build_pattern_index : Indexed %d expected nonces (longest probe %d)\n",
+           index->count, index->max_probe);
+    return 0;
+}
 
-            work_ptr++;
-        }
+/**
+ * Format every pattern as a ready-to-push work packet (pattern test uses the
+ * same midstate in all 4 slots), so sending only patches chain and work_id
+ */
+int prepare_pattern_work(bm1398_work_arena_t *arena, const pattern_set_t *set,
+                         pattern_work_t *works, int chain, int num_works) {
+    if (bm1398_work_arena_init(arena, num_works) < 0) {
+        return -1;
+    }
 
-        // Skip remaining pattern slots (8 total slots per core)
-        skip_count = PATTERNS_PER_CORE_ROW - patterns_per_core;
-        for (int skip = 0; skip < skip_count; skip++) {
-            if (fread(temp_buf, 1, PATTERN_ENTRY_SIZE, fp) != PATTERN_ENTRY_SIZE) {
-                printf("skip_rows : skip pattern from file error!\n");
-                break;
-            }
-        }
+    for (int i = 0; i < num_works; i++) {
+        const test_pattern_t *pattern = pattern_set_get(set, i);
+        bm1398_prepare_work(&arena->packets[i], chain, works[i].work_id,
+                            pattern->work_data, pattern->midstate, 1);
     }
 
-    fclose(fp);
-    printf("parse_bin_file_to_pattern_ex : Loaded %d patterns successfully\n",
-           num_cores * patterns_per_core);
+    printf("prepare_pattern_work : %d work packets formatted (%zu KB)\n",
+           num_works, (size_t)num_works * sizeof(bm1398_work_t) / 1024);
     return 0;
 }
 
@@ -112,53 +96,247 @@ int load_asic_patterns(const char *filename, int num_cores, int patterns_per_cor
  * Matches sub_1C3B0 (software_pattern_4_midstate_send_function) exactly
  */
 int send_pattern_work(bm1398_context_t *ctx, int chain,
-                     pattern_work_t *works, int num_works) {
+                     const bm1398_work_arena_t *arena, pattern_work_t *works, int num_works) {
     int i;
 
     printf("software_pattern_4_midstate_send_function :  \n");
+    bm1398_reset_work_flow_stats(ctx, chain);
 
     for (i = 0; i < num_works; i++) {
-        // Build midstates array (use same midstate for all 4 slots)
-        uint8_t midstates[4][32];
-        for (int m = 0; m < 4; m++) {
-            memcpy(midstates[m], works[i].pattern.midstate, 32);
-        }
+        // Packet is pre-formatted (big-endian, midstate in all 4 slots);
+        // only the chain/work_id words are patched for this send
+        bm1398_work_t *packet = &arena->packets[i];
+        bm1398_work_set_id(packet, chain, works[i].work_id);
 
-        // Send work packet
-        // NOTE: bm1398_send_work() handles:
-        //   - work_id << 3 shift
-        //   - Byte swapping
-        //   - FPGA buffer check
-        //   - Actual transmission
-        if (bm1398_send_work(ctx, chain, works[i].work_id,
-                            works[i].pattern.work_data, midstates) < 0) {
+        if (bm1398_send_prepared_work(ctx, chain, packet) < 0) {
             fprintf(stderr, "Error: Failed to send pattern %d\n", i);
             return -1;
         }
-
-        // Small delay between packets
-        usleep(10);
+        // No fixed delay: sends are paced by work FIFO credits
     }
 
     printf("software_pattern_4_midstate_send_function : Send test %d pattern done\n", num_works);
+    bm1398_print_work_flow_stats(ctx);
     return 0;
 }
 
+//==============================================================================
+// Full-chain PT2
+//==============================================================================
+
+typedef struct {
+    bm1398_context_t *ctx;
+    const pattern_set_t *set;
+    const pattern_index_t *index;
+    pattern_work_t *works;
+    int num_works;
+    int num_asics;
+    int chip_interval;          // Chip address spacing (256 / num_asics)
+    atomic_bool running;
+
+    // Polled by the main thread while the verifier runs
+    atomic_int valid_nonces;
+    _Atomic time_t last_nonce;
+
+    // Written by the verifier thread only, read after it is joined
+    uint8_t (*core_nonces)[CORES_PER_ASIC];
+    int total_nonces;
+    int duplicate_nonces;
+    int wrong_chip;
+} full_chain_test_t;
+
+/**
+ * Verifier thread: drains the nonce FIFO while work is still being sent,
+ * so the FIFO never backs up during the ~73k-pattern stream
+ */
+static void *full_chain_verify_thread(void *arg) {
+    full_chain_test_t *t = arg;
+    nonce_response_t nonces[256];
+    int per_asic = PATTERNS_PER_ASIC;
+
+    while (atomic_load(&t->running)) {
+        int read = bm1398_read_nonces(t->ctx, nonces, 256);
+        if (read <= 0) {
+            usleep(1000);
+            continue;
+        }
+
+        for (int i = 0; i < read; i++) {
+            t->total_nonces++;
+            atomic_store(&t->last_nonce, time(NULL));
+
+            // work_id is the pattern within the chip; the chip comes back in
+            // the nonce's address byte
+            int asic = nonces[i].chip_id / t->chip_interval;
+            int local = nonces[i].work_id >> 3;
+            int idx = asic * per_asic + local;
+            if (local >= per_asic || idx >= t->num_works ||
+                pattern_set_get(t->set, idx)->nonce != nonces[i].nonce) {
+                // Not the pattern that address points at: find it on any chip
+                idx = pattern_index_lookup(t->index, nonces[i].nonce,
+                                           PATTERN_ID_KEY(nonces[i].work_id));
+                if (idx < 0) {
+                    continue;
+                }
+                t->wrong_chip++;
+                asic = idx / per_asic;
+            }
+
+            int core = (idx % per_asic) / PATTERNS_PER_CORE;
+            if (t->works[idx].nonce_returned++) {
+                t->duplicate_nonces++;
+                continue;
+            }
+            t->core_nonces[asic][core]++;
+            atomic_fetch_add(&t->valid_nonces, 1);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Print pass matrix: one row per chip, one column per core.
+ * Cell is the number of distinct patterns that returned (0-8), '.' for 0.
+ *
+ * Returns number of failing chips
+ */
+static int print_full_chain_matrix(full_chain_test_t *t) {
+    int per_asic = PATTERNS_PER_ASIC;
+    int failed_chips = 0;
+
+    printf("Core pass matrix (patterns returned per core, pass >= %d/%d)\n",
+           LEAST_NONCE_PER_CORE, PATTERNS_PER_CORE);
+    printf("         core 0");
+    for (int c = 10; c < CORES_PER_ASIC; c += 10) {
+        printf("%*d", 10, c);
+    }
+    printf("\n");
+
+    for (int asic = 0; asic < t->num_asics; asic++) {
+        char row[CORES_PER_ASIC + 1];
+        int bad_cores = 0, nonces = 0;
+
+        for (int core = 0; core < CORES_PER_ASIC; core++) {
+            int n = t->core_nonces[asic][core];
+            row[core] = n ? '0' + n : '.';
+            nonces += n;
+            if (n < LEAST_NONCE_PER_CORE) bad_cores++;
+        }
+        row[CORES_PER_ASIC] = '\0';
+
+        int rate = nonces * 10000 / per_asic;
+        bool pass = bad_cores == 0 && rate >= NONCE_RATE;
+        if (!pass) failed_chips++;
+
+        printf("ASIC %3d  %s  %3d/%d %3d.%02d%% %s\n", asic, row, nonces, per_asic,
+               rate / 100, rate % 100, pass ? "OK" : "NG");
+    }
+
+    return failed_chips;
+}
+
+/**
+ * Full-chain pattern test: stream all patterns with concurrent verification
+ *
+ * Returns 0 if every chip passed
+ */
+static int run_full_chain_test(bm1398_context_t *ctx, int chain, int num_asics,
+                               const bm1398_work_arena_t *arena, pattern_work_t *works,
+                               int num_patterns, const pattern_set_t *set,
+                               const pattern_index_t *index) {
+    full_chain_test_t t;
+    pthread_t verifier;
+
+    memset(&t, 0, sizeof(t));
+    t.ctx = ctx;
+    t.set = set;
+    t.index = index;
+    t.works = works;
+    t.num_works = num_patterns;
+    t.num_asics = num_asics;
+    t.chip_interval = 256 / num_asics;
+    t.core_nonces = calloc(num_asics, sizeof(*t.core_nonces));
+    if (!t.core_nonces) {
+        fprintf(stderr, "Error: Failed to allocate pass matrix\n");
+        return -1;
+    }
+
+    atomic_init(&t.valid_nonces, 0);
+    atomic_init(&t.last_nonce, time(NULL));
+    atomic_init(&t.running, true);
+    if (pthread_create(&verifier, NULL, full_chain_verify_thread, &t) != 0) {
+        fprintf(stderr, "Error: Failed to start verifier thread\n");
+        free(t.core_nonces);
+        return -1;
+    }
+
+    printf("====================================\n");
+    printf("Streaming %d Patterns (%d ASICs)\n", num_patterns, num_asics);
+    printf("====================================\n");
+    time_t start_time = time(NULL);
+    int ret = send_pattern_work(ctx, chain, arena, works, num_patterns);
+    time_t sent_time = time(NULL);
+    printf("Sent in %ds, %d nonces verified so far\n\n",
+           (int)(sent_time - start_time), atomic_load(&t.valid_nonces));
+
+    // Keep verifying until everything is back, the chain goes quiet or timeout
+    atomic_store(&t.last_nonce, sent_time);
+    while (ret == 0 && time(NULL) - start_time < NONCE_TIMEOUT_SEC &&
+           atomic_load(&t.valid_nonces) < num_patterns &&
+           time(NULL) - atomic_load(&t.last_nonce) < NONCE_IDLE_SEC) {
+        sleep(1);
+        printf("[%ds] %d/%d valid nonces\n", (int)(time(NULL) - start_time),
+               atomic_load(&t.valid_nonces), num_patterns);
+    }
+
+    atomic_store(&t.running, false);
+    pthread_join(verifier, NULL);
+    int elapsed = (int)(time(NULL) - start_time);
+
+    printf("\n");
+    printf("====================================\n");
+    printf("Full Chain Results\n");
+    printf("====================================\n");
+    int failed_chips = print_full_chain_matrix(&t);
+
+    int rate = num_patterns ? (int)((int64_t)t.valid_nonces * 10000 / num_patterns) : 0;
+    printf("\n");
+    printf("Patterns sent: %d\n", num_patterns);
+    printf("Total nonces received: %d\n", t.total_nonces);
+    printf("Valid nonces: %d (%d duplicate, %d from unexpected chip address)\n",
+           t.valid_nonces, t.duplicate_nonces, t.wrong_chip);
+    printf("Nonce rate: %d.%02d%% (need %d.%02d%%)\n", rate / 100, rate % 100,
+           NONCE_RATE / 100, NONCE_RATE % 100);
+    printf("Failed ASICs: %d of %d\n", failed_chips, num_asics);
+    printf("Test time: %ds\n", elapsed);
+    printf("Result: %s\n", (ret == 0 && failed_chips == 0) ? "PASS" : "FAIL");
+
+    free(t.core_nonces);
+    return (ret == 0 && failed_chips == 0) ? 0 : -1;
+}
+
 /**
  * Main test function
  */
 int main(int argc, char *argv[]) {
     const char *pattern_dir = "/tmp/BM1398-pattern";
-    char filename[256];
     int chain = TEST_CHAIN;
     pattern_work_t *works;
     int num_patterns;
-
-    if (argc > 1) {
-        chain = atoi(argv[1]);
-    }
-    if (argc > 2) {
-        pattern_dir = argv[2];
+    bool full_chain = false;
+    int num_asics = 1;
+    int positional = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--all") == 0) {
+            full_chain = true;
+            num_asics = CHIPS_PER_CHAIN_S19PRO;
+        } else if (positional++ == 0) {
+            chain = atoi(argv[i]);
+        } else {
+            pattern_dir = argv[i];
+        }
     }
 
     printf("\n");
@@ -166,39 +344,85 @@ int main(int argc, char *argv[]) {
     printf("BM1398 Pattern Test (single_board_test Compatible)\n");
     printf("====================================\n");
     printf("Chain: %d\n", chain);
-    printf("ASIC: %d\n", TEST_ASIC_ID);
+    if (full_chain) {
+        printf("ASICs: all %d\n", num_asics);
+    } else {
+        printf("ASIC: %d\n", TEST_ASIC_ID);
+    }
     printf("Cores per ASIC: %d\n", CORES_PER_ASIC);
     printf("Patterns per core: %d\n", PATTERNS_PER_CORE);
     printf("Pattern dir: %s\n", pattern_dir);
     printf("\n");
 
-    // Allocate pattern storage (matches calloc in get_works_ex)
-    num_patterns = CORES_PER_ASIC * PATTERNS_PER_CORE;
+    // Map pattern files (no copy: patterns are read in place)
+    printf("get_works_ex : pattern file path: %s/btc-asic-%%03d.bin\n", pattern_dir);
+    printf("get_works_ex : asic_num = %d, core_num = %d, pattern_num = %d\n",
+           num_asics, CORES_PER_ASIC, PATTERNS_PER_CORE);
+
+    pattern_set_t set;
+    int asic_id = TEST_ASIC_ID;
+    long file_before, file_after;
+    long rss_before = pattern_rss_kb(&file_before);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    if (pattern_set_open(&set, pattern_dir, full_chain ? NULL : &asic_id, num_asics,
+                         CORES_PER_ASIC, PATTERNS_PER_CORE) < 0) {
+        fprintf(stderr, "Error: Failed to load patterns\n");
+        return 1;
+    }
+
+    // Per-work state only (8 bytes per work instead of a 124-byte copy)
+    num_patterns = pattern_set_count(&set);
     works = calloc(num_patterns, sizeof(pattern_work_t));
     if (!works) {
         fprintf(stderr, "Error: Failed to allocate pattern storage\n");
+        pattern_set_close(&set);
         return 1;
     }
 
-    // Build filename
-    snprintf(filename, sizeof(filename), "%s/btc-asic-%03d.bin",
-             pattern_dir, TEST_ASIC_ID);
+    for (int i = 0; i < num_patterns; i++) {
+        if (full_chain) {
+            // Pattern index within the chip (< 640): fits the 12 work_id
+            // bits the FIFO keeps, the nonce's address byte gives the chip
+            works[i].work_id = i % PATTERNS_PER_ASIC;
+        } else {
+            // work_id is pattern index within the core (sub_2B254), NOT shifted here
+            works[i].work_id = i % PATTERNS_PER_CORE;
+        }
+    }
 
-    // Load patterns
-    printf("get_works_ex : pattern file path: %s\n", filename);
-    printf("get_works_ex : asic_num = 1, core_num = %d, pattern_num = %d\n",
-           CORES_PER_ASIC, PATTERNS_PER_CORE);
+    pattern_index_t index;
+    if (build_pattern_index(&index, &set, works, num_patterns) < 0) {
+        fprintf(stderr, "Error: Failed to index patterns\n");
+        pattern_set_close(&set);
+        free(works);
+        return 1;
+    }
 
-    if (load_asic_patterns(filename, CORES_PER_ASIC, PATTERNS_PER_CORE, works) < 0) {
-        fprintf(stderr, "Error: Failed to load patterns\n");
+    bm1398_work_arena_t arena;
+    if (prepare_pattern_work(&arena, &set, works, chain, num_patterns) < 0) {
+        fprintf(stderr, "Error: Failed to prepare work packets\n");
+        pattern_index_free(&index);
+        pattern_set_close(&set);
         free(works);
         return 1;
     }
 
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    long rss_after = pattern_rss_kb(&file_after);
+    printf("prepare_pattern : read pattern file done (%d patterns, %.1f ms)\n",
+           num_patterns, (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+    printf("prepare_pattern : RSS anon %ld -> %ld KB, file-backed %ld -> %ld KB\n\n",
+           rss_before, rss_after, file_before, file_after);
+
     // Initialize driver
     bm1398_context_t ctx;
     if (bm1398_init(&ctx) < 0) {
         fprintf(stderr, "Error: Failed to initialize driver\n");
+        pattern_index_free(&index);
+        bm1398_work_arena_free(&arena);
+        pattern_set_close(&set);
         free(works);
         return 1;
     }
@@ -210,6 +434,9 @@ int main(int argc, char *argv[]) {
     if (bm1398_psu_power_on(&ctx, 15000) < 0) {
         fprintf(stderr, "Error: Failed to power on PSU\n");
         bm1398_cleanup(&ctx);
+        pattern_index_free(&index);
+        bm1398_work_arena_free(&arena);
+        pattern_set_close(&set);
         free(works);
         return 1;
     }
@@ -241,6 +468,9 @@ int main(int argc, char *argv[]) {
     if (bm1398_init_chain_pt1_full(&ctx, chain) < 0) {
         fprintf(stderr, "Error: PT1 full initialization failed\n");
         bm1398_cleanup(&ctx);
+        pattern_index_free(&index);
+        bm1398_work_arena_free(&arena);
+        pattern_set_close(&set);
         free(works);
         return 1;
     }
@@ -274,6 +504,9 @@ int main(int argc, char *argv[]) {
     if (bm1398_enable_work_send(&ctx) < 0) {
         fprintf(stderr, "Error: Failed to enable work send\n");
         bm1398_cleanup(&ctx);
+        pattern_index_free(&index);
+        bm1398_work_arena_free(&arena);
+        pattern_set_close(&set);
         free(works);
         return 1;
     }
@@ -288,17 +521,34 @@ int main(int argc, char *argv[]) {
     if (bm1398_set_ticket_mask(&ctx, chain, 0xFFFF) < 0) {
         fprintf(stderr, "Error: Failed to set ticket mask\n");
         bm1398_cleanup(&ctx);
+        pattern_index_free(&index);
+        bm1398_work_arena_free(&arena);
+        pattern_set_close(&set);
         free(works);
         return 1;
     }
     printf("\n");
 
+    if (full_chain) {
+        int result = run_full_chain_test(&ctx, chain, num_asics, &arena, works,
+                                         num_patterns, &set, &index);
+        bm1398_cleanup(&ctx);
+        pattern_index_free(&index);
+        bm1398_work_arena_free(&arena);
+        pattern_set_close(&set);
+        free(works);
+        return result == 0 ? 0 : 1;
+    }
+
     // Send test patterns
     printf("====================================\n");
     printf("Sending Test Patterns\n");
     printf("====================================\n");
-    if (send_pattern_work(&ctx, chain, works, num_patterns) < 0) {
+    if (send_pattern_work(&ctx, chain, &arena, works, num_patterns) < 0) {
         bm1398_cleanup(&ctx);
+        pattern_index_free(&index);
+        bm1398_work_arena_free(&arena);
+        pattern_set_close(&set);
         free(works);
         return 1;
     }
@@ -355,29 +605,24 @@ int main(int argc, char *argv[]) {
                        nonces[i].chain_id, nonces[i].chip_id,
                        nonces[i].core_id, nonces[i].work_id);
 
-                // Parse the nonce value to check if it matches expected patterns
-                // Try to match against all expected nonces
-                // work_id in nonce response is encoded as (pattern_index << 3) & 0xFF
-                bool found = false;
-                for (int idx = 0; idx < num_patterns && !found; idx++) {
-                    if (nonces[i].nonce == works[idx].pattern.nonce) {
-                        // Verify work_id matches (with proper encoding)
-                        uint8_t expected_work_id = (idx << 3) & 0xFF;
-                        if (nonces[i].work_id == expected_work_id || nonces[i].work_id == 0) {
-                            printf("  ✓ VALID! Pattern idx=%d (core=%d, pattern=%d), expected_nonce=0x%08X\n",
-                                   idx, idx / PATTERNS_PER_CORE, idx % PATTERNS_PER_CORE,
-                                   works[idx].pattern.nonce);
-                            if (nonces[i].work_id == expected_work_id) {
-                                printf("    Work ID matches: 0x%02X\n", expected_work_id);
-                            } else {
-                                printf("    Work ID mismatch: got 0x%02X, expected 0x%02X (ignoring for now)\n",
-                                       nonces[i].work_id, expected_work_id);
-                            }
-                            works[idx].nonce_returned++;
-                            valid_nonces++;
-                            found = true;
-                        }
+                // Look up the expected pattern by (nonce, work_id)
+                // A returned work_id of 0 matches any pattern with this nonce
+                int idx = pattern_index_lookup(&index, nonces[i].nonce,
+                                               PATTERN_ID_KEY(nonces[i].work_id));
+                bool found = idx >= 0;
+                if (found) {
+                    uint16_t expected_work_id = PATTERN_RETURNED_ID(works[idx].work_id);
+                    printf("  ✓ VALID! Pattern idx=%d (core=%d, pattern=%d), expected_nonce=0x%08X\n",
+                           idx, idx / PATTERNS_PER_CORE, idx % PATTERNS_PER_CORE,
+                           pattern_set_get(&set, idx)->nonce);
+                    if (PATTERN_ID_KEY(nonces[i].work_id) == expected_work_id) {
+                        printf("    Work ID matches: 0x%04X\n", expected_work_id);
+                    } else {
+                        printf("    Work ID mismatch: got 0x%04X, expected 0x%04X (ignoring for now)\n",
+                               nonces[i].work_id, expected_work_id);
                     }
+                    works[idx].nonce_returned++;
+                    valid_nonces++;
                 }
 
                 if (!found) {
@@ -385,9 +630,9 @@ int main(int argc, char *argv[]) {
                     // Show first few expected nonces for debugging
                     if (total_nonces <= 5 && num_patterns > 0) {
                         printf("    Expected nonces: 0x%08X, 0x%08X, 0x%08X...\n",
-                               works[0].pattern.nonce,
-                               num_patterns > 1 ? works[1].pattern.nonce : 0,
-                               num_patterns > 2 ? works[2].pattern.nonce : 0);
+                               pattern_set_get(&set, 0)->nonce,
+                               num_patterns > 1 ? pattern_set_get(&set, 1)->nonce : 0,
+                               num_patterns > 2 ? pattern_set_get(&set, 2)->nonce : 0);
                     }
                 }
             }
@@ -411,6 +656,9 @@ int main(int argc, char *argv[]) {
 
     // Cleanup
     bm1398_cleanup(&ctx);
+    pattern_index_free(&index);
+    bm1398_work_arena_free(&arena);
+    pattern_set_close(&set);
     free(works);
 
     return (valid_nonces > 0) ? 0 : 1;
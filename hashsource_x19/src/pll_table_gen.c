@@ -0,0 +1,34 @@
+/*
+ * pll_table_gen - write the PLL0 5 MHz step table from the solver
+ *
+ * Build host tool: the Makefile compiles it with bm1398_pll.c for the
+ * machine running the build and redirects its output to
+ * obj/bm1398_pll_table.h, which bm1398_asic.c includes as the body of
+ * pll_step_table[].
+ *
+ * Usage: pll_table_gen > bm1398_pll_table.h
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../include/bm1398_asic.h"
+
+int main(void) {
+    printf("/* Generated by pll_table_gen from bm1398_pll_solve(), do not edit */\n");
+
+    for (int i = 0; i < BM1398_PLL_TABLE_SIZE; i++) {
+        uint32_t mhz = BM1398_PLL_TABLE_MIN_MHZ + (uint32_t)i * BM1398_PLL_TABLE_STEP_MHZ;
+        bm1398_pll_t pll;
+
+        if (bm1398_pll_solve(mhz, &pll) < 0) {
+            fprintf(stderr, "Error: No PLL setting for %u MHz\n", mhz);
+            return 1;
+        }
+        if (i % 6 == 0) {
+            printf("    /* %3u */", mhz);
+        }
+        printf(" 0x%08X%s", bm1398_pll_encode(&pll),
+               i == BM1398_PLL_TABLE_SIZE - 1 ? "\n" : i % 6 == 5 ? ",\n" : ",");
+    }
+    return 0;
+}
@@ -0,0 +1,346 @@
+/*
+ * SHA-256 (FIPS 180-4)
+ */
+
+#include <string.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+#include "../include/sha256.h"
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+#define ROTR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)  (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define EP0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define EP1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SIG0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SIG1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+void sha256_transform(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = load_be32(block + i * 4);
+    }
+    for (int i = 16; i < 64; i++) {
+        w[i] = SIG1(w[i - 2]) + w[i - 7] + SIG0(w[i - 15]) + w[i - 16];
+    }
+
+    a = state[0]; b = state[1]; c = state[2]; d = state[3];
+    e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + EP1(e) + CH(e, f, g) + K[i] + w[i];
+        uint32_t t2 = EP0(a) + MAJ(a, b, c);
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void sha256_init(sha256_ctx_t *ctx) {
+    memcpy(ctx->state, H0, sizeof(H0));
+    ctx->length = 0;
+    ctx->block_len = 0;
+}
+
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len) {
+    const uint8_t *p = data;
+
+    ctx->length += len;
+    if (ctx->block_len) {
+        size_t n = 64 - ctx->block_len;
+        if (n > len) n = len;
+        memcpy(ctx->block + ctx->block_len, p, n);
+        ctx->block_len += n;
+        p += n;
+        len -= n;
+        if (ctx->block_len < 64) {
+            return;
+        }
+        sha256_transform(ctx->state, ctx->block);
+        ctx->block_len = 0;
+    }
+    while (len >= 64) {
+        sha256_transform(ctx->state, p);
+        p += 64;
+        len -= 64;
+    }
+    memcpy(ctx->block, p, len);
+    ctx->block_len = len;
+}
+
+void sha256_final(sha256_ctx_t *ctx, uint8_t digest[32]) {
+    uint64_t bits = ctx->length * 8;
+
+    ctx->block[ctx->block_len++] = 0x80;
+    if (ctx->block_len > 56) {
+        memset(ctx->block + ctx->block_len, 0, 64 - ctx->block_len);
+        sha256_transform(ctx->state, ctx->block);
+        ctx->block_len = 0;
+    }
+    memset(ctx->block + ctx->block_len, 0, 56 - ctx->block_len);
+    store_be32(ctx->block + 56, (uint32_t)(bits >> 32));
+    store_be32(ctx->block + 60, (uint32_t)bits);
+    sha256_transform(ctx->state, ctx->block);
+
+    for (int i = 0; i < 8; i++) {
+        store_be32(digest + i * 4, ctx->state[i]);
+    }
+}
+
+void sha256(const void *data, size_t len, uint8_t digest[32]) {
+    sha256_ctx_t ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, digest);
+}
+
+void sha256d(const void *data, size_t len, uint8_t digest[32]) {
+    uint8_t first[32];
+    sha256(data, len, first);
+    sha256(first, 32, digest);
+}
+
+void sha256d_64(const uint8_t data[64], uint8_t digest[32]) {
+    // Padding for a 64-byte message: 0x80, zeros, length 512 bits
+    static const uint8_t pad64[64] = { [0] = 0x80, [62] = 0x02 };
+    uint32_t state[8];
+    uint8_t block[64] = { [32] = 0x80, [62] = 0x01 };   // 32-byte message: 256 bits
+
+    memcpy(state, H0, sizeof(H0));
+    sha256_transform(state, data);
+    sha256_transform(state, pad64);
+    for (int i = 0; i < 8; i++) {
+        store_be32(block + i * 4, state[i]);
+    }
+
+    memcpy(state, H0, sizeof(H0));
+    sha256_transform(state, block);
+    for (int i = 0; i < 8; i++) {
+        store_be32(digest + i * 4, state[i]);
+    }
+}
+
+void sha256_midstate(const uint8_t header[64], uint8_t midstate[32]) {
+    uint32_t state[8];
+
+    memcpy(state, H0, sizeof(H0));
+    sha256_transform(state, header);
+    for (int i = 0; i < 8; i++) {
+        store_be32(midstate + i * 4, state[i]);
+    }
+}
+
+int sha256_hash_zero_bits(const uint8_t hash[32]) {
+    int bits = 0;
+
+    // Hash as a little-endian 256-bit number: most significant byte last
+    for (int i = 31; i >= 0; i--) {
+        if (hash[i]) {
+            return bits + __builtin_clz(hash[i]) - 24;
+        }
+        bits += 8;
+    }
+    return bits;
+}
+
+//==============================================================================
+// 4-lane engine: one lane per independent message, lanes in vector registers
+//==============================================================================
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+typedef uint32x4_t v4u;
+#define V_DUP(x)        vdupq_n_u32(x)
+#define V_ADD(a, b)     vaddq_u32(a, b)
+#define V_XOR(a, b)     veorq_u32(a, b)
+#define V_AND(a, b)     vandq_u32(a, b)
+#define V_ANDN(a, b)    vbicq_u32(b, a)                 // ~a & b
+#define V_SHR(x, n)     vshrq_n_u32(x, n)
+#define V_ROTR(x, n)    vsriq_n_u32(vshlq_n_u32(x, 32 - (n)), x, n)
+#define V_LOAD(p)       vld1q_u32(p)
+#define V_STORE(p, v)   vst1q_u32(p, v)
+#else
+// GCC generic vectors: SSE2 on x86 hosts, plain scalar code elsewhere
+typedef uint32_t v4u __attribute__((vector_size(16)));
+#define V_DUP(x)        ((v4u){ (x), (x), (x), (x) })
+#define V_ADD(a, b)     ((a) + (b))
+#define V_XOR(a, b)     ((a) ^ (b))
+#define V_AND(a, b)     ((a) & (b))
+#define V_ANDN(a, b)    (~(a) & (b))
+#define V_SHR(x, n)     ((x) >> (n))
+#define V_ROTR(x, n)    (((x) >> (n)) | ((x) << (32 - (n))))
+#define V_LOAD(p)       ({ v4u v_; memcpy(&v_, (p), 16); v_; })
+#define V_STORE(p, v)   do { v4u v_ = (v); memcpy((p), &v_, 16); } while (0)
+#endif
+
+#define V_EP0(x)   V_XOR(V_XOR(V_ROTR(x, 2), V_ROTR(x, 13)), V_ROTR(x, 22))
+#define V_EP1(x)   V_XOR(V_XOR(V_ROTR(x, 6), V_ROTR(x, 11)), V_ROTR(x, 25))
+#define V_SIG0(x)  V_XOR(V_XOR(V_ROTR(x, 7), V_ROTR(x, 18)), V_SHR(x, 3))
+#define V_SIG1(x)  V_XOR(V_XOR(V_ROTR(x, 17), V_ROTR(x, 19)), V_SHR(x, 10))
+#define V_CH(x, y, z)   V_XOR(V_AND(x, y), V_ANDN(x, z))
+#define V_MAJ(x, y, z)  V_XOR(V_AND(x, V_XOR(y, z)), V_AND(y, z))
+
+static void compress4(v4u state[8], const v4u block[16]) {
+    v4u w[64];
+    v4u a = state[0], b = state[1], c = state[2], d = state[3];
+    v4u e = state[4], f = state[5], g = state[6], h = state[7];
+
+    memcpy(w, block, 16 * sizeof(v4u));
+    for (int i = 16; i < 64; i++) {
+        w[i] = V_ADD(V_ADD(V_SIG1(w[i - 2]), w[i - 7]), V_ADD(V_SIG0(w[i - 15]), w[i - 16]));
+    }
+
+    for (int i = 0; i < 64; i++) {
+        v4u t1 = V_ADD(V_ADD(h, V_EP1(e)), V_ADD(V_CH(e, f, g), V_ADD(V_DUP(K[i]), w[i])));
+        v4u t2 = V_ADD(V_EP0(a), V_MAJ(a, b, c));
+        h = g; g = f; f = e; e = V_ADD(d, t1);
+        d = c; c = b; b = a; a = V_ADD(t1, t2);
+    }
+
+    state[0] = V_ADD(state[0], a); state[1] = V_ADD(state[1], b);
+    state[2] = V_ADD(state[2], c); state[3] = V_ADD(state[3], d);
+    state[4] = V_ADD(state[4], e); state[5] = V_ADD(state[5], f);
+    state[6] = V_ADD(state[6], g); state[7] = V_ADD(state[7], h);
+}
+
+// Word i of every lane's block, big-endian
+static inline v4u load_lanes_be32(const uint8_t *const blocks[SHA256_LANES], int i) {
+    uint32_t lanes[SHA256_LANES];
+    for (int l = 0; l < SHA256_LANES; l++) {
+        lanes[l] = load_be32(blocks[l] + i * 4);
+    }
+    return V_LOAD(lanes);
+}
+
+void sha256_transform4(uint32_t state[SHA256_LANES][8], const uint8_t *const blocks[SHA256_LANES]) {
+    v4u s[8], w[16];
+    uint32_t lanes[SHA256_LANES];
+
+    for (int i = 0; i < 8; i++) {
+        for (int l = 0; l < SHA256_LANES; l++) lanes[l] = state[l][i];
+        s[i] = V_LOAD(lanes);
+    }
+    for (int i = 0; i < 16; i++) {
+        w[i] = load_lanes_be32(blocks, i);
+    }
+
+    compress4(s, w);
+
+    for (int i = 0; i < 8; i++) {
+        V_STORE(lanes, s[i]);
+        for (int l = 0; l < SHA256_LANES; l++) state[l][i] = lanes[l];
+    }
+}
+
+void sha256_midstate4(const uint8_t *const headers[SHA256_LANES],
+                      uint8_t midstates[SHA256_LANES][32]) {
+    v4u s[8], w[16];
+    uint32_t lanes[SHA256_LANES];
+
+    for (int i = 0; i < 8; i++) {
+        s[i] = V_DUP(H0[i]);
+    }
+    for (int i = 0; i < 16; i++) {
+        w[i] = load_lanes_be32(headers, i);
+    }
+
+    compress4(s, w);
+
+    for (int i = 0; i < 8; i++) {
+        V_STORE(lanes, s[i]);
+        for (int l = 0; l < SHA256_LANES; l++) store_be32(midstates[l] + i * 4, lanes[l]);
+    }
+}
+
+void sha256d_nonces(const uint8_t header[80], const uint32_t *nonces, int count,
+                    uint8_t (*hashes)[32]) {
+    uint32_t mid[8];
+    v4u tail[3];
+    uint32_t lanes[SHA256_LANES];
+
+    // First block is the same for every nonce
+    memcpy(mid, H0, sizeof(H0));
+    sha256_transform(mid, header);
+    for (int i = 0; i < 3; i++) {
+        tail[i] = V_DUP(load_be32(header + 64 + i * 4));
+    }
+
+    for (int n = 0; n < count; n += SHA256_LANES) {
+        v4u s[8], w[16];
+
+        // Second block: header tail, nonce (stored little-endian), padding for 80 bytes
+        for (int l = 0; l < SHA256_LANES; l++) {
+            lanes[l] = __builtin_bswap32(nonces[n + l < count ? n + l : n]);
+        }
+        w[0] = tail[0];
+        w[1] = tail[1];
+        w[2] = tail[2];
+        w[3] = V_LOAD(lanes);
+        w[4] = V_DUP(0x80000000);
+        for (int i = 5; i < 15; i++) w[i] = V_DUP(0);
+        w[15] = V_DUP(80 * 8);
+        for (int i = 0; i < 8; i++) s[i] = V_DUP(mid[i]);
+        compress4(s, w);
+
+        // Second hash: the 32-byte digest in one padded block
+        for (int i = 0; i < 8; i++) w[i] = s[i];
+        w[8] = V_DUP(0x80000000);
+        for (int i = 9; i < 15; i++) w[i] = V_DUP(0);
+        w[15] = V_DUP(32 * 8);
+        for (int i = 0; i < 8; i++) s[i] = V_DUP(H0[i]);
+        compress4(s, w);
+
+        for (int i = 0; i < 8; i++) {
+            V_STORE(lanes, s[i]);
+            for (int l = 0; l < SHA256_LANES && n + l < count; l++) {
+                store_be32(hashes[n + l] + i * 4, lanes[l]);
+            }
+        }
+    }
+}
+
+int sha256d_check_nonces(const uint8_t header[80], const uint32_t *nonces, int count,
+                         int min_zero_bits, bool *valid) {
+    uint8_t hashes[SHA256_LANES * 16][32];
+    int good = 0;
+
+    for (int n = 0; n < count; n += SHA256_LANES * 16) {
+        int batch = count - n < SHA256_LANES * 16 ? count - n : SHA256_LANES * 16;
+        sha256d_nonces(header, nonces + n, batch, hashes);
+        for (int i = 0; i < batch; i++) {
+            valid[n + i] = sha256_hash_zero_bits(hashes[i]) >= min_zero_bits;
+            good += valid[n + i];
+        }
+    }
+    return good;
+}
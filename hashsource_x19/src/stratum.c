@@ -0,0 +1,1086 @@
+/*
+ * Stratum v1 Client - asynchronous pool connection for hashsource_miner
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../include/stratum.h"
+#include "../include/sha256.h"
+
+// Request kinds (pending table)
+enum {
+    REQ_CONFIGURE = 1,
+    REQ_SUBSCRIBE,
+    REQ_EXTRANONCE_SUBSCRIBE,
+    REQ_AUTHORIZE,
+    REQ_SUBMIT
+};
+
+#define STRATUM_MAX_TOKENS  256
+
+static uint64_t stratum_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//==============================================================================
+// Minimal JSON tokenizer (jsmn-style: tokens index into the line buffer)
+//==============================================================================
+
+typedef enum {
+    JSON_PRIMITIVE = 0,     // number, true, false, null
+    JSON_OBJECT,
+    JSON_ARRAY,
+    JSON_STRING
+} json_type_t;
+
+typedef struct {
+    json_type_t type;
+    int start;
+    int end;
+    int size;               // Children (object: keys)
+    int parent;
+} json_tok_t;
+
+/**
+ * Tokenize one JSON document; string contents are not unescaped (stratum
+ * strings are hex, ids and method names)
+ *
+ * Returns the number of tokens, -1 on malformed input or overflow
+ */
+static int json_parse(const char *js, int len, json_tok_t *toks, int max_toks) {
+    int n = 0;
+    int parent = -1;
+
+    for (int pos = 0; pos < len; pos++) {
+        char ch = js[pos];
+        switch (ch) {
+        case '{':
+        case '[':
+            if (n >= max_toks) return -1;
+            if (parent >= 0) toks[parent].size++;
+            toks[n] = (json_tok_t){ ch == '{' ? JSON_OBJECT : JSON_ARRAY, pos, -1, 0, parent };
+            parent = n++;
+            break;
+
+        case '}':
+        case ']': {
+            json_type_t type = ch == '}' ? JSON_OBJECT : JSON_ARRAY;
+            // Close the innermost open container (skipping a pending key string)
+            while (parent >= 0 && (toks[parent].type != type || toks[parent].end != -1)) {
+                if (toks[parent].type == JSON_OBJECT || toks[parent].type == JSON_ARRAY) {
+                    return -1;
+                }
+                parent = toks[parent].parent;
+            }
+            if (parent < 0) return -1;
+            toks[parent].end = pos + 1;
+            parent = toks[parent].parent;
+            break;
+        }
+
+        case '"': {
+            int start = ++pos;
+            while (pos < len && js[pos] != '"') {
+                if (js[pos] == '\\' && pos + 1 < len) pos++;
+                pos++;
+            }
+            if (pos >= len || n >= max_toks) return -1;
+            if (parent >= 0) toks[parent].size++;
+            toks[n] = (json_tok_t){ JSON_STRING, start, pos, 0, parent };
+            // A key string becomes the parent of its value
+            if (parent >= 0 && toks[parent].type == JSON_OBJECT) {
+                toks[parent].size--;    // Count keys, not keys + values
+                int key = n;
+                int look = pos + 1;
+                while (look < len && (js[look] == ' ' || js[look] == '\t')) look++;
+                if (look < len && js[look] == ':') {
+                    toks[parent].size++;
+                    n++;
+                    parent = key;
+                    pos = look;
+                    break;
+                }
+            }
+            n++;
+            if (parent >= 0 && toks[parent].type == JSON_STRING) {
+                parent = toks[parent].parent;
+            }
+            break;
+        }
+
+        case ' ': case '\t': case '\r': case '\n': case ':':
+            break;
+
+        case ',':
+            if (parent >= 0 && toks[parent].type == JSON_STRING) {
+                parent = toks[parent].parent;
+            }
+            break;
+
+        default: {
+            int start = pos;
+            while (pos < len && js[pos] != ',' && js[pos] != ']' && js[pos] != '}' &&
+                   js[pos] != ' ' && js[pos] != '\r' && js[pos] != '\n') {
+                pos++;
+            }
+            if (n >= max_toks) return -1;
+            if (parent >= 0) toks[parent].size++;
+            toks[n++] = (json_tok_t){ JSON_PRIMITIVE, start, pos, 0, parent };
+            if (parent >= 0 && toks[parent].type == JSON_STRING) {
+                parent = toks[parent].parent;
+            }
+            pos--;
+            break;
+        }
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if ((toks[i].type == JSON_OBJECT || toks[i].type == JSON_ARRAY) && toks[i].end < 0) {
+            return -1;
+        }
+    }
+    return n;
+}
+
+// Index of the token after tok and everything nested in it
+static int json_skip(const json_tok_t *toks, int ntoks, int tok) {
+    int end = toks[tok].end;
+    int i = tok + 1;
+    while (i < ntoks && toks[i].start < end) i++;
+    return i;
+}
+
+static bool json_eq(const char *js, const json_tok_t *t, const char *s) {
+    int len = t->end - t->start;
+    return t->type == JSON_STRING && (int)strlen(s) == len && strncmp(js + t->start, s, len) == 0;
+}
+
+// Value token of key in object obj, or -1
+static int json_get(const char *js, const json_tok_t *toks, int ntoks, int obj, const char *key) {
+    if (obj < 0 || toks[obj].type != JSON_OBJECT) return -1;
+    for (int i = obj + 1; i < ntoks && toks[i].start < toks[obj].end; ) {
+        if (toks[i].parent == obj && json_eq(js, &toks[i], key)) {
+            return i + 1 < ntoks ? i + 1 : -1;
+        }
+        i = toks[i].parent == obj ? json_skip(toks, ntoks, i + 1) : i + 1;
+    }
+    return -1;
+}
+
+// Element n of array arr, or -1
+static int json_at(const json_tok_t *toks, int ntoks, int arr, int n) {
+    if (arr < 0 || toks[arr].type != JSON_ARRAY || n >= toks[arr].size) return -1;
+    int i = arr + 1;
+    for (int k = 0; k < n && i < ntoks; k++) {
+        i = json_skip(toks, ntoks, i);
+    }
+    return i < ntoks ? i : -1;
+}
+
+static bool json_is_null(const char *js, const json_tok_t *toks, int tok) {
+    return tok < 0 || (toks[tok].type == JSON_PRIMITIVE && js[toks[tok].start] == 'n');
+}
+
+static bool json_is_true(const char *js, const json_tok_t *toks, int tok) {
+    return tok >= 0 && toks[tok].type == JSON_PRIMITIVE && js[toks[tok].start] == 't';
+}
+
+static int json_str(const char *js, const json_tok_t *toks, int tok, char *buf, size_t size) {
+    if (tok < 0 || toks[tok].type != JSON_STRING) return -1;
+    size_t len = toks[tok].end - toks[tok].start;
+    if (len >= size) return -1;
+    memcpy(buf, js + toks[tok].start, len);
+    buf[len] = '\0';
+    return (int)len;
+}
+
+static double json_num(const char *js, const json_tok_t *toks, int tok) {
+    if (tok < 0) return 0;
+    return strtod(js + toks[tok].start, NULL);
+}
+
+//==============================================================================
+// Hex helpers
+//==============================================================================
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode a hex string token; returns byte count or -1
+static int json_hex(const char *js, const json_tok_t *toks, int tok, uint8_t *out, size_t max) {
+    if (tok < 0 || toks[tok].type != JSON_STRING) return -1;
+    int len = toks[tok].end - toks[tok].start;
+    if (len % 2 || (size_t)len / 2 > max) return -1;
+
+    const char *p = js + toks[tok].start;
+    for (int i = 0; i < len / 2; i++) {
+        int hi = hex_nibble(p[i * 2]), lo = hex_nibble(p[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return -1;
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return len / 2;
+}
+
+// Big-endian hex word ("20000000") as sent for version/nbits/ntime
+static int json_hex32(const char *js, const json_tok_t *toks, int tok, uint32_t *value) {
+    uint8_t b[4];
+    if (json_hex(js, toks, tok, b, sizeof(b)) != 4) return -1;
+    *value = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+    return 0;
+}
+
+static void bin2hex(char *out, const uint8_t *in, int len) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < len; i++) {
+        out[i * 2] = digits[in[i] >> 4];
+        out[i * 2 + 1] = digits[in[i] & 0xF];
+    }
+    out[len * 2] = '\0';
+}
+
+//==============================================================================
+// Work construction
+//==============================================================================
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+void stratum_build_header(const stratum_job_t *job, const uint8_t *extranonce2,
+                          uint8_t header[80]) {
+    uint8_t coinbase[2 * STRATUM_MAX_COINBASE + 2 * STRATUM_MAX_EXTRANONCE];
+    uint8_t node[64];
+    size_t len = 0;
+
+    memcpy(coinbase, job->coinb1, job->coinb1_len);
+    len += job->coinb1_len;
+    memcpy(coinbase + len, job->extranonce1, job->extranonce1_len);
+    len += job->extranonce1_len;
+    memcpy(coinbase + len, extranonce2, job->extranonce2_size);
+    len += job->extranonce2_size;
+    memcpy(coinbase + len, job->coinb2, job->coinb2_len);
+    len += job->coinb2_len;
+
+    // Merkle root: coinbase hash folded with each branch on the right
+    sha256d(coinbase, len, node);
+    for (int i = 0; i < job->num_merkle; i++) {
+        memcpy(node + 32, job->merkle[i], 32);
+        sha256d(node, 64, node);
+    }
+
+    put_le32(header, job->version);
+    memcpy(header + 4, job->prevhash, 32);
+    memcpy(header + 36, node, 32);
+    put_le32(header + 68, job->ntime);
+    put_le32(header + 72, job->nbits);
+    put_le32(header + 76, 0);
+}
+
+void stratum_header_to_work(const uint8_t header[80], uint8_t work_data[12],
+                            uint8_t midstate[32]) {
+    memcpy(work_data, header + 64, 12);
+    sha256_midstate(header, midstate);
+}
+
+// Spread value over the set bits of mask, lowest first; false if it doesn't fit
+static bool deposit_bits(uint32_t value, uint32_t mask, uint32_t *out) {
+    uint32_t result = 0;
+    for (uint32_t bit = 1; bit && value; bit <<= 1) {
+        if (mask & bit) {
+            if (value & 1) result |= bit;
+            value >>= 1;
+        }
+    }
+    *out = result;
+    return value == 0;
+}
+
+int stratum_template_init(stratum_template_t *t, const stratum_job_t *job) {
+    size_t prefix_len = job->coinb1_len + job->extranonce1_len;
+    size_t coinbase_len = prefix_len + job->extranonce2_size + job->coinb2_len;
+    size_t whole = prefix_len & ~(size_t)63;
+
+    memset(t, 0, sizeof(*t));
+    t->job = job;
+    t->midstates = __builtin_popcount(job->version_mask) >= 2 ? STRATUM_MIDSTATES : 1;
+
+    // Hash every complete block before extranonce2 once
+    uint8_t prefix[2 * STRATUM_MAX_COINBASE];
+    memcpy(prefix, job->coinb1, job->coinb1_len);
+    memcpy(prefix + job->coinb1_len, job->extranonce1, job->extranonce1_len);
+    sha256_ctx_t ctx;
+    sha256_init(&ctx);
+    for (size_t off = 0; off < whole; off += 64) {
+        sha256_transform(ctx.state, prefix + off);
+    }
+    memcpy(t->prefix_state, ctx.state, sizeof(t->prefix_state));
+
+    // Tail: prefix remainder | extranonce2 | coinb2 | SHA padding, as blocks
+    size_t len = prefix_len - whole;
+    memcpy(t->tail, prefix + whole, len);
+    t->extranonce2_offset = (int)len;
+    len += job->extranonce2_size;
+    memcpy(t->tail + len, job->coinb2, job->coinb2_len);
+    len += job->coinb2_len;
+    t->tail[len++] = 0x80;
+    while (len % 64 != 56) {
+        t->tail[len++] = 0;
+    }
+    uint64_t bits = (uint64_t)coinbase_len * 8;
+    for (int i = 7; i >= 0; i--) {
+        t->tail[len++] = (uint8_t)(bits >> (i * 8));
+    }
+    t->tail_len = (int)len;
+
+    put_le32(t->header, job->version);
+    memcpy(t->header + 4, job->prevhash, 32);
+    put_le32(t->header + 68, job->ntime);
+    put_le32(t->header + 72, job->nbits);
+    return 0;
+}
+
+void stratum_template_set_extranonce2(stratum_template_t *t, const uint8_t *extranonce2) {
+    const stratum_job_t *job = t->job;
+    uint32_t state[8];
+    uint8_t node[64];
+
+    // Coinbase: only the tail blocks are hashed per extranonce2
+    memcpy(t->extranonce2, extranonce2, job->extranonce2_size);
+    memcpy(t->tail + t->extranonce2_offset, extranonce2, job->extranonce2_size);
+    memcpy(state, t->prefix_state, sizeof(state));
+    for (int off = 0; off < t->tail_len; off += 64) {
+        sha256_transform(state, t->tail + off);
+    }
+    for (int i = 0; i < 8; i++) {
+        node[i * 4] = state[i] >> 24;
+        node[i * 4 + 1] = state[i] >> 16;
+        node[i * 4 + 2] = state[i] >> 8;
+        node[i * 4 + 3] = state[i];
+    }
+    sha256(node, 32, node);
+
+    // Merkle branch: one 64-byte double hash per level
+    for (int i = 0; i < job->num_merkle; i++) {
+        memcpy(node + 32, job->merkle[i], 32);
+        sha256d_64(node, node);
+    }
+    memcpy(t->header + 36, node, 32);
+}
+
+int stratum_template_work(const stratum_template_t *t, uint32_t roll,
+                          uint8_t work_data[12], uint8_t midstates[STRATUM_MIDSTATES][32],
+                          uint32_t versions[STRATUM_MIDSTATES]) {
+    const stratum_job_t *job = t->job;
+
+    // Versions first: nothing to hash if the mask is used up
+    if (t->midstates == 1) {
+        if (roll > 0) {
+            return -1;
+        }
+        for (int i = 0; i < STRATUM_MIDSTATES; i++) {
+            versions[i] = job->version;
+        }
+        memcpy(work_data, t->header + 64, 12);
+        sha256_midstate(t->header, midstates[0]);
+        return 1;
+    }
+
+    uint8_t blocks[STRATUM_MIDSTATES][64];
+    const uint8_t *lanes[STRATUM_MIDSTATES];
+    for (int i = 0; i < STRATUM_MIDSTATES; i++) {
+        uint32_t bits;
+        if (!deposit_bits(roll * STRATUM_MIDSTATES + i, job->version_mask, &bits)) {
+            return -1;
+        }
+        versions[i] = (job->version & ~job->version_mask) | bits;
+        memcpy(blocks[i], t->header, 64);
+        put_le32(blocks[i], versions[i]);
+        lanes[i] = blocks[i];
+    }
+
+    // Same merkle root for all four; only the first header block differs
+    memcpy(work_data, t->header + 64, 12);
+    sha256_midstate4(lanes, midstates);
+    return STRATUM_MIDSTATES;
+}
+
+//==============================================================================
+// Send path
+//==============================================================================
+
+static void wake_client(stratum_client_t *c) {
+    uint64_t one = 1;
+    if (write(c->wake_fd, &one, sizeof(one)) < 0) {
+        // Counter saturated: the loop is already due to wake
+    }
+}
+
+// Append a request; caller holds c->lock. Returns id, or -1 if no room.
+static int queue_request(stratum_client_t *c, int kind, const char *method, const char *params) {
+    uint32_t id = c->next_id++;
+    int len = snprintf(c->tx + c->tx_len, sizeof(c->tx) - c->tx_len,
+                       "{\"id\":%u,\"method\":\"%s\",\"params\":%s}\n", id, method, params);
+    if (len < 0 || (size_t)len >= sizeof(c->tx) - c->tx_len ||
+        c->num_pending >= STRATUM_MAX_PENDING) {
+        c->tx[c->tx_len] = '\0';
+        return -1;
+    }
+    c->tx_len += len;
+    c->pending[c->num_pending++] = (stratum_pending_t){ id, kind, stratum_now_ns() };
+    return (int)id;
+}
+
+// Write as much of the send buffer as the socket takes (client thread)
+static int flush_tx(stratum_client_t *c) {
+    pthread_mutex_lock(&c->lock);
+    while (c->tx_len > 0) {
+        ssize_t n = send(c->fd, c->tx, c->tx_len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            pthread_mutex_unlock(&c->lock);
+            return -1;
+        }
+        memmove(c->tx, c->tx + n, c->tx_len - n);
+        c->tx_len -= n;
+    }
+    bool pending = c->tx_len > 0;
+    pthread_mutex_unlock(&c->lock);
+
+    if (pending != c->want_write) {
+        struct epoll_event ev = { .events = EPOLLIN | (pending ? EPOLLOUT : 0), .data.fd = c->fd };
+        epoll_ctl(c->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->want_write = pending;
+    }
+    return 0;
+}
+
+int stratum_submit(stratum_client_t *c, const char *job_id, const uint8_t *extranonce2,
+                   int extranonce2_len, uint32_t ntime, uint32_t nonce, uint32_t version) {
+    char en2[2 * STRATUM_MAX_EXTRANONCE + 1];
+    char params[512];
+
+    if (extranonce2_len > STRATUM_MAX_EXTRANONCE) {
+        return -1;
+    }
+    bin2hex(en2, extranonce2, extranonce2_len);
+
+    pthread_mutex_lock(&c->lock);
+    int len = snprintf(params, sizeof(params), "[\"%s\",\"%s\",\"%s\",\"%08x\",\"%08x\"",
+                       c->user, job_id, en2, ntime, nonce);
+    if (c->version_mask) {
+        snprintf(params + len, sizeof(params) - len, ",\"%08x\"", version & c->version_mask);
+    }
+    strncat(params, "]", sizeof(params) - strlen(params) - 1);
+
+    int id = -1;
+    if (c->state == STRATUM_READY) {
+        id = queue_request(c, REQ_SUBMIT, "mining.submit", params);
+        if (id >= 0) c->stats.submits++;
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    if (id >= 0) {
+        wake_client(c);
+    }
+    return id;
+}
+
+//==============================================================================
+// Message handling (client thread)
+//==============================================================================
+
+static void handle_notify(stratum_client_t *c, const char *js, const json_tok_t *toks,
+                          int ntoks, int params) {
+    stratum_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    int merkle = json_at(toks, ntoks, params, 4);
+    int len;
+    if (json_str(js, toks, json_at(toks, ntoks, params, 0), job.job_id, sizeof(job.job_id)) < 0 ||
+        json_hex(js, toks, json_at(toks, ntoks, params, 1), job.prevhash, 32) != 32 ||
+        (len = json_hex(js, toks, json_at(toks, ntoks, params, 2), job.coinb1,
+                        sizeof(job.coinb1))) < 0) {
+        fprintf(stderr, "Stratum: malformed mining.notify\n");
+        return;
+    }
+    job.coinb1_len = len;
+    if ((len = json_hex(js, toks, json_at(toks, ntoks, params, 3), job.coinb2,
+                        sizeof(job.coinb2))) < 0 ||
+        merkle < 0 || toks[merkle].type != JSON_ARRAY || toks[merkle].size > STRATUM_MAX_MERKLE ||
+        json_hex32(js, toks, json_at(toks, ntoks, params, 5), &job.version) < 0 ||
+        json_hex32(js, toks, json_at(toks, ntoks, params, 6), &job.nbits) < 0 ||
+        json_hex32(js, toks, json_at(toks, ntoks, params, 7), &job.ntime) < 0) {
+        fprintf(stderr, "Stratum: malformed mining.notify\n");
+        return;
+    }
+    job.coinb2_len = len;
+    job.num_merkle = toks[merkle].size;
+    for (int i = 0; i < job.num_merkle; i++) {
+        if (json_hex(js, toks, json_at(toks, ntoks, merkle, i), job.merkle[i], 32) != 32) {
+            fprintf(stderr, "Stratum: malformed merkle branch\n");
+            return;
+        }
+    }
+    job.clean = json_is_true(js, toks, json_at(toks, ntoks, params, 8));
+
+    // Stratum sends prevhash as 8 words in reversed byte order
+    for (int i = 0; i < 8; i++) {
+        uint8_t *w = job.prevhash + i * 4;
+        uint8_t t = w[0]; w[0] = w[3]; w[3] = t;
+        t = w[1]; w[1] = w[2]; w[2] = t;
+    }
+
+    job.received_ns = stratum_now_ns();
+
+    pthread_mutex_lock(&c->lock);
+    memcpy(job.extranonce1, c->extranonce1, c->extranonce1_len);
+    job.extranonce1_len = c->extranonce1_len;
+    job.extranonce2_size = c->extranonce2_size;
+    job.difficulty = c->difficulty;
+    job.version_mask = c->version_mask;
+    job.seq = c->job.seq + 1;
+    c->job = job;
+    c->has_job = true;
+    c->stats.notifies++;
+    if (job.clean) c->stats.clean_jobs++;
+    pthread_cond_broadcast(&c->job_cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static void handle_method(stratum_client_t *c, const char *js, const json_tok_t *toks,
+                          int ntoks, int method, int params) {
+    if (json_eq(js, &toks[method], "mining.notify")) {
+        handle_notify(c, js, toks, ntoks, params);
+    } else if (json_eq(js, &toks[method], "mining.set_difficulty")) {
+        double diff = json_num(js, toks, json_at(toks, ntoks, params, 0));
+        pthread_mutex_lock(&c->lock);
+        if (diff > 0) c->difficulty = diff;
+        pthread_mutex_unlock(&c->lock);
+        printf("Stratum: difficulty %g\n", diff);
+    } else if (json_eq(js, &toks[method], "mining.set_version_mask")) {
+        // Applies from the next notify; shares of older jobs keep their bits
+        uint32_t mask;
+        if (json_hex32(js, toks, json_at(toks, ntoks, params, 0), &mask) == 0) {
+            pthread_mutex_lock(&c->lock);
+            c->version_mask = mask & c->version_mask_request;
+            pthread_mutex_unlock(&c->lock);
+            printf("Stratum: version mask 0x%08x\n", mask & c->version_mask_request);
+        }
+    } else if (json_eq(js, &toks[method], "mining.set_extranonce")) {
+        uint8_t en1[STRATUM_MAX_EXTRANONCE];
+        int len = json_hex(js, toks, json_at(toks, ntoks, params, 0), en1, sizeof(en1));
+        int en2_size = (int)json_num(js, toks, json_at(toks, ntoks, params, 1));
+        if (len >= 0 && en2_size > 0 && en2_size <= STRATUM_MAX_EXTRANONCE) {
+            pthread_mutex_lock(&c->lock);
+            memcpy(c->extranonce1, en1, len);
+            c->extranonce1_len = len;
+            c->extranonce2_size = en2_size;
+            pthread_mutex_unlock(&c->lock);
+            printf("Stratum: extranonce1 changed (%d bytes), extranonce2 %d bytes\n", len, en2_size);
+        }
+    }
+}
+
+static void handle_response(stratum_client_t *c, const char *js, const json_tok_t *toks,
+                            int ntoks, uint32_t id, int result, int error) {
+    uint64_t now = stratum_now_ns();
+    stratum_pending_t req = {0};
+
+    pthread_mutex_lock(&c->lock);
+    for (int i = 0; i < c->num_pending; i++) {
+        if (c->pending[i].id == id) {
+            req = c->pending[i];
+            c->pending[i] = c->pending[--c->num_pending];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    bool ok = json_is_null(js, toks, error) && !json_is_null(js, toks, result);
+
+    switch (req.kind) {
+    case REQ_CONFIGURE: {
+        // {"version-rolling": true, "version-rolling.mask": "1fffe000"}
+        uint32_t mask = 0;
+        if (ok && json_is_true(js, toks, json_get(js, toks, ntoks, result, "version-rolling"))) {
+            json_hex32(js, toks, json_get(js, toks, ntoks, result, "version-rolling.mask"), &mask);
+        }
+        mask &= c->version_mask_request;
+        pthread_mutex_lock(&c->lock);
+        c->version_mask = mask;
+        pthread_mutex_unlock(&c->lock);
+        if (mask) {
+            printf("Stratum: version rolling, mask 0x%08x\n", mask);
+        } else {
+            printf("Stratum: pool does not support version rolling\n");
+        }
+        break;
+    }
+
+    case REQ_SUBSCRIBE: {
+        // [[subscriptions...], extranonce1, extranonce2_size]
+        uint8_t en1[STRATUM_MAX_EXTRANONCE];
+        int len = json_hex(js, toks, json_at(toks, ntoks, result, 1), en1, sizeof(en1));
+        int en2_size = (int)json_num(js, toks, json_at(toks, ntoks, result, 2));
+        if (!ok || len < 0 || en2_size <= 0 || en2_size > STRATUM_MAX_EXTRANONCE) {
+            fprintf(stderr, "Stratum: subscribe failed\n");
+            c->state = STRATUM_DISCONNECTED;
+            return;
+        }
+        pthread_mutex_lock(&c->lock);
+        memcpy(c->extranonce1, en1, len);
+        c->extranonce1_len = len;
+        c->extranonce2_size = en2_size;
+        pthread_mutex_unlock(&c->lock);
+        c->state = STRATUM_AUTHORIZING;
+        printf("Stratum: subscribed, extranonce1 %d bytes, extranonce2 %d bytes\n", len, en2_size);
+        break;
+    }
+
+    case REQ_EXTRANONCE_SUBSCRIBE:
+        // Optional extension; many pools answer with an error
+        break;
+
+    case REQ_AUTHORIZE:
+        if (!ok || !json_is_true(js, toks, result)) {
+            fprintf(stderr, "Stratum: worker %s not authorized\n", c->user);
+            c->state = STRATUM_DISCONNECTED;
+            return;
+        }
+        c->state = STRATUM_READY;
+        c->reconnect_ms = STRATUM_RECONNECT_MIN_MS;
+        printf("Stratum: authorized as %s\n", c->user);
+        break;
+
+    case REQ_SUBMIT: {
+        uint64_t rtt = now - req.sent_ns;
+        pthread_mutex_lock(&c->lock);
+        if (ok && json_is_true(js, toks, result)) {
+            c->stats.accepted++;
+        } else {
+            c->stats.rejected++;
+        }
+        c->stats.rtt_ns_total += rtt;
+        if (rtt > c->stats.rtt_ns_max) c->stats.rtt_ns_max = rtt;
+        if (c->stats.rtt_ns_min == 0 || rtt < c->stats.rtt_ns_min) c->stats.rtt_ns_min = rtt;
+        pthread_mutex_unlock(&c->lock);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+static void handle_line(stratum_client_t *c, const char *line, int len) {
+    json_tok_t toks[STRATUM_MAX_TOKENS];
+    int ntoks = json_parse(line, len, toks, STRATUM_MAX_TOKENS);
+
+    if (ntoks <= 0 || toks[0].type != JSON_OBJECT) {
+        fprintf(stderr, "Stratum: unparsable message (%d bytes)\n", len);
+        return;
+    }
+
+    int method = json_get(line, toks, ntoks, 0, "method");
+    if (method >= 0 && toks[method].type == JSON_STRING) {
+        handle_method(c, line, toks, ntoks, method, json_get(line, toks, ntoks, 0, "params"));
+        return;
+    }
+
+    int id = json_get(line, toks, ntoks, 0, "id");
+    if (!json_is_null(line, toks, id)) {
+        handle_response(c, line, toks, ntoks, (uint32_t)json_num(line, toks, id),
+                        json_get(line, toks, ntoks, 0, "result"),
+                        json_get(line, toks, ntoks, 0, "error"));
+    }
+}
+
+// Read everything available and dispatch complete lines
+static int read_socket(stratum_client_t *c) {
+    for (;;) {
+        if (c->rx_len == sizeof(c->rx)) {
+            fprintf(stderr, "Stratum: line exceeds %d bytes\n", STRATUM_RX_BUF);
+            return -1;
+        }
+        ssize_t n = recv(c->fd, c->rx + c->rx_len, sizeof(c->rx) - c->rx_len, 0);
+        if (n == 0) {
+            return -1;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        c->rx_len += n;
+
+        size_t start = 0;
+        for (size_t i = c->rx_len - n; i < c->rx_len; i++) {
+            if (c->rx[i] == '\n') {
+                if (i > start) handle_line(c, c->rx + start, (int)(i - start));
+                start = i + 1;
+                if (c->state == STRATUM_DISCONNECTED) return -1;
+            }
+        }
+        memmove(c->rx, c->rx + start, c->rx_len - start);
+        c->rx_len -= start;
+    }
+    return 0;
+}
+
+//==============================================================================
+// Connection management (client thread)
+//==============================================================================
+
+static void disconnect(stratum_client_t *c) {
+    if (c->fd >= 0) {
+        epoll_ctl(c->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        c->fd = -1;
+        c->stats.disconnects++;
+    }
+
+    pthread_mutex_lock(&c->lock);
+    c->tx_len = 0;
+    c->num_pending = 0;
+    c->has_job = false;     // Jobs are per session
+    c->version_mask = 0;    // Renegotiated by mining.configure
+    pthread_mutex_unlock(&c->lock);
+
+    c->rx_len = 0;
+    c->want_write = false;
+    c->state = STRATUM_DISCONNECTED;
+    c->reconnect_at_ns = stratum_now_ns() + (uint64_t)c->reconnect_ms * 1000000ULL;
+    if (c->reconnect_ms < STRATUM_RECONNECT_MAX_MS) {
+        c->reconnect_ms *= 2;
+    }
+}
+
+static int start_connect(stratum_client_t *c) {
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res;
+
+    int err = getaddrinfo(c->host, c->port, &hints, &res);
+    if (err != 0) {
+        fprintf(stderr, "Stratum: cannot resolve %s: %s\n", c->host, gai_strerror(err));
+        return -1;
+    }
+
+    int fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        freeaddrinfo(res);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(fd, res->ai_addr, res->ai_addrlen) < 0 && errno != EINPROGRESS) {
+        fprintf(stderr, "Stratum: connect to %s:%s failed: %s\n", c->host, c->port, strerror(errno));
+        close(fd);
+        freeaddrinfo(res);
+        return -1;
+    }
+    freeaddrinfo(res);
+
+    c->fd = fd;
+    c->state = STRATUM_CONNECTING;
+    c->want_write = true;
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT, .data.fd = fd };
+    epoll_ctl(c->epfd, EPOLL_CTL_ADD, fd, &ev);
+    return 0;
+}
+
+// Connected: pipeline subscribe, extranonce.subscribe and authorize
+static void start_session(stratum_client_t *c) {
+    char params[512];
+
+    c->stats.connects++;
+    c->state = STRATUM_SUBSCRIBING;
+    printf("Stratum: connected to %s:%s\n", c->host, c->port);
+
+    pthread_mutex_lock(&c->lock);
+    if (c->version_mask_request) {
+        snprintf(params, sizeof(params),
+                 "[[\"version-rolling\"],{\"version-rolling.mask\":\"%08x\","
+                 "\"version-rolling.min-bit-count\":2}]", c->version_mask_request);
+        queue_request(c, REQ_CONFIGURE, "mining.configure", params);
+    }
+    snprintf(params, sizeof(params), "[\"%s\"]", c->agent);
+    queue_request(c, REQ_SUBSCRIBE, "mining.subscribe", params);
+    queue_request(c, REQ_EXTRANONCE_SUBSCRIBE, "mining.extranonce.subscribe", "[]");
+    snprintf(params, sizeof(params), "[\"%s\",\"%s\"]", c->user, c->pass);
+    queue_request(c, REQ_AUTHORIZE, "mining.authorize", params);
+    pthread_mutex_unlock(&c->lock);
+}
+
+// Responses that never came: count submit timeouts, drop the session otherwise
+static bool expire_pending(stratum_client_t *c) {
+    uint64_t now = stratum_now_ns();
+    bool session_lost = false;
+
+    pthread_mutex_lock(&c->lock);
+    for (int i = 0; i < c->num_pending; ) {
+        if (now - c->pending[i].sent_ns < STRATUM_RESPONSE_TIMEOUT_MS * 1000000ULL) {
+            i++;
+            continue;
+        }
+        if (c->pending[i].kind == REQ_SUBMIT) {
+            c->stats.timeouts++;
+        } else if (c->pending[i].kind != REQ_EXTRANONCE_SUBSCRIBE &&
+                   c->pending[i].kind != REQ_CONFIGURE) {
+            session_lost = true;
+        }
+        c->pending[i] = c->pending[--c->num_pending];
+    }
+    pthread_mutex_unlock(&c->lock);
+    return session_lost;
+}
+
+static void *stratum_thread(void *arg) {
+    stratum_client_t *c = arg;
+    struct epoll_event events[4];
+
+    while (c->running) {
+        if (c->fd < 0 && stratum_now_ns() >= c->reconnect_at_ns) {
+            if (start_connect(c) < 0) {
+                disconnect(c);
+            }
+        }
+
+        int n = epoll_wait(c->epfd, events, 4, 1000);
+        if (n < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == c->wake_fd) {
+                uint64_t count;
+                if (read(c->wake_fd, &count, sizeof(count)) < 0) {
+                    // Nothing pending
+                }
+                if (c->fd >= 0 && c->state != STRATUM_CONNECTING && flush_tx(c) < 0) {
+                    disconnect(c);
+                }
+                continue;
+            }
+            if (events[i].data.fd != c->fd) {
+                continue;
+            }
+
+            if (c->state == STRATUM_CONNECTING) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    fprintf(stderr, "Stratum: connect to %s:%s failed: %s\n",
+                            c->host, c->port, strerror(err));
+                    disconnect(c);
+                    continue;
+                }
+                start_session(c);
+            }
+
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && read_socket(c) < 0) {
+                if (c->state != STRATUM_DISCONNECTED) {
+                    fprintf(stderr, "Stratum: connection to %s:%s closed\n", c->host, c->port);
+                }
+                disconnect(c);
+                continue;
+            }
+            if (c->fd >= 0 && flush_tx(c) < 0) {
+                disconnect(c);
+            }
+        }
+
+        if (c->fd >= 0 && expire_pending(c)) {
+            fprintf(stderr, "Stratum: pool stopped responding\n");
+            disconnect(c);
+        }
+    }
+
+    if (c->fd >= 0) {
+        disconnect(c);
+    }
+    return NULL;
+}
+
+//==============================================================================
+// Public API
+//==============================================================================
+
+int stratum_init(stratum_client_t *c, const char *url, const char *user, const char *pass) {
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    c->epfd = -1;
+    c->wake_fd = -1;
+
+    // [stratum+tcp://]host:port
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    const char *colon = strrchr(p, ':');
+    if (!colon || colon == p || (size_t)(colon - p) >= sizeof(c->host) ||
+        strlen(colon + 1) == 0 || strlen(colon + 1) >= sizeof(c->port)) {
+        fprintf(stderr, "Stratum: bad pool URL '%s' (expected host:port)\n", url);
+        return -1;
+    }
+    memcpy(c->host, p, colon - p);
+    snprintf(c->port, sizeof(c->port), "%s", colon + 1);
+    snprintf(c->user, sizeof(c->user), "%s", user ? user : "");
+    snprintf(c->pass, sizeof(c->pass), "%s", pass ? pass : "x");
+    snprintf(c->agent, sizeof(c->agent), "hashsource/0.1");
+
+    c->next_id = 1;
+    c->difficulty = 1.0;
+    c->reconnect_ms = STRATUM_RECONNECT_MIN_MS;
+    pthread_mutex_init(&c->lock, NULL);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&c->job_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return 0;
+}
+
+void stratum_set_version_rolling(stratum_client_t *c, uint32_t mask) {
+    c->version_mask_request = mask;
+}
+
+int stratum_start(stratum_client_t *c) {
+    c->epfd = epoll_create1(EPOLL_CLOEXEC);
+    c->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (c->epfd < 0 || c->wake_fd < 0) {
+        fprintf(stderr, "Stratum: cannot create event loop: %s\n", strerror(errno));
+        stratum_stop(c);
+        return -1;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = c->wake_fd };
+    epoll_ctl(c->epfd, EPOLL_CTL_ADD, c->wake_fd, &ev);
+
+    c->running = true;
+    if (pthread_create(&c->thread, NULL, stratum_thread, c) != 0) {
+        c->running = false;
+        stratum_stop(c);
+        return -1;
+    }
+    return 0;
+}
+
+void stratum_stop(stratum_client_t *c) {
+    if (c->running) {
+        c->running = false;
+        wake_client(c);
+        pthread_join(c->thread, NULL);
+    }
+    if (c->wake_fd >= 0) close(c->wake_fd);
+    if (c->epfd >= 0) close(c->epfd);
+    c->wake_fd = -1;
+    c->epfd = -1;
+
+    // Release anyone waiting for a job
+    pthread_mutex_lock(&c->lock);
+    pthread_cond_broadcast(&c->job_cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+bool stratum_wait_job(stratum_client_t *c, stratum_job_t *job, uint32_t *seq, int timeout_us) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += (long)timeout_us * 1000;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    pthread_mutex_lock(&c->lock);
+    while (!(c->has_job && c->job.seq != *seq) && c->running) {
+        if (pthread_cond_timedwait(&c->job_cond, &c->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    bool fresh = c->has_job && c->job.seq != *seq;
+    if (fresh) {
+        *job = c->job;
+        *seq = c->job.seq;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return fresh;
+}
+
+void stratum_note_first_work(stratum_client_t *c, const stratum_job_t *job) {
+    uint64_t latency = stratum_now_ns() - job->received_ns;
+
+    pthread_mutex_lock(&c->lock);
+    c->stats.first_work++;
+    c->stats.first_work_ns_total += latency;
+    if (latency > c->stats.first_work_ns_max) c->stats.first_work_ns_max = latency;
+    if (c->stats.first_work_ns_min == 0 || latency < c->stats.first_work_ns_min) {
+        c->stats.first_work_ns_min = latency;
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+void stratum_get_stats(stratum_client_t *c, stratum_stats_t *stats) {
+    pthread_mutex_lock(&c->lock);
+    *stats = c->stats;
+    pthread_mutex_unlock(&c->lock);
+}
+
+const char *stratum_state_name(stratum_state_t state) {
+    switch (state) {
+    case STRATUM_DISCONNECTED: return "disconnected";
+    case STRATUM_CONNECTING:   return "connecting";
+    case STRATUM_SUBSCRIBING:  return "subscribing";
+    case STRATUM_AUTHORIZING:  return "authorizing";
+    case STRATUM_READY:        return "ready";
+    }
+    return "unknown";
+}
+
+void stratum_print_stats(stratum_client_t *c) {
+    stratum_stats_t s;
+    stratum_get_stats(c, &s);
+
+    printf("Stratum %s:%s (%s): %llu notifies (%llu clean), %llu connects\n",
+           c->host, c->port, stratum_state_name(c->state),
+           (unsigned long long)s.notifies, (unsigned long long)s.clean_jobs,
+           (unsigned long long)s.connects);
+    if (c->version_mask) {
+        printf("  Version rolling: mask 0x%08x, %d midstates per work\n",
+               c->version_mask, STRATUM_MIDSTATES);
+    }
+    if (s.first_work) {
+        printf("  Notify -> first work: avg %.1f us, min %.1f us, max %.1f us (%llu jobs)\n",
+               s.first_work_ns_total / 1e3 / s.first_work, s.first_work_ns_min / 1e3,
+               s.first_work_ns_max / 1e3, (unsigned long long)s.first_work);
+    }
+    if (s.submits) {
+        uint64_t answered = s.accepted + s.rejected;
+        printf("  Shares: %llu submitted, %llu accepted, %llu rejected, %llu timed out\n",
+               (unsigned long long)s.submits, (unsigned long long)s.accepted,
+               (unsigned long long)s.rejected, (unsigned long long)s.timeouts);
+        if (answered) {
+            printf("  Submit RTT: avg %.2f ms, min %.2f ms, max %.2f ms\n",
+                   s.rtt_ns_total / 1e6 / answered, s.rtt_ns_min / 1e6, s.rtt_ns_max / 1e6);
+        }
+    }
+}
@@ -0,0 +1,350 @@
+/*
+ * Stratum Stand-in Pool - local Stratum v1 server for exercising the client
+ * - Answers configure (version rolling) / subscribe / extranonce.subscribe /
+ *   authorize / submit
+ * - Sends set_difficulty and a synthetic mining.notify on a fixed interval
+ * - Optional response delay to model a distant pool
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define MAX_CLIENTS     64
+#define MAX_DELAYED     4096
+#define RX_BUF_SIZE     8192
+#define VERSION_MASK    0x1FFFE000
+
+typedef struct {
+    int fd;
+    uint32_t extranonce1;
+    bool authorized;
+    uint32_t version_mask;      // Granted by mining.configure
+    char rx[RX_BUF_SIZE];
+    size_t rx_len;
+    uint64_t submits;
+    uint64_t rolled_submits;    // Carried version bits
+    uint64_t rejected;
+} pool_client_t;
+
+// Submit response held back to simulate latency
+typedef struct {
+    int fd;
+    uint64_t due_ns;
+    char line[128];
+} delayed_reply_t;
+
+static volatile int g_running = 1;
+static pool_client_t g_clients[MAX_CLIENTS];
+static delayed_reply_t g_delayed[MAX_DELAYED];
+static int g_num_delayed;
+static uint32_t g_job_id;
+static uint32_t g_next_extranonce1 = 0x10000000;
+static bool g_version_rolling = true;
+
+static void signal_handler(int signum) {
+    (void)signum;
+    g_running = 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static pool_client_t *find_client(int fd) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (g_clients[i].fd == fd) return &g_clients[i];
+    }
+    return NULL;
+}
+
+static void send_line(int fd, const char *line) {
+    size_t len = strlen(line);
+    // Lines are small; a full socket buffer just drops the client's backlog
+    if (send(fd, line, len, MSG_NOSIGNAL | MSG_DONTWAIT) != (ssize_t)len) {
+        fprintf(stderr, "Warning: short write to client fd %d\n", fd);
+    }
+}
+
+static void send_notify(int fd, int clean) {
+    char line[1024];
+    uint32_t id = g_job_id;
+    uint32_t ntime = (uint32_t)time(NULL);
+
+    // Synthetic job: prevhash and branches derived from the job id
+    snprintf(line, sizeof(line),
+             "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"%x\","
+             "\"%08x00000000000000000000000000000000000000000000000000000000\","
+             "\"01000000010000000000000000000000000000000000000000000000000000000000000000"
+             "ffffffff20%08x\","
+             "\"ffffffff0100f2052a010000001976a914000000000000000000000000000000000000000088ac00000000\","
+             "[\"%08x00000000000000000000000000000000000000000000000000000000\","
+             "\"%08x11111111111111111111111111111111111111111111111111111111\"],"
+             "\"20000000\",\"1703a30c\",\"%08x\",%s]}\n",
+             id, id, id, id, id, ntime, clean ? "true" : "false");
+    send_line(fd, line);
+}
+
+/**
+ * Version bits of a submit (optional 6th parameter); -1 if absent.
+ * Params are all strings, so the 6th is after the 11th quote.
+ */
+static int64_t submit_version_bits(const char *line) {
+    const char *p = strstr(line, "\"params\"");
+    int quotes = 0;
+
+    if (!p) return -1;
+    for (p += 8; *p && *p != ']'; p++) {
+        if (*p == '"' && ++quotes == 11) {
+            return (int64_t)strtoul(p + 1, NULL, 16);
+        }
+    }
+    return -1;
+}
+
+static void handle_request(pool_client_t *c, const char *line, int delay_ms) {
+    char reply[256];
+    char id[32] = "null";
+
+    // Request id is the first value; clients here always send numbers
+    const char *p = strstr(line, "\"id\":");
+    if (p) {
+        sscanf(p + 5, "%31[0-9]", id);
+    }
+
+    if (strstr(line, "\"mining.configure\"") && g_version_rolling) {
+        c->version_mask = VERSION_MASK;
+        snprintf(reply, sizeof(reply),
+                 "{\"id\":%s,\"result\":{\"version-rolling\":true,"
+                 "\"version-rolling.mask\":\"%08x\"},\"error\":null}\n", id, c->version_mask);
+        send_line(c->fd, reply);
+    } else if (strstr(line, "\"mining.subscribe\"")) {
+        c->extranonce1 = g_next_extranonce1++;
+        snprintf(reply, sizeof(reply),
+                 "{\"id\":%s,\"result\":[[[\"mining.notify\",\"%08x\"]],\"%08x\",4],\"error\":null}\n",
+                 id, c->extranonce1, c->extranonce1);
+        send_line(c->fd, reply);
+    } else if (strstr(line, "\"mining.extranonce.subscribe\"")) {
+        snprintf(reply, sizeof(reply), "{\"id\":%s,\"result\":true,\"error\":null}\n", id);
+        send_line(c->fd, reply);
+    } else if (strstr(line, "\"mining.authorize\"")) {
+        c->authorized = true;
+        snprintf(reply, sizeof(reply), "{\"id\":%s,\"result\":true,\"error\":null}\n", id);
+        send_line(c->fd, reply);
+        send_line(c->fd, "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[1024]}\n");
+        send_notify(c->fd, 1);
+    } else if (strstr(line, "\"mining.submit\"")) {
+        c->submits++;
+        int64_t bits = submit_version_bits(line);
+        if (bits >= 0) c->rolled_submits++;
+        if (bits >= 0 && (!c->version_mask || (bits & ~(int64_t)c->version_mask))) {
+            c->rejected++;
+            snprintf(reply, sizeof(reply),
+                     "{\"id\":%s,\"result\":false,\"error\":[20,\"Invalid version bits\",null]}\n", id);
+        } else {
+            snprintf(reply, sizeof(reply), "{\"id\":%s,\"result\":true,\"error\":null}\n", id);
+        }
+        if (delay_ms > 0 && g_num_delayed < MAX_DELAYED) {
+            delayed_reply_t *r = &g_delayed[g_num_delayed++];
+            r->fd = c->fd;
+            r->due_ns = now_ns() + (uint64_t)delay_ms * 1000000ULL;
+            snprintf(r->line, sizeof(r->line), "%s", reply);
+        } else {
+            send_line(c->fd, reply);
+        }
+    } else {
+        snprintf(reply, sizeof(reply),
+                 "{\"id\":%s,\"result\":null,\"error\":[20,\"Unsupported method\",null]}\n", id);
+        send_line(c->fd, reply);
+    }
+}
+
+static void drop_client(int epfd, pool_client_t *c) {
+    printf("Client fd %d disconnected (%llu submits, %llu with version bits, %llu rejected)\n",
+           c->fd, (unsigned long long)c->submits, (unsigned long long)c->rolled_submits,
+           (unsigned long long)c->rejected);
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+
+    // Forget its pending replies
+    for (int i = 0; i < g_num_delayed; ) {
+        if (g_delayed[i].fd == c->fd) {
+            g_delayed[i] = g_delayed[--g_num_delayed];
+        } else {
+            i++;
+        }
+    }
+    c->fd = -1;
+}
+
+static void read_client(int epfd, pool_client_t *c, int delay_ms) {
+    for (;;) {
+        ssize_t n = recv(c->fd, c->rx + c->rx_len, sizeof(c->rx) - c->rx_len - 1, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            drop_client(epfd, c);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        c->rx_len += n;
+        c->rx[c->rx_len] = '\0';
+
+        char *start = c->rx;
+        char *nl;
+        while ((nl = strchr(start, '\n')) != NULL) {
+            *nl = '\0';
+            handle_request(c, start, delay_ms);
+            start = nl + 1;
+        }
+        c->rx_len -= start - c->rx;
+        memmove(c->rx, start, c->rx_len);
+        if (c->rx_len == sizeof(c->rx) - 1) {
+            fprintf(stderr, "Client fd %d: line too long\n", c->fd);
+            drop_client(epfd, c);
+            return;
+        }
+    }
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("\n");
+    printf("Local Stratum v1 stand-in pool for client testing\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -p PORT     Listen port (default: 3333)\n");
+    printf("  -n MS       Interval between mining.notify (default: 1000)\n");
+    printf("  -c N        Send clean_jobs on every Nth notify (default: 10)\n");
+    printf("  -d MS       Delay submit responses by MS (default: 0)\n");
+    printf("  -V          Refuse version rolling (mining.configure)\n");
+    printf("  -h          Show this help\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  %s -p 3333 -n 200 -d 20 &\n", prog);
+    printf("  bm1398_bench stratum -o 127.0.0.1:3333 -s 10\n");
+}
+
+int main(int argc, char *argv[]) {
+    int port = 3333;
+    int notify_ms = 1000;
+    int clean_every = 10;
+    int delay_ms = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:n:c:d:Vh")) != -1) {
+        switch (opt) {
+        case 'p': port = atoi(optarg); break;
+        case 'n': notify_ms = atoi(optarg); break;
+        case 'c': clean_every = atoi(optarg); break;
+        case 'd': delay_ms = atoi(optarg); break;
+        case 'V': g_version_rolling = false; break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (notify_ms <= 0) notify_ms = 1000;
+    if (clean_every <= 0) clean_every = 1;
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int one = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY)
+    };
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 16) < 0) {
+        fprintf(stderr, "Error: Cannot listen on port %d: %s\n", port, strerror(errno));
+        return 1;
+    }
+
+    int epfd = epoll_create1(0);
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = lfd };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev);
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        g_clients[i].fd = -1;
+    }
+
+    printf("Stratum stand-in pool on port %d (notify every %d ms, submit delay %d ms)\n",
+           port, notify_ms, delay_ms);
+
+    uint64_t next_notify = now_ns() + (uint64_t)notify_ms * 1000000ULL;
+
+    while (g_running) {
+        struct epoll_event events[16];
+        int n = epoll_wait(epfd, events, 16, 1);
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == lfd) {
+                int cfd;
+                while ((cfd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+                    pool_client_t *c = find_client(-1);
+                    if (!c) {
+                        close(cfd);
+                        continue;
+                    }
+                    memset(c, 0, sizeof(*c));
+                    c->fd = cfd;
+                    setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    ev = (struct epoll_event){ .events = EPOLLIN, .data.fd = cfd };
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &ev);
+                    printf("Client fd %d connected\n", cfd);
+                }
+                continue;
+            }
+            pool_client_t *c = find_client(fd);
+            if (c) read_client(epfd, c, delay_ms);
+        }
+
+        uint64_t now = now_ns();
+
+        for (int i = 0; i < g_num_delayed; ) {
+            if (g_delayed[i].due_ns <= now) {
+                send_line(g_delayed[i].fd, g_delayed[i].line);
+                g_delayed[i] = g_delayed[--g_num_delayed];
+            } else {
+                i++;
+            }
+        }
+
+        if (now >= next_notify) {
+            g_job_id++;
+            int clean = (g_job_id % clean_every) == 0;
+            for (int i = 0; i < MAX_CLIENTS; i++) {
+                if (g_clients[i].fd >= 0 && g_clients[i].authorized) {
+                    send_notify(g_clients[i].fd, clean);
+                }
+            }
+            next_notify += (uint64_t)notify_ms * 1000000ULL;
+        }
+    }
+
+    printf("\nShutting down (%u jobs sent)\n", g_job_id + 1);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (g_clients[i].fd >= 0) close(g_clients[i].fd);
+    }
+    close(lfd);
+    close(epfd);
+    return 0;
+}
@@ -0,0 +1,332 @@
+/*
+ * Work Dispatch - per-chain work submission threads for BM1398 chains
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include "../include/work_dispatch.h"
+
+#define DEQUE_MASK  (WORK_DISPATCH_DEQUE_SLOTS - 1)
+#define POOL_MASK   (WORK_DISPATCH_POOL_SLOTS - 1)
+
+static uint64_t dispatch_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//==============================================================================
+// Work-stealing deque
+//==============================================================================
+
+static void deque_init(work_deque_t *q) {
+    atomic_init(&q->top, 0);
+    atomic_init(&q->bottom, 0);
+    for (int i = 0; i < WORK_DISPATCH_DEQUE_SLOTS; i++) {
+        atomic_init(&q->slots[i], NULL);
+    }
+}
+
+// Owner only. Returns -1 when full.
+static int deque_push(work_deque_t *q, dispatch_work_t *work) {
+    int64_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&q->top, memory_order_acquire);
+
+    if (b - t >= WORK_DISPATCH_DEQUE_SLOTS) {
+        return -1;
+    }
+    atomic_store_explicit(&q->slots[b & DEQUE_MASK], work, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    return 0;
+}
+
+// Owner only
+static dispatch_work_t *deque_pop(work_deque_t *q) {
+    int64_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&q->top, memory_order_relaxed);
+
+    if (t > b) {
+        // Empty
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    dispatch_work_t *work = atomic_load_explicit(&q->slots[b & DEQUE_MASK], memory_order_relaxed);
+    if (t == b) {
+        // Last item: race any thief for it
+        if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            work = NULL;
+        }
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    }
+    return work;
+}
+
+// Any thread. NULL if empty or another thief won.
+static dispatch_work_t *deque_steal(work_deque_t *q) {
+    int64_t t = atomic_load_explicit(&q->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return NULL;
+    }
+
+    dispatch_work_t *work = atomic_load_explicit(&q->slots[t & DEQUE_MASK], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return work;
+}
+
+int work_dispatch_queue_depth(const dispatch_chain_t *c) {
+    int64_t b = atomic_load_explicit(&c->deque.bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&c->deque.top, memory_order_relaxed);
+    return b > t ? (int)(b - t) : 0;
+}
+
+//==============================================================================
+// Shared pool
+//==============================================================================
+
+int work_dispatch_submit(work_dispatch_t *d, dispatch_work_t *work) {
+    pthread_mutex_lock(&d->pool_lock);
+    if (d->pool_head - d->pool_tail >= WORK_DISPATCH_POOL_SLOTS) {
+        d->pool_full++;
+        pthread_mutex_unlock(&d->pool_lock);
+        return -1;
+    }
+    d->pool[d->pool_head++ & POOL_MASK] = work;
+    d->submitted++;
+    pthread_cond_signal(&d->pool_cond);
+    pthread_mutex_unlock(&d->pool_lock);
+    return 0;
+}
+
+int work_dispatch_pool_depth(work_dispatch_t *d) {
+    pthread_mutex_lock(&d->pool_lock);
+    int depth = (int)(d->pool_head - d->pool_tail);
+    pthread_mutex_unlock(&d->pool_lock);
+    return depth;
+}
+
+// Move up to WORK_DISPATCH_REFILL works from the pool into the chain's deque
+static int pool_refill(work_dispatch_t *d, dispatch_chain_t *c) {
+    int moved = 0;
+
+    pthread_mutex_lock(&d->pool_lock);
+    while (moved < WORK_DISPATCH_REFILL && d->pool_tail != d->pool_head) {
+        if (deque_push(&c->deque, d->pool[d->pool_tail & POOL_MASK]) < 0) {
+            break;
+        }
+        d->pool_tail++;
+        moved++;
+    }
+    pthread_mutex_unlock(&d->pool_lock);
+
+    if (moved) c->refills++;
+    return moved;
+}
+
+// Steal one work from the chain with the deepest queue
+static dispatch_work_t *steal_work(work_dispatch_t *d, dispatch_chain_t *self) {
+    dispatch_chain_t *victim = NULL;
+    int deepest = 0;
+
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        dispatch_chain_t *c = &d->chains[i];
+        if (c == self || !c->active) continue;
+        int depth = work_dispatch_queue_depth(c);
+        if (depth > deepest) {
+            deepest = depth;
+            victim = c;
+        }
+    }
+    return victim ? deque_steal(&victim->deque) : NULL;
+}
+
+//==============================================================================
+// Chain submission threads
+//==============================================================================
+
+static void *dispatch_chain_thread(void *arg) {
+    dispatch_chain_t *c = arg;
+    work_dispatch_t *d = c->d;
+
+    while (d->running) {
+        dispatch_work_t *work = deque_pop(&c->deque);
+        if (!work && pool_refill(d, c) > 0) {
+            work = deque_pop(&c->deque);
+        }
+        if (!work && (work = steal_work(d, c)) != NULL) {
+            c->stolen++;
+        }
+
+        if (!work) {
+            // Nothing anywhere: sleep until a producer submits
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += WORK_DISPATCH_IDLE_US * 1000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_mutex_lock(&d->pool_lock);
+            if (d->running && d->pool_tail == d->pool_head) {
+                c->idle_waits++;
+                pthread_cond_timedwait(&d->pool_cond, &d->pool_lock, &deadline);
+            }
+            pthread_mutex_unlock(&d->pool_lock);
+            continue;
+        }
+
+        uint32_t work_id = c->next_work_id;
+        c->next_work_id = (c->next_work_id + 1) & WORK_DISPATCH_ID_MASK;
+        bm1398_work_set_id(&work->packet, c->chain, work_id);
+
+        // Blocks in FIFO backpressure; other chains keep stealing meanwhile
+        if (bm1398_send_prepared_work(d->ctx, c->chain, &work->packet) < 0) {
+            c->send_errors++;
+            if (d->done) d->done(d->done_arg, work, -1, 0);
+            continue;
+        }
+        c->sent++;
+        if (d->done) d->done(d->done_arg, work, c->chain, work_id);
+    }
+    return NULL;
+}
+
+//==============================================================================
+// Lifecycle
+//==============================================================================
+
+int work_dispatch_init(work_dispatch_t *d, bm1398_context_t *ctx, uint32_t chain_mask,
+                       dispatch_done_fn done, void *done_arg) {
+    memset(d, 0, sizeof(*d));
+    if (!ctx || (chain_mask & ((1U << MAX_CHAINS) - 1)) == 0) {
+        return -1;
+    }
+
+    d->ctx = ctx;
+    d->done = done;
+    d->done_arg = done_arg;
+    pthread_mutex_init(&d->pool_lock, NULL);
+    pthread_cond_init(&d->pool_cond, NULL);
+
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        dispatch_chain_t *c = &d->chains[i];
+        deque_init(&c->deque);
+        c->d = d;
+        c->chain = i;
+        c->active = (chain_mask >> i) & 1;
+    }
+    return 0;
+}
+
+int work_dispatch_start(work_dispatch_t *d) {
+    uint64_t now = dispatch_now_ns();
+
+    d->running = true;
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        dispatch_chain_t *c = &d->chains[i];
+        if (!c->active) continue;
+
+        c->last_report_ns = now;
+        if (pthread_create(&c->thread, NULL, dispatch_chain_thread, c) != 0) {
+            fprintf(stderr, "Error: Failed to start dispatch thread for chain %d\n", i);
+            c->active = false;
+            work_dispatch_stop(d);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void work_dispatch_stop(work_dispatch_t *d) {
+    if (!d->running) {
+        return;
+    }
+
+    pthread_mutex_lock(&d->pool_lock);
+    d->running = false;
+    pthread_cond_broadcast(&d->pool_cond);
+    pthread_mutex_unlock(&d->pool_lock);
+
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        if (d->chains[i].active) {
+            pthread_join(d->chains[i].thread, NULL);
+        }
+    }
+}
+
+int work_dispatch_flush(work_dispatch_t *d) {
+    int flushed = 0;
+
+    pthread_mutex_lock(&d->pool_lock);
+    while (d->pool_tail != d->pool_head) {
+        dispatch_work_t *work = d->pool[d->pool_tail++ & POOL_MASK];
+        if (d->done) d->done(d->done_arg, work, -1, 0);
+        flushed++;
+    }
+    pthread_mutex_unlock(&d->pool_lock);
+
+    // Deques are emptied from the top, as a thief would
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        dispatch_chain_t *c = &d->chains[i];
+        while (work_dispatch_queue_depth(c) > 0) {
+            dispatch_work_t *work = deque_steal(&c->deque);
+            if (work) {
+                if (d->done) d->done(d->done_arg, work, -1, 0);
+                flushed++;
+            }
+        }
+    }
+    return flushed;
+}
+
+void work_dispatch_destroy(work_dispatch_t *d) {
+    work_dispatch_stop(d);
+    work_dispatch_flush(d);
+    pthread_cond_destroy(&d->pool_cond);
+    pthread_mutex_destroy(&d->pool_lock);
+}
+
+void work_dispatch_print_stats(work_dispatch_t *d) {
+    uint64_t now = dispatch_now_ns();
+
+    printf("Work dispatch: %llu submitted, pool %d/%d (full %llu times)\n",
+           (unsigned long long)d->submitted, work_dispatch_pool_depth(d),
+           WORK_DISPATCH_POOL_SLOTS, (unsigned long long)d->pool_full);
+
+    for (int i = 0; i < MAX_CHAINS; i++) {
+        dispatch_chain_t *c = &d->chains[i];
+        if (!c->active) continue;
+
+        uint64_t sent = c->sent;
+        double secs = (now - c->last_report_ns) / 1e9;
+        double rate = secs > 0 ? (sent - c->last_sent) / secs : 0;
+        c->last_sent = sent;
+        c->last_report_ns = now;
+
+        bm1398_work_flow_t flow;
+        bm1398_get_work_flow_stats(d->ctx, i, &flow);
+
+        printf("  Chain %d: %8.0f works/s, queue %2d, sent %llu, stolen %llu, refills %llu, "
+               "idle %llu, errors %llu, backpressure %.1f ms\n",
+               i, rate, work_dispatch_queue_depth(c), (unsigned long long)sent,
+               (unsigned long long)c->stolen, (unsigned long long)c->refills,
+               (unsigned long long)c->idle_waits, (unsigned long long)c->send_errors,
+               flow.backpressure_ns / 1e6);
+    }
+}
@@ -0,0 +1,310 @@
+/*
+ * Work Prefetch - background work generation for the dispatcher
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "../include/work_prefetch.h"
+
+static uint64_t prefetch_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t prefetch_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//==============================================================================
+// Work items
+//==============================================================================
+
+static dispatch_work_t *item_get(work_prefetch_t *p) {
+    dispatch_work_t *work = NULL;
+
+    pthread_mutex_lock(&p->lock);
+    if (p->num_free > 0) {
+        work = p->free[--p->num_free];
+    }
+    pthread_mutex_unlock(&p->lock);
+    return work;
+}
+
+// Back onto the free list, bumping the given counter under the same lock
+static void item_put(work_prefetch_t *p, dispatch_work_t *work, uint64_t *count) {
+    pthread_mutex_lock(&p->lock);
+    p->free[p->num_free++] = work;
+    if (count) {
+        (*count)++;
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+void work_prefetch_done(void *arg, dispatch_work_t *work, int chain, uint32_t work_id) {
+    work_prefetch_t *p = arg;
+
+    if (chain >= 0 && p->pool && p->table) {
+        work_table_record(p->table, chain, work_id, work->user);
+    }
+
+    item_put(p, work, chain < 0 ? &p->stats.flushed : NULL);
+}
+
+//==============================================================================
+// Work generation (prefetch thread)
+//==============================================================================
+
+// Local work source without a pool: random header tail/midstate
+static void build_local_work(work_prefetch_t *p, dispatch_work_t *work) {
+    uint8_t data[12];
+    uint8_t midstate[32];
+
+    for (int i = 0; i < 12; i++) {
+        p->seed = p->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = (uint8_t)(p->seed >> 56);
+    }
+    for (int i = 0; i < 32; i++) {
+        p->seed = p->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        midstate[i] = (uint8_t)(p->seed >> 56);
+    }
+    bm1398_prepare_work(&work->packet, 0, 0, data, midstate, 1);
+    work->job_id = (uint32_t)p->stats.generated;
+}
+
+// Coinbase and merkle root for the next extranonce2 (little-endian counter)
+static void next_extranonce2(work_prefetch_t *p) {
+    uint8_t extranonce2[STRATUM_MAX_EXTRANONCE] = {0};
+
+    for (int i = 0; i < p->job.extranonce2_size && i < 8; i++) {
+        extranonce2[i] = (uint8_t)(p->extranonce2 >> (i * 8));
+    }
+    p->extranonce2++;
+    p->roll = 0;
+    stratum_template_set_extranonce2(&p->tpl, extranonce2);
+    p->stats.extranonce2s++;
+}
+
+// Next version roll of the current extranonce2, then the next extranonce2
+static void build_pool_work(work_prefetch_t *p, dispatch_work_t *work) {
+    work_info_t *info = work->user;
+    uint8_t data[12];
+    uint8_t midstates[STRATUM_MIDSTATES][32];
+    int count;
+
+    while ((count = stratum_template_work(&p->tpl, p->roll, data, midstates,
+                                          info->versions)) < 0) {
+        next_extranonce2(p);
+    }
+    p->roll++;
+
+    memcpy(info->job_id, p->job.job_id, sizeof(info->job_id));
+    info->job_seq = p->job.seq;
+    info->generation = p->generation;
+    memcpy(info->header, p->tpl.header, sizeof(info->header));
+    for (int i = 0; i < 4; i++) {
+        info->header[i] = (uint8_t)(info->versions[0] >> (i * 8));
+    }
+    info->midstates = count;
+    memcpy(info->extranonce2, p->tpl.extranonce2, sizeof(info->extranonce2));
+    info->extranonce2_len = p->job.extranonce2_size;
+    info->difficulty = p->job.difficulty;
+
+    bm1398_prepare_work(&work->packet, 0, 0, data, &midstates[0][0], count);
+    work->job_id = p->job.seq;
+}
+
+// New job from the pool client (already copied into p->job)
+static void start_job(work_prefetch_t *p) {
+    if (p->job.clean) {
+        // Old jobs are stale: drop queued work built from them, and let
+        // nonces still coming back for sent work resolve as stale
+        if (p->table) {
+            p->generation = work_table_new_generation(p->table);
+        }
+        work_dispatch_flush(p->dispatch);
+    }
+
+    // Chips must hash the 4 slots as 4 versions only while they differ
+    if (p->job.version_mask != p->asic_version_mask) {
+        for (int chain = 0; chain < MAX_CHAINS; chain++) {
+            if (p->chain_mask & (1U << chain)) {
+                bm1398_set_version_rolling(p->ctx, chain, p->job.version_mask);
+            }
+        }
+        p->asic_version_mask = p->job.version_mask;
+    }
+
+    stratum_template_init(&p->tpl, &p->job);
+    p->extranonce2 = 0;
+    next_extranonce2(p);
+    p->have_job = true;
+    p->first_work = true;
+    p->stats.jobs++;
+}
+
+static void *prefetch_thread(void *arg) {
+    work_prefetch_t *p = arg;
+    bool idle = true;                   // Last pass queued nothing
+
+    while (p->running) {
+        if (p->pool) {
+            // Waiting for a job doubles as the idle sleep
+            if (stratum_wait_job(p->pool, &p->job, &p->job_seq, idle ? WORK_PREFETCH_POLL_US : 0)) {
+                start_job(p);
+            }
+            if (!p->have_job) {
+                continue;
+            }
+        } else if (idle) {
+            usleep(WORK_PREFETCH_POLL_US);
+        }
+
+        int depth = work_dispatch_pool_depth(p->dispatch);
+        if (depth == 0 && p->stats.generated > 0) {
+            p->stats.starved++;
+        }
+
+        // Top up; stops early once every item is queued or in flight
+        dispatch_work_t *work;
+        uint64_t t0 = prefetch_cpu_ns();
+        idle = true;
+        while (depth < p->target && (work = item_get(p)) != NULL) {
+            if (p->pool) {
+                build_pool_work(p, work);
+            } else {
+                build_local_work(p, work);
+            }
+            if (work_dispatch_submit(p->dispatch, work) < 0) {
+                // Never sent: no work table entry, counted apart from flushes
+                item_put(p, work, &p->stats.rejected);
+                break;
+            }
+            depth++;
+            idle = false;
+            p->stats.generated++;
+
+            if (p->first_work) {
+                stratum_note_first_work(p->pool, &p->job);
+                p->first_work = false;
+            }
+        }
+        if (!idle) {
+            p->stats.build_ns += prefetch_cpu_ns() - t0;
+        }
+    }
+    return NULL;
+}
+
+//==============================================================================
+// Lifecycle
+//==============================================================================
+
+int work_prefetch_init(work_prefetch_t *p, bm1398_context_t *ctx, stratum_client_t *pool,
+                       work_table_t *table, uint32_t chain_mask, int per_chain) {
+    memset(p, 0, sizeof(*p));
+
+    int chains = __builtin_popcount(chain_mask & ((1U << MAX_CHAINS) - 1));
+    if (!ctx || chains == 0 || per_chain <= 0) {
+        return -1;
+    }
+
+    p->ctx = ctx;
+    p->pool = pool;
+    p->table = table;
+    p->chain_mask = chain_mask;
+    p->target = per_chain * chains;
+    if (p->target > WORK_DISPATCH_POOL_SLOTS) {
+        p->target = WORK_DISPATCH_POOL_SLOTS;
+    }
+    p->seed = (uint64_t)time(NULL);
+    if (table) {
+        p->generation = work_table_generation(table);
+    }
+
+    p->items = calloc(WORK_PREFETCH_ITEMS, sizeof(*p->items));
+    p->info = calloc(WORK_PREFETCH_ITEMS, sizeof(*p->info));
+    p->free = calloc(WORK_PREFETCH_ITEMS, sizeof(*p->free));
+    if (!p->items || !p->info || !p->free) {
+        free(p->items);
+        free(p->info);
+        free(p->free);
+        return -1;
+    }
+    for (int i = 0; i < WORK_PREFETCH_ITEMS; i++) {
+        p->items[i].user = &p->info[i];
+        p->free[i] = &p->items[i];
+    }
+    p->num_free = WORK_PREFETCH_ITEMS;
+    pthread_mutex_init(&p->lock, NULL);
+    return 0;
+}
+
+int work_prefetch_start(work_prefetch_t *p, work_dispatch_t *dispatch) {
+    p->dispatch = dispatch;
+    p->last_report_ns = prefetch_now_ns();
+    p->running = true;
+    if (pthread_create(&p->thread, NULL, prefetch_thread, p) != 0) {
+        fprintf(stderr, "Error: Failed to start work prefetch thread\n");
+        p->running = false;
+        return -1;
+    }
+    return 0;
+}
+
+void work_prefetch_stop(work_prefetch_t *p) {
+    if (p->running) {
+        p->running = false;
+        pthread_join(p->thread, NULL);
+    }
+}
+
+void work_prefetch_destroy(work_prefetch_t *p) {
+    work_prefetch_stop(p);
+    pthread_mutex_destroy(&p->lock);
+    free(p->items);
+    free(p->info);
+    free(p->free);
+}
+
+void work_prefetch_print_stats(work_prefetch_t *p) {
+    uint64_t now = prefetch_now_ns();
+    uint64_t cpu_ns = p->last_cpu_ns;
+    clockid_t cid;
+    struct timespec ts;
+
+    if (pthread_getcpuclockid(p->thread, &cid) == 0 && clock_gettime(cid, &ts) == 0) {
+        cpu_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    uint64_t generated = p->stats.generated;
+    uint64_t build_ns = p->stats.build_ns;
+    double secs = (now - p->last_report_ns) / 1e9;
+    double rate = secs > 0 ? (generated - p->last_generated) / secs : 0;
+    double cpu = secs > 0 ? (cpu_ns - p->last_cpu_ns) / 1e9 / secs : 0;
+    double build_us = generated > 0 ? build_ns / 1e3 / generated : 0;
+    p->last_generated = generated;
+    p->last_cpu_ns = cpu_ns;
+    p->last_report_ns = now;
+
+    printf("Work prefetch: %8.0f works/s, %.1f%% CPU, %.2f us/work, target %d, "
+           "%llu jobs, %llu extranonce2, %llu flushed, %llu rejected, %llu starved\n",
+           rate, cpu * 100, build_us, p->target,
+           (unsigned long long)p->stats.jobs, (unsigned long long)p->stats.extranonce2s,
+           (unsigned long long)p->stats.flushed, (unsigned long long)p->stats.rejected,
+           (unsigned long long)p->stats.starved);
+
+    // Each work covers 2^32 nonces per midstate on the chain it is sent to
+    if (p->pool && p->have_job && build_us > 0) {
+        double needed = WORK_PREFETCH_FULL_HASHRATE_GHS * 1e9 /
+                        (4294967296.0 * p->tpl.midstates);
+        printf("  Full hashrate (%.0f TH/s, %d midstates) needs %.0f works/s: %.1f%% of a core\n",
+               WORK_PREFETCH_FULL_HASHRATE_GHS / 1000, p->tpl.midstates, needed,
+               needed * build_us / 1e4);
+    }
+}
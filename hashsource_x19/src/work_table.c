@@ -0,0 +1,91 @@
+/*
+ * Work Table - in-flight work per chain, indexed by returned work_id
+ *
+ * Entry protocol (seqlock, one writer per chain row):
+ *   writer: seq += 1 (odd), release fence, write entry, store-release seq += 1
+ *   reader: load-acquire seq (retry if odd), copy, acquire fence, reload seq
+ * A copy is kept only if seq did not move while it was taken.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "../include/work_table.h"
+
+void work_table_init(work_table_t *t) {
+    memset(t, 0, sizeof(*t));
+    atomic_init(&t->generation, 0);
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        for (int i = 0; i < WORK_TABLE_SLOTS; i++) {
+            atomic_init(&t->entries[c][i].seq, 0);
+        }
+    }
+}
+
+uint32_t work_table_new_generation(work_table_t *t) {
+    return atomic_fetch_add_explicit(&t->generation, 1, memory_order_acq_rel) + 1;
+}
+
+void work_table_record(work_table_t *t, int chain, uint32_t work_id, const work_info_t *info) {
+    if (chain < 0 || chain >= MAX_CHAINS) {
+        return;
+    }
+
+    work_table_entry_t *e = &t->entries[chain][WORK_TABLE_SLOT(work_id)];
+    uint32_t seq = atomic_load_explicit(&e->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&e->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    e->work_id = work_id;
+    e->info = *info;
+    atomic_store_explicit(&e->seq, seq + 2, memory_order_release);
+    t->recorded[chain]++;
+}
+
+work_table_result_t work_table_lookup(work_table_t *t, const nonce_response_t *nonce,
+                                      work_info_t *info) {
+    if (nonce->chain_id >= MAX_CHAINS) {
+        return WORK_TABLE_BAD_CHAIN;
+    }
+
+    work_table_stats_t *s = &t->stats[nonce->chain_id];
+    work_table_entry_t *e = &t->entries[nonce->chain_id][WORK_TABLE_NONCE_SLOT(nonce->work_id)];
+    uint32_t seq;
+
+    s->lookups++;
+    for (;;) {
+        seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+        if (seq == 0) {
+            s->empty++;
+            return WORK_TABLE_EMPTY;
+        }
+        if (!(seq & 1)) {
+            *info = e->info;
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&e->seq, memory_order_relaxed) == seq) {
+                break;
+            }
+        }
+        s->retries++;
+    }
+
+    if (info->generation != work_table_generation(t)) {
+        s->stale++;
+        return WORK_TABLE_STALE;
+    }
+    s->hits++;
+    return WORK_TABLE_HIT;
+}
+
+void work_table_print_stats(work_table_t *t) {
+    printf("Work table (%d slots/chain, generation %u):\n",
+           WORK_TABLE_SLOTS, work_table_generation(t));
+    for (int c = 0; c < MAX_CHAINS; c++) {
+        work_table_stats_t *s = &t->stats[c];
+        if (t->recorded[c] == 0 && s->lookups == 0) continue;
+        printf("  Chain %d: %llu sent, %llu nonces: %llu current, %llu stale, %llu empty slot, "
+               "%llu retries\n",
+               c, (unsigned long long)t->recorded[c], (unsigned long long)s->lookups,
+               (unsigned long long)s->hits, (unsigned long long)s->stale,
+               (unsigned long long)s->empty, (unsigned long long)s->retries);
+    }
+}